@@ -38,8 +38,12 @@ struct act_args_fp16 {
  * @param dim     dimension vector
  * @param output  pointer to output vector
  * @param sum     final sum value of all exponentials
+ * @param L       length of each row (partial softmax variants, which work on n_heads*L rows)
+ * @param n_heads number of L x L matrices (partial softmax variants)
+ * @param maxes   vector where the max of each row is saved (can be NULL in the partial variants)
+ * @param sums    vector where the exponential sum of each row is saved (can be NULL in the partial variants)
 */
-struct softmax_args{
+struct softmax_args_fp16{
   struct blob_fp16 * input;
   struct blob_fp16 * output;
   int L;
@@ -48,6 +52,59 @@ struct softmax_args{
   fp16 * sums;
 };
 
+/**
+ * @brief Arguments for the row-wise softmax backward
+ * @param input   blob of the softmax input (diff only will be used)
+ * @param output  blob of the softmax output (data and diff will be used)
+ * @param n_rows  number of rows on which the softmax has been computed
+ * @param dim     length of each row
+*/
+struct softmax_bw_args_fp16{
+  struct blob_fp16 * input;
+  struct blob_fp16 * output;
+  int n_rows;
+  int dim;
+};
+
+/**
+ * @brief Selects the softmax algorithm (e.g. in the FP16 MHSA forward). The partial variants compute the exponentials in base 2 with v2f16 SIMD.
+ */
+#define SOFTMAX_ONLINE          0   // online softmax with fastexp_gist (pulp_softmax_fp16_fw_cl)
+#define SOFTMAX_PARTIAL         1   // 1/2^(eps_max*shift) with the FP16 bit-manipulated exponential
+#define SOFTMAX_PARTIAL_SHIFT   2   // 1/2^ceil(eps_max*shift), power-of-two exponentials only
+#define SOFTMAX_PARTIAL_APPROX  3   // Taylor's approximation of 1/2^(eps_max*shift)
+#define SOFTMAX_SIMPLE          4   // Taylor's approximation of 1/2^shift, without eps_max
+
+/**
+ * @brief Selects the implementation of the activations that need transcendental functions (GELU, SiLU)
+ */
+#define ACT_EXACT   0   // libm expf/erff: matches PyTorch
+#define ACT_APPROX  1   // v2f16 rational approximation of tanh: faster, less accurate
+
+/**
+ * @brief Structure for activation functions with a selectable exact/approximated implementation (GELU, SiLU)
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param approx ACT_EXACT or ACT_APPROX (the approximated mode is vectorized on v2f16)
+ */
+struct act_approx_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * output;
+    int approx;
+};
+
+/**
+ * @brief Structure for the LeakyReLU activation
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param negative_slope slope of the activation for negative inputs
+ */
+struct leakyrelu_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * output;
+    fp16 negative_slope;
+};
+
 
 
 /**
@@ -99,6 +156,118 @@ void pulp_relu_fp16_bw_cl( void * act_args_fp16 );
 
 
 
+/**
+ * @brief Forward pass function. Configure and pass a leakyrelu_args_fp16 structure pointer as argument.
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_fp16_fw_cl( void * leakyrelu_args_fp16 );
+
+/**
+ * @brief Backward pass function.
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_fp16_bw_cl( void * leakyrelu_args_fp16 );
+
+/**
+ * @brief Core function to implement the forward of leaky relu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_core_fw_fp16, &args)).
+ * @param leakyrelu_args_fp16 Input and output data (data only will be used)
+*/
+void leakyrelu_core_fw_fp16( void * leakyrelu_args_fp16 );
+
+/**
+ * @brief Core function to implement the backward of leaky relu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_core_bw_fp16, &args)).
+ * @param leakyrelu_args_fp16 Input and output data (gradients only will be used)
+*/
+void leakyrelu_core_bw_fp16( void * leakyrelu_args_fp16 );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_approx_args_fp16 structure pointer as argument.
+ * @param input Input for gelu.
+ * @param output Output of gelu.
+*/
+void pulp_gelu_fp16_fw_cl( void * act_approx_args_fp16 );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for gelu.
+ * @param output Output of gelu.
+*/
+void pulp_gelu_fp16_bw_cl( void * act_approx_args_fp16 );
+
+/**
+ * @brief Core function to implement the forward of gelu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, gelu_core_fw_fp16, &args)).
+ * @param act_approx_args_fp16 Input and output data (data only will be used)
+*/
+void gelu_core_fw_fp16( void * act_approx_args_fp16 );
+
+/**
+ * @brief Core function to implement the backward of gelu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, gelu_core_bw_fp16, &args)).
+ * @param act_approx_args_fp16 Input and output data (input data and gradients will be used)
+*/
+void gelu_core_bw_fp16( void * act_approx_args_fp16 );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_approx_args_fp16 structure pointer as argument.
+ * @param input Input for silu (swish).
+ * @param output Output of silu (swish).
+*/
+void pulp_silu_fp16_fw_cl( void * act_approx_args_fp16 );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for silu (swish).
+ * @param output Output of silu (swish).
+*/
+void pulp_silu_fp16_bw_cl( void * act_approx_args_fp16 );
+
+/**
+ * @brief Core function to implement the forward of silu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_fw_fp16, &args)).
+ * @param act_approx_args_fp16 Input and output data (data only will be used)
+*/
+void silu_core_fw_fp16( void * act_approx_args_fp16 );
+
+/**
+ * @brief Core function to implement the backward of silu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_bw_fp16, &args)).
+ * @param act_approx_args_fp16 Input and output data (input data and gradients will be used)
+*/
+void silu_core_bw_fp16( void * act_approx_args_fp16 );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_args_fp16 structure pointer as argument. Hardswish is piecewise polynomial, so it has no approximated mode.
+ * @param input Input for hardswish.
+ * @param output Output of hardswish.
+*/
+void pulp_hardswish_fp16_fw_cl( void * act_args_fp16 );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for hardswish.
+ * @param output Output of hardswish.
+*/
+void pulp_hardswish_fp16_bw_cl( void * act_args_fp16 );
+
+/**
+ * @brief Core function to implement the forward of hardswish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hardswish_core_fw_fp16, &args)).
+ * @param act_args_fp16 Input and output data (data only will be used)
+*/
+void hardswish_core_fw_fp16( void * act_args_fp16 );
+
+/**
+ * @brief Core function to implement the backward of hardswish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hardswish_core_bw_fp16, &args)).
+ * @param act_args_fp16 Input and output data (input data and gradients will be used)
+*/
+void hardswish_core_bw_fp16( void * act_args_fp16 );
+
+
+
 /**
  * @brief Forward pass function.
  * @param input Input for softmax.
@@ -111,4 +280,51 @@ void pulp_softmax_fp16_fw_cl( void * act_args_fp16 );
  * @param input Input for softmax.
  * @param output Output of softmax.
 */
-void pulp_softmax_fp16_bw_cl( void * act_args_fp16 );
\ No newline at end of file
+void pulp_softmax_fp16_bw_cl( void * act_args_fp16 );
+
+/**
+ * @brief Backward pass function of a row-wise softmax (n_rows x dim), parallelized over the rows. The dot product between output gradient and output of each row is computed once, so the cost is linear in the number of elements.
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_row_softmax_fp16_bw_cl( void * softmax_bw_args_fp16 );
+
+/**
+ * @brief Core function to implement the backward of the row-wise softmax (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, row_softmax_core_bw_fp16, &args)).
+ * @param softmax_bw_args_fp16 Input and output data (gradients and output data will be used)
+*/
+void row_softmax_core_bw_fp16( void * softmax_bw_args_fp16 );
+
+/**
+ * @brief Forward pass function, partial algorithm with the Taylor's approximation of 1/2^x and no eps_max scaling. Forks partial_softmax_simple_core_fw_fp16 on the n_heads*L rows.
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_partial_softmax_simple_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief Core function of the simple partial softmax (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, partial_softmax_simple_core_fw_fp16, &args)).
+ * @param act_args structure of type softmax_args_fp16
+*/
+void partial_softmax_simple_core_fw_fp16( void * act_args );
+
+/**
+ * @brief Forward pass function using partial algorithm, parallelized over the n_heads*L rows (parallelize with pi_cl_team_fork). Exponentials use fastexp_gist_v2f16.
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_partial_softmax_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief Forward pass function using partial algorithm with power-of-two exponentials, parallelized over the n_heads*L rows (parallelize with pi_cl_team_fork).
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_partial_softmax_shift_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief Forward pass function using partial algorithm and taylor approximation, parallelized over the n_heads*L rows (parallelize with pi_cl_team_fork).
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_partial_softmax_approximate_fp16_fw_cl( void * act_args );
\ No newline at end of file
@@ -51,6 +51,50 @@ struct softmax_args{
   float * sums;
 };
 
+/**
+ * @brief Arguments for the row-wise softmax backward
+ * @param input   blob of the softmax input (diff only will be used)
+ * @param output  blob of the softmax output (data and diff will be used)
+ * @param n_rows  number of rows on which the softmax has been computed
+ * @param dim     length of each row
+*/
+struct softmax_bw_args{
+  struct blob * input;
+  struct blob * output;
+  int n_rows;
+  int dim;
+};
+
+/**
+ * @brief Selects the implementation of the activations that need transcendental functions (GELU, SiLU)
+ */
+#define ACT_EXACT   0   // libm expf/erff: matches PyTorch
+#define ACT_APPROX  1   // fastexp/fasttanh bit tricks: faster, less accurate
+
+/**
+ * @brief Structure for activation functions with a selectable exact/approximated implementation (GELU, SiLU)
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param approx ACT_EXACT or ACT_APPROX (GELU uses the tanh formulation in approximated mode)
+ */
+struct act_approx_args {
+    struct blob * input;
+    struct blob * output;
+    int approx;
+};
+
+/**
+ * @brief Structure for the LeakyReLU activation
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param negative_slope slope of the activation for negative inputs
+ */
+struct leakyrelu_args {
+    struct blob * input;
+    struct blob * output;
+    float negative_slope;
+};
+
 
 
 /**
@@ -102,6 +146,118 @@ void pulp_relu_fp32_bw_cl( void * act_args );
 
 
 
+/**
+ * @brief Forward pass function. Configure and pass a leakyrelu_args structure pointer as argument.
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_fp32_fw_cl( void * leakyrelu_args );
+
+/**
+ * @brief Backward pass function.
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_fp32_bw_cl( void * leakyrelu_args );
+
+/**
+ * @brief Core function to implement the forward of leaky relu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_core_fw_fp32, &args)).
+ * @param leakyrelu_args Input and output data (data only will be used)
+*/
+void leakyrelu_core_fw_fp32( void * leakyrelu_args );
+
+/**
+ * @brief Core function to implement the backward of leaky relu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_core_bw_fp32, &args)).
+ * @param leakyrelu_args Input and output data (gradients only will be used)
+*/
+void leakyrelu_core_bw_fp32( void * leakyrelu_args );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_approx_args structure pointer as argument.
+ * @param input Input for gelu.
+ * @param output Output of gelu.
+*/
+void pulp_gelu_fp32_fw_cl( void * act_approx_args );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for gelu.
+ * @param output Output of gelu.
+*/
+void pulp_gelu_fp32_bw_cl( void * act_approx_args );
+
+/**
+ * @brief Core function to implement the forward of gelu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, gelu_core_fw_fp32, &args)).
+ * @param act_approx_args Input and output data (data only will be used)
+*/
+void gelu_core_fw_fp32( void * act_approx_args );
+
+/**
+ * @brief Core function to implement the backward of gelu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, gelu_core_bw_fp32, &args)).
+ * @param act_approx_args Input and output data (input data and gradients will be used)
+*/
+void gelu_core_bw_fp32( void * act_approx_args );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_approx_args structure pointer as argument.
+ * @param input Input for silu (swish).
+ * @param output Output of silu (swish).
+*/
+void pulp_silu_fp32_fw_cl( void * act_approx_args );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for silu (swish).
+ * @param output Output of silu (swish).
+*/
+void pulp_silu_fp32_bw_cl( void * act_approx_args );
+
+/**
+ * @brief Core function to implement the forward of silu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_fw_fp32, &args)).
+ * @param act_approx_args Input and output data (data only will be used)
+*/
+void silu_core_fw_fp32( void * act_approx_args );
+
+/**
+ * @brief Core function to implement the backward of silu (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_bw_fp32, &args)).
+ * @param act_approx_args Input and output data (input data and gradients will be used)
+*/
+void silu_core_bw_fp32( void * act_approx_args );
+
+
+
+/**
+ * @brief Forward pass function. Configure and pass a act_args structure pointer as argument. Hardswish is piecewise polynomial, so it has no approximated mode.
+ * @param input Input for hardswish.
+ * @param output Output of hardswish.
+*/
+void pulp_hardswish_fp32_fw_cl( void * act_args );
+
+/**
+ * @brief Backward pass function. Uses the input data, so the forward input must be still available.
+ * @param input Input for hardswish.
+ * @param output Output of hardswish.
+*/
+void pulp_hardswish_fp32_bw_cl( void * act_args );
+
+/**
+ * @brief Core function to implement the forward of hardswish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hardswish_core_fw_fp32, &args)).
+ * @param act_args Input and output data (data only will be used)
+*/
+void hardswish_core_fw_fp32( void * act_args );
+
+/**
+ * @brief Core function to implement the backward of hardswish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hardswish_core_bw_fp32, &args)).
+ * @param act_args Input and output data (input data and gradients will be used)
+*/
+void hardswish_core_bw_fp32( void * act_args );
+
+
+
 /**
  * @brief Forward pass function.
  * @param input Input for softmax.
@@ -116,6 +272,19 @@ void pulp_softmax_fp32_fw_cl( void * act_args );
 */
 void pulp_softmax_fp32_bw_cl( void * act_args );
 
+/**
+ * @brief Backward pass function of a row-wise softmax (n_rows x dim), parallelized over the rows. The dot product between output gradient and output of each row is computed once, so the cost is linear in the number of elements.
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_row_softmax_fp32_bw_cl( void * softmax_bw_args );
+
+/**
+ * @brief Core function to implement the backward of the row-wise softmax (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, row_softmax_core_bw_fp32, &args)).
+ * @param softmax_bw_args Input and output data (gradients and output data will be used)
+*/
+void row_softmax_core_bw_fp32( void * softmax_bw_args );
+
 /**
  * @brief Forward pass function, second version using partial algorithm
  * @param input Input for softmax.
@@ -44,6 +44,7 @@
  * @param opt_matmul_type_ig number of the optimizer matmul to be chosen by the mm_manager for the input gradient primitive (see mm_manager_list.txt)
  * @param USE_IM2COL if set to 0, the convd kernel calls for the naive implementation, if set to 1 for the im2col+matmul optimized execution
  * @param USE_DMA_IM2COL in case the primitive uses IM2COL + MM, select if to perform im2col using DMA-managed transfers from L2 to L1 (input and output gradient tensors need to be stored in L2, im2col_buffer in L1)
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args_fp16). The input gradient has then to be computed before the weight gradient.
  */
 struct Conv2D_args_fp16 {
 	struct blob_fp16 * input; 
@@ -64,6 +65,7 @@ struct Conv2D_args_fp16 {
 	int opt_matmul_type_ig;
 	int USE_IM2COL;
 	int USE_DMA_IM2COL;
+	struct fused_update_args_fp16 * fused_update;
 };
 
 
@@ -35,6 +35,7 @@
  * @param Dpad lower padding
  * @param skip_in_grad skips the computation of the input grad (1st DNN layer)
  * @param HWC tells the DW Convolution if the input/output tensor is in CHW layout (HWC=0) or HWC format (HWC=1)
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args_fp16). The input gradient has then to be computed before the weight gradient.
  */
 struct DepthWise_Conv_args_fp16 {
 	struct blob_fp16 * input;
@@ -46,6 +47,7 @@ struct DepthWise_Conv_args_fp16 {
 	int Dpad;
 	int skip_in_grad;
 	int HWC;
+	struct fused_update_args_fp16 * fused_update;
 };
 
 
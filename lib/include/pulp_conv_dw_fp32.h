@@ -34,6 +34,7 @@
  * @param Dpad lower padding
  * @param skip_in_grad skips the computation of the input grad (1st DNN layer)
  * @param HWC tells the DW Convolution if the input/output tensor is in CHW layout (HWC=0) or HWC format (HWC=1)
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args). The input gradient has then to be computed before the weight gradient.
  */
 struct DepthWise_Conv_args {
 	struct blob * input;
@@ -45,6 +46,7 @@ struct DepthWise_Conv_args {
 	int Dpad;
 	int skip_in_grad;
 	int HWC;
+	struct fused_update_args * fused_update;
 };
 
 
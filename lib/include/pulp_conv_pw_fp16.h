@@ -35,6 +35,7 @@
  * @param opt_matmul_type_ig number of the optimizer matmul to be chosen by the mm_manager for the input gradient primitive (see mm_manager_list.txt)
  * @param transpose_buffer buffer for the momentary transposition of input/weights/output gradient (according to the step)
  * @param HWC parameter to set HWC (=1) or CHW (=0) primitive for the PointWise Convolution
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args_fp16). The input gradient has then to be computed before the weight gradient.
  */
 struct PointWise_Conv_args_fp16 {
 	struct blob_fp16 * input; 
@@ -46,6 +47,7 @@ struct PointWise_Conv_args_fp16 {
 	int opt_matmul_type_wg;
 	int opt_matmul_type_ig;
 	int HWC;
+	struct fused_update_args_fp16 * fused_update;
 };
 
 
@@ -34,6 +34,7 @@
  * @param opt_matmul_type_wg number of the optimizer matmul to be chosen by the mm_manager for the weight gradient primitive (see mm_manager_list.txt)
  * @param opt_matmul_type_ig number of the optimizer matmul to be chosen by the mm_manager for the input gradient primitive (see mm_manager_list.txt)
  * @param HWC parameter to set HWC (=1) or CHW (=0) primitive for the PointWise Convolution
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args). The input gradient has then to be computed before the weight gradient.
  */
 struct PointWise_Conv_args {
 	struct blob * input; 
@@ -45,6 +46,7 @@ struct PointWise_Conv_args {
 	int opt_matmul_type_wg;
 	int opt_matmul_type_ig;
 	int HWC;
+	struct fused_update_args * fused_update;
 };
 
 
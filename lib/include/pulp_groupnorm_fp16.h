@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Authors: Giacomo Saporetti
+*/
+
+
+/**
+ * Group Norm layer configuration structure
+ */
+
+/**
+ * @brief small number used to avoid division by zero
+ */
+#define EPSILON 1e-10
+
+/**
+ * @brief small number added to the variance of each group (EPSILON underflows to zero in FP16, the statistics are computed in FP32 but the normalization is applied in FP16)
+ */
+#define GN_EPSILON_FP16 1e-5f
+
+/**
+ * @brief number of partial sums stored for each (group, spatial) tile: sum(x), sum(x^2), sum(gamma*dy), sum(gamma*dy*x)
+ */
+#define GN_PARTIALS 4
+
+/**
+ * @brief number of spatial tiles of each group, so that each core gets at least one (group, spatial) tile
+ */
+#define GN_N_TILES(G) (((G) >= NUM_CORES) ? 1 : (NUM_CORES + (G) - 1) / (G))
+
+/**
+ * @brief number of floats of the partials_buffer of a Group Norm layer with G groups
+ */
+#define GN_PARTIALS_SIZE(G) (GN_PARTIALS*(G)*GN_N_TILES(G))
+
+/**
+ * @brief Structure for Group Norm Training in FP16. The C channels are split in num_groups groups of C/num_groups contiguous channels (CHW layout), each normalized with its own mean and variance. num_groups=C is equivalent to Instance Norm.
+ * @param input input feauture maps for the group norm layer
+ * @param output output feature maps for the group norm layer
+ * @param coeff coefficients to compute normalization, bias are included (gamma[C], then beta[C], as in InstNorm_args)
+ * @param num_groups number of groups in which the channels are split (must divide C)
+ * @param skip_in_grad skips the computation of the input grad (1st DNN layer)
+ * @param partials_buffer L1 buffer of GN_PARTIALS_SIZE(num_groups) floats, where the cores store the partial sums of each tile (FP32 also in the FP16 layer, since sum(x^2) overflows FP16)
+ */
+struct GroupNorm_args_fp16 {
+	struct blob_fp16 * input;
+	struct blob_fp16 * output;
+	struct blob_fp16 * coeff;
+	int num_groups;
+	int skip_in_grad;
+	float * partials_buffer;
+};
+
+/**
+ * @brief Structure passed to the parallelized Group Norm kernels. Each group is split in n_tiles spatial tiles, so that all the cores work also when num_groups < NUM_CORES.
+ * @param gn_args pointer to the layer configuration structure
+ * @param partials partials_buffer of the layer, GN_PARTIALS*num_groups*n_tiles elements, containing the partial sums of each tile (in FP32, since sum(x^2) overflows FP16)
+ * @param n_tiles number of spatial tiles for each group
+ */
+struct GroupNorm_tile_args_fp16 {
+	struct GroupNorm_args_fp16 * gn_args;
+	float * partials;
+	int n_tiles;
+};
+
+/**
+ * @brief Forward function that sets up the tiling and forks the parallelized version
+ * @param (void *)  (struct GroupNorm_args_fp16 void_args)
+ */
+void pulp_groupnorm_fp16_fw_cl( void * GroupNorm_args_fp16 );
+
+/**
+ * @brief Backward function that computes both input and param gradients within a single fork
+ * @param (void *)  (struct GroupNorm_args_fp16 void_args)
+ */
+void pulp_groupnorm_fp16_bw_cl( void * GroupNorm_args_fp16 );
+
+/**
+ * @brief Backward param gradient function that sets up the tiling and forks the parallelized version
+ * @param (void *)  (struct GroupNorm_args_fp16 void_args)
+ */
+void pulp_groupnorm_fp16_bw_param_grads_cl( void * GroupNorm_args_fp16 );
+
+/**
+ * @brief Backward input gradient function that sets up the tiling and forks the parallelized version
+ * @param (void *)  (struct GroupNorm_args_fp16 void_args)
+ */
+void pulp_groupnorm_fp16_bw_input_grads_cl( void * GroupNorm_args_fp16 );
+
+/**
+ * @brief Real forward function parallelized on multicore over (group, spatial) tiles
+ * @param (void *)  (struct GroupNorm_tile_args_fp16 void_args)
+ */
+void pulp_groupnorm_parallelized_fp16_fw_cl( void * GroupNorm_tile_args_fp16 );
+/**
+ * @brief Real backward function parallelized on multicore, computing param gradients and (if not skipped) input gradients
+ * @param (void *)  (struct GroupNorm_tile_args_fp16 void_args)
+ */
+void pulp_groupnorm_parallelized_fp16_bw_cl( void * GroupNorm_tile_args_fp16 );
+/**
+ * @brief Real bacward function for input gradients parallelized on multicore over (group, spatial) tiles
+ * @param (void *)  (struct GroupNorm_tile_args_fp16 void_args)
+ */
+void pulp_groupnorm_parallelized_fp16_bw_input_grads_cl( void * GroupNorm_tile_args_fp16 );
+/**
+ * @brief Real bacward function for parameters gradients parallelized on multicore over channels
+ * @param (void *)  (struct GroupNorm_tile_args_fp16 void_args)
+ */
+void pulp_groupnorm_parallelized_fp16_bw_param_grads_cl( void * GroupNorm_tile_args_fp16 );
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Recurrent layer training functions, grouped into FW and BW
+*/
+
+/**
+ * Gated Recurrent Unit layer configuration structure
+ */
+
+/**
+ * @brief Structure for GRU Training in FP32 (PyTorch gate order, no biases):
+ *        [r, z] = sigm([x_t, h_(t-1)] * W_rz), n = tanh(x_t * W_xn + r * (h_(t-1) * W_hn)), h_t = (1 - z) * n + z * h_(t-1)
+ * @param input             Input sequence (N x K, H = N and W = K). Its diff receives the input gradients.
+ * @param state             Initial hidden state h_(-1) (M elements). Its diff (M elements) is used as support buffer by the backward and receives the gradient of h_(-1).
+ * @param output            Hidden states of all the timesteps (N x M, W = M). Its diff contains the gradients coming from the next layer.
+ * @param coeff             Concatenated weights of the gates ((K+M) x 3M): the first K rows multiply x_t, the last M rows h_(t-1). Columns are grouped as [r, z, n].
+ * @param gates             Activated gates r, z, n and the h_(t-1) * W_hn term of all the timesteps (N x 4M), saved for the backward.
+ * @param grad_buffer       Gradients of the gate pre-activations of one BPTT window, grouped as [r, z, n, h_(t-1) * W_hn] (bptt_window x 4M, or N x 4M for full BPTT).
+ * @param bptt_window       Truncated BPTT: the sequence is split in windows of bptt_window steps and no gradient flows between them (0 = full BPTT).
+ * @param approx            ACT_EXACT (expf/tanhf) or ACT_APPROX (fastexp_gist) gate activations.
+ */
+struct Gru_args {
+    struct blob * input;
+    struct blob * state;
+    struct blob * output;
+    struct blob * coeff;
+    float * gates;
+    float * grad_buffer;
+    int bptt_window;
+    int approx;
+};
+
+/**
+ * @brief Structure passed to the parallelized GRU BPTT kernel, selecting the window [t_start, t_stop) of the sequence.
+ * @param gru_args          Pointer to the layer configuration structure.
+ * @param t_start           First timestep of the window.
+ * @param t_stop            Last timestep of the window (excluded).
+ * @param accumulate        If 1, the weight gradients of the window are added to the ones of the windows already processed.
+ */
+struct Gru_bptt_args {
+    struct Gru_args * gru_args;
+    int t_start;
+    int t_stop;
+    int accumulate;
+};
+
+
+
+
+/**
+ * GRU layer training functions, grouped into FW and BW
+ */
+
+// FORWARD FUNCTIONS
+
+/**
+ * @brief Forward pass function over the whole sequence.
+ * @param Gru_args structure configuring the GRU layer.
+ */
+void pulp_gru_fp32_fw_cl(void * Gru_args);
+
+/**
+ * @brief Core function of the forward: a single fork for the whole sequence, parallelized over the hidden units with a barrier per timestep. Each core computes the gates of its units in one pass over the rows of the concatenated weights, then applies the gate activations and the state update.
+ * @param Gru_args structure configuring the GRU layer.
+ */
+void gru_core_fw_fp32(void * Gru_args);
+
+
+// BACKWARD FUNCTIONS
+
+/**
+ * @brief Backward pass function (backpropagation through time), computing weight gradients, input gradients and the initial state gradient. The windows are processed from the last one, one fork each.
+ * @param Gru_args structure configuring the GRU layer.
+ */
+void pulp_gru_fp32_bw_cl(void * Gru_args);
+
+/**
+ * @brief Core function of the BPTT on one window: the time loop (parallelized over the hidden units with a barrier per timestep) stores the gate gradients into grad_buffer, then weight and input gradients of the whole window are computed at once.
+ * @param Gru_bptt_args structure selecting the window.
+ */
+void gru_core_bw_fp32(void * Gru_bptt_args);
@@ -32,6 +32,7 @@
  * @param opt_matmul_type_fw number of the optimizer matmul to be chosen by the mm_manager for the forward primitive (see mm_manager_list.txt)
  * @param opt_matmul_type_wg number of the optimizer matmul to be chosen by the mm_manager for the weight gradient primitive (see mm_manager_list.txt)
  * @param opt_matmul_type_ig number of the optimizer matmul to be chosen by the mm_manager for the input gradient primitive (see mm_manager_list.txt)
+ * @param fused_update if not NULL, the weight gradient is not stored in coeff->diff but directly applied to the weights in tiles (fused backward-and-update, see fused_update_args_fp16). The input gradient has then to be computed before the weight gradient.
  */
 struct Linear_args_fp16 {
 	struct blob_fp16 * input; 
@@ -41,6 +42,7 @@ struct Linear_args_fp16 {
 	int opt_matmul_type_fw;
 	int opt_matmul_type_wg;
 	int opt_matmul_type_ig;
+	struct fused_update_args_fp16 * fused_update;
 };
 
 
@@ -29,17 +29,45 @@
  * @param output pointer to the blob structure of the output data to calculate the output gradient
  * @param target current sample's label
  * @param wr_loss variable to retrieve the value of the calculated loss
+ * @param delta threshold between the quadratic and linear regions of the Huber (delta) and Smooth L1 (beta) losses (1 if set to 0, as in PyTorch)
  */
 struct loss_args_fp16 {
     struct blob_fp16 * output;
     fp16 * target;
     fp16 * wr_loss;
+    fp16 delta;
+};
+
+/**
+ * @brief Selects the loss computed by the parallelized loss kernel
+ */
+#define LOSS_CROSSENTROPY           0   // -sum(target*log(output)), on probabilities
+#define LOSS_MSE                    1   // mean((output-target)^2)
+#define LOSS_L1                     2   // mean(|output-target|)
+#define LOSS_HUBER                  3   // quadratic below delta, linear above (nn.HuberLoss)
+#define LOSS_SMOOTHL1               4   // Huber divided by delta (nn.SmoothL1Loss)
+#define LOSS_BCE_LOGITS             5   // binary cross entropy on logits (nn.BCEWithLogitsLoss)
+#define LOSS_KLDIV                  6   // sum(target*(log(target)-output)), on log-probabilities
+#define LOSS_SOFTMAX_CROSSENTROPY   7   // fused log-softmax + cross entropy, on logits
+
+/**
+ * @brief Structure passed to the parallelized loss kernels. Each core reduces its slice of the output into partial sums, which are then combined with the cluster-wide reductions (pulp_team_sum, pulp_team_max).
+ * @param loss_args pointer to the loss configuration structure
+ * @param partials scratch buffer of NUM_CORES elements for the per-core partial sums
+ * @param loss_type loss to be computed (LOSS_CROSSENTROPY, LOSS_MSE, ...)
+ */
+struct loss_parallel_args_fp16 {
+    struct loss_args_fp16 * loss_args;
+    float * partials;
+    int loss_type;
 };
 
 
 
 /**
  * Loss functions
+ * All the losses are parallelized on NUM_CORES (to be called from a single core) and compute loss and output gradient in a single pass.
+ * The mean over the output elements is taken for MSE, L1, Huber, SmoothL1 and BCEWithLogits (reduction='mean'), while CrossEntropy and KLDiv sum over the output (batch size = 1).
  */
 
 /**
@@ -56,4 +84,66 @@ void pulp_CrossEntropyLoss_fp16( void * loss_args_fp16 );
  * @param target output label
  * @param wr_loss variable to retrieve the value of the calculated loss
  */
-void pulp_MSELoss_fp16( void * loss_args_fp16 );
\ No newline at end of file
+void pulp_MSELoss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Mean Absolute Error (L1) Loss function 
+ * @param output pointer to output data
+ * @param target output label
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ */
+void pulp_L1Loss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Huber Loss function (0.5*d^2 if |d| < delta, delta*(|d| - 0.5*delta) otherwise, with d = output - target)
+ * @param output pointer to output data
+ * @param target output label
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ * @param delta threshold of the quadratic region
+ */
+void pulp_HuberLoss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Smooth L1 Loss function (0.5*d^2/beta if |d| < beta, |d| - 0.5*beta otherwise, with d = output - target)
+ * @param output pointer to output data
+ * @param target output label
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ * @param delta threshold of the quadratic region (beta)
+ */
+void pulp_SmoothL1Loss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Binary Cross Entropy Loss function on logits, with the sigmoid fused in a numerically stable form 
+ * @param output pointer to output data (logits)
+ * @param target output label (probabilities)
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ */
+void pulp_BCEWithLogitsLoss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Kullback-Leibler divergence Loss function (e.g. for knowledge distillation), as nn.KLDivLoss(reduction='batchmean') with batch size = 1 
+ * @param output pointer to output data (log-probabilities, e.g. computed with a log-softmax)
+ * @param target output label (probabilities, e.g. the softmax of the teacher)
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ */
+void pulp_KLDivLoss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Fused (log-)Softmax and Cross Entropy Loss function. Takes the logits of the last layer (no separate softmax is needed), computes the loss with a max-shifted log-sum-exp and writes the output gradient as softmax*sum(target) - target (softmax - target for normalized targets), so that no softmax backward is needed.
+ * @param output pointer to output data (logits)
+ * @param target output label
+ * @param wr_loss variable to retrieve the value of the calculated loss
+ */
+void pulp_SoftmaxCrossEntropyLoss_fp16( void * loss_args_fp16 );
+
+/**
+ * @brief Real element-wise loss function parallelized on multicore (all the losses except the fused Softmax + Cross Entropy)
+ * @param (void *)  (struct loss_parallel_args_fp16 void_args)
+ */
+void pulp_loss_parallelized_fp16( void * loss_parallel_args_fp16 );
+
+/**
+ * @brief Real fused Softmax + Cross Entropy Loss function parallelized on multicore
+ * @param (void *)  (struct loss_parallel_args_fp16 void_args)
+ */
+void pulp_softmax_crossentropy_parallelized_fp16( void * loss_parallel_args_fp16 );
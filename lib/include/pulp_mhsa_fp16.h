@@ -41,6 +41,9 @@
  * @param temp_buffer       Support buffer used to save transposed matrices
  * @param grad              Support buffer used when calculating gradients for each computational head during MHSA backprop
  * @param head_buffer       Attention scores for every head
+ * @param causal            If 1, each query only attends to the keys up to its own position (autoregressive models)
+ * @param valid_len         Key-padding mask: keys at positions >= valid_len are padding and are masked out (0 = no padding)
+ * @param softmax_type      Softmax algorithm of the unmasked heads (SOFTMAX_ONLINE, SOFTMAX_PARTIAL, SOFTMAX_PARTIAL_SHIFT, SOFTMAX_PARTIAL_APPROX or SOFTMAX_SIMPLE, see pulp_act_fp16.h)
  * 
  */
 
@@ -79,6 +82,86 @@ struct Mhsa_args_fp16 {
     struct blob_fp16 * softmax_buffer;
     fp16 * maxes;
     fp16 * sums;
+    int causal;
+    int valid_len;
+    int softmax_type;
+};
+
+
+
+/**
+ * @brief Number of queries processed at once by the masked forward and backward. With a mask, temp_buffer must hold at least
+ * 3*L*H + MHSA_MASK_TILE*L elements in the forward (transposed Q, K and V chunks of a head and the scores of a block) and
+ * 4*L*H + MHSA_MASK_TILE*L in the backward (transposed Q gradient, K, V and attention map gradient, and the score gradient of a block)
+ */
+#ifndef MHSA_MASK_TILE
+#define MHSA_MASK_TILE 16
+#endif
+
+/**
+ * @brief Structure for the masked softmax of a block of queries in FP16, with causal and/or key-padding masks. The block's scores
+ * are computed by a matmul against the keys up to the last unmasked one of the block only.
+ * @param scores        Unscaled scores of the block (n_rows x n_keys), overwritten with the probabilities (zero on the masked keys)
+ * @param softmax       L x L softmax output of the head (one row per query), masked positions are set to zero
+ * @param maxes         Row-wise maxes of the scaled scores
+ * @param sums          Row-wise exponential sums
+ * @param L             Sequence length
+ * @param row0          Index of the first query of the block
+ * @param n_rows        Number of queries of the block
+ * @param n_keys        Number of keys of the block's scores (unmasked keys of its last query)
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_mask_args_fp16 {
+    fp16 * scores;
+    fp16 * softmax;
+    fp16 * maxes;
+    fp16 * sums;
+    int L;
+    int row0;
+    int n_rows;
+    int n_keys;
+    fp16 scaling;
+    int causal;
+    int valid_len;
+};
+
+/**
+ * @brief Structure for the masked backward of a head in FP16, with causal and/or key-padding masks. Only the unmasked entries
+ * of the softmax and grad rows are read and written.
+ * @param grad_tile     Probability gradient of the block (n_rows x n_keys), overwritten with the score gradient (zero on the masked keys)
+ * @param softmax       L x L softmax output of the head (one row per query)
+ * @param grad          L x L score gradient of the head (one row per query)
+ * @param q             Query chunk of the head (H x L)
+ * @param att_diff      Attention map gradient of the head (H x L)
+ * @param k_diff        Key gradient of the head (H x L)
+ * @param v_diff        Value gradient of the head (H x L)
+ * @param L             Sequence length
+ * @param H             Head dimension
+ * @param row0          Index of the first query of the block
+ * @param n_rows        Number of queries of the block
+ * @param n_keys        Number of keys of the block's tile (unmasked keys of its last query)
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_mask_bw_args_fp16 {
+    fp16 * grad_tile;
+    fp16 * softmax;
+    fp16 * grad;
+    fp16 * q;
+    fp16 * att_diff;
+    fp16 * k_diff;
+    fp16 * v_diff;
+    int L;
+    int H;
+    int row0;
+    int n_rows;
+    int n_keys;
+    fp16 scaling;
+    int causal;
+    int valid_len;
 };
 
 
@@ -96,6 +179,12 @@ struct Mhsa_args_fp16 {
  */
 void pulp_mhsa_fp16_fw_cl(void * Mhsa_args_fp16);
 
+/**
+ * @brief Masked softmax of a block of queries, parallelized over its rows (interleaved among the cores). Masked keys are skipped and their probabilities set to zero.
+ * @param mask_args structure of type mhsa_mask_args_fp16
+ */
+void mhsa_masked_softmax_fp16(void * mask_args);
+
 
 // BACKWARD FUNCTIONS
 
@@ -104,3 +193,17 @@ void pulp_mhsa_fp16_fw_cl(void * Mhsa_args_fp16);
  * @param Mhsa_args_fp16 structure configuring the MHSA layer.
  */
 void pulp_mhsa_fp16_bw_cl(void * Mhsa_args_fp16);
+
+/**
+ * @brief Masked softmax backward of a block of queries, parallelized over its rows (interleaved among the cores): turns grad_tile
+ * into the score gradient and saves it in the head's grad rows.
+ * @param mask_bw_args structure of type mhsa_mask_bw_args_fp16
+ */
+void mhsa_masked_softmax_bw_fp16(void * mask_bw_args);
+
+/**
+ * @brief Key and value gradients of a masked head, parallelized over the keys (interleaved among the cores). Each key only
+ * visits the queries attending to it.
+ * @param mask_bw_args structure of type mhsa_mask_bw_args_fp16
+ */
+void mhsa_masked_kv_bw_fp16(void * mask_bw_args);
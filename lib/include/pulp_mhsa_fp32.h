@@ -39,7 +39,12 @@
  * @param attention_map     Output of the MHSA module, pre-projection
  * @param temp_buffer       Support buffer used to save transposed matrices
  * @param grad              Support buffer used when calculating gradients for each computational head during MHSA backprop
- * @param head_buffer       Attention scores for every head
+ * @param head_buffer       Attention scores for every head. In the backward, its diff is a single L x L buffer for the score gradient of the current head
+ * @param lse               Row-wise log-sum-exp of the attention scores (n_heads x L), saved by the forward functions when not NULL
+ * @param causal            If 1, each query only attends to the keys up to its own position (autoregressive models)
+ * @param valid_len         Key-padding mask: keys at positions >= valid_len are padding and are masked out (0 = no padding)
+ * @param parallel_heads    If 1 and n_heads >= NUM_CORES, forward and backward fork once and assign whole heads to the cores, instead of splitting each small per-head matmul among them
+ * @param recompute_softmax If 1, the backward recomputes each head's softmax from qkv and lse into a single L x L softmax_buffer, instead of reading the n_heads x L x L probabilities saved in the forward
  * 
  */
 
@@ -62,6 +67,212 @@ struct Mhsa_args {
     float * partial_exp_sum;
     float * maxes;
     float * sums;
+    float * lse;
+    int causal;
+    int valid_len;
+    int parallel_heads;
+    int recompute_softmax;
+};
+
+
+
+/**
+ * @brief Number of keys processed at once by the tiled (flash) attention kernel
+ */
+#ifndef MHSA_FLASH_TILE
+#define MHSA_FLASH_TILE 16
+#endif
+
+/**
+ * @brief Number of queries processed at once by the masked forward and backward. With a mask, temp_buffer must hold at least
+ * 3*L*H + MHSA_MASK_TILE*L elements in the forward (transposed Q, K and V chunks of a head and the scores of a block) and
+ * 4*L*H + 2*MHSA_MASK_TILE*L in the backward (plus the transposed attention map gradient and the score gradient of a block)
+ */
+#ifndef MHSA_MASK_TILE
+#define MHSA_MASK_TILE 16
+#endif
+
+/**
+ * @brief Structure for the MHSA incremental decode (KV-cache inference) in FP32. K and V caches are F x max_len (head i at row i*H),
+ * so their rows are strided by max_len instead of the sequence length L of Mhsa_args.qkv. The keys and values of a causal forward
+ * over a prompt are copied into the caches with pulp_mhsa_fp32_prefill_cl.
+ * @param input             New token (E elements)
+ * @param output            Output for the new token (E elements)
+ * @param coeff_in          Weight for input projection (3F x E)
+ * @param coeff_out         Weight for output projection (E x F)
+ * @param k_cache           Key cache (F x max_len), the new token's key is appended at column cur_len
+ * @param v_cache           Value cache (F x max_len), the new token's value is appended at column cur_len
+ * @param qkv               Support buffer for the new token's query, key and value (3F elements)
+ * @param attention_map     Attention output of the new token, pre-projection (F elements)
+ * @param temp_buffer       Support buffer for the scores, of NUM_CORES*max_len elements
+ * @param n_heads           Number of heads
+ * @param max_len           Capacity of the caches
+ * @param cur_len           Number of tokens already stored in the caches, incremented by each decode step
+ * @param opt_matmul_type_fw Matmul type used for the projections
+ */
+struct Mhsa_decode_args {
+    struct blob * input;
+    struct blob * output;
+    struct blob * coeff_in;
+    struct blob * coeff_out;
+    float * k_cache;
+    float * v_cache;
+    float * qkv;
+    float * attention_map;
+    float * temp_buffer;
+    int n_heads;
+    int max_len;
+    int cur_len;
+    int opt_matmul_type_fw;
+};
+
+/**
+ * @brief Structure for the prefill of the decode caches in FP32
+ * @param mhsa_args     Structure of the causal forward over the prompt, whose qkv holds the keys and values (F x L each)
+ * @param dec_args      Structure configuring the decode steps, whose caches are filled
+ * @param n_tokens      Number of prompt tokens copied into the caches (at most L and max_len)
+ */
+struct mhsa_prefill_args {
+    struct Mhsa_args * mhsa_args;
+    struct Mhsa_decode_args * dec_args;
+    int n_tokens;
+};
+
+/**
+ * @brief Structure for the head-parallel MHSA kernels in FP32. Each core processes whole heads, one query row at a time,
+ * so only a few rows of temp_buffer are used by each core (L elements in the forward, 2*L in the backward).
+ * @param mhsa_args     Structure configuring the MHSA layer
+ * @param L             Sequence length
+ * @param H             Head dimension
+ * @param F             Hidden dimension of attention
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ */
+struct mhsa_heads_args {
+    struct Mhsa_args * mhsa_args;
+    int L;
+    int H;
+    int F;
+    float scaling;
+};
+
+/**
+ * @brief Structure for the masked softmax of a block of queries in FP32, with causal and/or key-padding masks. The block's scores
+ * are computed by a matmul against the keys up to the last unmasked one of the block only.
+ * @param scores        Unscaled scores of the block (n_rows x n_keys), overwritten with the probabilities (zero on the masked keys)
+ * @param softmax       L x L softmax output of the head (one row per query), masked positions are set to zero
+ * @param maxes         Row-wise maxes of the scaled scores
+ * @param sums          Row-wise exponential sums
+ * @param lse           Row-wise log-sum-exp of the head, saved for the backward if not NULL
+ * @param L             Sequence length
+ * @param row0          Index of the first query of the block
+ * @param n_rows        Number of queries of the block
+ * @param n_keys        Number of keys of the block's scores (unmasked keys of its last query)
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_mask_args {
+    float * scores;
+    float * softmax;
+    float * maxes;
+    float * sums;
+    float * lse;
+    int L;
+    int row0;
+    int n_rows;
+    int n_keys;
+    float scaling;
+    int causal;
+    int valid_len;
+};
+
+/**
+ * @brief Structure for the masked backward of a head in FP32, with causal and/or key-padding masks. Only the unmasked entries
+ * of the softmax and grad rows are read and written.
+ * @param scores        Unscaled scores of the block (n_rows x n_keys) if the softmax is recomputed, NULL if it was saved by the forward
+ * @param grad_tile     Probability gradient of the block (n_rows x n_keys), overwritten with the score gradient (zero on the masked keys)
+ * @param softmax       L x L softmax output of the head (one row per query)
+ * @param grad          L x L score gradient of the head (one row per query)
+ * @param lse           Row-wise log-sum-exp of the head, used when the softmax is recomputed
+ * @param q             Query chunk of the head (H x L)
+ * @param att_diff      Attention map gradient of the head (H x L)
+ * @param k_diff        Key gradient of the head (H x L)
+ * @param v_diff        Value gradient of the head (H x L)
+ * @param L             Sequence length
+ * @param H             Head dimension
+ * @param row0          Index of the first query of the block
+ * @param n_rows        Number of queries of the block
+ * @param n_keys        Number of keys of the block's tiles (unmasked keys of its last query)
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_mask_bw_args {
+    float * scores;
+    float * grad_tile;
+    float * softmax;
+    float * grad;
+    float * lse;
+    float * q;
+    float * att_diff;
+    float * k_diff;
+    float * v_diff;
+    int L;
+    int H;
+    int row0;
+    int n_rows;
+    int n_keys;
+    float scaling;
+    int causal;
+    int valid_len;
+};
+
+/**
+ * @brief Structure for the recomputation of a head's softmax in the MHSA backward, in FP32
+ * @param scores        L x L scores of the head (Q * Kt, one row per query), overwritten with the probabilities
+ * @param lse           Row-wise log-sum-exp of the head, saved by the forward
+ * @param L             Sequence length
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_recompute_args {
+    float * scores;
+    float * lse;
+    int L;
+    float scaling;
+    int causal;
+    int valid_len;
+};
+
+/**
+ * @brief Structure for the tiled (flash) attention kernel in FP32. Q, K and V are stored as in Mhsa_args (F x L, head i at row i*H).
+ * @param q             Pointer to the first element of Q
+ * @param k             Pointer to the first element of K
+ * @param v             Pointer to the first element of V
+ * @param attention_map Output of the attention heads (F x L), pre-projection
+ * @param lse           Row-wise log-sum-exp of the scaled scores (n_heads x L)
+ * @param scratch       Per-core support buffer of NUM_CORES*(H+MHSA_FLASH_TILE) elements
+ * @param L             Sequence length
+ * @param H             Head dimension
+ * @param n_heads       Number of heads
+ * @param scaling       Scaling factor applied to the scores (1/sqrt(H))
+ * @param causal        Causal mask flag
+ * @param valid_len     Number of non-padding keys (0 = no padding)
+ */
+struct mhsa_flash_args {
+    float * q;
+    float * k;
+    float * v;
+    float * attention_map;
+    float * lse;
+    float * scratch;
+    int L;
+    int H;
+    int n_heads;
+    float scaling;
+    int causal;
+    int valid_len;
 };
 
 
@@ -87,8 +298,90 @@ void pulp_mhsa_fp32_fw_cl(void * Mhsa_args);
 void pulp_mhsa_fp32_fw_cl_2(void * Mhsa_args);
 
 
+/**
+ * @brief Forward pass function, forked on PULP cluster, using tiled (flash) attention. The L x L score matrix is never stored:
+ * running max and sum are kept for each query while iterating over key tiles, and only the row-wise log-sum-exp is saved in lse.
+ * softmax_buffer, maxes and sums are not used; temp_buffer must hold at least NUM_CORES*(H+MHSA_FLASH_TILE) elements.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_flash_fp32_fw_cl(void * Mhsa_args);
+
+/**
+ * @brief Tiled attention kernel, parallelized over the (head, query) rows.
+ * @param flash_args structure of type mhsa_flash_args
+ */
+void mhsa_flash_core_fw_fp32(void * flash_args);
+
+/**
+ * @brief Head-parallel attention forward kernel: scores, softmax and product with V of whole heads. The probabilities are saved
+ * in softmax_buffer (n_heads x L x L) unless recompute_softmax is set, the log-sum-exp is saved in lse if not NULL.
+ * @param heads_args structure of type mhsa_heads_args
+ */
+void mhsa_heads_core_fw_fp32(void * heads_args);
+
+/**
+ * @brief Incremental decode step, forked on PULP cluster: projects a single new token, appends its key and value to the caches and
+ * attends to the cur_len+1 cached tokens. The cost is linear in the number of cached tokens. Returns without computing if the caches are full.
+ * Inside pulp_team_run, cur_len is incremented by core 0, followed by a barrier.
+ * @param Mhsa_decode_args structure configuring the decode step.
+ */
+void pulp_mhsa_fp32_decode_cl(void * Mhsa_decode_args);
+
+/**
+ * @brief Copies the keys and values of the first n_tokens of a causal forward into the decode caches, forked on PULP cluster, and sets cur_len to n_tokens (by core 0 only inside pulp_team_run).
+ * With the causal mask, the key and value of a token only depend on the token itself, so decoding can resume from the prompt.
+ * @param Mhsa_prefill_args structure of type mhsa_prefill_args
+ */
+void pulp_mhsa_fp32_prefill_cl(void * Mhsa_prefill_args);
+
+/**
+ * @brief Prefill kernel, copying the K and V rows into the caches, parallelized over the rows.
+ * @param Mhsa_prefill_args structure of type mhsa_prefill_args
+ */
+void mhsa_prefill_core_fp32(void * Mhsa_prefill_args);
+
+/**
+ * @brief Decode step attention kernel, parallelized over the heads.
+ * @param Mhsa_decode_args structure configuring the decode step.
+ */
+void mhsa_decode_core_fp32(void * Mhsa_decode_args);
+
+/**
+ * @brief Masked softmax of a block of queries, parallelized over its rows (interleaved among the cores). Masked keys are skipped and their probabilities set to zero.
+ * @param mask_args structure of type mhsa_mask_args
+ */
+void mhsa_masked_softmax_fp32(void * mask_args);
+
+/**
+ * @brief Recomputes the softmax probabilities of a head from its unscaled scores and the saved log-sum-exp, parallelized over the rows.
+ * @param recompute_args structure of type mhsa_recompute_args
+ */
+void mhsa_softmax_recompute_fp32(void * recompute_args);
+
+
 // BACKWARD FUNCTIONS
 
+/**
+ * @brief Head-parallel attention backward kernel: gradients of Q, K and V of whole heads, streaming over the query rows.
+ * The probabilities are read from softmax_buffer or, if recompute_softmax is set, recomputed from lse.
+ * @param heads_args structure of type mhsa_heads_args
+ */
+void mhsa_heads_core_bw_fp32(void * heads_args);
+
+/**
+ * @brief Masked softmax backward of a block of queries, parallelized over its rows (interleaved among the cores): recomputes the
+ * probabilities if scores is not NULL, then turns grad_tile into the score gradient and saves it in the head's grad rows.
+ * @param mask_bw_args structure of type mhsa_mask_bw_args
+ */
+void mhsa_masked_softmax_bw_fp32(void * mask_bw_args);
+
+/**
+ * @brief Key and value gradients of a masked head, parallelized over the keys (interleaved among the cores). Each key only
+ * visits the queries attending to it.
+ * @param mask_bw_args structure of type mhsa_mask_bw_args
+ */
+void mhsa_masked_kv_bw_fp32(void * mask_bw_args);
+
 /**
  * @brief Backward pass function, which internally calculate both weight gradient and input gradient.
  * @param Mhsa_args structure configuring the MHSA layer.
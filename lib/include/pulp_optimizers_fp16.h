@@ -34,6 +34,84 @@ struct optim_args_fp16 {
   fp16 learning_rate;
 };
 
+/**
+ * @brief Parameters for the stochastic-rounding gradient descent of a single layer. The FP32 result of each update is rounded to one of the two nearest FP16 values with probability proportional to its distance, so that updates smaller than half a FP16 ulp are not lost on average.
+ * @param weights blob of the weights (with their gradient inside)
+ * @param learning_rate the learning rate of the optimizer
+ * @param rng_state array of NUM_CORES PRNG states, one for each core (initialized with pulp_sr_seed_fp16)
+ */
+struct optim_sr_args_fp16 {
+  struct blob_fp16 * weights;
+  float learning_rate;
+  uint32_t * rng_state;
+};
+
+
+
+/**
+ * @brief Structure for the dynamic loss scaling of mixed-precision training (FP16 forward and backward, FP32 master weights). The output gradient is multiplied by scale before the backward, so that small gradients do not underflow in FP16. If any gradient overflows, the optimizer step is skipped and the scale is reduced, while after growth_interval steps without overflows the scale is increased.
+ * @param weights array of n_tensors blobs of the weights, whose gradients are checked for inf/NaN
+ * @param n_tensors number of parameter blobs
+ * @param output output blob of the DNN, whose gradient (computed by the loss) is scaled
+ * @param scale current loss scale, applied in FP32 (e.g. 32768 at the beginning of the training: larger scales overflow most FP16 gradients above 2)
+ * @param growth_factor factor multiplying the scale after growth_interval steps without overflows (e.g. 2)
+ * @param backoff_factor factor multiplying the scale when an overflow is found (e.g. 0.5)
+ * @param growth_interval number of consecutive steps without overflows after which the scale is increased
+ * @param good_steps number of consecutive steps without overflows (zero-initialized, updated by pulp_loss_scaler_update_fp16)
+ * @param overflow set to 1 by pulp_grad_overflow_check_fp16 if a gradient is inf/NaN (zero-initialized, reset by pulp_loss_scaler_update_fp16)
+ */
+struct loss_scaler_args_fp16 {
+  struct blob_fp16 ** weights;
+  int n_tensors;
+  struct blob_fp16 * output;
+  float scale;
+  float growth_factor;
+  float backoff_factor;
+  int growth_interval;
+  int good_steps;
+  int overflow;
+};
+
+/**
+ * @brief Structure for multi-tensor optimizers, which update a list of parameter blobs within a single fork. The work is split among the cores over the total number of elements, not per tensor.
+ * @param weights array of n_tensors blobs of the weights (with their gradient inside)
+ * @param first_moment array of n_tensors buffers (in FP32, also for FP16 weights) with the same size of the weights: velocity for momentum SGD, first moment for Adam/AdamW (zero-initialized, NULL if momentum=0 in SGD)
+ * @param second_moment array of n_tensors buffers (in FP32, also for FP16 weights) with the same size of the weights: second moment for Adam/AdamW (zero-initialized, unused by SGD)
+ * @param n_tensors number of parameter blobs to be updated
+ * @param learning_rate the learning rate of the optimizer
+ * @param momentum momentum of SGD (0 for plain gradient descent)
+ * @param beta1 decay rate of the first moment (Adam/AdamW)
+ * @param beta2 decay rate of the second moment (Adam/AdamW)
+ * @param epsilon term added to the denominator for numerical stability (Adam/AdamW)
+ * @param weight_decay L2 penalty added to the gradient (SGD, Adam) or decoupled weight decay (AdamW)
+ * @param step index of the current optimizer step, starting from 1 (Adam/AdamW bias correction). It is not incremented by the optimizer, since it is executed by all the cores.
+ * @param master_weights array of n_tensors FP32 master copies of the weights (mixed-precision training): the update is applied to the master weights, which are then cast into the FP16 weights. NULL to update the FP16 weights directly.
+ * @param scaler dynamic loss scaler (mixed-precision training): the gradients are unscaled inside the optimizer and the step is skipped if the scaler found an overflow. NULL if the loss is not scaled.
+ * @param rng_state array of NUM_CORES PRNG states (initialized with pulp_sr_seed_fp16) to stochastically round the updated FP16 weights, allowing FP16-only training without master weights. NULL to round to nearest.
+ * @param max_grad_norm threshold of the global L2 norm of the gradients (clip-by-global-norm, as torch.nn.utils.clip_grad_norm_). The norm of all the n_tensors gradients is reduced at the beginning of the optimizer fork and the gradients are scaled by max_grad_norm/norm inside the update when it is exceeded. 0 to disable the clipping.
+ * @param grad_norm variable to retrieve the global norm of the gradients before clipping (computed only if max_grad_norm > 0), NULL if not needed
+ * @param norm_partials scratch buffer of NUM_CORES elements in L1 for the reduction of the norm (needed if max_grad_norm > 0)
+ */
+struct optim_multi_args_fp16 {
+  struct blob_fp16 ** weights;
+  float ** first_moment;
+  float ** second_moment;
+  int n_tensors;
+  float learning_rate;
+  float momentum;
+  float beta1;
+  float beta2;
+  float epsilon;
+  float weight_decay;
+  int step;
+  float ** master_weights;
+  struct loss_scaler_args_fp16 * scaler;
+  uint32_t * rng_state;
+  float max_grad_norm;
+  float * grad_norm;
+  float * norm_partials;
+};
+
 
 
 /**
@@ -47,3 +125,97 @@ struct optim_args_fp16 {
 void pulp_gradient_descent_fp16(
     void * optim_args
 );
+
+/**
+ * @brief Gradient descent optimizer for a single layer, with stochastic rounding of the updated weights. Use pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_sr_fp16, &args) to parallelize.
+ * @param optim_sr_args_fp16 pointer to optim_sr_args_fp16 structure
+ */
+void pulp_gradient_descent_sr_fp16(
+    void * optim_sr_args_fp16
+);
+
+/**
+ * @brief Multi-tensor SGD with momentum (PyTorch formulation, v = momentum*v + grad, w -= lr*v). Use pi_cl_team_fork(NUM_CORES, pulp_momentum_sgd_fp16, &args) to parallelize.
+ * @param optim_multi_args_fp16 pointer to optim_multi_args_fp16 structure
+ */
+void pulp_momentum_sgd_fp16(
+    void * optim_multi_args_fp16
+);
+
+/**
+ * @brief Multi-tensor Adam optimizer. Use pi_cl_team_fork(NUM_CORES, pulp_adam_fp16, &args) to parallelize.
+ * @param optim_multi_args_fp16 pointer to optim_multi_args_fp16 structure
+ */
+void pulp_adam_fp16(
+    void * optim_multi_args_fp16
+);
+
+/**
+ * @brief Multi-tensor AdamW optimizer (Adam with decoupled weight decay). Use pi_cl_team_fork(NUM_CORES, pulp_adamw_fp16, &args) to parallelize.
+ * @param optim_multi_args_fp16 pointer to optim_multi_args_fp16 structure
+ */
+void pulp_adamw_fp16(
+    void * optim_multi_args_fp16
+);
+
+
+
+/**
+ * Mixed-precision training
+ * 
+ * A training step with dynamic loss scaling is:
+ *   forward (FP16) and loss
+ *   pi_cl_team_fork(NUM_CORES, pulp_loss_scale_fp16, &scaler);
+ *   backward (FP16)
+ *   pi_cl_team_fork(NUM_CORES, pulp_grad_overflow_check_fp16, &scaler);
+ *   pi_cl_team_fork(NUM_CORES, pulp_adam_fp16, &optim);     (with optim.master_weights and optim.scaler set)
+ *   pulp_loss_scaler_update_fp16(&scaler);
+ **/
+
+/**
+ * @brief Multiplies the output gradient (computed by the loss function) by the loss scale. Use pi_cl_team_fork(NUM_CORES, pulp_loss_scale_fp16, &args) to parallelize.
+ * @param loss_scaler_args_fp16 pointer to loss_scaler_args_fp16 structure
+ */
+void pulp_loss_scale_fp16(
+    void * loss_scaler_args_fp16
+);
+
+/**
+ * @brief Checks all the weight gradients for inf/NaN values, setting the overflow flag of the scaler. The work is split among the cores over the total number of elements. Use pi_cl_team_fork(NUM_CORES, pulp_grad_overflow_check_fp16, &args) to parallelize.
+ * @param loss_scaler_args_fp16 pointer to loss_scaler_args_fp16 structure
+ */
+void pulp_grad_overflow_check_fp16(
+    void * loss_scaler_args_fp16
+);
+
+/**
+ * @brief Updates the loss scale after the optimizer step (backoff on overflow, growth after growth_interval good steps) and resets the overflow flag. Not parallel, to be called from a single core after the optimizer (inside pulp_team_run, it can be called by all the cores: core 0 updates the scale, followed by a barrier).
+ * @param loss_scaler_args_fp16 pointer to loss_scaler_args_fp16 structure
+ */
+void pulp_loss_scaler_update_fp16(
+    void * loss_scaler_args_fp16
+);
+
+/**
+ * @brief Initializes the FP32 master weights with the values of the FP16 weights. Use pi_cl_team_fork(NUM_CORES, pulp_init_master_weights_fp16, &args) to parallelize.
+ * @param optim_multi_args_fp16 pointer to optim_multi_args_fp16 structure
+ */
+void pulp_init_master_weights_fp16(
+    void * optim_multi_args_fp16
+);
+
+
+
+/**
+ * Stochastic rounding
+ **/
+
+/**
+ * @brief Initializes the per-core PRNG states used by the stochastic-rounding optimizers. Not parallel, to be called once from a single core.
+ * @param rng_state array of NUM_CORES PRNG states
+ * @param seed seed of the PRNG
+ */
+void pulp_sr_seed_fp16(
+    uint32_t * rng_state,
+    uint32_t seed
+);
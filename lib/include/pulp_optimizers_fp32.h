@@ -35,6 +35,42 @@ struct optim_args {
 
 
 
+/**
+ * @brief Structure for multi-tensor optimizers, which update a list of parameter blobs within a single fork. The work is split among the cores over the total number of elements, not per tensor.
+ * @param weights array of n_tensors blobs of the weights (with their gradient inside)
+ * @param first_moment array of n_tensors buffers with the same size of the weights: velocity for momentum SGD, first moment for Adam/AdamW (zero-initialized, NULL if momentum=0 in SGD)
+ * @param second_moment array of n_tensors buffers with the same size of the weights: second moment for Adam/AdamW (zero-initialized, unused by SGD)
+ * @param n_tensors number of parameter blobs to be updated
+ * @param learning_rate the learning rate of the optimizer
+ * @param momentum momentum of SGD (0 for plain gradient descent)
+ * @param beta1 decay rate of the first moment (Adam/AdamW)
+ * @param beta2 decay rate of the second moment (Adam/AdamW)
+ * @param epsilon term added to the denominator for numerical stability (Adam/AdamW)
+ * @param weight_decay L2 penalty added to the gradient (SGD, Adam) or decoupled weight decay (AdamW)
+ * @param step index of the current optimizer step, starting from 1 (Adam/AdamW bias correction). It is not incremented by the optimizer, since it is executed by all the cores.
+ * @param max_grad_norm threshold of the global L2 norm of the gradients (clip-by-global-norm, as torch.nn.utils.clip_grad_norm_). The norm of all the n_tensors gradients is reduced at the beginning of the optimizer fork and the gradients are scaled by max_grad_norm/norm inside the update when it is exceeded. 0 to disable the clipping.
+ * @param grad_norm variable to retrieve the global norm of the gradients before clipping (computed only if max_grad_norm > 0), NULL if not needed
+ * @param norm_partials scratch buffer of NUM_CORES elements in L1 for the reduction of the norm (needed if max_grad_norm > 0)
+ */
+struct optim_multi_args {
+  struct blob ** weights;
+  float ** first_moment;
+  float ** second_moment;
+  int n_tensors;
+  float learning_rate;
+  float momentum;
+  float beta1;
+  float beta2;
+  float epsilon;
+  float weight_decay;
+  int step;
+  float max_grad_norm;
+  float * grad_norm;
+  float * norm_partials;
+};
+
+
+
 /**
  * Optimizers
  **/
@@ -46,3 +82,27 @@ struct optim_args {
 void pulp_gradient_descent_fp32(
     void * optim_args
 );
+
+/**
+ * @brief Multi-tensor SGD with momentum (PyTorch formulation, v = momentum*v + grad, w -= lr*v). Use pi_cl_team_fork(NUM_CORES, pulp_momentum_sgd_fp32, &args) to parallelize.
+ * @param optim_multi_args pointer to optim_multi_args structure
+ */
+void pulp_momentum_sgd_fp32(
+    void * optim_multi_args
+);
+
+/**
+ * @brief Multi-tensor Adam optimizer. Use pi_cl_team_fork(NUM_CORES, pulp_adam_fp32, &args) to parallelize.
+ * @param optim_multi_args pointer to optim_multi_args structure
+ */
+void pulp_adam_fp32(
+    void * optim_multi_args
+);
+
+/**
+ * @brief Multi-tensor AdamW optimizer (Adam with decoupled weight decay). Use pi_cl_team_fork(NUM_CORES, pulp_adamw_fp32, &args) to parallelize.
+ * @param optim_multi_args pointer to optim_multi_args structure
+ */
+void pulp_adamw_fp32(
+    void * optim_multi_args
+);
@@ -30,6 +30,12 @@
  * @param Wker horizontal size of the pooling kernel
  * @param Hstride controls the vertical stride of the kernel
  * @param Wstride controls the horizontal stride of the kernel
+ * @param Lpad left padding
+ * @param Rpad right padding
+ * @param Upad upper padding
+ * @param Dpad lower padding (padded elements are skipped by the max pooling and count as zeros in the average pooling, as in PyTorch)
+ * @param HWC tells the pooling if the input/output tensor is in CHW layout (HWC=0) or HWC format (HWC=1)
+ * @param argmax if not NULL, the max pooling forward stores here the position of the maximum inside each pooling window (one element per output, uint8_t if Hker*Wker <= 256, uint16_t otherwise), so that the backward scatters the gradients without scanning the input again (which is not needed anymore)
  */
 struct pool_args {
   struct blob * input;
@@ -38,6 +44,30 @@ struct pool_args {
   int Wker;
   int Hstride;
   int Wstride;
+  int Lpad;
+  int Rpad;
+  int Upad;
+  int Dpad;
+  int HWC;
+  void * argmax;
+};
+
+/**
+ * @brief Structure for a Global Average Pooling fused with the following Fully-Connected layer: output = coeff * GAP(input)
+ * @param input input feature maps (C x H x W)
+ * @param pooled averages of the C channels (dim = C). Its data is written by the forward and used by the backward for the weight gradient, its diff is not needed.
+ * @param coeff weight matrix of the Fully-Connected layer (Out x C)
+ * @param output output of the Fully-Connected layer (dim = Out)
+ * @param HWC tells if the input is in CHW layout (HWC=0) or HWC format (HWC=1)
+ * @param skip_in_grad skips the computation of the input grad (1st DNN layer)
+ */
+struct gap_linear_args {
+  struct blob * input;
+  struct blob * pooled;
+  struct blob * coeff;
+  struct blob * output;
+  int HWC;
+  int skip_in_grad;
 };
 
 
@@ -58,13 +88,25 @@ void pulp_avgpool_fp32_fw_cl(void * pool_args);
 void pulp_avgpool_fp32_bw_cl(void * pool_args);
 
 /**
- * @brief Forward pass function (parallelize with pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp32_fw_cl, &args);)
+ * @brief Forward pass function (parallelize with pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp32_fw_cl, &args);). Stores the argmax of each window if args->argmax is not NULL.
  * @param pool_args pointer to a struct pool_args structure.
 */
 void pulp_maxpool_fp32_fw_cl(void * pool_args);
 
 /**
- * @brief Backward pass function (parallelize with pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp32_bw_cl, &args);)
+ * @brief Backward pass function (parallelize with pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp32_bw_cl, &args);). Scatters the gradients to the argmax stored by the forward if args->argmax is not NULL, otherwise finds the maximum of each window again from the input data.
  * @param pool_args pointer to a struct pool_args structure.
 */
-void pulp_maxpool_fp32_bw_cl(void * pool_args);
\ No newline at end of file
+void pulp_maxpool_fp32_bw_cl(void * pool_args);
+
+/**
+ * @brief Forward pass function of the Global Average Pooling fused with the following Fully-Connected layer (parallelize with pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp32_fw_cl, &args);). The channel averages are computed in parallel over the channels, then (after a barrier) the outputs in parallel over the rows of the weights, without writing the pooled feature map to a separate layer.
+ * @param gap_linear_args pointer to a struct gap_linear_args structure.
+*/
+void pulp_gap_linear_fp32_fw_cl(void * gap_linear_args);
+
+/**
+ * @brief Backward pass function of the Global Average Pooling fused with the following Fully-Connected layer (parallelize with pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp32_bw_cl, &args);). Computes the weight gradient and, unless skipped, broadcasts the gradient of each channel average to all the pixels of the channel.
+ * @param gap_linear_args pointer to a struct gap_linear_args structure.
+*/
+void pulp_gap_linear_fp32_bw_cl(void * gap_linear_args);
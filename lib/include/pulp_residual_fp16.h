@@ -46,6 +46,9 @@
  * @param skip activation to be forwarded at the output 
  * @param lout second activation to be summed
  * @param output result from the sum of Input (@param skip) and LAYERS output (@param lout) (forward: activation data, backward: activation gradient)
+ * @param skip_in_grad skips the accumulation of the gradient on the skip branch (1st DNN layer)
+ * 
+ * The gradient of the LAYERS output can share the buffer of the output gradient (lout->diff == output->diff): in this case, the backward of the residual connection does not copy any data.
  */
 struct SkipConn_args_fp16 {
     struct blob_fp16 * skip;
@@ -54,6 +57,22 @@ struct SkipConn_args_fp16 {
     int skip_in_grad;
 };
 
+/**
+ * @brief Structure to configure a summation node with an arbitrary number of inputs (e.g. DenseNet/FPN merges), optionally followed by a ReLU
+ * @param inputs array of n_inputs activations to be summed (forward: activation data, backward: activation gradient)
+ * @param n_inputs number of inputs of the node (at least 2 in the forward step)
+ * @param output result of the sum of the inputs (forward: activation data, backward: activation gradient)
+ * @param relu if 1, the ReLU is fused with the sum (forward: output = max(sum, 0), backward: the output gradient is masked in place)
+ * @param accumulate if 1, the backward accumulates the output gradient on the input gradients, if 0 it overwrites them. Inputs whose diff is the output diff are never written.
+ */
+struct SumNode_args_fp16 {
+    struct blob_fp16 ** inputs;
+    int n_inputs;
+    struct blob_fp16 * output;
+    int relu;
+    int accumulate;
+};
+
 
 // FORWARD FUNCTIONS
 
@@ -89,3 +108,35 @@ void pulp_sumnode_fp16_bw( void * SkipConn_args );
 void pulp_residualconn_fp16_bw( void * SkipConn_args );
 
 
+
+// FUSED AND MULTI-INPUT FUNCTIONS
+
+/**
+ * @brief Sums the input activations to the output and applies a ReLU in the same pass (replaces pulp_residualconn_fp16_fw() + ReLU forward)
+ * 
+ * @param skip: activation to be forwarded at the output 
+ * @param lout: layers output, second activation to be summed
+ * @param output: ReLU of the sum between Input (@param skip) and LAYERS output (@param lout) (forward: activation data, backward: activation gradient)
+ */
+void pulp_residualconn_relu_fp16_fw( void * SkipConn_args );
+
+/**
+ * @brief Backward of the fused residual connection + ReLU: masks the output gradient in place and dispatches it to the layers (no copy if lout->diff == output->diff). pulp_sumnode_fp16_bw() with the same arguments then accumulates the masked gradient on the skip branch.
+ * 
+ * @param skip: activation to be forwarded at the output 
+ * @param lout: layers output, second activation to be summed
+ * @param output: ReLU of the sum between Input (@param skip) and LAYERS output (@param lout) (forward: activation data, backward: activation gradient)
+ */
+void pulp_residualconn_relu_fp16_bw( void * SkipConn_args );
+
+/**
+ * @brief Sums all the input activations into the output within a single fork, without intermediate buffers
+ * @param (void *)  (struct SumNode_args_fp16 void_args)
+ */
+void pulp_sumnode_multi_fp16_fw( void * SumNode_args_fp16 );
+
+/**
+ * @brief Dispatches (or accumulates) the output gradient to all the inputs within a single fork, applying the ReLU mask if fused
+ * @param (void *)  (struct SumNode_args_fp16 void_args)
+ */
+void pulp_sumnode_multi_fp16_bw( void * SumNode_args_fp16 );
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Recurrent layer training functions, grouped into FW and BW
+*/
+
+/**
+ * Recursive Neural Network layer configuration structure
+ */
+
+/**
+ * @brief Structure for full-sequence RNN Training in FP16, h_t = tanh(x_t * Wx + h_(t-1) * Ws)
+ * @param input             Input sequence (N x K, H = N and W = K). Its diff receives the input gradients.
+ * @param state             Initial hidden state h_(-1) (M elements). Its diff receives the gradient of the initial state (if not NULL).
+ * @param output            Hidden states of all the timesteps (N x M, W = M). Its diff contains the gradients coming from the next layer.
+ * @param coeff_x           Weight for input vector (K x M).
+ * @param coeff_s           Weight for state vector (M x M).
+ * @param grad_buffer       Gradients of the pre-activations of one BPTT window (bptt_window x M, or N x M for full BPTT).
+ * @param bptt_window       Truncated BPTT: the sequence is split in windows of bptt_window steps and no gradient flows between them (0 = full BPTT).
+ */
+struct Rnn_seq_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * state;
+    struct blob_fp16 * output;
+    struct blob_fp16 * coeff_x;
+    struct blob_fp16 * coeff_s;
+    fp16 * grad_buffer;
+    int bptt_window;
+};
+
+/**
+ * @brief Structure passed to the parallelized BPTT kernel, selecting the window [t_start, t_stop) of the sequence.
+ * @param rnn_args          Pointer to the layer configuration structure.
+ * @param t_start           First timestep of the window.
+ * @param t_stop            Last timestep of the window (excluded).
+ * @param accumulate        If 1, the weight gradients of the window are added to the ones of the windows already processed.
+ */
+struct Rnn_bptt_args_fp16 {
+    struct Rnn_seq_args_fp16 * rnn_args;
+    int t_start;
+    int t_stop;
+    int accumulate;
+};
+
+
+
+
+/**
+ * RNN layer training functions, grouped into FW and BW
+ */
+
+// FORWARD FUNCTIONS
+
+/**
+ * @brief Full-sequence forward pass function. The input projection of all the timesteps is computed up front with a single matmul, directly into the output, where each row is then overwritten with its hidden state.
+ * @param Rnn_seq_args_fp16 structure configuring the RNN layer.
+ */
+void pulp_rnn_seq_fp16_fw_cl(void * Rnn_seq_args_fp16);
+
+/**
+ * @brief Core function of the full-sequence forward: input projection and time loop within a single fork, parallelized over pairs of hidden units (v2f16) with a barrier per timestep.
+ * @param Rnn_seq_args_fp16 structure configuring the RNN layer.
+ */
+void rnn_seq_core_fw_fp16(void * Rnn_seq_args_fp16);
+
+
+// BACKWARD FUNCTIONS
+
+/**
+ * @brief Full-sequence backward pass function (backpropagation through time), computing weight gradients, input gradients and the initial state gradient. The windows are processed from the last one, one fork each.
+ * @param Rnn_seq_args_fp16 structure configuring the RNN layer.
+ */
+void pulp_rnn_seq_fp16_bw_cl(void * Rnn_seq_args_fp16);
+
+/**
+ * @brief Core function of the BPTT on one window: the time loop (parallelized over the hidden units with a barrier per timestep) stores the pre-activation gradients into grad_buffer, then weight and input gradients of the whole window are computed at once.
+ * @param Rnn_bptt_args_fp16 structure selecting the window.
+ */
+void rnn_seq_core_bw_fp16(void * Rnn_bptt_args_fp16);
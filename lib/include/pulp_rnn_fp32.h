@@ -49,6 +49,40 @@ struct Rnn_args {
     float * grad_buffer; 
 };
 
+/**
+ * @brief Structure for full-sequence RNN Training in FP32, h_t = tanh(x_t * Wx + h_(t-1) * Ws)
+ * @param input             Input sequence (N x K, H = N and W = K). Its diff receives the input gradients.
+ * @param state             Initial hidden state h_(-1) (M elements). Its diff receives the gradient of the initial state (if not NULL).
+ * @param output            Hidden states of all the timesteps (N x M, W = M). Its diff contains the gradients coming from the next layer.
+ * @param coeff_x           Weight for input vector (K x M).
+ * @param coeff_s           Weight for state vector (M x M).
+ * @param grad_buffer       Gradients of the pre-activations of one BPTT window (bptt_window x M, or N x M for full BPTT).
+ * @param bptt_window       Truncated BPTT: the sequence is split in windows of bptt_window steps and no gradient flows between them (0 = full BPTT).
+ */
+struct Rnn_seq_args {
+    struct blob * input;
+    struct blob * state;
+    struct blob * output;
+    struct blob * coeff_x;
+    struct blob * coeff_s;
+    float * grad_buffer;
+    int bptt_window;
+};
+
+/**
+ * @brief Structure passed to the parallelized BPTT kernel, selecting the window [t_start, t_stop) of the sequence.
+ * @param rnn_args          Pointer to the layer configuration structure.
+ * @param t_start           First timestep of the window.
+ * @param t_stop            Last timestep of the window (excluded).
+ * @param accumulate        If 1, the weight gradients of the window are added to the ones of the windows already processed.
+ */
+struct Rnn_bptt_args {
+    struct Rnn_seq_args * rnn_args;
+    int t_start;
+    int t_stop;
+    int accumulate;
+};
+
 
 
 
@@ -68,6 +102,18 @@ struct Rnn_args {
  */
 void pulp_rnn_fp32_fw_cl(void * Rnn_args);
 
+/**
+ * @brief Full-sequence forward pass function. The input projection of all the timesteps is computed up front with a single matmul, directly into the output, where each row is then overwritten with its hidden state.
+ * @param Rnn_seq_args structure configuring the RNN layer.
+ */
+void pulp_rnn_seq_fp32_fw_cl(void * Rnn_seq_args);
+
+/**
+ * @brief Core function of the full-sequence forward: input projection and time loop within a single fork, parallelized over the hidden units with a barrier per timestep.
+ * @param Rnn_seq_args structure configuring the RNN layer.
+ */
+void rnn_seq_core_fw_fp32(void * Rnn_seq_args);
+
 
 // BACKWARD FUNCTIONS
 
@@ -80,3 +126,15 @@ void pulp_rnn_fp32_fw_cl(void * Rnn_args);
  * @param coeff_s   weight state matrix
  */
 void pulp_rnn_fp32_bw_cl(void * Rnn_args);
+
+/**
+ * @brief Full-sequence backward pass function (backpropagation through time), computing weight gradients, input gradients and the initial state gradient. The windows are processed from the last one, one fork each.
+ * @param Rnn_seq_args structure configuring the RNN layer.
+ */
+void pulp_rnn_seq_fp32_bw_cl(void * Rnn_seq_args);
+
+/**
+ * @brief Core function of the BPTT on one window: the time loop (parallelized over the hidden units with a barrier per timestep) stores the pre-activation gradients into grad_buffer, then weight and input gradients of the whole window are computed at once.
+ * @param Rnn_bptt_args structure selecting the window.
+ */
+void rnn_seq_core_bw_fp32(void * Rnn_bptt_args);
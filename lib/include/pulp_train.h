@@ -40,8 +40,11 @@
 #include "pulp_pooling_fp32.h"
 #include "pulp_residual_fp32.h"
 #include "pulp_rnn_fp32.h"
+#include "pulp_lstm_fp32.h"
+#include "pulp_gru_fp32.h"
 #include "pulp_mhsa_fp32.h"
 #include "pulp_instnorm_fp32.h"
+#include "pulp_groupnorm_fp32.h"
 
 
 // FP16 structures
@@ -58,6 +61,10 @@
 #include "pulp_optimizers_fp16.h"
 #include "pulp_pooling_fp16.h"
 #include "pulp_residual_fp16.h"
+#include "pulp_rnn_fp16.h"
+#include "pulp_lstm_fp16.h"
+#include "pulp_gru_fp16.h"
 #include "pulp_mhsa_fp16.h"
 #include "pulp_instnorm_fp16.h"
+#include "pulp_groupnorm_fp16.h"
 
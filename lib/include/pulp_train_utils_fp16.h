@@ -21,6 +21,22 @@
 #include "pmsis.h"
 #include "pulp_train_defines.h"
 
+/**
+ * Constants for the FP16 exponential approximations
+ */
+
+#define GIST_A_FP16   1477.3197218702985f     // 2^10 / log(2)
+#define GIST_B_FP16   15315.274293248047f     // 15 * 2^10, minus the same correction as GIST_B
+#define GIST_C_FP16   1024                    // smallest normal FP16
+#define GIST_D_FP16   31744                   // FP16 +inf
+
+#define THR_C1_FP16   0.6931471805599453f     // Taylor's coefficients of 1/2^x (see threshold()),
+#define THR_C2_FP16   0.2402265069591007f     // already multiplied by the powers of log(2)
+#define THR_C3_FP16   0.0532839443182287f
+#define THR_C4_FP16   0.0096027401010563f
+#define THR_C5_FP16   0.0012800215820571f
+#define THR_SAT_FP16  3.14f
+
 /**
  * =====> BACKEND STRUCTURES <=====
  */
@@ -273,32 +289,48 @@ struct mm_manager_args_fp16 {
 };
 
 /**
- * @brief Arguments for tanh in parallel output=tanh(input)
- * @param input   pointer to input vector
- * @param dim     dimension vector
- * @param output  pointer to output vector
-*/
-struct tanh_args_fp16{
-  fp16* input;
-  int dim;
-  fp16* output;
+ * @brief Configuration of the fused backward-and-update mode of the trainable layers (Linear, Conv2D, PointWise and DepthWise Convolutions). When a layer is given this structure, its weight gradient is computed in tiles of output channels into a scratch buffer and the weights are updated with SGD (with momentum) as soon as each tile is ready, so that no coeff->diff buffer is needed. Since the weights are modified, the input gradient has to be computed before the weight gradient.
+ * @param buffer scratch buffer for a tile of the weight gradient, which can be shared among all the layers
+ * @param buffer_size size of the scratch buffer (in elements), at least one output channel of the weights (the larger the buffer, the fewer the forks)
+ * @param learning_rate learning rate of SGD
+ * @param momentum momentum of SGD (0 for plain gradient descent)
+ * @param velocity momentum buffer of the layer (FP32, same size of the weights, zero-initialized), NULL if momentum is 0
+ */
+struct fused_update_args_fp16 {
+  fp16 * buffer;
+  int buffer_size;
+  float learning_rate;
+  float momentum;
+  float * velocity;
 };
 
+/**
+ * @brief Arguments for the fused update of a tile of weights from the scratch buffer
+ * @param update configuration of the fused update
+ * @param weights pointer to the weights of the layer
+ * @param offset index of the first weight of the tile
+ * @param size number of weights of the tile
+ */
+struct fused_update_tile_args_fp16 {
+  struct fused_update_args_fp16 * update;
+  fp16 * weights;
+  int offset;
+  int size;
+};
 
 /**
- * @brief Arguments for exponential and softmax in parallel
+ * @brief Arguments for tanh in parallel output=tanh(input)
  * @param input   pointer to input vector
  * @param dim     dimension vector
  * @param output  pointer to output vector
- * @param sum     final sum value of all exponentials
 */
-struct softmax_args_fp16{
+struct tanh_args_fp16{
   fp16* input;
   int dim;
   fp16* output;
-  fp16 sum;
 };
 
+
 /**
  * @brief Arguments weight updates output=output + gradient
  * @param accum    pointer to weight gradient accumulators
@@ -329,14 +361,14 @@ struct max_args_fp16{
  * @param sums    vector on which each core saves their sum
  * @param output  vector where the exponential is saved
  * @param dim     dimension of input
- * @param max     maximum value of the input map
+ * @param maxes   maximum value for each row of the input map
 */
 struct exp_sum_args_fp16{
   fp16* input;
   fp16* sums;
   fp16* output;
   int dim;
-  fp16 max;
+  fp16* maxes;
 };
 
 /**
@@ -363,6 +395,24 @@ struct row_div_args_fp16{
   int dim;
 };
 
+/**
+ * @brief Arguments for the single-fork (online) softmax on the rows of a matrix
+ * @param input   input matrix (n_rows x dim)
+ * @param output  output matrix (n_rows x dim), can be the same as input
+ * @param maxes   vector where the max of each row is saved
+ * @param sums    vector where the exponential sum of each row (shifted by its max) is saved
+ * @param n_rows  number of rows of the matrix
+ * @param dim     length of each row
+*/
+struct online_softmax_args_fp16{
+  fp16* input;
+  fp16* output;
+  fp16* maxes;
+  fp16* sums;
+  int n_rows;
+  int dim;
+};
+
 /**
  * @brief Arguments for implementing parallelized multiplication of an input vector and a scalar
  * @param input   input vector we want to multiply
@@ -392,6 +442,45 @@ struct mean_std_args_fp16{
   fp16 epsilon;
   int dim;
 };
+/**
+ * @brief Operations of the cluster-wide tensor reductions
+ */
+#define REDUCE_SUM          0   // sum of the elements
+#define REDUCE_MAX          1   // max of the elements
+#define REDUCE_ARGMAX       2   // max of the elements and index of its first occurrence
+#define REDUCE_SUMSQ        3   // sum of the squares of the elements
+#define REDUCE_MEAN_VAR     4   // mean and (biased) variance of the elements
+
+/**
+ * @brief Number of v2f16 pairs accumulated in FP16 before flushing them to the FP32 accumulator
+ */
+#define REDUCE_FP16_CHUNK   8
+
+/**
+ * @brief Number of partial values stored by each core in the scratch buffer of the reductions
+ */
+#define REDUCE_PARTIALS     3
+
+/**
+ * @brief Arguments for the cluster-wide reductions of a tensor. Each core reduces its slice of the tensor into per-core partials, which are then combined with a tree after a cluster barrier. Sum and max are computed with v2f16 SIMD (input aligned to 4 bytes), flushing the v2f16 accumulators to FP32 every REDUCE_FP16_CHUNK pairs, while the sum of squares and mean/var are accumulated in FP32 to avoid underflows and overflows of the squares.
+ * @param input     input tensor to be reduced
+ * @param dim       number of elements of input
+ * @param op        reduction operation (REDUCE_SUM, REDUCE_MAX, REDUCE_ARGMAX, REDUCE_SUMSQ, REDUCE_MEAN_VAR)
+ * @param partials  scratch buffer of REDUCE_PARTIALS*NUM_CORES elements, to be allocated in L1 (TCDM)
+ * @param result    reduced value (sum, max or mean)
+ * @param var       variance (REDUCE_MEAN_VAR only, can be NULL otherwise)
+ * @param index     index of the max (REDUCE_ARGMAX only, can be NULL otherwise)
+*/
+struct reduce_args_fp16{
+  fp16* input;
+  int dim;
+  int op;
+  float* partials;
+  float* result;
+  float* var;
+  int* index;
+};
+
 /**
  * =====> FUNCTIONS <=====
  */
@@ -461,6 +550,22 @@ void pad_tensor_fp16 (void * pad_args_fp16);
  */
 void mm_manager_fp16 (void * void_args);
 
+/**
+ * @brief Updates a tile of weights with the gradient stored in the scratch buffer of the fused backward-and-update mode. Use pi_cl_team_fork(NUM_CORES, fused_update_tile_fp16, &args) to parallelize.
+ * @param (void *) (struct fused_update_tile_args_fp16 void_args)
+ */
+void fused_update_tile_fp16 (void * fused_update_tile_args);
+
+/**
+ * @brief Computes the weight gradient matmul described by mm_args in tiles of rows of the output into the scratch buffer of update, and updates the corresponding rows of the weights after each tile (fused backward-and-update). Forks internally.
+ * @param mm_args matmul of the weight gradient, whose output C (N x M) has the layout of the weights
+ * @param update configuration of the fused update
+ * @param weights weights of the layer to be updated
+ * @param layer_type type of layer, used by the mm_manager_fp16 (e.g. LAYER_LINEAR)
+ * @param matmul_type matmul to be chosen by the mm_manager_fp16 (see mm_manager_list_fp16.txt)
+ */
+void mm_fused_update_fp16 (struct matMul_args_fp16 * mm_args, struct fused_update_args_fp16 * update, fp16 * weights, int layer_type, int matmul_type);
+
 /**
  * @brief Calculates the exponential value of each element in the input vector/matrix.
  * @param (void *) (struct softmax_args_fp16 void_args)
@@ -504,12 +609,42 @@ void pulp_div_fp16_cl(void* void_args);
  */
 void pulp_row_div_fp16_cl(void* void_args);
 
+/**
+ * @brief Row-wise softmax in a single fork: one sweep keeps the running max and the rescaled exponential sum, a second one normalizes multiplying by the reciprocal of the sum
+ * @param (void *)  (struct online_softmax_args_fp16 void_args)
+ */
+void pulp_online_softmax_fp16_cl(void* void_args);
+
 /**
  * @brief Element-wise multiplication of vector with a single constant
  * @param (void *)  (struct scalar_mul_args_fp16 void_args)
  */
 void pulp_scalar_mul_fp16_cl(void* void_args);
 
+/**
+ * @brief Approximated exponential of a FP16 value, using the bit manipulation of fastexp_gist with the FP16 exponent and mantissa (FP16 version of fastexp_gist).
+ * @param x FP16 value to be exponentiated
+ */
+fp16 fastexp_gist_fp16(fp16 x);
+
+/**
+ * @brief Approximated exponential of two FP16 values, using the bit manipulation of fastexp_gist with the FP16 exponent and mantissa. The two results are packed into a single 32-bit word.
+ * @param x v2f16 vector to be exponentiated
+ */
+v2f16 fastexp_gist_v2f16(v2f16 x);
+
+/**
+ * @brief Taylor's approximation of 1/2^x on two FP16 values (SIMD version of threshold()). Returns 0 for x >= THR_SAT_FP16.
+ * @param x v2f16 vector of non-negative shifts
+ */
+v2f16 threshold_v2f16(v2f16 x);
+
+/**
+ * @brief 1/2^ceil(x) of two non-negative FP16 values, obtained by writing the FP16 exponent field only.
+ * @param x v2f16 vector of non-negative shifts
+ */
+v2f16 pow2_shift_v2f16(v2f16 x);
+
 /**
  * =====> ASSEMBLY CALLS <=====
  */
@@ -535,4 +670,68 @@ v2f16 vfpack(fp16 a, fp16 b);
  * @brief Mean, Variance and standard deviation calculation of a vector
  * @param (void *)  (struct mean_std_args void_args)
  */
-void pulp_mean_std_fp16_cl(void * mean_std_args);
\ No newline at end of file
+void pulp_mean_std_fp16_cl(void * mean_std_args);
+
+
+
+/**
+ * Cluster-wide reductions
+ **/
+
+/**
+ * @brief Sum of a value computed by each core, to be called by all the cores inside a fork (e.g. to reduce the partial results of a parallel kernel). The per-core values are combined with a tree in log2(NUM_CORES) steps. Returns the sum to all the cores.
+ * @param value     partial value of the calling core
+ * @param partials  scratch buffer of NUM_CORES elements in L1, shared by all the cores
+ */
+float pulp_team_sum_fp16(float value, float * partials);
+
+/**
+ * @brief Max of a value computed by each core, to be called by all the cores inside a fork. Returns the max to all the cores.
+ * @param value     partial value of the calling core
+ * @param partials  scratch buffer of NUM_CORES elements in L1, shared by all the cores
+ */
+float pulp_team_max_fp16(float value, float * partials);
+
+/**
+ * @brief Reduction of a whole tensor, to be called by all the cores inside a fork (e.g. within a layer kernel). When it returns, the results are available to all the cores.
+ * @param (void *)  (struct reduce_args_fp16 void_args)
+ */
+void pulp_reduce_parallelized_fp16_cl(void * reduce_args_fp16);
+
+/**
+ * @brief Reduction of a whole tensor, to be called from a single core: forks pulp_reduce_parallelized_fp16_cl on NUM_CORES.
+ * @param (void *)  (struct reduce_args_fp16 void_args)
+ */
+void pulp_reduce_fp16_cl(void * reduce_args_fp16);
+
+
+
+/**
+ * Persistent cluster team (shared with pulp_train_utils_fp32.h: the definitions are weak, so that FP32 and FP16 primitives can run inside the same team)
+ **/
+
+/**
+ * @brief Non-zero while the cores execute inside pulp_team_run
+ */
+extern int pulp_team_active;
+
+/**
+ * @brief Executes a parallel stage of a primitive: forks fn on nb_cores when called from a single core, or executes it in place (between two barriers) when called by all the cores inside pulp_team_run.
+ * @param nb_cores  number of cores that execute fn (inside pulp_team_run, it must be NUM_CORES, otherwise the stage is not executed)
+ * @param fn        parallel function (as passed to pi_cl_team_fork)
+ * @param args      arguments of fn
+ */
+void pulp_team_fork(int nb_cores, void (*fn)(void *), void * args);
+
+/**
+ * @brief Forks a single long-lived team on NUM_CORES which executes step. Inside step, all the cores call the primitives of the library as from a single core, and their stages are synchronized with barriers instead of forks.
+ * @param step  function executed by all the cores of the team
+ * @param args  arguments of step
+ */
+void pulp_team_run(void (*step)(void *), void * args);
+
+/**
+ * @brief Inside pulp_team_run, returns the ptr of core 0 to all the cores (to be called by all the cores), to share a scratch buffer declared on the stack. Outside pulp_team_run, returns ptr.
+ * @param ptr  buffer of the calling core
+ */
+void * pulp_team_share(void * ptr);
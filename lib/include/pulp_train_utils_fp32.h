@@ -294,6 +294,36 @@ struct mm_manager_args {
   int matmul_type;
 };
 
+/**
+ * @brief Configuration of the fused backward-and-update mode of the trainable layers (Linear, Conv2D, PointWise and DepthWise Convolutions). When a layer is given this structure, its weight gradient is computed in tiles of output channels into a scratch buffer and the weights are updated with SGD (with momentum) as soon as each tile is ready, so that no coeff->diff buffer is needed. Since the weights are modified, the input gradient has to be computed before the weight gradient.
+ * @param buffer scratch buffer for a tile of the weight gradient, which can be shared among all the layers
+ * @param buffer_size size of the scratch buffer (in elements), at least one output channel of the weights (the larger the buffer, the fewer the forks)
+ * @param learning_rate learning rate of SGD
+ * @param momentum momentum of SGD (0 for plain gradient descent)
+ * @param velocity momentum buffer of the layer (FP32, same size of the weights, zero-initialized), NULL if momentum is 0
+ */
+struct fused_update_args {
+  float * buffer;
+  int buffer_size;
+  float learning_rate;
+  float momentum;
+  float * velocity;
+};
+
+/**
+ * @brief Arguments for the fused update of a tile of weights from the scratch buffer
+ * @param update configuration of the fused update
+ * @param weights pointer to the weights of the layer
+ * @param offset index of the first weight of the tile
+ * @param size number of weights of the tile
+ */
+struct fused_update_tile_args {
+  struct fused_update_args * update;
+  float * weights;
+  int offset;
+  int size;
+};
+
 
 
 /**
@@ -394,6 +424,26 @@ struct row_div_args{
   int dim2;
 };
 
+/**
+ * @brief Arguments for the single-fork (online) softmax on the rows of a matrix
+ * @param input   input matrix (n_rows x dim)
+ * @param output  output matrix (n_rows x dim), can be the same as input
+ * @param maxes   vector where the max of each row is saved
+ * @param sums    vector where the exponential sum of each row (shifted by its max) is saved
+ * @param lse     vector where the log-sum-exp of each row is saved, not used if NULL
+ * @param n_rows  number of rows of the matrix
+ * @param dim     length of each row
+*/
+struct online_softmax_args{
+  float* input;
+  float* output;
+  float* maxes;
+  float* sums;
+  float* lse;
+  int n_rows;
+  int dim;
+};
+
 /**
  * @brief Arguments for implementing parallelized multiplication of an input vector and a scalar
  * @param input   input vector we want to multiply
@@ -425,6 +475,40 @@ struct mean_std_args{
   int dim;
 };
 
+/**
+ * @brief Operations of the cluster-wide tensor reductions
+ */
+#define REDUCE_SUM          0   // sum of the elements
+#define REDUCE_MAX          1   // max of the elements
+#define REDUCE_ARGMAX       2   // max of the elements and index of its first occurrence
+#define REDUCE_SUMSQ        3   // sum of the squares of the elements
+#define REDUCE_MEAN_VAR     4   // mean and (biased) variance of the elements
+
+/**
+ * @brief Number of partial values stored by each core in the scratch buffer of the reductions
+ */
+#define REDUCE_PARTIALS     3
+
+/**
+ * @brief Arguments for the cluster-wide reductions of a tensor. Each core reduces its slice of the tensor into per-core partials, which are then combined with a tree after a cluster barrier.
+ * @param input     input tensor to be reduced
+ * @param dim       number of elements of input
+ * @param op        reduction operation (REDUCE_SUM, REDUCE_MAX, REDUCE_ARGMAX, REDUCE_SUMSQ, REDUCE_MEAN_VAR)
+ * @param partials  scratch buffer of REDUCE_PARTIALS*NUM_CORES elements, to be allocated in L1 (TCDM)
+ * @param result    reduced value (sum, max or mean)
+ * @param var       variance (REDUCE_MEAN_VAR only, can be NULL otherwise)
+ * @param index     index of the max (REDUCE_ARGMAX only, can be NULL otherwise)
+*/
+struct reduce_args{
+  float* input;
+  int dim;
+  int op;
+  float* partials;
+  float* result;
+  float* var;
+  int* index;
+};
+
 /**
  * =====> FUNCTIONS <=====
  */
@@ -494,6 +578,22 @@ void pad_tensor (void * pad_args);
  */
 void mm_manager (void * void_args);
 
+/**
+ * @brief Updates a tile of weights with the gradient stored in the scratch buffer of the fused backward-and-update mode. Use pi_cl_team_fork(NUM_CORES, fused_update_tile, &args) to parallelize.
+ * @param (void *) (struct fused_update_tile_args void_args)
+ */
+void fused_update_tile (void * fused_update_tile_args);
+
+/**
+ * @brief Computes the weight gradient matmul described by mm_args in tiles of rows of the output into the scratch buffer of update, and updates the corresponding rows of the weights after each tile (fused backward-and-update). Forks internally.
+ * @param mm_args matmul of the weight gradient, whose output C (N x M) has the layout of the weights
+ * @param update configuration of the fused update
+ * @param weights weights of the layer to be updated
+ * @param layer_type type of layer, used by the mm_manager (e.g. LAYER_LINEAR)
+ * @param matmul_type matmul to be chosen by the mm_manager (see mm_manager_list.txt)
+ */
+void mm_fused_update (struct matMul_args * mm_args, struct fused_update_args * update, float * weights, int layer_type, int matmul_type);
+
 /**
  * @brief Calculates the exponential value of each element in the input vector/matrix.
  * @param (void *) (struct softmax_args void_args)
@@ -542,6 +642,12 @@ void pulp_div_fp32_cl(void* void_args);
  */
 void pulp_row_div_fp32_cl(void* void_args);
 
+/**
+ * @brief Row-wise softmax in a single fork: one sweep keeps the running max and the rescaled exponential sum, a second one normalizes multiplying by the reciprocal of the sum
+ * @param (void *)  (struct online_softmax_args void_args)
+ */
+void pulp_online_softmax_fp32_cl(void* void_args);
+
 /**
  * @brief Element-wise multiplication of vector with a single constant
  * @param (void *)  (struct scalar_mul_args void_args)
@@ -569,3 +675,65 @@ void pulp_mean_std_fp32_cl(void * mean_std_args);
 float fastexp_gist(float x);
 
 
+
+/**
+ * Cluster-wide reductions
+ **/
+
+/**
+ * @brief Sum of a value computed by each core, to be called by all the cores inside a fork (e.g. to reduce the partial results of a parallel kernel). The per-core values are combined with a tree in log2(NUM_CORES) steps. Returns the sum to all the cores.
+ * @param value     partial value of the calling core
+ * @param partials  scratch buffer of NUM_CORES elements in L1, shared by all the cores
+ */
+float pulp_team_sum(float value, float * partials);
+
+/**
+ * @brief Max of a value computed by each core, to be called by all the cores inside a fork. Returns the max to all the cores.
+ * @param value     partial value of the calling core
+ * @param partials  scratch buffer of NUM_CORES elements in L1, shared by all the cores
+ */
+float pulp_team_max(float value, float * partials);
+
+/**
+ * @brief Reduction of a whole tensor, to be called by all the cores inside a fork (e.g. within a layer kernel). When it returns, the results are available to all the cores.
+ * @param (void *)  (struct reduce_args void_args)
+ */
+void pulp_reduce_parallelized_cl(void * reduce_args);
+
+/**
+ * @brief Reduction of a whole tensor, to be called from a single core: forks pulp_reduce_parallelized_cl on NUM_CORES.
+ * @param (void *)  (struct reduce_args void_args)
+ */
+void pulp_reduce_cl(void * reduce_args);
+
+
+
+/**
+ * Persistent cluster team
+ **/
+
+/**
+ * @brief Non-zero while the cores execute inside pulp_team_run. Read by pulp_team_fork to decide whether to fork or to run the stage in place.
+ */
+extern int pulp_team_active;
+
+/**
+ * @brief Executes a parallel stage of a primitive. Called from a single core, it behaves as pi_cl_team_fork. Called by all the cores inside pulp_team_run, it executes fn in place on all the cores, with a barrier before and after the stage, so that the primitives can be chained without re-forking the cluster. All the primitives of the library fork their parallel stages through this function.
+ * @param nb_cores  number of cores that execute fn (inside pulp_team_run, it must be NUM_CORES, otherwise the stage is not executed)
+ * @param fn        parallel function (as passed to pi_cl_team_fork)
+ * @param args      arguments of fn
+ */
+void pulp_team_fork(int nb_cores, void (*fn)(void *), void * args);
+
+/**
+ * @brief Forks a single long-lived team on NUM_CORES and executes step on all the cores. Inside step, the primitives of the library (e.g. a whole training step: forward, loss, backward and optimizer) can be called by all the cores as from a single core, with their stages synchronized by pi_cl_team_barrier instead of pi_cl_team_fork. Code with side effects which is not part of the library (e.g. printf or updates of counters) must be executed by core 0 only and followed by pi_cl_team_barrier, as the serial state updates of the library do (e.g. pulp_loss_scaler_update_fp16, the cache length of pulp_mhsa_fp32_decode_cl). The arguments of the primitives can be declared on the stack of each core.
+ * @param step  function executed by all the cores of the team
+ * @param args  arguments of step
+ */
+void pulp_team_run(void (*step)(void *), void * args);
+
+/**
+ * @brief Returns a buffer shared by all the cores. Outside pulp_team_run, it returns ptr. Inside pulp_team_run, it must be called by all the cores and returns the ptr of core 0, so that a scratch buffer declared on the stack of a primitive (e.g. the partial sums of a reduction) is the same for all the cores. The buffer of core 0 must be in L1 and must stay alive until the last stage which uses it ends.
+ * @param ptr  buffer of the calling core
+ */
+void * pulp_team_share(void * ptr);
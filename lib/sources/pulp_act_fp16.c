@@ -26,13 +26,13 @@
 void pulp_sigmoid_fp16_fw_cl( void * act_args )
 {
   struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
-  pi_cl_team_fork(NUM_CORES, sigmoid_core_fw_fp16, act_args);
+  pulp_team_fork(NUM_CORES, sigmoid_core_fw_fp16, act_args);
 }
 
 void pulp_sigmoid_fp16_bw_cl( void * act_args )
 {
   struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
-  pi_cl_team_fork(NUM_CORES, sigmoid_core_bw_fp16, act_args);
+  pulp_team_fork(NUM_CORES, sigmoid_core_bw_fp16, act_args);
 }
 
 void sigmoid_core_fw_fp16( void * act_args )
@@ -106,60 +106,396 @@ void pulp_relu_fp16_bw_cl( void * act_args_fp16 )
 }
 
 
-void pulp_softmax_fp16_fw_cl( void * act_args_fp16 )
+void pulp_leakyrelu_fp16_fw_cl( void * leakyrelu_args_fp16 )
 {
-  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args_fp16;
+  pulp_team_fork(NUM_CORES, leakyrelu_core_fw_fp16, leakyrelu_args_fp16);
+}
+
+void pulp_leakyrelu_fp16_bw_cl( void * leakyrelu_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, leakyrelu_core_bw_fp16, leakyrelu_args_fp16);
+}
 
+void leakyrelu_core_fw_fp16( void * leakyrelu_args_fp16 )
+{
+  struct leakyrelu_args_fp16 * args = (struct leakyrelu_args_fp16 *) leakyrelu_args_fp16;
   int dim = args->input->dim;
   fp16* inData = args->input->data;
   fp16* outData = args->output->data;
+  fp16 slope = args->negative_slope;
+  v2f16 slope2 = (v2f16) {slope, slope};
 
-  /*
-  const int blockSize=(args_tanh->dim+NUM_CORES-1)/NUM_CORES;
+  // Parallelize over pairs of elements
+  const int n_pairs = dim >> 1;
+  const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
   const int start = pi_core_id()*blockSize;
-  const int stop = start + blockSize > args_tanh->dim ? args_tanh->dim : start+blockSize;
-  */
+  const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
 
-  short s = 0;
-  fp16 zero = (fp16) s;
+  for (int i=start; i<stop; i++) {
+    v2f16 x = *((v2f16 *) &inData[2*i]);
+    v2f16 neg = x * slope2;
+    v2f16 out = x;
+    if (x[0] <= 0) out[0] = neg[0];
+    if (x[1] <= 0) out[1] = neg[1];
+    *((v2f16 *) &outData[2*i]) = out;
+  }
+  // Leftover
+  if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+    outData[dim-1] = inData[dim-1] > 0 ? inData[dim-1] : slope * inData[dim-1];
+  }
+}
 
-  fp16 sum = zero;
-  fp16 sum2 = zero;
-  fp16 max = zero;
-  fp16 maxes[NUM_CORES] = {zero};
-  fp16 sums[NUM_CORES] = {zero};
+void leakyrelu_core_bw_fp16( void * leakyrelu_args_fp16 )
+{
+  struct leakyrelu_args_fp16 * args = (struct leakyrelu_args_fp16 *) leakyrelu_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+  fp16 slope = args->negative_slope;
+  v2f16 slope2 = (v2f16) {slope, slope};
+
+  const int n_pairs = dim >> 1;
+  const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+  for (int i=start; i<stop; i++) {
+    v2f16 x = *((v2f16 *) &inData[2*i]);
+    v2f16 dy = *((v2f16 *) &outDiff[2*i]);
+    v2f16 neg = dy * slope2;
+    if (x[0] <= 0) dy[0] = neg[0];
+    if (x[1] <= 0) dy[1] = neg[1];
+    *((v2f16 *) &inDiff[2*i]) = dy;
+  }
+  if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+    inDiff[dim-1] = inData[dim-1] > 0 ? outDiff[dim-1] : slope * outDiff[dim-1];
+  }
+}
+
+
+
+// Constants of GELU: 1/sqrt(2), 1/sqrt(2*pi), sqrt(2/pi) and the cubic coefficient of the tanh formulation
+#define GELU_INV_SQRT2      0.70710678f
+#define GELU_INV_SQRT2PI    0.39894228f
+#define GELU_SQRT_2_PI      0.79788456f
+#define GELU_CUBIC          0.044715f
+// Input clipping of the approximated GELU: beyond it, tanh is saturated (also avoids x^3 overflows in fp16)
+#define GELU_APPROX_SAT     4.5f
+// Input value at which the [5/4] Pade approximant of tanh reaches 1 (max error ~1.4e-3)
+#define PADE_TANH_SAT       3.64f
+
+/**
+ * Rational (Pade [5/4]) approximation of tanh on two fp16 lanes: y*(945+105y^2+y^4)/(945+420y^2+15y^4)
+ */
+static inline v2f16 pade_tanh_v2f16 (v2f16 y)
+{
+  y[0] = y[0] > PADE_TANH_SAT ? PADE_TANH_SAT : (y[0] < -PADE_TANH_SAT ? -PADE_TANH_SAT : y[0]);
+  y[1] = y[1] > PADE_TANH_SAT ? PADE_TANH_SAT : (y[1] < -PADE_TANH_SAT ? -PADE_TANH_SAT : y[1]);
+  v2f16 y2 = y * y;
+  v2f16 num = y * ((v2f16) {945.0f, 945.0f} + y2 * ((v2f16) {105.0f, 105.0f} + y2));
+  v2f16 den = (v2f16) {945.0f, 945.0f} + y2 * ((v2f16) {420.0f, 420.0f} + y2 * (v2f16) {15.0f, 15.0f});
+  return num / den;
+}
+
+static inline v2f16 clip_v2f16 (v2f16 x, fp16 sat)
+{
+  x[0] = x[0] > sat ? sat : (x[0] < -sat ? -sat : x[0]);
+  x[1] = x[1] > sat ? sat : (x[1] < -sat ? -sat : x[1]);
+  return x;
+}
+
+void pulp_gelu_fp16_fw_cl( void * act_approx_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, gelu_core_fw_fp16, act_approx_args_fp16);
+}
+
+void pulp_gelu_fp16_bw_cl( void * act_approx_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, gelu_core_bw_fp16, act_approx_args_fp16);
+}
+
+void gelu_core_fw_fp16( void * act_approx_args_fp16 )
+{
+  struct act_approx_args_fp16 * args = (struct act_approx_args_fp16 *) act_approx_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  if (args->approx == ACT_EXACT) {
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+    // 0.5 * x * (1 + erf(x / sqrt(2)))
+    for (int i=start; i<stop; i++) {
+      float x = (float) inData[i];
+      outData[i] = (fp16) (0.5f * x * (1.0f + erff(x * GELU_INV_SQRT2)));
+    }
+  }
+  else {
+    const int n_pairs = dim >> 1;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    const v2f16 half = (v2f16) {0.5f, 0.5f};
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+    const v2f16 k = (v2f16) {GELU_SQRT_2_PI, GELU_SQRT_2_PI};
+    const v2f16 c = (v2f16) {GELU_CUBIC, GELU_CUBIC};
+
+    // 0.5 * x * (1 + tanh(sqrt(2/pi) * (x + 0.044715 * x^3)))
+    for (int i=start; i<stop; i++) {
+      v2f16 x = *((v2f16 *) &inData[2*i]);
+      v2f16 xs = clip_v2f16(x, GELU_APPROX_SAT);
+      v2f16 t = pade_tanh_v2f16(k * (xs + c * xs * xs * xs));
+      *((v2f16 *) &outData[2*i]) = half * x * (one + t);
+    }
+    if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+      v2f16 x = (v2f16) {inData[dim-1], 0};
+      v2f16 xs = clip_v2f16(x, GELU_APPROX_SAT);
+      v2f16 t = pade_tanh_v2f16(k * (xs + c * xs * xs * xs));
+      outData[dim-1] = (half * x * (one + t))[0];
+    }
+  }
+}
+
+void gelu_core_bw_fp16( void * act_approx_args_fp16 )
+{
+  struct act_approx_args_fp16 * args = (struct act_approx_args_fp16 *) act_approx_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  if (args->approx == ACT_EXACT) {
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+    // Phi(x) + x * phi(x)
+    for (int i=start; i<stop; i++) {
+      float x = (float) inData[i];
+      float cdf = 0.5f * (1.0f + erff(x * GELU_INV_SQRT2));
+      float pdf = GELU_INV_SQRT2PI * expf(-0.5f * x * x);
+      inDiff[i] = (fp16) ((float) outDiff[i] * (cdf + x * pdf));
+    }
+  }
+  else {
+    const int n_pairs = dim >> 1;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    const v2f16 half = (v2f16) {0.5f, 0.5f};
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+    const v2f16 k = (v2f16) {GELU_SQRT_2_PI, GELU_SQRT_2_PI};
+    const v2f16 c = (v2f16) {GELU_CUBIC, GELU_CUBIC};
+    const v2f16 c3 = (v2f16) {3.0f*GELU_CUBIC, 3.0f*GELU_CUBIC};
+
+    // 0.5 * (1 + t) + 0.5 * x * (1 - t^2) * sqrt(2/pi) * (1 + 3 * 0.044715 * x^2), with x clipped where tanh saturates
+    for (int i=start; i<stop; i++) {
+      v2f16 x = clip_v2f16(*((v2f16 *) &inData[2*i]), GELU_APPROX_SAT);
+      v2f16 x2 = x * x;
+      v2f16 t = pade_tanh_v2f16(k * (x + c * x2 * x));
+      v2f16 grad = half * (one + t) + half * x * (one - t * t) * k * (one + c3 * x2);
+      *((v2f16 *) &inDiff[2*i]) = *((v2f16 *) &outDiff[2*i]) * grad;
+    }
+    if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+      v2f16 x = clip_v2f16((v2f16) {inData[dim-1], 0}, GELU_APPROX_SAT);
+      v2f16 x2 = x * x;
+      v2f16 t = pade_tanh_v2f16(k * (x + c * x2 * x));
+      v2f16 grad = half * (one + t) + half * x * (one - t * t) * k * (one + c3 * x2);
+      inDiff[dim-1] = outDiff[dim-1] * grad[0];
+    }
+  }
+}
+
+
+
+void pulp_silu_fp16_fw_cl( void * act_approx_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, silu_core_fw_fp16, act_approx_args_fp16);
+}
+
+void pulp_silu_fp16_bw_cl( void * act_approx_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, silu_core_bw_fp16, act_approx_args_fp16);
+}
+
+void silu_core_fw_fp16( void * act_approx_args_fp16 )
+{
+  struct act_approx_args_fp16 * args = (struct act_approx_args_fp16 *) act_approx_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  if (args->approx == ACT_EXACT) {
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+      float x = (float) inData[i];
+      outData[i] = (fp16) (x / (1.0f + expf(-x)));
+    }
+  }
+  else {
+    const int n_pairs = dim >> 1;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    const v2f16 half = (v2f16) {0.5f, 0.5f};
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+    // sigma(x) = 0.5 * (1 + tanh(x / 2))
+    for (int i=start; i<stop; i++) {
+      v2f16 x = *((v2f16 *) &inData[2*i]);
+      v2f16 sigma = half * (one + pade_tanh_v2f16(half * x));
+      *((v2f16 *) &outData[2*i]) = x * sigma;
+    }
+    if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+      v2f16 x = (v2f16) {inData[dim-1], 0};
+      v2f16 sigma = half * (one + pade_tanh_v2f16(half * x));
+      outData[dim-1] = (x * sigma)[0];
+    }
+  }
+}
+
+void silu_core_bw_fp16( void * act_approx_args_fp16 )
+{
+  struct act_approx_args_fp16 * args = (struct act_approx_args_fp16 *) act_approx_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  // sigma(x) * (1 + x * (1 - sigma(x)))
+  if (args->approx == ACT_EXACT) {
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+      float x = (float) inData[i];
+      float sigma = 1.0f / (1.0f + expf(-x));
+      inDiff[i] = (fp16) ((float) outDiff[i] * sigma * (1.0f + x * (1.0f - sigma)));
+    }
+  }
+  else {
+    const int n_pairs = dim >> 1;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    const v2f16 half = (v2f16) {0.5f, 0.5f};
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+    for (int i=start; i<stop; i++) {
+      v2f16 x = *((v2f16 *) &inData[2*i]);
+      v2f16 sigma = half * (one + pade_tanh_v2f16(half * x));
+      *((v2f16 *) &inDiff[2*i]) = *((v2f16 *) &outDiff[2*i]) * sigma * (one + x * (one - sigma));
+    }
+    if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+      v2f16 x = (v2f16) {inData[dim-1], 0};
+      v2f16 sigma = half * (one + pade_tanh_v2f16(half * x));
+      inDiff[dim-1] = outDiff[dim-1] * (sigma * (one + x * (one - sigma)))[0];
+    }
+  }
+}
+
+
+
+void pulp_hardswish_fp16_fw_cl( void * act_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, hardswish_core_fw_fp16, act_args_fp16);
+}
 
-  
-  struct max_args_fp16 m_args;
-  m_args.input = inData;
-  m_args.maxes = maxes;
-  m_args.dim = dim;
+void pulp_hardswish_fp16_bw_cl( void * act_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, hardswish_core_bw_fp16, act_args_fp16);
+}
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_max_fp16_cl, &m_args);
+void hardswish_core_fw_fp16( void * act_args_fp16 )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  const int n_pairs = dim >> 1;
+  const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
 
-  for(int i=0; i<NUM_CORES; i++)
-    if(max < maxes[i])
-      max = maxes[i];
-  
-  struct exp_sum_args_fp16 e_s_args;
-  e_s_args.input = inData;
-  e_s_args.sums = sums;
-  e_s_args.output = outData;
-  e_s_args.dim = dim;
-  e_s_args.max = max;
-  
-  pi_cl_team_fork(NUM_CORES, pulp_exp_sum_fp16_cl, &e_s_args);
+  const v2f16 three = (v2f16) {3.0f, 3.0f};
+  const v2f16 sixth = (v2f16) {0.16666667f, 0.16666667f};
 
-  for(int i=0; i<NUM_CORES; i++){
-    sum += sums[i];
+  // x * relu6(x + 3) / 6
+  for (int i=start; i<stop; i++) {
+    v2f16 x = *((v2f16 *) &inData[2*i]);
+    v2f16 r6 = clip_v2f16(x, 3.0f) + three;
+    *((v2f16 *) &outData[2*i]) = x * r6 * sixth;
+  }
+  if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+    fp16 x = inData[dim-1];
+    fp16 r6 = x + 3.0f;
+    r6 = r6 < 0 ? 0 : (r6 > 6.0f ? 6.0f : r6);
+    outData[dim-1] = x * r6 * 0.16666667f;
   }
+}
 
-  struct row_div_args_fp16 d_args;
-  d_args.input = outData;
-  d_args.n = sum;
-  d_args.dim = dim;
+void hardswish_core_bw_fp16( void * act_args_fp16 )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  const int n_pairs = dim >> 1;
+  const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_div_fp16_cl, &d_args);
+  const v2f16 three = (v2f16) {3.0f, 3.0f};
+  const v2f16 sixth = (v2f16) {0.16666667f, 0.16666667f};
+
+  // Same convention of PyTorch at the boundaries: 0 for x < -3, 1 for x > 3, (2x + 3) / 6 otherwise
+  for (int i=start; i<stop; i++) {
+    v2f16 x = *((v2f16 *) &inData[2*i]);
+    v2f16 grad = (x + x + three) * sixth;
+    if (x[0] < -3.0f) grad[0] = 0;  else if (x[0] > 3.0f) grad[0] = 1.0f;
+    if (x[1] < -3.0f) grad[1] = 0;  else if (x[1] > 3.0f) grad[1] = 1.0f;
+    *((v2f16 *) &inDiff[2*i]) = *((v2f16 *) &outDiff[2*i]) * grad;
+  }
+  if ((dim & 1) && pi_core_id() == NUM_CORES-1) {
+    fp16 x = inData[dim-1];
+    fp16 grad = x < -3.0f ? 0 : (x > 3.0f ? 1.0f : (2.0f * x + 3.0f) * 0.16666667f);
+    inDiff[dim-1] = outDiff[dim-1] * grad;
+  }
+}
+
+
+void pulp_softmax_fp16_fw_cl( void * act_args_fp16 )
+{
+  struct softmax_args_fp16 * args = (struct softmax_args_fp16 *) act_args_fp16;
+
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  // Max, exponential sum and normalization of each row in a single fork
+  struct online_softmax_args_fp16 o_s_args;
+  o_s_args.input = inData;
+  o_s_args.output = outData;
+  o_s_args.maxes = args->maxes;
+  o_s_args.sums = args->sums;
+  o_s_args.n_rows = dim;
+  o_s_args.dim = dim;
+
+  pulp_team_fork(NUM_CORES, pulp_online_softmax_fp16_cl, &o_s_args);
 }
 
 void pulp_softmax_fp16_bw_cl( void * act_args_fp16 )
@@ -189,4 +525,128 @@ void pulp_softmax_fp16_bw_cl( void * act_args_fp16 )
   for(int j=0; j<dim; j++){
       inDiff[j] += (outData)[j] * (outDiff)[j]; // Gradient of pre-softmax head buffer: (L x L)
   }
-}
\ No newline at end of file
+}
+
+void pulp_row_softmax_fp16_bw_cl( void * softmax_bw_args_fp16 )
+{
+  pulp_team_fork(NUM_CORES, row_softmax_core_bw_fp16, softmax_bw_args_fp16);
+}
+
+void row_softmax_core_bw_fp16( void * softmax_bw_args_fp16 )
+{
+  struct softmax_bw_args_fp16 * args = (struct softmax_bw_args_fp16 *) softmax_bw_args_fp16;
+  int n_rows = args->n_rows;
+  int dim = args->dim;
+  fp16* inDiff = args->input->diff;
+  fp16* outData = args->output->data;
+  fp16* outDiff = args->output->diff;
+
+  const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+  for(int i=start; i<stop; i++){
+    fp16* y = outData + i*dim;
+    fp16* dy = outDiff + i*dim;
+    fp16* dx = inDiff + i*dim;
+
+    // dx_j = y_j * (dy_j - sum_z(dy_z * y_z))
+    fp16 dot = 0;
+    for(int z=0; z<dim; z++)
+      dot += dy[z] * y[z];
+    for(int j=0; j<dim; j++)
+      dx[j] = y[j] * (dy[j] - dot);
+  }
+}
+
+// Exponential term of the partial softmax variants, computed on two elements of a row at once
+static inline v2f16 partial_softmax_exp_v2f16( v2f16 x, v2f16 max, int type )
+{
+  const fp16 eps_max = 0.03125f;
+  const fp16 eps_max_log2 = 0.0216608493924983f;  // eps_max * log(2)
+
+  if      (type == SOFTMAX_PARTIAL)         return fastexp_gist_v2f16((x - max) * (v2f16) {eps_max_log2, eps_max_log2});
+  else if (type == SOFTMAX_PARTIAL_SHIFT)   return pow2_shift_v2f16((max - x) * (v2f16) {eps_max, eps_max});
+  else if (type == SOFTMAX_PARTIAL_APPROX)  return threshold_v2f16((max - x) * (v2f16) {eps_max, eps_max});
+  else                                      return threshold_v2f16(max - x);
+}
+
+// Partial softmax of the n_heads*L rows (each one L elements long), parallelized over the rows
+static inline void partial_softmax_core_fp16( void * act_args, int type )
+{
+  struct softmax_args_fp16 * args = (struct softmax_args_fp16 *) act_args;
+
+  int L = args->L;
+  int n_rows = args->n_heads * L;
+  fp16 * inData = args->input->data;
+  fp16 * outData = args->output->data;
+  fp16 * maxes = args->maxes;
+  fp16 * sums = args->sums;
+
+  const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+  for(int i=start; i<stop; i++){
+    fp16* in_row = inData + i*L;
+    fp16* out_row = outData + i*L;
+
+    //STAGE 1: Row max
+    fp16 max = in_row[0];
+    for(int k=1; k<L; k++)
+      if(max < in_row[k])
+        max = in_row[k];
+
+    //STAGE 2: Exponentials and their sum, two elements at a time
+    v2f16 vmax = (v2f16) {max, max};
+    v2f16 vsum = (v2f16) {0, 0};
+    int k = 0;
+    for(; k<L-1; k+=2){
+      v2f16 e = partial_softmax_exp_v2f16(*((v2f16 *) &in_row[k]), vmax, type);
+      *((v2f16 *) &out_row[k]) = e;
+      vsum += e;
+    }
+    if(L & 1){
+      v2f16 e = partial_softmax_exp_v2f16((v2f16) {in_row[L-1], max}, vmax, type);
+      out_row[L-1] = e[0];
+      vsum[0] += e[0];
+    }
+    fp16 sum = vsum[0] + vsum[1];
+
+    //STAGE 3: Normalize by multiplying with the reciprocal of the sum
+    fp16 inv_sum = 1 / sum;
+    v2f16 vinv = (v2f16) {inv_sum, inv_sum};
+    for(k=0; k<L-1; k+=2)
+      *((v2f16 *) &out_row[k]) = *((v2f16 *) &out_row[k]) * vinv;
+    if(L & 1)
+      out_row[L-1] = out_row[L-1] * inv_sum;
+
+    if(maxes != NULL) maxes[i] = max;
+    if(sums != NULL) sums[i] = sum;
+  }
+}
+
+void pulp_partial_softmax_simple_fp16_fw_cl( void * act_args )
+{
+  pulp_team_fork(NUM_CORES, partial_softmax_simple_core_fw_fp16, act_args);
+}
+
+void partial_softmax_simple_core_fw_fp16( void * act_args )
+{
+  partial_softmax_core_fp16(act_args, SOFTMAX_SIMPLE);
+}
+
+void pulp_partial_softmax_fp16_fw_cl( void * act_args )
+{
+  partial_softmax_core_fp16(act_args, SOFTMAX_PARTIAL);
+}
+
+void pulp_partial_softmax_shift_fp16_fw_cl( void * act_args )
+{
+  partial_softmax_core_fp16(act_args, SOFTMAX_PARTIAL_SHIFT);
+}
+
+void pulp_partial_softmax_approximate_fp16_fw_cl( void * act_args )
+{
+  partial_softmax_core_fp16(act_args, SOFTMAX_PARTIAL_APPROX);
+}
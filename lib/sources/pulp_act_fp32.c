@@ -26,13 +26,13 @@
 void pulp_sigmoid_fp32_fw_cl( void * act_args )
 {
   struct act_args * args = (struct act_args *) act_args;
-  pi_cl_team_fork(NUM_CORES, sigmoid_core_fw_fp32, act_args);
+  pulp_team_fork(NUM_CORES, sigmoid_core_fw_fp32, act_args);
 }
 
 void pulp_sigmoid_fp32_bw_cl( void * act_args )
 {
   struct act_args * args = (struct act_args *) act_args;
-  pi_cl_team_fork(NUM_CORES, sigmoid_core_bw_fp32, act_args);
+  pulp_team_fork(NUM_CORES, sigmoid_core_bw_fp32, act_args);
 }
 
 void sigmoid_core_fw_fp32( void * act_args )
@@ -107,40 +107,278 @@ void pulp_relu_fp32_bw_cl( void * act_args )
 }
 
 
-void pulp_softmax_fp32_fw_cl( void * act_args )
+void pulp_leakyrelu_fp32_fw_cl( void * leakyrelu_args )
 {
-  struct softmax_args * args = (struct softmax_args *) act_args;
+  pulp_team_fork(NUM_CORES, leakyrelu_core_fw_fp32, leakyrelu_args);
+}
+
+void pulp_leakyrelu_fp32_bw_cl( void * leakyrelu_args )
+{
+  pulp_team_fork(NUM_CORES, leakyrelu_core_bw_fp32, leakyrelu_args);
+}
 
+void leakyrelu_core_fw_fp32( void * leakyrelu_args )
+{
+  struct leakyrelu_args * args = (struct leakyrelu_args *) leakyrelu_args;
   int dim = args->input->dim;
   float* inData = args->input->data;
   float* outData = args->output->data;
+  float slope = args->negative_slope;
 
-  float* maxes = args->maxes;
-  float* sums = args->sums;
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-  struct max_args m_args;
-  m_args.input = inData;
-  m_args.maxes = maxes;
-  m_args.dim = dim;
+  for (int i=start; i<stop; i++) {
+    outData[i] = inData[i] > 0 ? inData[i] : slope * inData[i];
+  }
+}
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_max_fp32_cl, &m_args);
-  
-  struct exp_sum_args e_s_args;
-  e_s_args.input = inData;
-  e_s_args.sums = sums;
-  e_s_args.output = outData;
-  e_s_args.dim = dim;
-  e_s_args.maxes = maxes;
-  
-  pi_cl_team_fork(NUM_CORES, pulp_exp_sum_fp32_cl, &e_s_args);
+void leakyrelu_core_bw_fp32( void * leakyrelu_args )
+{
+  struct leakyrelu_args * args = (struct leakyrelu_args *) leakyrelu_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+  float slope = args->negative_slope;
 
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i=start; i<stop; i++) {
+    inDiff[i] = inData[i] > 0 ? outDiff[i] : slope * outDiff[i];
+  }
+}
+
+
+
+// Constants of GELU: 1/sqrt(2), 1/sqrt(2*pi), sqrt(2/pi) and the cubic coefficient of the tanh formulation
+#define GELU_INV_SQRT2      0.70710678f
+#define GELU_INV_SQRT2PI    0.39894228f
+#define GELU_SQRT_2_PI      0.79788456f
+#define GELU_CUBIC          0.044715f
+// Beyond this value, tanh is saturated in float precision (avoids the overflow of fastpow2)
+#define FAST_TANH_SAT       9.0f
+
+void pulp_gelu_fp32_fw_cl( void * act_approx_args )
+{
+  pulp_team_fork(NUM_CORES, gelu_core_fw_fp32, act_approx_args);
+}
+
+void pulp_gelu_fp32_bw_cl( void * act_approx_args )
+{
+  pulp_team_fork(NUM_CORES, gelu_core_bw_fp32, act_approx_args);
+}
+
+void gelu_core_fw_fp32( void * act_approx_args )
+{
+  struct act_approx_args * args = (struct act_approx_args *) act_approx_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  if (args->approx == ACT_EXACT) {
+    // 0.5 * x * (1 + erf(x / sqrt(2)))
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      outData[i] = 0.5f * x * (1.0f + erff(x * GELU_INV_SQRT2));
+    }
+  }
+  else {
+    // 0.5 * x * (1 + tanh(sqrt(2/pi) * (x + 0.044715 * x^3)))
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float u = GELU_SQRT_2_PI * (x + GELU_CUBIC * x * x * x);
+      u = u > FAST_TANH_SAT ? FAST_TANH_SAT : (u < -FAST_TANH_SAT ? -FAST_TANH_SAT : u);
+      outData[i] = 0.5f * x * (1.0f + fasttanh(u));
+    }
+  }
+}
+
+void gelu_core_bw_fp32( void * act_approx_args )
+{
+  struct act_approx_args * args = (struct act_approx_args *) act_approx_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  if (args->approx == ACT_EXACT) {
+    // Phi(x) + x * phi(x)
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float cdf = 0.5f * (1.0f + erff(x * GELU_INV_SQRT2));
+      float pdf = GELU_INV_SQRT2PI * expf(-0.5f * x * x);
+      inDiff[i] = outDiff[i] * (cdf + x * pdf);
+    }
+  }
+  else {
+    // 0.5 * (1 + t) + 0.5 * x * (1 - t^2) * sqrt(2/pi) * (1 + 3 * 0.044715 * x^2)
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float x2 = x * x;
+      float u = GELU_SQRT_2_PI * (x + GELU_CUBIC * x2 * x);
+      u = u > FAST_TANH_SAT ? FAST_TANH_SAT : (u < -FAST_TANH_SAT ? -FAST_TANH_SAT : u);
+      float t = fasttanh(u);
+      float du = GELU_SQRT_2_PI * (1.0f + 3.0f * GELU_CUBIC * x2);
+      inDiff[i] = outDiff[i] * (0.5f * (1.0f + t) + 0.5f * x * (1.0f - t * t) * du);
+    }
+  }
+}
 
-  struct row_div_args r_d_args;
-  r_d_args.input = outData;
-  r_d_args.sums = sums;
-  r_d_args.dim = dim;
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_div_fp32_cl, &r_d_args);
+
+// Beyond this value, the sigmoid is saturated in float precision (avoids the overflow of fastpow2)
+#define FAST_SIGMOID_SAT    20.0f
+
+void pulp_silu_fp32_fw_cl( void * act_approx_args )
+{
+  pulp_team_fork(NUM_CORES, silu_core_fw_fp32, act_approx_args);
+}
+
+void pulp_silu_fp32_bw_cl( void * act_approx_args )
+{
+  pulp_team_fork(NUM_CORES, silu_core_bw_fp32, act_approx_args);
+}
+
+void silu_core_fw_fp32( void * act_approx_args )
+{
+  struct act_approx_args * args = (struct act_approx_args *) act_approx_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  if (args->approx == ACT_EXACT) {
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      outData[i] = x / (1.0f + expf(-x));
+    }
+  }
+  else {
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float xc = x < -FAST_SIGMOID_SAT ? -FAST_SIGMOID_SAT : x;
+      outData[i] = x / (1.0f + fastexp(-xc));
+    }
+  }
+}
+
+void silu_core_bw_fp32( void * act_approx_args )
+{
+  struct act_approx_args * args = (struct act_approx_args *) act_approx_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  // sigma(x) * (1 + x * (1 - sigma(x)))
+  if (args->approx == ACT_EXACT) {
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float sigma = 1.0f / (1.0f + expf(-x));
+      inDiff[i] = outDiff[i] * sigma * (1.0f + x * (1.0f - sigma));
+    }
+  }
+  else {
+    for (int i=start; i<stop; i++) {
+      float x = inData[i];
+      float xc = x < -FAST_SIGMOID_SAT ? -FAST_SIGMOID_SAT : x;
+      float sigma = 1.0f / (1.0f + fastexp(-xc));
+      inDiff[i] = outDiff[i] * sigma * (1.0f + x * (1.0f - sigma));
+    }
+  }
+}
+
+
+
+void pulp_hardswish_fp32_fw_cl( void * act_args )
+{
+  pulp_team_fork(NUM_CORES, hardswish_core_fw_fp32, act_args);
+}
+
+void pulp_hardswish_fp32_bw_cl( void * act_args )
+{
+  pulp_team_fork(NUM_CORES, hardswish_core_bw_fp32, act_args);
+}
+
+void hardswish_core_fw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  // x * relu6(x + 3) / 6
+  for (int i=start; i<stop; i++) {
+    float x = inData[i];
+    float r6 = x + 3.0f;
+    r6 = r6 < 0.0f ? 0.0f : (r6 > 6.0f ? 6.0f : r6);
+    outData[i] = x * r6 * 0.16666667f;
+  }
+}
+
+void hardswish_core_bw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  // Same convention of PyTorch at the boundaries: 0 for x < -3, 1 for x > 3, (2x + 3) / 6 otherwise
+  for (int i=start; i<stop; i++) {
+    float x = inData[i];
+    float grad = x < -3.0f ? 0.0f : (x > 3.0f ? 1.0f : (2.0f * x + 3.0f) * 0.16666667f);
+    inDiff[i] = outDiff[i] * grad;
+  }
+}
+
+
+void pulp_softmax_fp32_fw_cl( void * act_args )
+{
+  struct softmax_args * args = (struct softmax_args *) act_args;
+
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  // Max, exponential sum and normalization of each row in a single fork
+  struct online_softmax_args o_s_args;
+  o_s_args.input = inData;
+  o_s_args.output = outData;
+  o_s_args.maxes = args->maxes;
+  o_s_args.sums = args->sums;
+  o_s_args.lse = NULL;
+  o_s_args.n_rows = dim;
+  o_s_args.dim = dim;
+
+  pulp_team_fork(NUM_CORES, pulp_online_softmax_fp32_cl, &o_s_args);
 
   #ifdef DEBUG
     if(pi_core_id()==0){
@@ -173,7 +411,7 @@ void pulp_partial_softmax_simple_fp32_fw_cl( void * act_args )
   m_args.dim = dim;
   m_args.dim2 = dim2;
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_max_fp32_cl, &m_args);
+  pulp_team_fork(NUM_CORES, pulp_row_max_fp32_cl, &m_args);
 
   struct shift_sum_args ss_args;
   ss_args.input = inData;
@@ -183,7 +421,7 @@ void pulp_partial_softmax_simple_fp32_fw_cl( void * act_args )
   ss_args.dim2 = dim2;
   ss_args.maxes = maxes;
 
-  pi_cl_team_fork(NUM_CORES, pulp_shift_sum_fp32_cl, &ss_args);
+  pulp_team_fork(NUM_CORES, pulp_shift_sum_fp32_cl, &ss_args);
 
 
   struct row_div_args r_d_args;
@@ -192,7 +430,7 @@ void pulp_partial_softmax_simple_fp32_fw_cl( void * act_args )
   r_d_args.dim = dim;
   r_d_args.dim2 = dim2;
 
-  pi_cl_team_fork(NUM_CORES, pulp_row_div_fp32_cl, &r_d_args);
+  pulp_team_fork(NUM_CORES, pulp_row_div_fp32_cl, &r_d_args);
 }
 
 void pulp_softmax_fp32_bw_cl( void * act_args )
@@ -220,6 +458,38 @@ void pulp_softmax_fp32_bw_cl( void * act_args )
   }
 }
 
+void pulp_row_softmax_fp32_bw_cl( void * softmax_bw_args )
+{
+  pulp_team_fork(NUM_CORES, row_softmax_core_bw_fp32, softmax_bw_args);
+}
+
+void row_softmax_core_bw_fp32( void * softmax_bw_args )
+{
+  struct softmax_bw_args * args = (struct softmax_bw_args *) softmax_bw_args;
+  int n_rows = args->n_rows;
+  int dim = args->dim;
+  float* inDiff = args->input->diff;
+  float* outData = args->output->data;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+  for(int i=start; i<stop; i++){
+    float* y = outData + i*dim;
+    float* dy = outDiff + i*dim;
+    float* dx = inDiff + i*dim;
+
+    // dx_j = y_j * (dy_j - sum_z(dy_z * y_z))
+    float dot = 0.0f;
+    for(int z=0; z<dim; z++)
+      dot += dy[z] * y[z];
+    for(int j=0; j<dim; j++)
+      dx[j] = y[j] * (dy[j] - dot);
+  }
+}
+
 
 void pulp_partial_softmax_fp32_fw_cl( void * act_args )
 {
@@ -80,7 +80,7 @@ void pulp_conv2d_fp32_fw_cl( void * Conv2D_args )
         im2col_args.USE_DMA = USE_DMA;
         im2col_args.HWC = HWC_layout;
 
-        pi_cl_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
+        pulp_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
 
         matMul_args.A = coeffData;
         matMul_args.B = i2c_buffer;
@@ -91,14 +91,14 @@ void pulp_conv2d_fp32_fw_cl( void * Conv2D_args )
         matMul_args.trans_B = 1;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+        pulp_team_fork(NUM_CORES, mm, &matMul_args);
         #else
         struct mm_manager_args man_args;
         man_args.mm_args = &matMul_args;
         man_args.layer_type = LAYER_CONV2D;
         man_args.step_type = STEP_FW;
         man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+        pulp_team_fork(NUM_CORES, mm_manager, &man_args);
         #endif
       }
 
@@ -121,7 +121,7 @@ void pulp_conv2d_fp32_fw_cl( void * Conv2D_args )
       im2col_args.USE_DMA = USE_DMA;
       im2col_args.HWC = HWC_layout;
 
-      pi_cl_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
+      pulp_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
 
       matMul_args.A = i2c_buffer;
       matMul_args.B = coeffData;
@@ -132,14 +132,14 @@ void pulp_conv2d_fp32_fw_cl( void * Conv2D_args )
       matMul_args.trans_B = 1;
 
       #ifndef OPTIMIZE
-      pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+      pulp_team_fork(NUM_CORES, mm, &matMul_args);
       #else
       struct mm_manager_args man_args;
       man_args.mm_args = &matMul_args;
       man_args.layer_type = LAYER_CONV2D;
       man_args.step_type = STEP_FW;
       man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-      pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+      pulp_team_fork(NUM_CORES, mm_manager, &man_args);
       #endif     
     }
     else {
@@ -173,7 +173,7 @@ void pulp_conv2d_fp32_fw_cl( void * Conv2D_args )
       matMul_args.Upad = Upad;
       matMul_args.Dpad = Dpad;
 
-      pi_cl_team_fork(NUM_CORES, naive_conv2d_fw_kernel_CHW, &matMul_args);
+      pulp_team_fork(NUM_CORES, naive_conv2d_fw_kernel_CHW, &matMul_args);
     }
 
     /**
@@ -200,6 +200,14 @@ void pulp_conv2d_fp32_bw_cl( void * Conv2D_args )
     struct Conv2D_args * C2D_args = (struct Conv2D_args *) Conv2D_args;
     int skip_in_grad = C2D_args->skip_in_grad;
 
+    // The fused update modifies the weights, so the input gradient has to be computed first
+    if (C2D_args->fused_update != NULL)
+    {
+      if (skip_in_grad == 0)  pulp_conv2d_fp32_bw_input_grads_cl(Conv2D_args);
+      pulp_conv2d_fp32_bw_param_grads_cl(Conv2D_args);
+      return;
+    }
+
     pulp_conv2d_fp32_bw_param_grads_cl(Conv2D_args); 
     if (skip_in_grad == 0)
     {
@@ -273,7 +281,7 @@ void pulp_conv2d_fp32_bw_param_grads_cl( void * Conv2D_args )
       im2col_args.USE_DMA = USE_DMA;
       im2col_args.HWC = HWC_layout;
 
-      pi_cl_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
+      pulp_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
 
       matMul_args.A = outDiff;
       matMul_args.B = i2c_buffer;
@@ -283,16 +291,21 @@ void pulp_conv2d_fp32_bw_param_grads_cl( void * Conv2D_args )
       matMul_args.M = pW*pH*C_in; 
       matMul_args.trans_B = 0;
 
+      if (C2D_args->fused_update != NULL) {
+        mm_fused_update(&matMul_args, C2D_args->fused_update, coeffData, LAYER_CONV2D, opt_matmul_type);
+      }
+      else {
       #ifndef OPTIMIZE
-      pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+      pulp_team_fork(NUM_CORES, mm, &matMul_args);
       #else
       struct mm_manager_args man_args;
       man_args.mm_args = &matMul_args;
       man_args.layer_type = LAYER_CONV2D;
       man_args.step_type = STEP_WGT_GRAD;
       man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-      pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+      pulp_team_fork(NUM_CORES, mm_manager, &man_args);
       #endif
+      }
     }
   
     /**
@@ -313,14 +326,14 @@ void pulp_conv2d_fp32_bw_param_grads_cl( void * Conv2D_args )
       im2col_args.USE_DMA = USE_DMA;
       im2col_args.HWC = HWC_layout;
 
-      pi_cl_team_fork(NUM_CORES, pulp_im2col_fp32, &im2col_args);
+      pulp_team_fork(NUM_CORES, pulp_im2col_fp32, &im2col_args);
 
       struct transp_args tr_args;
       tr_args.matrix = outDiff;
       tr_args.transp_matrix = tr_buffer;
       tr_args.M = C_out;
       tr_args.N = H_out*W_out;
-      pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+      pulp_team_fork(NUM_CORES, transpose, &tr_args);
 
       matMul_args.A = tr_buffer; // outDiff;
       matMul_args.B = i2c_buffer;
@@ -330,16 +343,21 @@ void pulp_conv2d_fp32_bw_param_grads_cl( void * Conv2D_args )
       matMul_args.M = pW*pH*C_in; 
       matMul_args.trans_B = 1;
 
+      if (C2D_args->fused_update != NULL) {
+        mm_fused_update(&matMul_args, C2D_args->fused_update, coeffData, LAYER_CONV2D, opt_matmul_type);
+      }
+      else {
       #ifndef OPTIMIZE
-      pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+      pulp_team_fork(NUM_CORES, mm, &matMul_args);
       #else
       struct mm_manager_args man_args;
       man_args.mm_args = &matMul_args;
       man_args.layer_type = LAYER_CONV2D;
       man_args.step_type = STEP_WGT_GRAD;
       man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-      pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+      pulp_team_fork(NUM_CORES, mm_manager, &man_args);
       #endif     
+      }
     }
     else {
       printf("[pulp_conv2d_fp32_bw_param_grads_cl:] Invalid data layout format (HWC or CHW)!\n");
@@ -372,7 +390,32 @@ void pulp_conv2d_fp32_bw_param_grads_cl( void * Conv2D_args )
       matMul_args.Upad = Upad;
       matMul_args.Dpad = Dpad;
 
-      pi_cl_team_fork(NUM_CORES, naive_conv2d_param_grad_kernel_CHW, &matMul_args);
+      if (C2D_args->fused_update != NULL) {
+        // Fused update, on tiles of output channels of the weight gradient
+        struct fused_update_args * update = C2D_args->fused_update;
+        int ker_size = pW*pH*C_in;
+        int tile_co = update->buffer_size / ker_size;
+        if (tile_co < 1) {
+          printf("[pulp_conv2d_fp32_bw_param_grads_cl:] Fused update buffer too small for one output channel!\n");
+          return;
+        }
+        struct fused_update_tile_args upd_args;
+        upd_args.update = update;
+        upd_args.weights = coeffData;
+        matMul_args.B = update->buffer;
+        for (int co=0; co<C_out; co+=tile_co) {
+          int n_co = C_out-co < tile_co ? C_out-co : tile_co;
+          matMul_args.C = outDiff + co*H_out*W_out;
+          matMul_args.pCout = n_co;
+          pulp_team_fork(NUM_CORES, naive_conv2d_param_grad_kernel_CHW, &matMul_args);
+          upd_args.offset = co*ker_size;
+          upd_args.size = n_co*ker_size;
+          pulp_team_fork(NUM_CORES, fused_update_tile, &upd_args);
+        }
+      }
+      else {
+        pulp_team_fork(NUM_CORES, naive_conv2d_param_grad_kernel_CHW, &matMul_args);
+      }
     }
 
     /**
@@ -457,7 +500,7 @@ void pulp_conv2d_fp32_bw_input_grads_cl( void * Conv2D_args )
       im2col_args.USE_DMA = USE_DMA; 
       im2col_args.HWC = HWC_layout;
 
-      pi_cl_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
+      pulp_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
 
       // Blocktranspose weights
       struct blocktransp_args bt_args;
@@ -477,17 +520,17 @@ void pulp_conv2d_fp32_bw_input_grads_cl( void * Conv2D_args )
       matMul_args.M = W_in*H_in;
       matMul_args.trans_B = 1;
 
-      pi_cl_team_fork(NUM_CORES, pulp_blocktransp_fp32, &bt_args);
+      pulp_team_fork(NUM_CORES, pulp_blocktransp_fp32, &bt_args);
 
       #ifndef OPTIMIZE
-      pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+      pulp_team_fork(NUM_CORES, mm, &matMul_args);
       #else
       struct mm_manager_args man_args;
       man_args.mm_args = &matMul_args;
       man_args.layer_type = LAYER_CONV2D;
       man_args.step_type = STEP_IN_GRAD;
       man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-      pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+      pulp_team_fork(NUM_CORES, mm_manager, &man_args);
       #endif
     }
 
@@ -510,7 +553,7 @@ void pulp_conv2d_fp32_bw_input_grads_cl( void * Conv2D_args )
       im2col_args.USE_DMA = USE_DMA; 
       im2col_args.HWC = HWC_layout;
 
-      pi_cl_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
+      pulp_team_fork(NUM_CORES, pulp_im2row_fp32, &im2col_args);
 
       // Blocktranspose weights
       struct blocktransp_args bt_args;
@@ -530,17 +573,17 @@ void pulp_conv2d_fp32_bw_input_grads_cl( void * Conv2D_args )
       matMul_args.M = C_in;
       matMul_args.trans_B = 1;
 
-      pi_cl_team_fork(NUM_CORES, pulp_blocktransp_fp32, &bt_args);
+      pulp_team_fork(NUM_CORES, pulp_blocktransp_fp32, &bt_args);
 
       #ifndef OPTIMIZE
-      pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+      pulp_team_fork(NUM_CORES, mm, &matMul_args);
       #else
       struct mm_manager_args man_args;
       man_args.mm_args = &matMul_args;
       man_args.layer_type = LAYER_CONV2D;
       man_args.step_type = STEP_IN_GRAD;
       man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-      pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+      pulp_team_fork(NUM_CORES, mm_manager, &man_args);
       #endif 
     }
     else {
@@ -575,7 +618,7 @@ void pulp_conv2d_fp32_bw_input_grads_cl( void * Conv2D_args )
       matMul_args.Upad = Upad;
       matMul_args.Dpad = Dpad;
 
-      pi_cl_team_fork(NUM_CORES, naive_conv2d_in_grad_kernel_CHW, &matMul_args);
+      pulp_team_fork(NUM_CORES, naive_conv2d_in_grad_kernel_CHW, &matMul_args);
     }
 
     /**
@@ -34,7 +34,7 @@ void pulp_conv_dw_fp32_fw_cl ( void * DepthWise_Conv_args )
   ker_args.weights = DW_args->coeff;
   ker_args.output = DW_args->output;
 
-  pi_cl_team_fork(NUM_CORES, dw_kernel_forward, &ker_args);
+  pulp_team_fork(NUM_CORES, dw_kernel_forward, &ker_args);
 
   return;
 }
@@ -46,6 +46,14 @@ void pulp_conv_dw_fp32_bw_cl( void * DepthWise_Conv_args )
   struct DepthWise_Conv_args * DW_args = (struct DepthWise_Conv_args *) DepthWise_Conv_args;
   int skip_in_grad = DW_args->skip_in_grad;
 
+  // The fused update modifies the weights, so the input gradient has to be computed first
+  if (DW_args->fused_update != NULL)
+  {
+    if (skip_in_grad == 0)  pulp_conv_dw_fp32_bw_input_grads_cl(DepthWise_Conv_args);
+    pulp_conv_dw_fp32_bw_param_grads_cl(DepthWise_Conv_args);
+    return;
+  }
+
   pulp_conv_dw_fp32_bw_param_grads_cl(DepthWise_Conv_args); 
   if (skip_in_grad == 0)
   {
@@ -64,7 +72,46 @@ void pulp_conv_dw_fp32_bw_param_grads_cl( void * DepthWise_Conv_args )
   ker_args.weights = DW_args->coeff;
   ker_args.output = DW_args->output;
 
-  pi_cl_team_fork(NUM_CORES, dw_kernel_weight_grad, &ker_args);
+  if (DW_args->fused_update != NULL) 
+  {
+    // Fused update, on tiles of channels of the weight gradient
+    struct fused_update_args * update = DW_args->fused_update;
+    struct blob in_tile = *DW_args->input;
+    struct blob wgt_tile = *DW_args->coeff;
+    struct blob out_tile = *DW_args->output;
+    int C = DW_args->input->C;
+    int in_size = in_tile.H*in_tile.W;
+    int out_size = out_tile.H*out_tile.W;
+    int ker_size = wgt_tile.H*wgt_tile.W;
+    int tile_c = update->buffer_size / ker_size;
+    if (tile_c < 1) {
+      printf("[pulp_conv_dw_fp32_bw_param_grads_cl]: Fused update buffer too small for one channel!\n");
+      return;
+    }
+    struct fused_update_tile_args upd_args;
+    upd_args.update = update;
+    upd_args.weights = DW_args->coeff->data;
+    wgt_tile.diff = update->buffer;
+    ker_args.input = &in_tile;
+    ker_args.weights = &wgt_tile;
+    ker_args.output = &out_tile;
+    for (int c=0; c<C; c+=tile_c) 
+    {
+      int n_c = C-c < tile_c ? C-c : tile_c;
+      in_tile.data = DW_args->input->data + c*in_size;
+      in_tile.C = n_c;
+      wgt_tile.C = n_c;
+      out_tile.diff = DW_args->output->diff + c*out_size;
+      out_tile.C = n_c;
+      pulp_team_fork(NUM_CORES, dw_kernel_weight_grad, &ker_args);
+      upd_args.offset = c*ker_size;
+      upd_args.size = n_c*ker_size;
+      pulp_team_fork(NUM_CORES, fused_update_tile, &upd_args);
+    }
+    return;
+  }
+
+  pulp_team_fork(NUM_CORES, dw_kernel_weight_grad, &ker_args);
 
 }
 
@@ -79,6 +126,6 @@ void pulp_conv_dw_fp32_bw_input_grads_cl( void * DepthWise_Conv_args )
   ker_args.weights = DW_args->coeff;
   ker_args.output = DW_args->output;
 
-  pi_cl_team_fork(NUM_CORES, dw_kernel_input_grad, &ker_args);
+  pulp_team_fork(NUM_CORES, dw_kernel_input_grad, &ker_args);
 
 }
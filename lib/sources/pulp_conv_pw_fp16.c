@@ -57,14 +57,14 @@ void pulp_conv_pw_fp16_fw_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_FW;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
   }
   // HWC format for both input and output
@@ -79,14 +79,14 @@ void pulp_conv_pw_fp16_fw_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.trans_B = 1;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_FW;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
   }
   else
@@ -96,9 +96,9 @@ void pulp_conv_pw_fp16_fw_cl( void * PointWise_Conv_args_fp16 )
 
   #ifdef DEBUG
   printf("FORWARD PW LAYER \n\n");
-  for (int i=0; i<Cout*output->W*output->H; i++) {
-    if ((i+1)%output->W==0) {
-      printf(" %f \n\n", i, outData[i]);
+  for (int i=0; i<Cout*PW_args->output->W*PW_args->output->H; i++) {
+    if ((i+1)%PW_args->output->W==0) {
+      printf(" %f \n\n", outData[i]);
     }
     else
       printf(" %f \n", outData[i]);
@@ -116,6 +116,14 @@ void pulp_conv_pw_fp16_bw_cl( void * PointWise_Conv_args_fp16 )
   struct PointWise_Conv_args_fp16 * PW_args = (struct PointWise_Conv_args_fp16 *) PointWise_Conv_args_fp16;
   int skip_in_grad = PW_args->skip_in_grad;
 
+  // The fused update modifies the weights, so the input gradient has to be computed first
+  if (PW_args->fused_update != NULL)
+  {
+    if (skip_in_grad == 0)  pulp_conv_pw_fp16_bw_input_grads_cl(PointWise_Conv_args_fp16);
+    pulp_conv_pw_fp16_bw_param_grads_cl(PointWise_Conv_args_fp16);
+    return;
+  }
+
   pulp_conv_pw_fp16_bw_param_grads_cl(PointWise_Conv_args_fp16); 
   if (skip_in_grad == 0)
   {
@@ -172,16 +180,21 @@ void pulp_conv_pw_fp16_bw_param_grads_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.K = W_out*H_out;
     matMul_args.trans_B = 1;
 
+    if (PW_args->fused_update != NULL) {
+      mm_fused_update_fp16(&matMul_args, PW_args->fused_update, coeffData, LAYER_PW_CONV, opt_matmul_type);
+    }
+    else {
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_WGT_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
+    }
   }
   // HWC format for both input and output
   else if (HWC == 1) 
@@ -192,12 +205,12 @@ void pulp_conv_pw_fp16_bw_param_grads_cl( void * PointWise_Conv_args_fp16 )
     tr_args.transp_matrix = transp_buffer;
     tr_args.N = H_out*W_out;
     tr_args.M = C_out;
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
     tr_args.matrix = inData;
     tr_args.transp_matrix = (transp_buffer + H_out*W_out*C_out);
     tr_args.N = H_in*W_in;
     tr_args.M = C_in;
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
     matMul_args.A = transp_buffer; //outDiff;
     matMul_args.B = (transp_buffer + H_out*W_out*C_out); //inData;
     matMul_args.C = coeffDiff;
@@ -206,16 +219,21 @@ void pulp_conv_pw_fp16_bw_param_grads_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.K = W_out*H_out;
     matMul_args.trans_B = 1;
 
+    if (PW_args->fused_update != NULL) {
+      mm_fused_update_fp16(&matMul_args, PW_args->fused_update, coeffData, LAYER_PW_CONV, opt_matmul_type);
+    }
+    else {
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_WGT_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
+    }
   }
   else
   {
@@ -225,15 +243,18 @@ void pulp_conv_pw_fp16_bw_param_grads_cl( void * PointWise_Conv_args_fp16 )
   #ifdef DEBUG
   printf("%d %d %d %d\n\n", pW,pH,C_in,C_out);
 
+  // With the fused update there is no coeff->diff to print
+  if (PW_args->fused_update == NULL) {
   printf("GRADIENT PW LAYER \n\n");
   for (int i=0; i<pW*pH*C_out*C_in; i++) {
     if ((i+1)%C_out==0) {
-      printf(" %f \n\n", i, coeffDiff[i]);
+      printf(" %f \n\n", coeffDiff[i]);
     }
     else
       printf(" %f \n", coeffDiff[i]);
   }
   printf("\n");
+  }
   #endif
 }
 
@@ -283,7 +304,7 @@ void pulp_conv_pw_fp16_bw_input_grads_cl( void * PointWise_Conv_args_fp16 )
     tr_args.transp_matrix = transp_buffer;
     tr_args.N = C_out;
     tr_args.M = C_in;
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
     matMul_args.A = transp_buffer; // coeffData; // transp 
     matMul_args.B = outDiff;
     matMul_args.C = inDiff;
@@ -293,14 +314,14 @@ void pulp_conv_pw_fp16_bw_input_grads_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.trans_B = 0;
     
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_IN_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
   }
   // HWC format for both input and output
@@ -313,7 +334,7 @@ void pulp_conv_pw_fp16_bw_input_grads_cl( void * PointWise_Conv_args_fp16 )
     tr_args.transp_matrix = transp_buffer;
     tr_args.N = C_out;
     tr_args.M = C_in;
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
     matMul_args.A = outDiff;
     matMul_args.B = transp_buffer; // coeffData;
     matMul_args.C = inDiff;
@@ -323,14 +344,14 @@ void pulp_conv_pw_fp16_bw_input_grads_cl( void * PointWise_Conv_args_fp16 )
     matMul_args.trans_B = 1;
     
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args);
     #else
     struct mm_manager_args_fp16 man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_IN_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
     #endif
   }
   else
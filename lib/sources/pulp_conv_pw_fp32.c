@@ -55,14 +55,14 @@ void pulp_conv_pw_fp32_fw_cl( void * PointWise_Conv_args )
     matMul_args.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_FW;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
   }
   // HWC format for both input and output
@@ -77,14 +77,14 @@ void pulp_conv_pw_fp32_fw_cl( void * PointWise_Conv_args )
     matMul_args.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_FW;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
   }  
   else 
@@ -94,9 +94,9 @@ void pulp_conv_pw_fp32_fw_cl( void * PointWise_Conv_args )
 
   #ifdef DEBUG
   printf("FORWARD PW LAYER \n\n");
-  for (int i=0; i<Cout*output->W*output->H; i++) {
-    if ((i+1)%output->W==0) {
-      printf(" %f \n\n", i, outData[i]);
+  for (int i=0; i<Cout*PW_args->output->W*PW_args->output->H; i++) {
+    if ((i+1)%PW_args->output->W==0) {
+      printf(" %f \n\n", outData[i]);
     }
     else
       printf(" %f \n", outData[i]);
@@ -114,6 +114,14 @@ void pulp_conv_pw_fp32_bw_cl( void * PointWise_Conv_args )
   struct PointWise_Conv_args * PW_args = (struct PointWise_Conv_args *) PointWise_Conv_args;
   int skip_in_grad = PW_args->skip_in_grad;
 
+  // The fused update modifies the weights, so the input gradient has to be computed first
+  if (PW_args->fused_update != NULL)
+  {
+    if (skip_in_grad == 0)  pulp_conv_pw_fp32_bw_input_grads_cl(PointWise_Conv_args);
+    pulp_conv_pw_fp32_bw_param_grads_cl(PointWise_Conv_args);
+    return;
+  }
+
   pulp_conv_pw_fp32_bw_param_grads_cl(PointWise_Conv_args); 
   if (skip_in_grad == 0)
   {
@@ -171,16 +179,21 @@ void pulp_conv_pw_fp32_bw_param_grads_cl( void * PointWise_Conv_args )
     matMul_args.K = W_out*H_out;
     matMul_args.trans_B = 1;
 
+    if (PW_args->fused_update != NULL) {
+      mm_fused_update(&matMul_args, PW_args->fused_update, coeffData, LAYER_PW_CONV, opt_matmul_type);
+    }
+    else {
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_WGT_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
+    }
   }
   // HWC format for both input and output
   else if (HWC == 1) 
@@ -191,7 +204,7 @@ void pulp_conv_pw_fp32_bw_param_grads_cl( void * PointWise_Conv_args )
     tr_args.transp_matrix = tr_buff;
     tr_args.M = C_in; 
     tr_args.N = H_in*W_in; 
-    pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose, &tr_args);
     // COMPUTE GRADIENT
     matMul_args.A = tr_buff; 
     matMul_args.B = outDiff; 
@@ -201,16 +214,21 @@ void pulp_conv_pw_fp32_bw_param_grads_cl( void * PointWise_Conv_args )
     matMul_args.K = W_out*H_out;  
     matMul_args.trans_B = 0;
 
+    if (PW_args->fused_update != NULL) {
+      mm_fused_update(&matMul_args, PW_args->fused_update, coeffData, LAYER_PW_CONV, opt_matmul_type);
+    }
+    else {
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_WGT_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
+    }
   }
   else
   {
@@ -220,15 +238,18 @@ void pulp_conv_pw_fp32_bw_param_grads_cl( void * PointWise_Conv_args )
   #ifdef DEBUG
   printf("%d %d %d %d\n\n", pW,pH,C_in,C_out);
 
+  // With the fused update there is no coeff->diff to print
+  if (PW_args->fused_update == NULL) {
   printf("GRADIENT PW LAYER \n\n");
   for (int i=0; i<pW*pH*C_out*C_in; i++) {
     if ((i+1)%C_out==0) {
-      printf(" %f \n\n", i, coeffDiff[i]);
+      printf(" %f \n\n", coeffDiff[i]);
     }
     else
       printf(" %f \n", coeffDiff[i]);
   }
   printf("\n");
+  }
   #endif
 }
 
@@ -278,7 +299,7 @@ void pulp_conv_pw_fp32_bw_input_grads_cl( void * PointWise_Conv_args )
     tr_args.transp_matrix = tr_buffer;
     tr_args.N = C_out;
     tr_args.M = C_in;
-    pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose, &tr_args);
 
     // COMPUTE ACTIV_GRAD
     matMul_args.A = tr_buffer; // coeffData; // transp ?
@@ -290,14 +311,14 @@ void pulp_conv_pw_fp32_bw_input_grads_cl( void * PointWise_Conv_args )
     matMul_args.trans_B = 0;
     
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_IN_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
   }
   // HWC format for both input and output
@@ -309,7 +330,7 @@ void pulp_conv_pw_fp32_bw_input_grads_cl( void * PointWise_Conv_args )
     tr_args.transp_matrix = tr_buffer;
     tr_args.N = C_in; 
     tr_args.M = C_out; 
-    pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+    pulp_team_fork(NUM_CORES, transpose, &tr_args);
 
     // COMPUTE ACTIV_GRAD
     matMul_args.A = outDiff;
@@ -321,14 +342,14 @@ void pulp_conv_pw_fp32_bw_input_grads_cl( void * PointWise_Conv_args )
     matMul_args.trans_B = 0;
     
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+    pulp_team_fork(NUM_CORES, mm, &matMul_args);
     #else
     struct mm_manager_args man_args;
     man_args.mm_args = &matMul_args;
     man_args.layer_type = LAYER_PW_CONV;
     man_args.step_type = STEP_IN_GRAD;
     man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
     #endif
   }
   else
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Authors: Giacomo Saporetti
+*/
+#include "pmsis.h"
+#include "pulp_train_utils_fp32.h"
+#include "pulp_groupnorm_fp32.h"
+#include "pulp_train_defines.h"
+#include <math.h>
+
+
+// Computes the partial sums of the (group, spatial) tiles assigned to the current core
+static void groupnorm_fp32_partial_sums(struct GroupNorm_tile_args * t_args, int with_grads)
+{
+    struct GroupNorm_args * args = t_args->gn_args;
+    struct blob * in = args->input;
+    struct blob * out = args->output;
+    struct blob * coeff = args->coeff;
+    int C = in->C;
+    int HW = in->H*in->W;
+    int G = args->num_groups;
+    int D = (C/G)*HW;
+    int n_tiles = t_args->n_tiles;
+    float * partials = t_args->partials;
+
+    int tileSize = (D+n_tiles-1) / n_tiles;
+    int T = G*n_tiles;
+    int blockSize = (T+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > T ? T : start+blockSize;
+
+    for (int t=start; t<stop; t++)
+    {
+        int g = t / n_tiles;
+        int d_start = (t % n_tiles)*tileSize;
+        int d_stop = d_start+tileSize > D ? D : d_start+tileSize;
+        float * in_data = in->data + g*D;
+
+        float s = 0.0f;
+        float s2 = 0.0f;
+        for (int d=d_start; d<d_stop; d++)
+        {
+            float x = in_data[d];
+            s += x;
+            s2 += x*x;
+        }
+        partials[GN_PARTIALS*t] = s;
+        partials[GN_PARTIALS*t+1] = s2;
+
+        if (with_grads)
+        {
+            float * out_diff = out->diff + g*D;
+            float sd = 0.0f;
+            float sdx = 0.0f;
+            int d = d_start;
+            // Walk the tile channel by channel to fetch gamma once per channel
+            while (d < d_stop)
+            {
+                int c_stop = (d/HW + 1)*HW;
+                if (c_stop > d_stop) c_stop = d_stop;
+                float gamma = coeff->data[g*(C/G) + d/HW];
+                float sum_dy = 0.0f;
+                float sum_dyx = 0.0f;
+                for (; d<c_stop; d++)
+                {
+                    float dy = out_diff[d];
+                    sum_dy += dy;
+                    sum_dyx += dy*in_data[d];
+                }
+                sd += gamma*sum_dy;
+                sdx += gamma*sum_dyx;
+            }
+            partials[GN_PARTIALS*t+2] = sd;
+            partials[GN_PARTIALS*t+3] = sdx;
+        }
+    }
+}
+
+// Reduces the partial sums of the n_tiles tiles of a group into its statistics
+static inline void groupnorm_fp32_group_stats(float * partials, int n_tiles, int D, float * mean, float * std)
+{
+    float s = 0.0f;
+    float s2 = 0.0f;
+    for (int t=0; t<n_tiles; t++)
+    {
+        s += partials[GN_PARTIALS*t];
+        s2 += partials[GN_PARTIALS*t+1];
+    }
+    float D_inverse = 1.0f / (float) D;
+    float m = s*D_inverse;
+    float v = s2*D_inverse - m*m + EPSILON;
+    if (v < 0) v = EPSILON;
+    *mean = m;
+    *std = sqrtf(v);
+}
+
+
+// Input gradient of the tiles assigned to the current core (partial sums with grads must be ready)
+static void groupnorm_fp32_input_grads(struct GroupNorm_tile_args * t_args)
+{
+    struct GroupNorm_args * args = t_args->gn_args;
+
+    struct blob * in = args->input;
+    struct blob * out = args->output;
+    struct blob * coeff = args->coeff;
+    int C = in->C;
+    int HW = in->H*in->W;
+    int G = args->num_groups;
+    int Cg = C/G;
+    int D = Cg*HW;
+    int n_tiles = t_args->n_tiles;
+    float * partials = t_args->partials;
+
+    int tileSize = (D+n_tiles-1) / n_tiles;
+    int T = G*n_tiles;
+    int blockSize = (T+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > T ? T : start+blockSize;
+
+    float D_inverse = 1.0f / (float) D;
+
+    for (int t=start; t<stop; t++)
+    {
+        int g = t / n_tiles;
+        int d_start = (t % n_tiles)*tileSize;
+        int d_stop = d_start+tileSize > D ? D : d_start+tileSize;
+        float * in_data = in->data + g*D;
+        float * out_diff = out->diff + g*D;
+        float * in_diff = in->diff + g*D;
+
+        float mean;
+        float std;
+        float * g_partials = partials + GN_PARTIALS*g*n_tiles;
+        groupnorm_fp32_group_stats(g_partials, n_tiles, D, &mean, &std);
+
+        // sum(gamma*dy) and sum(gamma*dy*xhat) over the whole group
+        float sum_dy = 0.0f;
+        float sum_dyx = 0.0f;
+        for (int i=0; i<n_tiles; i++)
+        {
+            sum_dy += g_partials[GN_PARTIALS*i+2];
+            sum_dyx += g_partials[GN_PARTIALS*i+3];
+        }
+        float std_inverse = 1.0f / std;
+        float mean_dy = sum_dy*D_inverse;
+        float mean_dyxhat = (sum_dyx - mean*sum_dy)*std_inverse*D_inverse;
+
+        int d = d_start;
+        while (d < d_stop)
+        {
+            int c_stop = (d/HW + 1)*HW;
+            if (c_stop > d_stop) c_stop = d_stop;
+            float gamma = coeff->data[g*Cg + d/HW];
+            for (; d<c_stop; d++)
+            {
+                float xhat = (in_data[d] - mean)*std_inverse;
+                in_diff[d] = (gamma*out_diff[d] - mean_dy - xhat*mean_dyxhat)*std_inverse;
+            }
+        }
+    }
+}
+
+// Param gradients of the channels assigned to the current core (partial sums must be ready)
+static void groupnorm_fp32_param_grads(struct GroupNorm_tile_args * t_args)
+{
+    struct GroupNorm_args * args = t_args->gn_args;
+
+    struct blob * in = args->input;
+    struct blob * out = args->output;
+    struct blob * coeff = args->coeff;
+    int C = in->C;
+    int HW = in->H*in->W;
+    int G = args->num_groups;
+    int Cg = C/G;
+    int D = Cg*HW;
+    int n_tiles = t_args->n_tiles;
+    float * partials = t_args->partials;
+
+    // gamma and beta are per-channel, so parallelize on C
+    int blockSize = (C+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > C ? C : start+blockSize;
+
+    for (int c=start; c<stop; c++)
+    {
+        int g = c / Cg;
+        float * in_data = in->data + c*HW;
+        float * out_diff = out->diff + c*HW;
+
+        float mean;
+        float std;
+        groupnorm_fp32_group_stats(partials + GN_PARTIALS*g*n_tiles, n_tiles, D, &mean, &std);
+
+        float gamma_grad = 0.0f;
+        float bias_grad = 0.0f;
+        for (int d=0; d<HW; d++)
+        {
+            gamma_grad += out_diff[d]*(in_data[d] - mean);
+            bias_grad += out_diff[d];
+        }
+
+        coeff->diff[c] = gamma_grad/std;
+        coeff->diff[C + c] = bias_grad;
+    }
+}
+
+
+void pulp_groupnorm_fp32_fw_cl( void * GroupNorm_args )
+{
+    struct GroupNorm_args * args = (struct GroupNorm_args *) GroupNorm_args;
+
+    struct GroupNorm_tile_args t_args;
+    t_args.gn_args = args;
+    t_args.partials = args->partials_buffer;
+    t_args.n_tiles = GN_N_TILES(args->num_groups);
+
+    pulp_team_fork(NUM_CORES, pulp_groupnorm_parallelized_fp32_fw_cl, &t_args);
+}
+
+// Real forward function that parallelize on multicore
+void pulp_groupnorm_parallelized_fp32_fw_cl( void * GroupNorm_tile_args )
+{
+    struct GroupNorm_tile_args * t_args = (struct GroupNorm_tile_args *) GroupNorm_tile_args;
+    struct GroupNorm_args * args = t_args->gn_args;
+
+    struct blob * in = args->input;
+    struct blob * out = args->output;
+    struct blob * coeff = args->coeff;
+    int C = in->C;
+    int HW = in->H*in->W;
+    int G = args->num_groups;
+    int Cg = C/G;
+    int D = Cg*HW;
+    int n_tiles = t_args->n_tiles;
+    float * partials = t_args->partials;
+
+    // Partial sums of each tile, then wait for all the tiles of each group
+    groupnorm_fp32_partial_sums(t_args, 0);
+    pi_cl_team_barrier();
+
+    int tileSize = (D+n_tiles-1) / n_tiles;
+    int T = G*n_tiles;
+    int blockSize = (T+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > T ? T : start+blockSize;
+
+    for (int t=start; t<stop; t++)
+    {
+        int g = t / n_tiles;
+        int d_start = (t % n_tiles)*tileSize;
+        int d_stop = d_start+tileSize > D ? D : d_start+tileSize;
+        float * in_data = in->data + g*D;
+        float * out_data = out->data + g*D;
+
+        float mean;
+        float std;
+        groupnorm_fp32_group_stats(partials + GN_PARTIALS*g*n_tiles, n_tiles, D, &mean, &std);
+
+        int d = d_start;
+        while (d < d_stop)
+        {
+            int c = g*Cg + d/HW;
+            int c_stop = (d/HW + 1)*HW;
+            if (c_stop > d_stop) c_stop = d_stop;
+            float gamma = coeff->data[c]/std;
+            float b = coeff->data[C + c];
+            for (; d<c_stop; d++)
+                out_data[d] = gamma*(in_data[d] - mean) + b;
+        }
+    }
+}
+
+
+
+void pulp_groupnorm_fp32_bw_input_grads_cl( void * GroupNorm_args )
+{
+    struct GroupNorm_args * args = (struct GroupNorm_args *) GroupNorm_args;
+
+    struct GroupNorm_tile_args t_args;
+    t_args.gn_args = args;
+    t_args.partials = args->partials_buffer;
+    t_args.n_tiles = GN_N_TILES(args->num_groups);
+
+    pulp_team_fork(NUM_CORES, pulp_groupnorm_parallelized_fp32_bw_input_grads_cl, &t_args);
+}
+
+void pulp_groupnorm_fp32_bw_param_grads_cl( void * GroupNorm_args )
+{
+    struct GroupNorm_args * args = (struct GroupNorm_args *) GroupNorm_args;
+
+    struct GroupNorm_tile_args t_args;
+    t_args.gn_args = args;
+    t_args.partials = args->partials_buffer;
+    t_args.n_tiles = GN_N_TILES(args->num_groups);
+
+    pulp_team_fork(NUM_CORES, pulp_groupnorm_parallelized_fp32_bw_param_grads_cl, &t_args);
+}
+
+void pulp_groupnorm_fp32_bw_cl( void * GroupNorm_args )
+{
+    struct GroupNorm_args * args = (struct GroupNorm_args *) GroupNorm_args;
+
+    struct GroupNorm_tile_args t_args;
+    t_args.gn_args = args;
+    t_args.partials = args->partials_buffer;
+    t_args.n_tiles = GN_N_TILES(args->num_groups);
+
+    pulp_team_fork(NUM_CORES, pulp_groupnorm_parallelized_fp32_bw_cl, &t_args);
+}
+
+void pulp_groupnorm_parallelized_fp32_bw_input_grads_cl( void * GroupNorm_tile_args )
+{
+    struct GroupNorm_tile_args * t_args = (struct GroupNorm_tile_args *) GroupNorm_tile_args;
+
+    groupnorm_fp32_partial_sums(t_args, 1);
+    pi_cl_team_barrier();
+    groupnorm_fp32_input_grads(t_args);
+}
+
+void pulp_groupnorm_parallelized_fp32_bw_param_grads_cl( void * GroupNorm_tile_args )
+{
+    struct GroupNorm_tile_args * t_args = (struct GroupNorm_tile_args *) GroupNorm_tile_args;
+
+    groupnorm_fp32_partial_sums(t_args, 0);
+    pi_cl_team_barrier();
+    groupnorm_fp32_param_grads(t_args);
+}
+
+void pulp_groupnorm_parallelized_fp32_bw_cl( void * GroupNorm_tile_args )
+{
+    struct GroupNorm_tile_args * t_args = (struct GroupNorm_tile_args *) GroupNorm_tile_args;
+    int skip = t_args->gn_args->skip_in_grad;
+
+    // A single pass over the tiles provides the statistics for both gradients
+    groupnorm_fp32_partial_sums(t_args, skip == 0);
+    pi_cl_team_barrier();
+
+    groupnorm_fp32_param_grads(t_args);
+    if (skip == 0)
+        groupnorm_fp32_input_grads(t_args);
+}
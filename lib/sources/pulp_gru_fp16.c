@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pulp_train_utils_fp16.h"
+#include "pulp_gru_fp16.h"
+#include "pulp_act_fp16.h"
+#include <math.h>
+
+
+// Gate activations on two hidden units at a time, exact or with the bit-manipulated exponential
+static inline v2f16 gru_sigmoid_v2f16(v2f16 x, int approx)
+{
+    v2f16 e;
+    if (approx == ACT_APPROX)   e = fastexp_gist_v2f16(-x);
+    else                        e = (v2f16) {expf(-x[0]), expf(-x[1])};
+    return (v2f16) {1, 1} / ((v2f16) {1, 1} + e);
+}
+
+static inline v2f16 gru_tanh_v2f16(v2f16 x, int approx)
+{
+    if (approx == ACT_APPROX)
+        return (v2f16) {2, 2} * gru_sigmoid_v2f16((v2f16) {2, 2} * x, approx) - (v2f16) {1, 1};
+    else
+        return (v2f16) {tanhf(x[0]), tanhf(x[1])};
+}
+
+// Dot product of two fp16 vectors, two elements at a time
+static inline fp16 gru_dot_fp16(fp16 * a, fp16 * b, int dim)
+{
+    v2f16 acc = (v2f16) {0, 0};
+    int m = 0;
+    for(; m<dim-1; m+=2)
+        acc += *((v2f16 *) &a[m]) * *((v2f16 *) &b[m]);
+    fp16 res = acc[0] + acc[1];
+    if(dim & 1)
+        res += a[dim-1] * b[dim-1];
+    return res;
+}
+
+
+//FORWARD
+void pulp_gru_fp16_fw_cl(void * Gru_args_fp16)
+{
+    pulp_team_fork(NUM_CORES, gru_core_fw_fp16, Gru_args_fp16);
+}
+
+void gru_core_fw_fp16(void * Gru_args_fp16)
+{
+    struct Gru_args_fp16 *gru_args = (struct Gru_args_fp16 *) Gru_args_fp16;
+    fp16 *coeffData = gru_args->coeff->data;  // Concatenated gate weights
+    fp16 *inputData = gru_args->input->data;
+    fp16 *outData = gru_args->output->data;   // Hidden states of all the timesteps
+    fp16 *stateData = gru_args->state->data;  // Initial hidden state
+    fp16 *gates = gru_args->gates;
+    int approx = gru_args->approx;
+
+    int N = gru_args->input->H; // Input/Output Sequence length
+    int K = gru_args->input->W; // Input Sequence element length
+    int M = gru_args->output->W; // Output Sequence element length
+
+    const int n_pairs = (M+1)/2;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        fp16 *currInput = inputData + t*K;
+        fp16 *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        fp16 *currGates = gates + t*4*M;
+
+        for(int p=start; p<stop; p++){
+            int j = 2*p;
+            int pair = (j+1 < M);
+            // [x_t, h_(t-1)] * W on the three gate columns of the j-th and (j+1)-th units, keeping apart the two terms of n
+            v2f16 zr = (v2f16) {0, 0}, zz = (v2f16) {0, 0}, xn = (v2f16) {0, 0}, hn = (v2f16) {0, 0};
+            fp16 *w = coeffData + j;
+            for(int r=0; r<K+M; r++){
+                fp16 a = (r < K) ? currInput[r] : prevState[r-K];
+                v2f16 av = (v2f16) {a, a};
+                v2f16 wr = pair ? *((v2f16 *) &w[0]) : (v2f16) {w[0], 0};
+                v2f16 wz = pair ? *((v2f16 *) &w[M]) : (v2f16) {w[M], 0};
+                v2f16 wn = pair ? *((v2f16 *) &w[2*M]) : (v2f16) {w[2*M], 0};
+                zr += av * wr;
+                zz += av * wz;
+                if(r < K)   xn += av * wn;
+                else        hn += av * wn;
+                w += 3*M;
+            }
+
+            v2f16 r_g = gru_sigmoid_v2f16(zr, approx);
+            v2f16 z_g = gru_sigmoid_v2f16(zz, approx);
+            v2f16 n_g = gru_tanh_v2f16(xn + r_g * hn, approx);
+            v2f16 h_p = pair ? *((v2f16 *) &prevState[j]) : (v2f16) {prevState[j], 0};
+            v2f16 h = ((v2f16) {1, 1} - z_g) * n_g + z_g * h_p;
+
+            for(int u=0; u<1+pair; u++){
+                currGates[j+u] = r_g[u];
+                currGates[M+j+u] = z_g[u];
+                currGates[2*M+j+u] = n_g[u];
+                currGates[3*M+j+u] = hn[u];
+                outData[t*M+j+u] = h[u];
+            }
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
+//BACKWARD
+void pulp_gru_fp16_bw_cl(void * Gru_args_fp16)
+{
+    struct Gru_args_fp16 *gru_args = (struct Gru_args_fp16 *) Gru_args_fp16;
+
+    int N = gru_args->input->H; // Input sequence length
+    int window = (gru_args->bptt_window > 0 && gru_args->bptt_window < N) ? gru_args->bptt_window : N;
+
+    struct Gru_bptt_args_fp16 bptt_args;
+    bptt_args.gru_args = gru_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, gru_core_bw_fp16, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+// Gradient flowing into h_(t-1) through the gates: j-th row of W_h times [dr, dz, dhn]
+static inline fp16 gru_state_grad_fp16(fp16 *w, fp16 *grad, int M)
+{
+    return gru_dot_fp16(grad, w, 2*M) + gru_dot_fp16(grad + 3*M, w + 2*M, M);
+}
+
+void gru_core_bw_fp16(void * Gru_bptt_args_fp16)
+{
+    struct Gru_bptt_args_fp16 *bptt_args = (struct Gru_bptt_args_fp16 *) Gru_bptt_args_fp16;
+    struct Gru_args_fp16 *gru_args = bptt_args->gru_args;
+
+    fp16 *coeffData = gru_args->coeff->data;
+    fp16 *coeffDiff = gru_args->coeff->diff;
+    fp16 *inData = gru_args->input->data;
+    fp16 *inDiff = gru_args->input->diff;
+    fp16 *outData = gru_args->output->data;
+    fp16 *outDiff = gru_args->output->diff;
+    fp16 *stateData = gru_args->state->data;
+    fp16 *stateDiff = gru_args->state->diff;   // Carries the direct z * dh_t term between timesteps
+    fp16 *gates = gru_args->gates;
+    fp16 *grad = gru_args->grad_buffer; // Gate gradients of the window
+
+    int K = gru_args->input->W; // Input sequence element size
+    int M = gru_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards, no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        fp16 *currGates = gates + t*4*M;
+        fp16 *currGrad = grad + (t-t_start)*4*M;
+        fp16 *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+
+        for(int j=start; j<stop; j++){
+            fp16 dh = outDiff[t*M+j];
+            if(t < t_stop-1)
+                dh += stateDiff[j] + gru_state_grad_fp16(coeffData + (K+j)*3*M, currGrad + 4*M, M);
+
+            fp16 r_g = currGates[j];
+            fp16 z_g = currGates[M+j];
+            fp16 n_g = currGates[2*M+j];
+            fp16 hn = currGates[3*M+j];
+
+            fp16 dn = dh * (1 - z_g) * (1 - n_g * n_g);
+            currGrad[j] = dn * hn * r_g * (1 - r_g);
+            currGrad[M+j] = dh * (prevState[j] - n_g) * z_g * (1 - z_g);
+            currGrad[2*M+j] = dn;
+            currGrad[3*M+j] = dn * r_g;
+            stateDiff[j] = dh * z_g;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial hidden state
+    if(t_start == 0)
+        for(int j=start; j<stop; j++)
+            stateDiff[j] += gru_state_grad_fp16(coeffData + (K+j)*3*M, grad, M);
+
+    // Weight gradients of the whole window: dW = [X, H_prev]^T * dGates, parallelized over the K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        fp16 *wgtDiff = coeffDiff + r*3*M;
+        // The n column of the state rows is driven by r * dn instead of dn
+        int nOffset = (r < K) ? 2*M : 3*M;
+        if(!bptt_args->accumulate)
+            for(int c=0; c<3*M; c++)
+                wgtDiff[c] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            fp16 a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            fp16 *currGrad = grad + (t-t_start)*4*M;
+            v2f16 av = (v2f16) {a, a};
+            // 2M is even: no leftover
+            for(int c=0; c<2*M; c+=2)
+                *((v2f16 *) &wgtDiff[c]) += av * *((v2f16 *) &currGrad[c]);
+            for(int c=0; c<M; c++)
+                wgtDiff[2*M+c] += a * currGrad[nOffset+c];
+        }
+    }
+
+    // Input gradients of the window: dX = [dr, dz, dn] * W_x^T (W_x being the first K rows of the weights)
+    const int inBlockSize=(T*K+NUM_CORES-1)/NUM_CORES;
+    const int inStart = pi_core_id()*inBlockSize;
+    const int inStop = inStart + inBlockSize > T*K ? T*K : inStart+inBlockSize;
+
+    for(int i=inStart; i<inStop; i++){
+        fp16 *currGrad = grad + (i/K)*4*M;
+        fp16 *w = coeffData + (i%K)*3*M;
+        inDiff[t_start*K+i] = gru_dot_fp16(currGrad, w, 3*M);
+    }
+}
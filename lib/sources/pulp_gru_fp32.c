@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pulp_train_utils_fp32.h"
+#include "pulp_gru_fp32.h"
+#include "pulp_act_fp32.h"
+#include <math.h>
+
+
+// Gate activations, exact or with the bit-manipulated exponential
+static inline float gru_sigmoid(float x, int approx)
+{
+    return 1.0f / (1.0f + (approx == ACT_APPROX ? fastexp_gist(-x) : expf(-x)));
+}
+
+static inline float gru_tanh(float x, int approx)
+{
+    return approx == ACT_APPROX ? 2.0f * gru_sigmoid(2.0f * x, approx) - 1.0f : tanhf(x);
+}
+
+
+//FORWARD
+void pulp_gru_fp32_fw_cl(void * Gru_args)
+{
+    pulp_team_fork(NUM_CORES, gru_core_fw_fp32, Gru_args);
+}
+
+void gru_core_fw_fp32(void * Gru_args)
+{
+    struct Gru_args *gru_args = (struct Gru_args *) Gru_args;
+    float *coeffData = gru_args->coeff->data;  // Concatenated gate weights
+    float *inputData = gru_args->input->data;
+    float *outData = gru_args->output->data;   // Hidden states of all the timesteps
+    float *stateData = gru_args->state->data;  // Initial hidden state
+    float *gates = gru_args->gates;
+    int approx = gru_args->approx;
+
+    int N = gru_args->input->H; // Input/Output Sequence length
+    int K = gru_args->input->W; // Input Sequence element length
+    int M = gru_args->output->W; // Output Sequence element length
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        float *currInput = inputData + t*K;
+        float *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        float *currGates = gates + t*4*M;
+
+        for(int j=start; j<stop; j++){
+            // [x_t, h_(t-1)] * W on the three gate columns of the j-th unit, keeping apart the two terms of n
+            float zr = 0, zz = 0, xn = 0, hn = 0;
+            float *w = coeffData + j;
+            for(int r=0; r<K; r++){
+                float a = currInput[r];
+                zr += a * w[0];
+                zz += a * w[M];
+                xn += a * w[2*M];
+                w += 3*M;
+            }
+            for(int r=0; r<M; r++){
+                float a = prevState[r];
+                zr += a * w[0];
+                zz += a * w[M];
+                hn += a * w[2*M];
+                w += 3*M;
+            }
+
+            float r_g = gru_sigmoid(zr, approx);
+            float z_g = gru_sigmoid(zz, approx);
+            float n_g = gru_tanh(xn + r_g * hn, approx);
+
+            currGates[j] = r_g;
+            currGates[M+j] = z_g;
+            currGates[2*M+j] = n_g;
+            currGates[3*M+j] = hn;
+            outData[t*M+j] = (1 - z_g) * n_g + z_g * prevState[j];
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
+//BACKWARD
+void pulp_gru_fp32_bw_cl(void * Gru_args)
+{
+    struct Gru_args *gru_args = (struct Gru_args *) Gru_args;
+
+    int N = gru_args->input->H; // Input sequence length
+    int window = (gru_args->bptt_window > 0 && gru_args->bptt_window < N) ? gru_args->bptt_window : N;
+
+    struct Gru_bptt_args bptt_args;
+    bptt_args.gru_args = gru_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, gru_core_bw_fp32, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+// Gradient flowing into h_(t-1) through the gates: j-th row of W_h times [dr, dz, dhn]
+static inline float gru_state_grad(float *w, float *grad, int M)
+{
+    float acc = 0;
+    for(int c=0; c<2*M; c++)
+        acc += grad[c] * w[c];
+    for(int c=0; c<M; c++)
+        acc += grad[3*M+c] * w[2*M+c];
+    return acc;
+}
+
+void gru_core_bw_fp32(void * Gru_bptt_args)
+{
+    struct Gru_bptt_args *bptt_args = (struct Gru_bptt_args *) Gru_bptt_args;
+    struct Gru_args *gru_args = bptt_args->gru_args;
+
+    float *coeffData = gru_args->coeff->data;
+    float *coeffDiff = gru_args->coeff->diff;
+    float *inData = gru_args->input->data;
+    float *inDiff = gru_args->input->diff;
+    float *outData = gru_args->output->data;
+    float *outDiff = gru_args->output->diff;
+    float *stateData = gru_args->state->data;
+    float *stateDiff = gru_args->state->diff;   // Carries the direct z * dh_t term between timesteps
+    float *gates = gru_args->gates;
+    float *grad = gru_args->grad_buffer; // Gate gradients of the window
+
+    int K = gru_args->input->W; // Input sequence element size
+    int M = gru_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards, no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        float *currGates = gates + t*4*M;
+        float *currGrad = grad + (t-t_start)*4*M;
+        float *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+
+        for(int j=start; j<stop; j++){
+            float dh = outDiff[t*M+j];
+            if(t < t_stop-1)
+                dh += stateDiff[j] + gru_state_grad(coeffData + (K+j)*3*M, currGrad + 4*M, M);
+
+            float r_g = currGates[j];
+            float z_g = currGates[M+j];
+            float n_g = currGates[2*M+j];
+            float hn = currGates[3*M+j];
+
+            float dn = dh * (1 - z_g) * (1 - n_g * n_g);
+            currGrad[j] = dn * hn * r_g * (1 - r_g);
+            currGrad[M+j] = dh * (prevState[j] - n_g) * z_g * (1 - z_g);
+            currGrad[2*M+j] = dn;
+            currGrad[3*M+j] = dn * r_g;
+            stateDiff[j] = dh * z_g;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial hidden state
+    if(t_start == 0)
+        for(int j=start; j<stop; j++)
+            stateDiff[j] += gru_state_grad(coeffData + (K+j)*3*M, grad, M);
+
+    // Weight gradients of the whole window: dW = [X, H_prev]^T * dGates, parallelized over the K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        float *wgtDiff = coeffDiff + r*3*M;
+        // The n column of the state rows is driven by r * dn instead of dn
+        int nOffset = (r < K) ? 2*M : 3*M;
+        if(!bptt_args->accumulate)
+            for(int c=0; c<3*M; c++)
+                wgtDiff[c] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            float a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            float *currGrad = grad + (t-t_start)*4*M;
+            for(int c=0; c<2*M; c++)
+                wgtDiff[c] += a * currGrad[c];
+            for(int c=0; c<M; c++)
+                wgtDiff[2*M+c] += a * currGrad[nOffset+c];
+        }
+    }
+
+    // Input gradients of the window: dX = [dr, dz, dn] * W_x^T (W_x being the first K rows of the weights)
+    const int inBlockSize=(T*K+NUM_CORES-1)/NUM_CORES;
+    const int inStart = pi_core_id()*inBlockSize;
+    const int inStop = inStart + inBlockSize > T*K ? T*K : inStart+inBlockSize;
+
+    for(int i=inStart; i<inStop; i++){
+        float *currGrad = grad + (i/K)*4*M;
+        float *w = coeffData + (i%K)*3*M;
+        float acc = 0;
+        for(int c=0; c<3*M; c++)
+            acc += currGrad[c] * w[c];
+        inDiff[t_start*K+i] = acc;
+    }
+}
@@ -25,7 +25,7 @@
 
 void pulp_instnorm_fp16_fw_cl( void * InstNorm_args_fp16 )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_fw_cl, InstNorm_args_fp16);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_fw_cl, InstNorm_args_fp16);
 }
 
 // Real forward function that parallelize on multicore 
@@ -87,7 +87,7 @@ void pulp_instnorm_parallelized_fp16_fw_cl( void * InstNorm_args_fp16 )
         normalize_args.std = std;
         normalize_args.dim = D;
 
-        pi_cl_team_fork(NUM_CORES, pulp_normalize_fp32_cl, &normalize_args);*/
+        pulp_team_fork(NUM_CORES, pulp_normalize_fp32_cl, &normalize_args);*/
         gamma = gamma/std;
         for(int d=0; d<D; d++)
             out_data[d] = gamma*(in_data[d] - mean) + b;
@@ -100,7 +100,7 @@ void pulp_instnorm_parallelized_fp16_fw_cl( void * InstNorm_args_fp16 )
 
 void pulp_instnorm_fp16_bw_input_grads_cl( void * InstNorm_args_fp16 )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_input_grads_cl, InstNorm_args_fp16);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_input_grads_cl, InstNorm_args_fp16);
 }
 
 void pulp_instnorm_parallelized_fp16_bw_input_grads_cl( void * InstNorm_args_fp16 )
@@ -172,7 +172,7 @@ void pulp_instnorm_parallelized_fp16_bw_input_grads_cl( void * InstNorm_args_fp1
 
 void pulp_instnorm_fp16_bw_param_grads_cl( void * InstNorm_args_fp16 )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_param_grads_cl, InstNorm_args_fp16);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_param_grads_cl, InstNorm_args_fp16);
 }
 
 void pulp_instnorm_parallelized_fp16_bw_param_grads_cl( void * InstNorm_args_fp16 )
@@ -246,9 +246,9 @@ void pulp_instnorm_fp16_bw_cl( void * InstNorm_args_fp16 )
     struct InstNorm_args_fp16 * args = (struct InstNorm_args_fp16 *) InstNorm_args_fp16;
     int skip = args->skip_in_grad;
     //pulp_instnorm_fp32_bw_param_grads_cl(args);
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_param_grads_cl, InstNorm_args_fp16);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_param_grads_cl, InstNorm_args_fp16);
 
     if(skip == 0)
        //pulp_instnorm_fp32_bw_input_grads_cl(args);
-        pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_input_grads_cl, InstNorm_args_fp16);
+        pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp16_bw_input_grads_cl, InstNorm_args_fp16);
 }
\ No newline at end of file
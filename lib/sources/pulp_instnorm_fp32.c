@@ -25,7 +25,7 @@
 
 void pulp_instnorm_fp32_fw_cl( void * InstNorm_args )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_fw_cl, InstNorm_args);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_fw_cl, InstNorm_args);
 }
 
 // Real forward function that parallelize on multicore 
@@ -89,7 +89,7 @@ void pulp_instnorm_parallelized_fp32_fw_cl( void * InstNorm_args )
         normalize_args.std = std;
         normalize_args.dim = D;
 
-        pi_cl_team_fork(NUM_CORES, pulp_normalize_fp32_cl, &normalize_args);*/
+        pulp_team_fork(NUM_CORES, pulp_normalize_fp32_cl, &normalize_args);*/
         gamma = gamma/std;
         for(int d=0; d<D; d++)
             out_data[d] = gamma*(in_data[d] - mean) + b;
@@ -102,7 +102,7 @@ void pulp_instnorm_parallelized_fp32_fw_cl( void * InstNorm_args )
 
 void pulp_instnorm_fp32_bw_input_grads_cl( void * InstNorm_args )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_input_grads_cl, InstNorm_args);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_input_grads_cl, InstNorm_args);
 }
 
 void pulp_instnorm_parallelized_fp32_bw_input_grads_cl( void * InstNorm_args )
@@ -175,7 +175,7 @@ void pulp_instnorm_parallelized_fp32_bw_input_grads_cl( void * InstNorm_args )
 
 void pulp_instnorm_fp32_bw_param_grads_cl( void * InstNorm_args )
 {
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_param_grads_cl, InstNorm_args);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_param_grads_cl, InstNorm_args);
 }
 
 void pulp_instnorm_parallelized_fp32_bw_param_grads_cl( void * InstNorm_args )
@@ -251,9 +251,9 @@ void pulp_instnorm_fp32_bw_cl( void * InstNorm_args )
     struct InstNorm_args * args = (struct InstNorm_args *) InstNorm_args;
     int skip = args->skip_in_grad;
     //pulp_instnorm_fp32_bw_param_grads_cl(args);
-    pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_param_grads_cl, InstNorm_args);
+    pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_param_grads_cl, InstNorm_args);
 
     if(skip == 0)
        //pulp_instnorm_fp32_bw_input_grads_cl(args);
-        pi_cl_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_input_grads_cl, InstNorm_args);
+        pulp_team_fork(NUM_CORES, pulp_instnorm_parallelized_fp32_bw_input_grads_cl, InstNorm_args);
 }
\ No newline at end of file
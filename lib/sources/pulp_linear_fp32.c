@@ -42,19 +42,19 @@ void pulp_linear_fp32_fw_cl( void * Linear_args )
   matMul_args.trans_B = 0;
 
   #ifndef OPTIMIZE
-  pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+  pulp_team_fork(NUM_CORES, mm, &matMul_args);
   #else
   struct mm_manager_args man_args;
   man_args.mm_args = &matMul_args;
   man_args.layer_type = LAYER_LINEAR;
   man_args.step_type = STEP_FW;
   man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-  pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+  pulp_team_fork(NUM_CORES, mm_manager, &man_args);
   #endif
 
   #ifdef DEBUG 
     printf("\nLinear OutData: %d\n", matMul_args.N);
-    for (int i=0; i<output->dim; i++){
+    for (int i=0; i<FC_args->output->dim; i++){
       printf("%4.2e ", outData[i]);
     }
     printf("\n");
@@ -67,6 +67,14 @@ void pulp_linear_fp32_bw_cl( void * Linear_args )
   struct Linear_args * FC_args = (struct Linear_args *) Linear_args;
   int skip_in_grad = FC_args->skip_in_grad;
 
+  // The fused update modifies the weights, so the input gradient has to be computed first
+  if (FC_args->fused_update != NULL)
+  {
+    if (skip_in_grad == 0)  pulp_linear_fp32_bw_input_grads_cl(Linear_args);
+    pulp_linear_fp32_bw_param_grads_cl(Linear_args);
+    return;
+  }
+
   pulp_linear_fp32_bw_param_grads_cl(Linear_args);
   if (skip_in_grad == 0) 
   {
@@ -91,7 +99,7 @@ void pulp_linear_fp32_bw_param_grads_cl( void * Linear_args )
 
 #ifdef DEBUG
   printf("\nLinear outDiff\n");
-  for(int i=0; i<output->dim; i++)
+  for(int i=0; i<FC_args->output->dim; i++)
     printf("%4.2e ", outDiff[i]);
   printf("\n");
 #endif
@@ -104,24 +112,32 @@ void pulp_linear_fp32_bw_param_grads_cl( void * Linear_args )
   matMul_args.M = FC_args->input->dim;
   matMul_args.trans_B = 0;
 
+  if (FC_args->fused_update != NULL) {
+    mm_fused_update(&matMul_args, FC_args->fused_update, coeffData, LAYER_LINEAR, opt_matmul_type);
+  }
+  else {
   #ifndef OPTIMIZE
-  pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+  pulp_team_fork(NUM_CORES, mm, &matMul_args);
   #else
   struct mm_manager_args man_args;
   man_args.mm_args = &matMul_args;
   man_args.layer_type = LAYER_LINEAR;
   man_args.step_type = STEP_WGT_GRAD;
   man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-  pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+  pulp_team_fork(NUM_CORES, mm_manager, &man_args);
   #endif
+  }
 
   #ifdef DEBUG 
+  // With the fused update there is no coeff->diff to print
+  if (FC_args->fused_update == NULL) {
   printf("\nLinear coeffDiff ");
-    for (int i=0; i<input->dim*output->dim; i++){
-      if(!(i%(output->dim))) printf("\n");
+    for (int i=0; i<FC_args->input->dim*FC_args->output->dim; i++){
+      if(!(i%(FC_args->output->dim))) printf("\n");
       printf("%4.2e (i=%d)", coeffDiff[i], i);
     }
     printf("\n");
+  }
   #endif
 }
 
@@ -142,7 +158,7 @@ void pulp_linear_fp32_bw_input_grads_cl( void * Linear_args )
 
 #ifdef DEBUG
   printf("\nLinear outDiff\n");
-  for(int i=0; i<output->dim; i++)
+  for(int i=0; i<FC_args->output->dim; i++)
     printf("%4.2e ", outDiff[i]);
   printf("\n");
 #endif
@@ -156,21 +172,21 @@ void pulp_linear_fp32_bw_input_grads_cl( void * Linear_args )
   matMul_args.trans_B = 0;
 
   #ifndef OPTIMIZE
-  pi_cl_team_fork(NUM_CORES, mm_M, &matMul_args);
+  pulp_team_fork(NUM_CORES, mm_M, &matMul_args);
   #else
   struct mm_manager_args man_args;
   man_args.mm_args = &matMul_args;
   man_args.layer_type = LAYER_LINEAR;
   man_args.step_type = STEP_IN_GRAD;
   man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
-  pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+  pulp_team_fork(NUM_CORES, mm_manager, &man_args);
   #endif
 
   #ifdef DEBUG 
   printf("\nLinear outDiff (coeffData.T * inDiff)");
 
-    for (int i=0; i<output->dim/*+2*/; i++){
-      if(!(i%(coeff->H))) printf("\n");
+    for (int i=0; i<FC_args->output->dim/*+2*/; i++){
+      if(!(i%(FC_args->coeff->H))) printf("\n");
       printf("%4.2e ", outDiff[i]);
     }
     printf("\n");
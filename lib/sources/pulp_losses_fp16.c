@@ -18,98 +18,236 @@
  * Authors: Davide Nadalini, Leonardo Ravaglia
 */ 
 
+#include "pmsis.h"
 #include "math.h"
 #include "pulp_train_utils_fp16.h"
 #include "pulp_losses_fp16.h"
 
 
-void pulp_CrossEntropyLoss_fp16 ( void * loss_args_fp16 )
+// Forks the parallelized kernel of the selected loss
+static void pulp_loss_fork_fp16 ( void * loss_args_fp16, int loss_type )
 {
-  struct loss_args_fp16 * args = (struct loss_args_fp16 *) loss_args_fp16;
-  fp16 * outData = args->output->data;
-  fp16 * outDiff = args->output->diff;
-  fp16 * target = args->target;
-  fp16 * wr_loss = args->wr_loss;
-  int size = args->output->dim;
+  struct loss_parallel_args_fp16 par_args;
+  float partials[NUM_CORES];
 
-  fp16 loss = 0.0;
-  for(int i=0; i<size; i++){
-    loss += -target[i]*((fp16) logf((float) outData[i]));
-    
-    #ifdef DEBUG
-      printf("target: %f, out_diff: %f, out_data:%f\n", target[i], outDiff[i], outData[i]);
-      printf("loss:%f \n",loss);
-    #endif
-  }
+  par_args.loss_args = (struct loss_args_fp16 *) loss_args_fp16;
+  par_args.partials = pulp_team_share(partials);
+  par_args.loss_type = loss_type;
+
+  if (loss_type == LOSS_SOFTMAX_CROSSENTROPY)
+    pulp_team_fork(NUM_CORES, pulp_softmax_crossentropy_parallelized_fp16, &par_args);
+  else
+    pulp_team_fork(NUM_CORES, pulp_loss_parallelized_fp16, &par_args);
 
   // Skip printf profiling in debug mode
   #ifdef DEBUG
   #ifdef PROF_NET
   pi_perf_stop();
   #endif
-  printf("\nLoss: %+.4f\n", loss);  
+  printf("\nLoss: %+.4f\n", *(par_args.loss_args->wr_loss));
   #ifdef PROF_NET
   pi_perf_start();
   #endif
-  #endif  
+  #endif
+}
 
-  *wr_loss = loss;
 
-  for(int i=0; i<size; i++){
-    outDiff[i] = (-target[i] / outData[i]);
-    
-    #ifdef DEBUG
-    printf("target: %+.4f, out_diff: %+.4f, out_data:%+.4f\n", target[i], outDiff[i], outData[i]);
-    #endif
-  }
+void pulp_CrossEntropyLoss_fp16 ( void * loss_args_fp16 )
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_CROSSENTROPY);
 }
 
 
 void pulp_MSELoss_fp16 ( void * loss_args_fp16 ) 
 {
-  struct loss_args_fp16 * args = (struct loss_args_fp16 *) loss_args_fp16;
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_MSE);
+}
+
+
+void pulp_L1Loss_fp16 ( void * loss_args_fp16 ) 
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_L1);
+}
+
+
+void pulp_HuberLoss_fp16 ( void * loss_args_fp16 ) 
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_HUBER);
+}
+
+
+void pulp_SmoothL1Loss_fp16 ( void * loss_args_fp16 ) 
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_SMOOTHL1);
+}
+
+
+void pulp_BCEWithLogitsLoss_fp16 ( void * loss_args_fp16 ) 
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_BCE_LOGITS);
+}
+
+
+void pulp_KLDivLoss_fp16 ( void * loss_args_fp16 ) 
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_KLDIV);
+}
+
+
+void pulp_SoftmaxCrossEntropyLoss_fp16 ( void * loss_args_fp16 )
+{
+  pulp_loss_fork_fp16(loss_args_fp16, LOSS_SOFTMAX_CROSSENTROPY);
+}
+
+
+void pulp_loss_parallelized_fp16 ( void * loss_parallel_args_fp16 )
+{
+  struct loss_parallel_args_fp16 * par_args = (struct loss_parallel_args_fp16 *) loss_parallel_args_fp16;
+  struct loss_args_fp16 * args = par_args->loss_args;
   fp16 * outData = args->output->data;
   fp16 * outDiff = args->output->diff;
   fp16 * target = args->target;
-  fp16 * wr_loss = args->wr_loss;
   int size = args->output->dim;
-  int off = 0;
-
-  fp16 loss = 0.0;
-  fp16 meanval = 1.0f / size;
-  
-  #ifdef DEBUG
-  printf("loss meanval is: %f\n", meanval);
-  #endif
-  
-  for(int i=0; i<size; i++){
-    loss += meanval * (outData[i] - target[i]) * (outData[i] - target[i]);
-
-    #ifdef DEBUG
-    printf("target: %f, out_diff: %f, out_data:%f\n", target[i], outDiff[i], outData[i]);
-    printf("loss:%f \n",loss);
-    #endif
+  int type = par_args->loss_type;
+  int id = pi_core_id();
+
+  float meanval = 1.0f / size;
+  float delta = args->delta != 0 ? (float) args->delta : 1.0f;
+
+  int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+  int start = id*blockSize;
+  int stop = start+blockSize > size ? size : start+blockSize;
+
+  // Loss and gradient in a single pass, target is read before writing outDiff (they may share the same buffer)
+  float loss = 0.0f;
+  if (type == LOSS_CROSSENTROPY) 
+  {
+    for (int i=start; i<stop; i++) 
+    {
+      float x = (float) outData[i];
+      float t = (float) target[i];
+      loss -= t * logf(x);
+      outDiff[i] = (fp16) (-t / x);
+    }
+  }
+  else if (type == LOSS_MSE) 
+  {
+    for (int i=start; i<stop; i++) 
+    {
+      float d = (float) outData[i] - (float) target[i];
+      loss += d * d;
+      outDiff[i] = (fp16) (2.0f * meanval * d);
+    }
+    loss *= meanval;
+  }
+  else if (type == LOSS_L1) 
+  {
+    for (int i=start; i<stop; i++) 
+    {
+      float d = (float) outData[i] - (float) target[i];
+      loss += fabsf(d);
+      outDiff[i] = (fp16) (d > 0.0f ? meanval : (d < 0.0f ? -meanval : 0.0f));
+    }
+    loss *= meanval;
+  }
+  else if (type == LOSS_HUBER || type == LOSS_SMOOTHL1) 
+  {
+    // Smooth L1 is the Huber loss divided by delta (beta)
+    float inv_delta = type == LOSS_SMOOTHL1 ? 1.0f / delta : 1.0f;
+    for (int i=start; i<stop; i++) 
+    {
+      float d = (float) outData[i] - (float) target[i];
+      float ad = fabsf(d);
+      float grad;
+      if (ad < delta) 
+      {
+        loss += 0.5f * d * d;
+        grad = d;
+      }
+      else 
+      {
+        loss += delta * (ad - 0.5f * delta);
+        grad = d > 0.0f ? delta : -delta;
+      }
+      outDiff[i] = (fp16) (meanval * inv_delta * grad);
+    }
+    loss *= meanval * inv_delta;
+  }
+  else if (type == LOSS_BCE_LOGITS) 
+  {
+    for (int i=start; i<stop; i++) 
+    {
+      float x = (float) outData[i];
+      float t = (float) target[i];
+      // max(x,0) - x*t + log(1+exp(-|x|)), sigmoid(x) from the same exponential
+      float e = expf(-fabsf(x));
+      float sig = x >= 0.0f ? 1.0f / (1.0f + e) : e / (1.0f + e);
+      loss += (x > 0.0f ? x : 0.0f) - x * t + log1pf(e);
+      outDiff[i] = (fp16) (meanval * (sig - t));
+    }
+    loss *= meanval;
+  }
+  else if (type == LOSS_KLDIV) 
+  {
+    for (int i=start; i<stop; i++) 
+    {
+      float x = (float) outData[i];
+      float t = (float) target[i];
+      if (t > 0.0f)  loss += t * (logf(t) - x);
+      outDiff[i] = (fp16) (-t);
+    }
   }
 
-  // Skip printf profiling in debug mode
-  #ifdef DEBUG
-  #ifdef PROF_NET
-  pi_perf_stop();
-  #endif
-  printf("\nLoss: %+.4f\n", loss);
-  #ifdef PROF_NET
-  pi_perf_start();
-  #endif
-  #endif  
-
-  *wr_loss = loss;
+  // Cluster-wide reduction of the partial losses
+  float total = pulp_team_sum_fp16(loss, par_args->partials);
+  if (id == 0)  *(args->wr_loss) = (fp16) total;
+}
 
-  for(int i=0; i<size; i++){
-    outDiff[i] = meanval * 2.0f *(-target[i]+outData[i]);
 
-    #ifdef DEBUG
-    printf("target: %+.4f, out_diff: %+.4f, out_data:%+.4f\n", target[i], outDiff[i], outData[i]);
-    #endif
+void pulp_softmax_crossentropy_parallelized_fp16 ( void * loss_parallel_args_fp16 )
+{
+  struct loss_parallel_args_fp16 * par_args = (struct loss_parallel_args_fp16 *) loss_parallel_args_fp16;
+  struct loss_args_fp16 * args = par_args->loss_args;
+  fp16 * outData = args->output->data;
+  fp16 * outDiff = args->output->diff;
+  fp16 * target = args->target;
+  float * partials = par_args->partials;
+  int size = args->output->dim;
+  int id = pi_core_id();
+
+  int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+  int start = id*blockSize;
+  int stop = start+blockSize > size ? size : start+blockSize;
+
+  // Max of the logits, to shift the exponentials
+  float max = -INFINITY;
+  for (int i=start; i<stop; i++)  if ((float) outData[i] > max)  max = (float) outData[i];
+  max = pulp_team_max_fp16(max, partials);
+
+  // Partial sums of exp(x-max), target and target*(x-max)
+  float exp_sum = 0.0f;
+  float t_sum = 0.0f;
+  float tx_sum = 0.0f;
+  for (int i=start; i<stop; i++) 
+  {
+    float x = (float) outData[i] - max;
+    float t = (float) target[i];
+    exp_sum += expf(x);
+    t_sum += t;
+    tx_sum += t * x;
+  }
+  exp_sum = pulp_team_sum_fp16(exp_sum, partials);
+  t_sum = pulp_team_sum_fp16(t_sum, partials);
+  tx_sum = pulp_team_sum_fp16(tx_sum, partials);
+
+  // loss = -sum(t * log_softmax(x)) = sum(t) * log(sum(exp(x-max))) - sum(t * (x-max))
+  if (id == 0)  *(args->wr_loss) = (fp16) (t_sum * logf(exp_sum) - tx_sum);
+
+  // Gradient, target is read before writing outDiff (they may share the same buffer)
+  float scale = t_sum / exp_sum;
+  for (int i=start; i<stop; i++) 
+  {
+    float t = (float) target[i];
+    outDiff[i] = (fp16) (expf((float) outData[i] - max) * scale - t);
   }
-
 }
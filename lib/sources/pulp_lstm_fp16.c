@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pulp_train_utils_fp16.h"
+#include "pulp_lstm_fp16.h"
+#include "pulp_matmul_fp16.h"
+#include "pulp_act_fp16.h"
+#include <math.h>
+
+
+// Gate activations on two hidden units at a time, exact or with the bit-manipulated exponential
+static inline v2f16 lstm_sigmoid_v2f16(v2f16 x, int approx)
+{
+    v2f16 e;
+    if (approx == ACT_APPROX)   e = fastexp_gist_v2f16(-x);
+    else                        e = (v2f16) {expf(-x[0]), expf(-x[1])};
+    return (v2f16) {1, 1} / ((v2f16) {1, 1} + e);
+}
+
+static inline v2f16 lstm_tanh_v2f16(v2f16 x, int approx)
+{
+    if (approx == ACT_APPROX)
+        return (v2f16) {2, 2} * lstm_sigmoid_v2f16((v2f16) {2, 2} * x, approx) - (v2f16) {1, 1};
+    else
+        return (v2f16) {tanhf(x[0]), tanhf(x[1])};
+}
+
+// Dot product of two fp16 vectors, two elements at a time
+static inline fp16 lstm_dot_fp16(fp16 * a, fp16 * b, int dim)
+{
+    v2f16 acc = (v2f16) {0, 0};
+    int m = 0;
+    for(; m<dim-1; m+=2)
+        acc += *((v2f16 *) &a[m]) * *((v2f16 *) &b[m]);
+    fp16 res = acc[0] + acc[1];
+    if(dim & 1)
+        res += a[dim-1] * b[dim-1];
+    return res;
+}
+
+
+//FORWARD
+void pulp_lstm_fp16_fw_cl(void * Lstm_args_fp16)
+{
+    pulp_team_fork(NUM_CORES, lstm_core_fw_fp16, Lstm_args_fp16);
+}
+
+void lstm_core_fw_fp16(void * Lstm_args_fp16)
+{
+    struct Lstm_args_fp16 *lstm_args = (struct Lstm_args_fp16 *) Lstm_args_fp16;
+    fp16 *coeffData = lstm_args->coeff->data;       // Concatenated gate weights
+    fp16 *inputData = lstm_args->input->data;
+    fp16 *outData = lstm_args->output->data;        // Hidden states of all the timesteps
+    fp16 *stateData = lstm_args->state->data;       // Initial hidden state
+    fp16 *cellStateData = lstm_args->cell_state->data; // Initial cell state
+    fp16 *gates = lstm_args->gates;
+    fp16 *cells = lstm_args->cells;
+    int approx = lstm_args->approx;
+
+    int N = lstm_args->input->H; // Input/Output Sequence length
+    int K = lstm_args->input->W; // Input Sequence element length
+    int M = lstm_args->output->W; // Output Sequence element length
+
+    const int n_pairs = (M+1)/2;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        fp16 *currInput = inputData + t*K;
+        fp16 *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        fp16 *prevCell = (t == 0) ? cellStateData : cells + (t-1)*M;
+        fp16 *currGates = gates + t*4*M;
+
+        for(int p=start; p<stop; p++){
+            int j = 2*p;
+            int pair = (j+1 < M);
+            // [x_t, h_(t-1)] * W on the four gate columns of the j-th and (j+1)-th units
+            v2f16 zi = (v2f16) {0, 0}, zf = (v2f16) {0, 0}, zg = (v2f16) {0, 0}, zo = (v2f16) {0, 0};
+            fp16 *w = coeffData + j;
+            for(int r=0; r<K+M; r++){
+                fp16 a = (r < K) ? currInput[r] : prevState[r-K];
+                v2f16 av = (v2f16) {a, a};
+                if(pair){
+                    zi += av * *((v2f16 *) &w[0]);
+                    zf += av * *((v2f16 *) &w[M]);
+                    zg += av * *((v2f16 *) &w[2*M]);
+                    zo += av * *((v2f16 *) &w[3*M]);
+                }
+                else {
+                    zi[0] += a * w[0];
+                    zf[0] += a * w[M];
+                    zg[0] += a * w[2*M];
+                    zo[0] += a * w[3*M];
+                }
+                w += 4*M;
+            }
+
+            v2f16 i_g = lstm_sigmoid_v2f16(zi, approx);
+            v2f16 f_g = lstm_sigmoid_v2f16(zf, approx);
+            v2f16 g_g = lstm_tanh_v2f16(zg, approx);
+            v2f16 o_g = lstm_sigmoid_v2f16(zo, approx);
+            v2f16 c_p = pair ? *((v2f16 *) &prevCell[j]) : (v2f16) {prevCell[j], 0};
+            v2f16 c = f_g * c_p + i_g * g_g;
+            v2f16 h = o_g * lstm_tanh_v2f16(c, approx);
+
+            for(int u=0; u<1+pair; u++){
+                currGates[j+u] = i_g[u];
+                currGates[M+j+u] = f_g[u];
+                currGates[2*M+j+u] = g_g[u];
+                currGates[3*M+j+u] = o_g[u];
+                cells[t*M+j+u] = c[u];
+                outData[t*M+j+u] = h[u];
+            }
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
+//BACKWARD
+void pulp_lstm_fp16_bw_cl(void * Lstm_args_fp16)
+{
+    struct Lstm_args_fp16 *lstm_args = (struct Lstm_args_fp16 *) Lstm_args_fp16;
+
+    int N = lstm_args->input->H; // Input sequence length
+    int window = (lstm_args->bptt_window > 0 && lstm_args->bptt_window < N) ? lstm_args->bptt_window : N;
+
+    struct Lstm_bptt_args_fp16 bptt_args;
+    bptt_args.lstm_args = lstm_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, lstm_core_bw_fp16, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+void lstm_core_bw_fp16(void * Lstm_bptt_args_fp16)
+{
+    struct Lstm_bptt_args_fp16 *bptt_args = (struct Lstm_bptt_args_fp16 *) Lstm_bptt_args_fp16;
+    struct Lstm_args_fp16 *lstm_args = bptt_args->lstm_args;
+
+    fp16 *coeffData = lstm_args->coeff->data;
+    fp16 *coeffDiff = lstm_args->coeff->diff;
+    fp16 *inData = lstm_args->input->data;
+    fp16 *inDiff = lstm_args->input->diff;
+    fp16 *outData = lstm_args->output->data;
+    fp16 *outDiff = lstm_args->output->diff;
+    fp16 *stateData = lstm_args->state->data;
+    fp16 *stateDiff = lstm_args->state->diff;          // Carries the hidden state gradient between timesteps
+    fp16 *cellStateData = lstm_args->cell_state->data;
+    fp16 *cellStateDiff = lstm_args->cell_state->diff; // Carries the cell state gradient between timesteps
+    fp16 *gates = lstm_args->gates;
+    fp16 *cells = lstm_args->cells;
+    fp16 *grad = lstm_args->grad_buffer; // Gate gradients of the window
+    int approx = lstm_args->approx;
+
+    int K = lstm_args->input->W; // Input sequence element size
+    int M = lstm_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards, no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        fp16 *currGates = gates + t*4*M;
+        fp16 *currGrad = grad + (t-t_start)*4*M;
+        fp16 *prevCell = (t == 0) ? cellStateData : cells + (t-1)*M;
+
+        for(int j=start; j<stop; j++){
+            fp16 dh = outDiff[t*M+j];
+            fp16 dc = 0;
+            if(t < t_stop-1){
+                // dh_t += dGates_(t+1) * W_h^T (j-th row of the state weights)
+                dh += lstm_dot_fp16(currGrad + 4*M, coeffData + (K+j)*4*M, 4*M);
+                dc = cellStateDiff[j];
+            }
+
+            fp16 i_g = currGates[j];
+            fp16 f_g = currGates[M+j];
+            fp16 g_g = currGates[2*M+j];
+            fp16 o_g = currGates[3*M+j];
+            fp16 tc = lstm_tanh_v2f16((v2f16) {cells[t*M+j], cells[t*M+j]}, approx)[0];
+
+            dc += dh * o_g * (1 - tc * tc);
+            currGrad[j] = dc * g_g * i_g * (1 - i_g);
+            currGrad[M+j] = dc * prevCell[j] * f_g * (1 - f_g);
+            currGrad[2*M+j] = dc * i_g * (1 - g_g * g_g);
+            currGrad[3*M+j] = dh * tc * o_g * (1 - o_g);
+            cellStateDiff[j] = dc * f_g;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial hidden state (the one of the initial cell state is already in cellStateDiff)
+    if(t_start == 0)
+        for(int j=start; j<stop; j++)
+            stateDiff[j] = lstm_dot_fp16(grad, coeffData + (K+j)*4*M, 4*M);
+
+    // Weight gradients of the whole window: dW = [X, H_prev]^T * dGates, parallelized over the K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        fp16 *wgtDiff = coeffDiff + r*4*M;
+        if(!bptt_args->accumulate)
+            for(int c=0; c<4*M; c++)
+                wgtDiff[c] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            fp16 a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            fp16 *currGrad = grad + (t-t_start)*4*M;
+            v2f16 av = (v2f16) {a, a};
+            // 4M is even: no leftover
+            for(int c=0; c<4*M; c+=2)
+                *((v2f16 *) &wgtDiff[c]) += av * *((v2f16 *) &currGrad[c]);
+        }
+    }
+
+    // Input gradients of the window: dX = dGates * W_x^T (W_x being the first K rows of the weights)
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.A = grad;
+    matMul_args1.B = coeffData;
+    matMul_args1.C = inDiff + t_start*K;
+    matMul_args1.N = T;
+    matMul_args1.K = 4*M;
+    matMul_args1.M = K;
+    matMul_args1.trans_B = 1;
+
+    mm_fp16(&matMul_args1);
+}
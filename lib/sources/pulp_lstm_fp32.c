@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pulp_train_utils_fp32.h"
+#include "pulp_lstm_fp32.h"
+#include "pulp_matmul_fp32.h"
+#include "pulp_act_fp32.h"
+#include <math.h>
+
+
+// Gate activations, exact or with the bit-manipulated exponential
+static inline float lstm_sigmoid(float x, int approx)
+{
+    return 1.0f / (1.0f + (approx == ACT_APPROX ? fastexp_gist(-x) : expf(-x)));
+}
+
+static inline float lstm_tanh(float x, int approx)
+{
+    return approx == ACT_APPROX ? 2.0f * lstm_sigmoid(2.0f * x, approx) - 1.0f : tanhf(x);
+}
+
+
+//FORWARD
+void pulp_lstm_fp32_fw_cl(void * Lstm_args)
+{
+    pulp_team_fork(NUM_CORES, lstm_core_fw_fp32, Lstm_args);
+}
+
+void lstm_core_fw_fp32(void * Lstm_args)
+{
+    struct Lstm_args *lstm_args = (struct Lstm_args *) Lstm_args;
+    float *coeffData = lstm_args->coeff->data;       // Concatenated gate weights
+    float *inputData = lstm_args->input->data;
+    float *outData = lstm_args->output->data;        // Hidden states of all the timesteps
+    float *stateData = lstm_args->state->data;       // Initial hidden state
+    float *cellStateData = lstm_args->cell_state->data; // Initial cell state
+    float *gates = lstm_args->gates;
+    float *cells = lstm_args->cells;
+    int approx = lstm_args->approx;
+
+    int N = lstm_args->input->H; // Input/Output Sequence length
+    int K = lstm_args->input->W; // Input Sequence element length
+    int M = lstm_args->output->W; // Output Sequence element length
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        float *currInput = inputData + t*K;
+        float *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        float *prevCell = (t == 0) ? cellStateData : cells + (t-1)*M;
+        float *currGates = gates + t*4*M;
+
+        for(int j=start; j<stop; j++){
+            // [x_t, h_(t-1)] * W on the four gate columns of the j-th unit
+            float zi = 0, zf = 0, zg = 0, zo = 0;
+            float *w = coeffData + j;
+            for(int r=0; r<K+M; r++){
+                float a = (r < K) ? currInput[r] : prevState[r-K];
+                zi += a * w[0];
+                zf += a * w[M];
+                zg += a * w[2*M];
+                zo += a * w[3*M];
+                w += 4*M;
+            }
+
+            float i_g = lstm_sigmoid(zi, approx);
+            float f_g = lstm_sigmoid(zf, approx);
+            float g_g = lstm_tanh(zg, approx);
+            float o_g = lstm_sigmoid(zo, approx);
+            float c = f_g * prevCell[j] + i_g * g_g;
+
+            currGates[j] = i_g;
+            currGates[M+j] = f_g;
+            currGates[2*M+j] = g_g;
+            currGates[3*M+j] = o_g;
+            cells[t*M+j] = c;
+            outData[t*M+j] = o_g * lstm_tanh(c, approx);
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
+//BACKWARD
+void pulp_lstm_fp32_bw_cl(void * Lstm_args)
+{
+    struct Lstm_args *lstm_args = (struct Lstm_args *) Lstm_args;
+
+    int N = lstm_args->input->H; // Input sequence length
+    int window = (lstm_args->bptt_window > 0 && lstm_args->bptt_window < N) ? lstm_args->bptt_window : N;
+
+    struct Lstm_bptt_args bptt_args;
+    bptt_args.lstm_args = lstm_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, lstm_core_bw_fp32, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+void lstm_core_bw_fp32(void * Lstm_bptt_args)
+{
+    struct Lstm_bptt_args *bptt_args = (struct Lstm_bptt_args *) Lstm_bptt_args;
+    struct Lstm_args *lstm_args = bptt_args->lstm_args;
+
+    float *coeffData = lstm_args->coeff->data;
+    float *coeffDiff = lstm_args->coeff->diff;
+    float *inData = lstm_args->input->data;
+    float *inDiff = lstm_args->input->diff;
+    float *outData = lstm_args->output->data;
+    float *outDiff = lstm_args->output->diff;
+    float *stateData = lstm_args->state->data;
+    float *stateDiff = lstm_args->state->diff;          // Carries the hidden state gradient between timesteps
+    float *cellStateData = lstm_args->cell_state->data;
+    float *cellStateDiff = lstm_args->cell_state->diff; // Carries the cell state gradient between timesteps
+    float *gates = lstm_args->gates;
+    float *cells = lstm_args->cells;
+    float *grad = lstm_args->grad_buffer; // Gate gradients of the window
+    int approx = lstm_args->approx;
+
+    int K = lstm_args->input->W; // Input sequence element size
+    int M = lstm_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards, no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        float *currGates = gates + t*4*M;
+        float *currGrad = grad + (t-t_start)*4*M;
+        float *nextGrad = currGrad + 4*M;
+        float *prevCell = (t == 0) ? cellStateData : cells + (t-1)*M;
+
+        for(int j=start; j<stop; j++){
+            float dh = outDiff[t*M+j];
+            float dc = 0;
+            if(t < t_stop-1){
+                // dh_t += dGates_(t+1) * W_h^T (j-th row of the state weights)
+                float *w = coeffData + (K+j)*4*M;
+                for(int c=0; c<4*M; c++)
+                    dh += nextGrad[c] * w[c];
+                dc = cellStateDiff[j];
+            }
+
+            float i_g = currGates[j];
+            float f_g = currGates[M+j];
+            float g_g = currGates[2*M+j];
+            float o_g = currGates[3*M+j];
+            float tc = lstm_tanh(cells[t*M+j], approx);
+
+            dc += dh * o_g * (1 - tc * tc);
+            currGrad[j] = dc * g_g * i_g * (1 - i_g);
+            currGrad[M+j] = dc * prevCell[j] * f_g * (1 - f_g);
+            currGrad[2*M+j] = dc * i_g * (1 - g_g * g_g);
+            currGrad[3*M+j] = dh * tc * o_g * (1 - o_g);
+            cellStateDiff[j] = dc * f_g;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial hidden state (the one of the initial cell state is already in cellStateDiff)
+    if(t_start == 0){
+        for(int j=start; j<stop; j++){
+            float *w = coeffData + (K+j)*4*M;
+            float acc = 0;
+            for(int c=0; c<4*M; c++)
+                acc += grad[c] * w[c];
+            stateDiff[j] = acc;
+        }
+    }
+
+    // Weight gradients of the whole window: dW = [X, H_prev]^T * dGates, parallelized over the K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        float *wgtDiff = coeffDiff + r*4*M;
+        if(!bptt_args->accumulate)
+            for(int c=0; c<4*M; c++)
+                wgtDiff[c] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            float a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            float *currGrad = grad + (t-t_start)*4*M;
+            for(int c=0; c<4*M; c++)
+                wgtDiff[c] += a * currGrad[c];
+        }
+    }
+
+    // Input gradients of the window: dX = dGates * W_x^T (W_x being the first K rows of the weights)
+    struct matMul_args matMul_args1;
+    matMul_args1.A = grad;
+    matMul_args1.B = coeffData;
+    matMul_args1.C = inDiff + t_start*K;
+    matMul_args1.N = T;
+    matMul_args1.K = 4*M;
+    matMul_args1.M = K;
+    matMul_args1.trans_B = 1;
+
+    mm(&matMul_args1);
+}
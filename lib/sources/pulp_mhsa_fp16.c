@@ -15,6 +15,14 @@
 #include "pulp_act_fp16.h"
 #include <math.h>
 
+
+// Number of keys the l-th query attends to, given the causal and key-padding masks
+static inline int mhsa_key_limit(int l, int L, int causal, int valid_len){
+    int n_keys = (valid_len > 0 && valid_len < L) ? valid_len : L;
+    if (causal && l+1 < n_keys) n_keys = l+1;
+    return n_keys;
+}
+
 /*
 //FORWARD
 void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
@@ -73,14 +81,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args1);
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args1);
     #else
     struct mm_manager_args_fp16 man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
     #endif
 
     #ifdef DEBUG
@@ -99,14 +107,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     transp_args1.N = L;
     transp_args1.M = 3*F;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args1);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args1);
 
     struct copy_args_fp16 copy_args1;
     copy_args1.from = temp;
     copy_args1.to = qkv;
     copy_args1.size = L*3*F;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args1);
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args1);
 
     // Separate Q, K and V entry points in the QKV matrix
     q = qkv;
@@ -124,7 +132,7 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
         transp_args2.N = H;
         transp_args2.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
 
         // Multiply it with the i-th head's Q chunk
         struct matMul_args_fp16 matMul_args2;
@@ -137,14 +145,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
         matMul_args2.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args2);
+        pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args2);
         #else
         struct mm_manager_args_fp16 man_args2;
         man_args2.mm_args = &matMul_args2;
         man_args2.layer_type = LAYER_LINEAR;
         man_args2.step_type = STEP_FW;
         man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
         #endif
 
 
@@ -153,7 +161,7 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
         s_m_args.scalar = scaling;
         s_m_args.dim = L*L;
 
-        pi_cl_team_fork(NUM_CORES,  pulp_scalar_mul_fp16_cl, &s_m_args);
+        pulp_team_fork(NUM_CORES,  pulp_scalar_mul_fp16_cl, &s_m_args);
 
         /*
         for(int j = 0; j < (L*L); j++)
@@ -171,7 +179,7 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
 
         pulp_softmax_fp16_fw_cl(&softmax_arg);
 
-        //pi_cl_team_fork(1, pulp_softmax_fp16_fw_cl, &softmax_arg); //TODO: actually parallelize this function
+        //pulp_team_fork(1, pulp_softmax_fp16_fw_cl, &softmax_arg); //TODO: actually parallelize this function
 
         // Multiply softmax result with the i-th head's V chunk
         struct matMul_args_fp16 matMul_args3;
@@ -184,14 +192,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
         matMul_args3.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args3);
+        pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args3);
         #else
         struct mm_manager_args_fp16 man_args3;
         man_args3.mm_args = &matMul_args3;
         man_args3.layer_type = LAYER_LINEAR;
         man_args3.step_type = STEP_FW;
         man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
         #endif
     }
 
@@ -206,14 +214,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     matMul_args4.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args4);
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args4);
     #else
     struct mm_manager_args_fp16 man_args4;
     man_args4.mm_args = &matMul_args4;
     man_args4.layer_type = LAYER_LINEAR;
     man_args4.step_type = STEP_FW;
     man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
     #endif
 
     #ifdef DEBUG
@@ -232,14 +240,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     transp_args3.N = E;
     transp_args3.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args3);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args3);
 
     struct copy_args_fp16 copy_args2;
     copy_args2.from = temp;
     copy_args2.to = outData;
     copy_args2.size = L*E;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args2);
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args2);
     
     #ifdef DEBUG
     printf("\nOutput Data map Data: %d %d\n", E, L);
@@ -312,14 +320,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args1);
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args1);
     #else
     struct mm_manager_args_fp16 man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
     #endif
 
     #ifdef DEBUG
@@ -347,151 +355,194 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
 
     //  Cycle on the different heads
     for(int i = 0; i < n_heads; i++){
-        /*
-        //  Initialize the pointers to the correct starting positions for the i-th head
-        float* current_head_buffer = head_buffer + i*L*L;
-        float* current_softmax_buffer = softmax_buffer + i*L*L;
-        */
+        //  The i-th head's probabilities are kept for the backward
+        fp16* head_softmax = softmax_buffer + i*L*L;
 
-        //  Transpose i-th head's K chunk
+        //  Transpose i-th head's Q chunk (H x L -> L x H), so that the scores are obtained as Q * Kt with one row per query
         struct transp_args_fp16 transp_args2;
-        transp_args2.matrix = k + L*i*H;
+        transp_args2.matrix = q + L*i*H;
         transp_args2.transp_matrix = temp;
         transp_args2.N = H;
         transp_args2.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
-
-        //  Multiply it with the i-th head's Q chunk
-        struct matMul_args_fp16 matMul_args2;
-        matMul_args2.A = temp;
-        matMul_args2.B = q + L*i*H;
-        matMul_args2.C = softmax_buffer;
-        matMul_args2.N = L;
-        matMul_args2.K = H;
-        matMul_args2.M = L;
-        matMul_args2.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args2);
-        #else
-        struct mm_manager_args man_args2;
-        man_args2.mm_args = &matMul_args2;
-        man_args2.layer_type = LAYER_LINEAR;
-        man_args2.step_type = STEP_FW;
-        man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
-        #endif
-
-        //  Scale the current head values by a factor proportional to the head dimension
-        struct scalar_mul_args_fp16 s_m_args;
-        s_m_args.input = softmax_buffer;
-        s_m_args.scalar = scaling;
-        s_m_args.dim = L*L;
-
-        pi_cl_team_fork(NUM_CORES,  pulp_scalar_mul_fp16_cl, &s_m_args);
-
-        #ifdef DEBUG
-        printf("\nCurrent head buffer Data: %d %d\n", L, L);
-        for (int j=0; j<L*L; j++){
-            if(!(j%(L))) printf("\n");
-            printf("%.8f ", softmax_buffer[j]);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
+
+        if (mhsa_args->causal || mhsa_args->valid_len > 0) {
+            //  Masked head, by blocks of MHSA_MASK_TILE queries: each block only multiplies the keys up to its last unmasked one.
+            //  K and V chunks are transposed (L x H), so that the unmasked keys of a block are the first rows of Kt and Vt
+            fp16 *kt = temp + L*H;
+            fp16 *vt = kt + L*H;
+            fp16 *tile = vt + L*H;     //  Scores and probabilities of a block (MHSA_MASK_TILE x n_keys)
+
+            struct transp_args_fp16 transp_args5;
+            transp_args5.matrix = k + L*i*H;
+            transp_args5.transp_matrix = kt;
+            transp_args5.N = H;
+            transp_args5.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args5);
+
+            struct transp_args_fp16 transp_args6;
+            transp_args6.matrix = v + L*i*H;
+            transp_args6.transp_matrix = vt;
+            transp_args6.N = H;
+            transp_args6.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args6);
+
+            for (int r0 = 0; r0 < L; r0 += MHSA_MASK_TILE) {
+                int n_rows = (r0 + MHSA_MASK_TILE > L) ? L - r0 : MHSA_MASK_TILE;
+                int n_keys = mhsa_key_limit(r0 + n_rows - 1, L, mhsa_args->causal, mhsa_args->valid_len);
+
+                //  Scores of the block against its unmasked keys: (n_rows x H) * (n_keys x H)t -> (n_rows x n_keys)
+                struct matMul_args_fp16 matMul_args5;
+                matMul_args5.A = temp + r0*H;
+                matMul_args5.B = kt;
+                matMul_args5.C = tile;
+                matMul_args5.N = n_rows;
+                matMul_args5.K = H;
+                matMul_args5.M = n_keys;
+                matMul_args5.trans_B = 1;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args5);
+                #else
+                struct mm_manager_args_fp16 man_args5;
+                man_args5.mm_args = &matMul_args5;
+                man_args5.layer_type = LAYER_LINEAR;
+                man_args5.step_type = STEP_FW;
+                man_args5.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args5);
+                #endif
+
+                //  Masked softmax of the block's rows, also saved in the head's L x L probabilities
+                struct mhsa_mask_args_fp16 mask_args;
+                mask_args.scores = tile;
+                mask_args.softmax = head_softmax;
+                mask_args.maxes = maxes;
+                mask_args.sums = sums;
+                mask_args.L = L;
+                mask_args.row0 = r0;
+                mask_args.n_rows = n_rows;
+                mask_args.n_keys = n_keys;
+                mask_args.scaling = scaling;
+                mask_args.causal = mhsa_args->causal;
+                mask_args.valid_len = mhsa_args->valid_len;
+
+                pulp_team_fork(NUM_CORES, mhsa_masked_softmax_fp16, &mask_args);
+
+                //  Product with the unmasked values: (n_rows x n_keys) * (n_keys x H) -> (n_rows x H), over the block's rows of Qt (no longer needed)
+                struct matMul_args_fp16 matMul_args6;
+                matMul_args6.A = tile;
+                matMul_args6.B = vt;
+                matMul_args6.C = temp + r0*H;
+                matMul_args6.N = n_rows;
+                matMul_args6.K = n_keys;
+                matMul_args6.M = H;
+                matMul_args6.trans_B = 0;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args6);
+                #else
+                struct mm_manager_args_fp16 man_args6;
+                man_args6.mm_args = &matMul_args6;
+                man_args6.layer_type = LAYER_LINEAR;
+                man_args6.step_type = STEP_FW;
+                man_args6.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args6);
+                #endif
+            }
+
+            //  Transpose the head's attention map back (L x H -> H x L)
+            struct transp_args_fp16 transp_args7;
+            transp_args7.matrix = temp;
+            transp_args7.transp_matrix = attention_map + L*i*H;
+            transp_args7.N = L;
+            transp_args7.M = H;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args7);
+        }
+        else {
+            //  Multiply it with the i-th head's K chunk
+            struct matMul_args_fp16 matMul_args2;
+            matMul_args2.A = temp;
+            matMul_args2.B = k + L*i*H;
+            matMul_args2.C = head_softmax;
+            matMul_args2.N = L;
+            matMul_args2.K = H;
+            matMul_args2.M = L;
+            matMul_args2.trans_B = 0;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args2);
+            #else
+            struct mm_manager_args_fp16 man_args2;
+            man_args2.mm_args = &matMul_args2;
+            man_args2.layer_type = LAYER_LINEAR;
+            man_args2.step_type = STEP_FW;
+            man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
+            #endif
+
+            //  Scale the current head values by a factor proportional to the head dimension
+            struct scalar_mul_args_fp16 s_m_args;
+            s_m_args.input = head_softmax;
+            s_m_args.scalar = scaling;
+            s_m_args.dim = L*L;
+
+            pulp_team_fork(NUM_CORES,  pulp_scalar_mul_fp16_cl, &s_m_args);
+
+            #ifdef DEBUG
+            printf("\nCurrent head buffer Data: %d %d\n", L, L);
+            for (int j=0; j<L*L; j++){
+                if(!(j%(L))) printf("\n");
+                printf("%.8f ", head_softmax[j]);
+            }
+            printf("\n");
+            #endif
+
+            //  Softmax algorithm selected by softmax_type, row-wise on the natively laid out scores (in place)
+            struct softmax_args_fp16 softmax_arg;
+            struct blob_fp16 input;
+            struct blob_fp16 output;
+            input.data = head_softmax;
+            input.dim = L;
+            output.data = head_softmax;
+            softmax_arg.input = &input;
+            softmax_arg.output = &output;
+            softmax_arg.L = L;
+            softmax_arg.n_heads = 1;
+            softmax_arg.maxes = maxes;
+            softmax_arg.sums = sums;
+
+            int softmax_type = mhsa_args->softmax_type;
+            if      (softmax_type == SOFTMAX_PARTIAL)           { pulp_team_fork(NUM_CORES, pulp_partial_softmax_fp16_fw_cl, &softmax_arg); }
+            else if (softmax_type == SOFTMAX_PARTIAL_SHIFT)     { pulp_team_fork(NUM_CORES, pulp_partial_softmax_shift_fp16_fw_cl, &softmax_arg); }
+            else if (softmax_type == SOFTMAX_PARTIAL_APPROX)    { pulp_team_fork(NUM_CORES, pulp_partial_softmax_approximate_fp16_fw_cl, &softmax_arg); }
+            else if (softmax_type == SOFTMAX_SIMPLE)            { pulp_partial_softmax_simple_fp16_fw_cl(&softmax_arg); }
+            else                                                { pulp_softmax_fp16_fw_cl(&softmax_arg); }
+
+            //  Multiply the i-th head's V chunk with the transposed softmax result (H x L), appending it to the attention map
+            struct matMul_args_fp16 matMul_args3;
+            matMul_args3.A = v + L*i*H;
+            matMul_args3.B = head_softmax;
+            matMul_args3.C = attention_map + L*i*H;
+            matMul_args3.N = H;
+            matMul_args3.K = L;
+            matMul_args3.M = L;
+            matMul_args3.trans_B = 1;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args3);
+            #else
+            struct mm_manager_args_fp16 man_args3;
+            man_args3.mm_args = &matMul_args3;
+            man_args3.layer_type = LAYER_LINEAR;
+            man_args3.step_type = STEP_FW;
+            man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
+            #endif
         }
-        printf("\n");
-        #endif
-
-        //  Due to the fact that we multiplied K * Qt instead of Q * Kt like in the original MHSA model, the current
-        //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
-        //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
-        struct transp_args_fp16 transp_args4;
-        transp_args4.matrix = softmax_buffer;
-        transp_args4.transp_matrix = temp;
-        transp_args4.N = L;
-        transp_args4.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args4);
-
-        /*
-        struct copy_args copy_args3;
-        copy_args3.from = temp;
-        copy_args3.to = current_head_buffer;
-        copy_args3.size = L*L;
-
-        pi_cl_team_fork(NUM_CORES, copy, &copy_args3);
-        */
-
-        //  Softmax algorithm
-        struct softmax_args_fp16 softmax_arg;
-        struct blob input;
-        struct blob output;
-        input.data = temp;
-        input.dim = L;
-        output.data = softmax_buffer;
-        softmax_arg.input = &input;
-        softmax_arg.output = &output;
-        softmax_arg.maxes = maxes;
-        softmax_arg.sums = sums;
-
-        /*
-        ///------------------------------------------------------------------///
-        //printf("\nSoftmax stats\n");
-        pi_perf_conf((1<<PI_PERF_CYCLES)); 
-
-
-        pi_perf_stop();
-        pi_perf_reset(); 
-        pi_perf_start();
-        */
-
-        pulp_softmax_fp16_fw_cl(&softmax_arg);
-        //pulp_partial_softmax_simple_fp32_fw_cl(&softmax_arg);
-
-        /*
-        pi_perf_stop(); 
-        _cycles   += pi_perf_read (PI_PERF_CYCLES); 
-        id = pi_core_id(); 
-        ///----------------------------------------------------------------///
-        */
-
-        //  Each head result has to be appended to the full attention map, to do so we require to store the current
-        //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
-        struct transp_args_fp16 transp_args5;
-        transp_args5.matrix = softmax_buffer;
-        transp_args5.transp_matrix = temp;
-        transp_args5.N = L;
-        transp_args5.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args5);
-
-        /*
-        struct copy_args copy_args4;
-        copy_args4.from = temp;
-        copy_args4.to = current_softmax_buffer;
-        copy_args4.size = L*L;
-
-        pi_cl_team_fork(NUM_CORES, copy, &copy_args4);
-        */
-
-        //  Multiply softmax result with the i-th head's Vt chunk
-        struct matMul_args_fp16 matMul_args3;
-        matMul_args3.A = v + L*i*H;
-        matMul_args3.B = temp;
-        matMul_args3.C = attention_map + L*i*H;
-        matMul_args3.N = H;
-        matMul_args3.K = L;
-        matMul_args3.M = L;
-        matMul_args3.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args3);
-        #else
-        struct mm_manager_args_fp16 man_args3;
-        man_args3.mm_args = &matMul_args3;
-        man_args3.layer_type = LAYER_LINEAR;
-        man_args3.step_type = STEP_FW;
-        man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
-        #endif
     }
 
     #ifdef DEBUG
@@ -526,14 +577,14 @@ void pulp_mhsa_fp16_fw_cl(void* Mhsa_args){
     matMul_args4.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args4);
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args4);
     #else
     struct mm_manager_args_fp16 man_args4;
     man_args4.mm_args = &matMul_args4;
     man_args4.layer_type = LAYER_LINEAR;
     man_args4.step_type = STEP_FW;
     man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
     #endif
 
     #ifdef DEBUG
@@ -623,14 +674,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     matMul_args1.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args1); // Gradient of attention map: (L x E)*(E x F) - > (L x F)
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args1); // Gradient of attention map: (L x E)*(E x F) - > (L x F)
     #else
     struct mm_manager_args_fp16 man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
     #endif
 
     //Transpose map gradients (copy required because transpose can't be done inplace)
@@ -640,14 +691,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     transp_args1.N = L;
     transp_args1.M = F;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args1);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args1);
 
     struct copy_args_fp16 copy_args1;
     copy_args1.from = temp;
     copy_args1.to = attention_map_diff;
     copy_args1.size = F*L;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args1); // Transposed gradient of attention map: (L x F) - > (F x L)
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args1); // Transposed gradient of attention map: (L x F) - > (F x L)
 
     // Output Projection Weights
 
@@ -680,14 +731,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args2); // Output weight gradient: (F x L)*(L x E) - > (F x E)
+    pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args2); // Output weight gradient: (F x L)*(L x E) - > (F x E)
     #else
     struct mm_manager_args_fp16 man_args2;
     man_args2.mm_args = &matMul_args2;
     man_args2.layer_type = LAYER_LINEAR;
     man_args2.step_type = STEP_FW;
     man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
     #endif
 
 
@@ -698,14 +749,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     transp_args9.N = F;
     transp_args9.M = E;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args9);
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args9);
 
     struct copy_args_fp16 copy_args9;
     copy_args9.from = temp;
     copy_args9.to = coeffDiffWout;
     copy_args9.size = E*F;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args9); // Transposed output weight gradient: (F x E) - > (E x F)
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args9); // Transposed output weight gradient: (F x E) - > (E x F)
 
 
     #ifdef DEBUG
@@ -719,6 +770,122 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
 
     // Cycle on the heads
     for(int i=0; i<n_heads; i++){
+        if (mhsa_args->causal || mhsa_args->valid_len > 0) {
+            // Masked head, by blocks of MHSA_MASK_TILE queries: the GEMMs of each block stop at its last unmasked key,
+            // then the key and value gradients only visit the queries attending to each key
+            fp16 scaling = 1/sqrt(H);
+
+            fp16 *dqt = temp;                               // Transposed Q gradient of the head (L x H)
+            fp16 *kt = dqt + L*H;
+            fp16 *vt = kt + L*H;
+            fp16 *dot = vt + L*H;                           // Transposed attention map gradient of the head (L x H)
+            fp16 *ds_tile = dot + L*H;                      // Probability gradient of a block, turned into its score gradient
+
+            struct transp_args_fp16 transp_args12;
+            transp_args12.matrix = k + i*L*H;
+            transp_args12.transp_matrix = kt;
+            transp_args12.N = H;
+            transp_args12.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args12);
+
+            struct transp_args_fp16 transp_args13;
+            transp_args13.matrix = v + i*L*H;
+            transp_args13.transp_matrix = vt;
+            transp_args13.N = H;
+            transp_args13.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args13);
+
+            struct transp_args_fp16 transp_args14;
+            transp_args14.matrix = attention_map_diff + i*L*H;
+            transp_args14.transp_matrix = dot;
+            transp_args14.N = H;
+            transp_args14.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args14);
+
+            struct mhsa_mask_bw_args_fp16 mask_bw_args;
+            mask_bw_args.grad_tile = ds_tile;
+            mask_bw_args.softmax = softmax_buffer + i*L*L;
+            mask_bw_args.grad = grad;
+            mask_bw_args.q = q + i*L*H;
+            mask_bw_args.att_diff = attention_map_diff + i*L*H;
+            mask_bw_args.k_diff = k_diff + i*L*H;
+            mask_bw_args.v_diff = v_diff + i*L*H;
+            mask_bw_args.L = L;
+            mask_bw_args.H = H;
+            mask_bw_args.scaling = scaling;
+            mask_bw_args.causal = mhsa_args->causal;
+            mask_bw_args.valid_len = mhsa_args->valid_len;
+
+            for (int r0 = 0; r0 < L; r0 += MHSA_MASK_TILE) {
+                int n_rows = (r0 + MHSA_MASK_TILE > L) ? L - r0 : MHSA_MASK_TILE;
+                int n_keys = mhsa_key_limit(r0 + n_rows - 1, L, mhsa_args->causal, mhsa_args->valid_len);
+
+                // Probability gradient of the block: (n_rows x H) * (n_keys x H)t -> (n_rows x n_keys)
+                struct matMul_args_fp16 matMul_args12;
+                matMul_args12.A = dot + r0*H;
+                matMul_args12.B = vt;
+                matMul_args12.C = ds_tile;
+                matMul_args12.N = n_rows;
+                matMul_args12.K = H;
+                matMul_args12.M = n_keys;
+                matMul_args12.trans_B = 1;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args12);
+                #else
+                struct mm_manager_args_fp16 man_args12;
+                man_args12.mm_args = &matMul_args12;
+                man_args12.layer_type = LAYER_LINEAR;
+                man_args12.step_type = STEP_FW;
+                man_args12.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args12);
+                #endif
+
+                // Back propagation through the masked softmax, rows interleaved among the cores
+                mask_bw_args.row0 = r0;
+                mask_bw_args.n_rows = n_rows;
+                mask_bw_args.n_keys = n_keys;
+
+                pulp_team_fork(NUM_CORES, mhsa_masked_softmax_bw_fp16, &mask_bw_args);
+
+                // Transposed Q gradient of the block: (n_rows x n_keys) * (n_keys x H) -> (n_rows x H)
+                struct matMul_args_fp16 matMul_args13;
+                matMul_args13.A = ds_tile;
+                matMul_args13.B = kt;
+                matMul_args13.C = dqt + r0*H;
+                matMul_args13.N = n_rows;
+                matMul_args13.K = n_keys;
+                matMul_args13.M = H;
+                matMul_args13.trans_B = 0;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args13);
+                #else
+                struct mm_manager_args_fp16 man_args13;
+                man_args13.mm_args = &matMul_args13;
+                man_args13.layer_type = LAYER_LINEAR;
+                man_args13.step_type = STEP_FW;
+                man_args13.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args13);
+                #endif
+            }
+
+            struct transp_args_fp16 transp_args15;
+            transp_args15.matrix = dqt;
+            transp_args15.transp_matrix = q_diff + i*L*H;
+            transp_args15.N = L;
+            transp_args15.M = H;
+
+            pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args15); // i-th head Query gradient: (L x H) - > (H x L)
+
+            // i-th head Key and Value gradients, keys interleaved among the cores
+            pulp_team_fork(NUM_CORES, mhsa_masked_kv_bw_fp16, &mask_bw_args);
+            continue;
+        }
+
         // I-th head Value Gradient
 
         // matmul setup 3
@@ -732,14 +899,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         matMul_args3.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args3); // i-th head Value gradient: (H x L)*(L x L) - > (H x L)
+        pulp_team_fork(NUM_CORES,  mm_fp16, &matMul_args3); // i-th head Value gradient: (H x L)*(L x L) - > (H x L)
         #else
         struct mm_manager_args_fp16 man_args3;
         man_args3.mm_args = &matMul_args3;
         man_args3.layer_type = LAYER_LINEAR;
         man_args3.step_type = STEP_FW;
         man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
         #endif
 
 
@@ -752,7 +919,7 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         transp_args3.N = H;
         transp_args3.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args3); // Transpose i-th head attention map gradient: (H x L) - > (L x H) 
+        pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args3); // Transpose i-th head attention map gradient: (H x L) - > (L x H) 
 
 
         // matmul setup 4
@@ -766,31 +933,31 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         matMul_args4.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args4); // i-th head Buffer gradient: (L x H)*(H x L) - > (L x L)
+        pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args4); // i-th head Buffer gradient: (L x H)*(H x L) - > (L x L)
         #else
         struct mm_manager_args_fp16 man_args4;
         man_args4.mm_args = &matMul_args4;
         man_args4.layer_type = LAYER_LINEAR;
         man_args4.step_type = STEP_FW;
         man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
         #endif
 
 
-        struct act_args_fp16 softmax_arg;
+        struct softmax_bw_args_fp16 softmax_arg;
         struct blob_fp16 input;
         struct blob_fp16 output;
         input.diff = grad;
         input.dim = L*L;
         output.data = softmax_buffer + i*L*L;
         output.diff = head_buffer_diff + i*L*L;
-        output.dim = i;
+        output.dim = L*L;
         softmax_arg.input = &input;
         softmax_arg.output = &output;
-        // Back propagation of i-th head Buffer gradient through the softmax operation
-
-        
-        pi_cl_team_fork(1, pulp_softmax_fp16_bw_cl, &softmax_arg);
+        softmax_arg.n_rows = L;
+        softmax_arg.dim = L;
+        // Back propagation of i-th head Buffer gradient through the softmax operation (row-wise, parallel on the rows)
+        pulp_row_softmax_fp16_bw_cl(&softmax_arg);
 
 
 
@@ -804,14 +971,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         transp_args4.N = L;
         transp_args4.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args4); 
+        pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args4); 
 
         struct copy_args_fp16 copy_args3;
         copy_args3.from = temp;
         copy_args3.to = grad;
         copy_args3.size = L*L;
 
-        pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args3); // Still (L x L). Unsure if it is needed.
+        pulp_team_fork(NUM_CORES, copy_fp16, &copy_args3); // Still (L x L). Unsure if it is needed.
 
         // matmul setup 5
         struct matMul_args_fp16 matMul_args5;
@@ -824,14 +991,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         matMul_args5.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args5); // i-th head Query gradient: (H x L)*(L x L) - > (H x L)
+        pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args5); // i-th head Query gradient: (H x L)*(L x L) - > (H x L)
         #else
         struct mm_manager_args_fp16 man_args5;
         man_args5.mm_args = &matMul_args5;
         man_args5.layer_type = LAYER_LINEAR;
         man_args5.step_type = STEP_FW;
         man_args5.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args5);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args5);
         #endif
 
 
@@ -848,14 +1015,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
         matMul_args6.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args6); // i-th head Key gradient: (H x L)*(L x L) - > (H x L)
+        pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args6); // i-th head Key gradient: (H x L)*(L x L) - > (H x L)
         #else
         struct mm_manager_args_fp16 man_args6;
         man_args6.mm_args = &matMul_args6;
         man_args6.layer_type = LAYER_LINEAR;
         man_args6.step_type = STEP_FW;
         man_args6.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args6);
+        pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args6);
         #endif
     }
 
@@ -872,14 +1039,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     matMul_args7.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7); // Input weight gradient: (3F x L)*(L x E) - > (3F x E)
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args7); // Input weight gradient: (3F x L)*(L x E) - > (3F x E)
     #else
     struct mm_manager_args_fp16 man_args7;
     man_args7.mm_args = &matMul_args7;
     man_args7.layer_type = LAYER_LINEAR;
     man_args7.step_type = STEP_FW;
     man_args7.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args7);
     #endif
 
     // Transpose input weight gradients
@@ -889,14 +1056,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     transp_args5.N = 3*F;
     transp_args5.M = E;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args5); 
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args5); 
 
     struct copy_args_fp16 copy_args4;
     copy_args4.from = temp;
     copy_args4.to = coeffDiffWin;
     copy_args4.size = E*3*F;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args4); // Transpose input weight gradient: (3F x E) - > (E x 3F)
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args4); // Transpose input weight gradient: (3F x E) - > (E x 3F)
 
 
 
@@ -914,14 +1081,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     matMul_args8.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8); // Input gradients: (E x 3F)*(3F x L) - > (E x L)
+    pulp_team_fork(NUM_CORES, mm_fp16, &matMul_args8); // Input gradients: (E x 3F)*(3F x L) - > (E x L)
     #else
     struct mm_manager_args_fp16 man_args8;
     man_args8.mm_args = &matMul_args8;
     man_args8.layer_type = LAYER_LINEAR;
     man_args8.step_type = STEP_FW;
     man_args8.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8);
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args8);
     #endif
 
     // Transpose input weight gradients
@@ -931,14 +1098,14 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
     transp_args6.N = E;
     transp_args6.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args6); 
+    pulp_team_fork(NUM_CORES, transpose_fp16, &transp_args6); 
 
     struct copy_args_fp16 copy_args5;
     copy_args5.from = temp;
     copy_args5.to = inDiff;
     copy_args5.size = L*E;
 
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &copy_args5); // Input gradients transpose: (E x L) - > (L x E)
+    pulp_team_fork(NUM_CORES, copy_fp16, &copy_args5); // Input gradients transpose: (E x L) - > (L x E)
 
 
 }
@@ -946,3 +1113,90 @@ void pulp_mhsa_fp16_bw_cl(void * Mhsa_args) {
 
 
 
+void mhsa_masked_softmax_fp16(void * mask_args){
+    struct mhsa_mask_args_fp16 *args = (struct mhsa_mask_args_fp16 *) mask_args;
+    int L = args->L;
+    int n_keys = args->n_keys;
+    fp16 scaling = args->scaling;
+
+    // Rows are interleaved among the cores, since their number of unmasked keys grows along the block under the causal mask
+    for (int t=pi_core_id(); t<args->n_rows; t+=NUM_CORES) {
+        int l = args->row0 + t;
+        fp16 *s = args->scores + t*n_keys;
+        fp16 *row = args->softmax + l*L;
+        int n = mhsa_key_limit(l, L, args->causal, args->valid_len);
+
+        for (int j=0; j<n; j++) s[j] *= scaling;
+
+        fp16 max = s[0];
+        for (int j=1; j<n; j++) if (s[j] > max) max = s[j];
+
+        fp16 sum = 0;
+        for (int j=0; j<n; j++) {
+            s[j] = fastexp_gist_fp16(s[j] - max);
+            sum += s[j];
+        }
+
+        // Probabilities are kept in the block for the product with V, and saved in the head's rows with zeros on the masked keys
+        fp16 inv_sum = 1 / sum;
+        for (int j=0; j<n; j++) {
+            s[j] *= inv_sum;
+            row[j] = s[j];
+        }
+        for (int j=n; j<n_keys; j++) s[j] = 0;
+        for (int j=n; j<L; j++) row[j] = 0;
+
+        args->maxes[l] = max;
+        args->sums[l] = sum;
+    }
+}
+
+void mhsa_masked_softmax_bw_fp16(void * mask_bw_args){
+    struct mhsa_mask_bw_args_fp16 *args = (struct mhsa_mask_bw_args_fp16 *) mask_bw_args;
+    int L = args->L;
+    int n_keys = args->n_keys;
+    fp16 scaling = args->scaling;
+
+    for (int t=pi_core_id(); t<args->n_rows; t+=NUM_CORES) {
+        int l = args->row0 + t;
+        fp16 *p = args->softmax + l*L;
+        fp16 *ds = args->grad_tile + t*n_keys;
+        fp16 *g = args->grad + l*L;
+        int n = mhsa_key_limit(l, L, args->causal, args->valid_len);
+
+        // ds_j = scaling * p_j * (dp_j - sum_z(dp_z * p_z)), zero on the masked keys
+        fp16 dot = 0;
+        for (int j=0; j<n; j++) dot += p[j] * ds[j];
+        for (int j=0; j<n; j++) {
+            ds[j] = scaling * p[j] * (ds[j] - dot);
+            g[j] = ds[j];
+        }
+        for (int j=n; j<n_keys; j++) ds[j] = 0;
+    }
+}
+
+
+void mhsa_masked_kv_bw_fp16(void * mask_bw_args){
+    struct mhsa_mask_bw_args_fp16 *args = (struct mhsa_mask_bw_args_fp16 *) mask_bw_args;
+    int L = args->L;
+    int H = args->H;
+    int n_valid = (args->valid_len > 0 && args->valid_len < L) ? args->valid_len : L;
+
+    // Keys are interleaved among the cores, since under the causal mask the j-th key is only seen by the queries from j on
+    for (int j=pi_core_id(); j<L; j+=NUM_CORES) {
+        int l0 = (j >= n_valid) ? L : (args->causal ? j : 0);
+
+        for (int h=0; h<H; h++) {
+            fp16 *q_row = args->q + h*L;
+            fp16 *do_row = args->att_diff + h*L;
+            fp16 dk = 0;
+            fp16 dv = 0;
+            for (int l=l0; l<L; l++) {
+                dk += q_row[l] * args->grad[l*L+j];
+                dv += do_row[l] * args->softmax[l*L+j];
+            }
+            args->k_diff[h*L+j] = dk;
+            args->v_diff[h*L+j] = dv;
+        }
+    }
+}
@@ -16,6 +16,14 @@
 #include <math.h>
 
 
+// Number of keys the l-th query attends to, given the causal and key-padding masks
+static inline int mhsa_key_limit(int l, int L, int causal, int valid_len){
+    int n_keys = (valid_len > 0 && valid_len < L) ? valid_len : L;
+    if (causal && l+1 < n_keys) n_keys = l+1;
+    return n_keys;
+}
+
+
 //FORWARD
 void pulp_mhsa_fp32_fw_cl(void* Mhsa_args){
     struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
@@ -76,14 +84,14 @@ void pulp_mhsa_fp32_fw_cl(void* Mhsa_args){
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args1);
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1);
     #else
     struct mm_manager_args man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args1);
     #endif
 
     #ifdef DEBUG
@@ -109,153 +117,202 @@ void pulp_mhsa_fp32_fw_cl(void* Mhsa_args){
 
 
 
-    //  Cycle on the different heads
-    for(int i = 0; i < n_heads; i++){
-        /*
-        //  Initialize the pointers to the correct starting positions for the i-th head
-        float* current_head_buffer = head_buffer + i*L*L;
-        float* current_softmax_buffer = softmax_buffer + i*L*L;
-        */
-
-        //  Transpose i-th head's K chunk
-        struct transp_args transp_args2;
-        transp_args2.matrix = k + L*i*H;
-        transp_args2.transp_matrix = temp;
-        transp_args2.N = H;
-        transp_args2.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args2);
+    if (mhsa_args->parallel_heads && n_heads >= NUM_CORES) {
+        //  Whole heads are assigned to the cores within a single fork, instead of splitting each small per-head matmul
+        struct mhsa_heads_args heads_args;
+        heads_args.mhsa_args = mhsa_args;
+        heads_args.L = L;
+        heads_args.H = H;
+        heads_args.F = F;
+        heads_args.scaling = scaling;
 
-        //  Multiply it with the i-th head's Q chunk
-        struct matMul_args matMul_args2;
-        matMul_args2.A = temp;
-        matMul_args2.B = q + L*i*H;
-        matMul_args2.C = softmax_buffer;
-        matMul_args2.N = L;
-        matMul_args2.K = H;
-        matMul_args2.M = L;
-        matMul_args2.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm, &matMul_args2);
-        #else
-        struct mm_manager_args man_args2;
-        man_args2.mm_args = &matMul_args2;
-        man_args2.layer_type = LAYER_LINEAR;
-        man_args2.step_type = STEP_FW;
-        man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args2);
-        #endif
-
-        //  Scale the current head values by a factor proportional to the head dimension
-        struct scalar_mul_args s_m_args;
-        s_m_args.input = softmax_buffer;
-        s_m_args.scalar = scaling;
-        s_m_args.dim = L*L;
-
-        pi_cl_team_fork(NUM_CORES,  pulp_scalar_mul_fp32_cl, &s_m_args);
-
-        #ifdef DEBUG
-        printf("\nCurrent head buffer Data: %d %d\n", L, L);
-        for (int j=0; j<L*L; j++){
-            if(!(j%(L))) printf("\n");
-            printf("%.8f ", softmax_buffer[j]);
+        pulp_team_fork(NUM_CORES, mhsa_heads_core_fw_fp32, &heads_args);
+    }
+    else {
+        //  Cycle on the different heads
+        for(int i = 0; i < n_heads; i++){
+            //  Each head's probabilities are kept for the backward, unless it recomputes them from the log-sum-exp
+            float* head_softmax = mhsa_args->recompute_softmax ? softmax_buffer : softmax_buffer + i*L*L;
+
+            //  Transpose i-th head's Q chunk (H x L -> L x H), so that the scores are obtained as Q * Kt with one row per query
+            struct transp_args transp_args2;
+            transp_args2.matrix = q + L*i*H;
+            transp_args2.transp_matrix = temp;
+            transp_args2.N = H;
+            transp_args2.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose, &transp_args2);
+
+            if (mhsa_args->causal || mhsa_args->valid_len > 0) {
+                //  Masked head, by blocks of MHSA_MASK_TILE queries: each block only multiplies the keys up to its last unmasked one.
+                //  K and V chunks are transposed (L x H), so that the unmasked keys of a block are the first rows of Kt and Vt
+                float *kt = temp + L*H;
+                float *vt = kt + L*H;
+                float *tile = vt + L*H;     //  Scores and probabilities of a block (MHSA_MASK_TILE x n_keys)
+
+                struct transp_args transp_args5;
+                transp_args5.matrix = k + L*i*H;
+                transp_args5.transp_matrix = kt;
+                transp_args5.N = H;
+                transp_args5.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args5);
+
+                struct transp_args transp_args6;
+                transp_args6.matrix = v + L*i*H;
+                transp_args6.transp_matrix = vt;
+                transp_args6.N = H;
+                transp_args6.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args6);
+
+                for (int r0 = 0; r0 < L; r0 += MHSA_MASK_TILE) {
+                    int n_rows = (r0 + MHSA_MASK_TILE > L) ? L - r0 : MHSA_MASK_TILE;
+                    int n_keys = mhsa_key_limit(r0 + n_rows - 1, L, mhsa_args->causal, mhsa_args->valid_len);
+
+                    //  Scores of the block against its unmasked keys: (n_rows x H) * (n_keys x H)t -> (n_rows x n_keys)
+                    struct matMul_args matMul_args5;
+                    matMul_args5.A = temp + r0*H;
+                    matMul_args5.B = kt;
+                    matMul_args5.C = tile;
+                    matMul_args5.N = n_rows;
+                    matMul_args5.K = H;
+                    matMul_args5.M = n_keys;
+                    matMul_args5.trans_B = 1;
+
+                    #ifndef OPTIMIZE
+                    pulp_team_fork(NUM_CORES,  mm, &matMul_args5);
+                    #else
+                    struct mm_manager_args man_args5;
+                    man_args5.mm_args = &matMul_args5;
+                    man_args5.layer_type = LAYER_LINEAR;
+                    man_args5.step_type = STEP_FW;
+                    man_args5.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                    pulp_team_fork(NUM_CORES, mm_manager, &man_args5);
+                    #endif
+
+                    //  Masked softmax of the block's rows, also saved in the head's L x L probabilities
+                    struct mhsa_mask_args mask_args;
+                    mask_args.scores = tile;
+                    mask_args.softmax = head_softmax;
+                    mask_args.maxes = maxes;
+                    mask_args.sums = sums;
+                    mask_args.lse = mhsa_args->lse != NULL ? mhsa_args->lse + i*L : NULL;
+                    mask_args.L = L;
+                    mask_args.row0 = r0;
+                    mask_args.n_rows = n_rows;
+                    mask_args.n_keys = n_keys;
+                    mask_args.scaling = scaling;
+                    mask_args.causal = mhsa_args->causal;
+                    mask_args.valid_len = mhsa_args->valid_len;
+
+                    pulp_team_fork(NUM_CORES, mhsa_masked_softmax_fp32, &mask_args);
+
+                    //  Product with the unmasked values: (n_rows x n_keys) * (n_keys x H) -> (n_rows x H), over the block's rows of Qt (no longer needed)
+                    struct matMul_args matMul_args6;
+                    matMul_args6.A = tile;
+                    matMul_args6.B = vt;
+                    matMul_args6.C = temp + r0*H;
+                    matMul_args6.N = n_rows;
+                    matMul_args6.K = n_keys;
+                    matMul_args6.M = H;
+                    matMul_args6.trans_B = 0;
+
+                    #ifndef OPTIMIZE
+                    pulp_team_fork(NUM_CORES,  mm, &matMul_args6);
+                    #else
+                    struct mm_manager_args man_args6;
+                    man_args6.mm_args = &matMul_args6;
+                    man_args6.layer_type = LAYER_LINEAR;
+                    man_args6.step_type = STEP_FW;
+                    man_args6.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                    pulp_team_fork(NUM_CORES, mm_manager, &man_args6);
+                    #endif
+                }
+
+                //  Transpose the head's attention map back (L x H -> H x L)
+                struct transp_args transp_args7;
+                transp_args7.matrix = temp;
+                transp_args7.transp_matrix = attention_map + L*i*H;
+                transp_args7.N = L;
+                transp_args7.M = H;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args7);
+            }
+            else {
+                //  Multiply it with the i-th head's K chunk
+                struct matMul_args matMul_args2;
+                matMul_args2.A = temp;
+                matMul_args2.B = k + L*i*H;
+                matMul_args2.C = head_softmax;
+                matMul_args2.N = L;
+                matMul_args2.K = H;
+                matMul_args2.M = L;
+                matMul_args2.trans_B = 0;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES,  mm, &matMul_args2);
+                #else
+                struct mm_manager_args man_args2;
+                man_args2.mm_args = &matMul_args2;
+                man_args2.layer_type = LAYER_LINEAR;
+                man_args2.step_type = STEP_FW;
+                man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager, &man_args2);
+                #endif
+
+                //  Scale the current head values by a factor proportional to the head dimension
+                struct scalar_mul_args s_m_args;
+                s_m_args.input = head_softmax;
+                s_m_args.scalar = scaling;
+                s_m_args.dim = L*L;
+
+                pulp_team_fork(NUM_CORES,  pulp_scalar_mul_fp32_cl, &s_m_args);
+
+                #ifdef DEBUG
+                printf("\nCurrent head buffer Data: %d %d\n", L, L);
+                for (int j=0; j<L*L; j++){
+                    if(!(j%(L))) printf("\n");
+                    printf("%.8f ", head_softmax[j]);
+                }
+                printf("\n");
+                #endif
+
+                //  Softmax algorithm, row-wise on the natively laid out scores (in place). The core that owns a row also saves
+                //  its log-sum-exp, so that the backward can recompute this head's softmax
+                struct online_softmax_args o_s_args;
+                o_s_args.input = head_softmax;
+                o_s_args.output = head_softmax;
+                o_s_args.maxes = maxes;
+                o_s_args.sums = sums;
+                o_s_args.lse = mhsa_args->lse != NULL ? mhsa_args->lse + i*L : NULL;
+                o_s_args.n_rows = L;
+                o_s_args.dim = L;
+
+                pulp_team_fork(NUM_CORES, pulp_online_softmax_fp32_cl, &o_s_args);
+
+                //  Multiply the i-th head's V chunk with the transposed softmax result (H x L), appending it to the attention map
+                struct matMul_args matMul_args3;
+                matMul_args3.A = v + L*i*H;
+                matMul_args3.B = head_softmax;
+                matMul_args3.C = attention_map + L*i*H;
+                matMul_args3.N = H;
+                matMul_args3.K = L;
+                matMul_args3.M = L;
+                matMul_args3.trans_B = 1;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES,  mm, &matMul_args3);
+                #else
+                struct mm_manager_args man_args3;
+                man_args3.mm_args = &matMul_args3;
+                man_args3.layer_type = LAYER_LINEAR;
+                man_args3.step_type = STEP_FW;
+                man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager, &man_args3);
+                #endif
+            }
         }
-        printf("\n");
-        #endif
-
-        //  Due to the fact that we multiplied K * Qt instead of Q * Kt like in the original MHSA model, the current
-        //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
-        //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
-        struct transp_args transp_args4;
-        transp_args4.matrix = softmax_buffer;
-        transp_args4.transp_matrix = temp;
-        transp_args4.N = L;
-        transp_args4.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args4);
-
-        /*
-        struct copy_args copy_args3;
-        copy_args3.from = temp;
-        copy_args3.to = current_head_buffer;
-        copy_args3.size = L*L;
-
-        pi_cl_team_fork(NUM_CORES, copy, &copy_args3);
-        */
-
-        //  Softmax algorithm
-        struct softmax_args softmax_arg;
-        struct blob input;
-        struct blob output;
-        input.data = temp;
-        input.dim = L;
-        output.data = softmax_buffer;
-        softmax_arg.input = &input;
-        softmax_arg.output = &output;
-        softmax_arg.maxes = maxes;
-        softmax_arg.sums = sums;
-
-        /*
-        ///------------------------------------------------------------------///
-        //printf("\nSoftmax stats\n");
-        pi_perf_conf((1<<PI_PERF_CYCLES)); 
-
-
-        pi_perf_stop();
-        pi_perf_reset(); 
-        pi_perf_start();
-        */
-
-        pulp_softmax_fp32_fw_cl(&softmax_arg);
-        //pulp_partial_softmax_simple_fp32_fw_cl(&softmax_arg);
-
-        /*
-        pi_perf_stop(); 
-        _cycles   += pi_perf_read (PI_PERF_CYCLES); 
-        id = pi_core_id(); 
-        ///----------------------------------------------------------------///
-        */
-
-        //  Each head result has to be appended to the full attention map, to do so we require to store the current
-        //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
-        struct transp_args transp_args5;
-        transp_args5.matrix = softmax_buffer;
-        transp_args5.transp_matrix = temp;
-        transp_args5.N = L;
-        transp_args5.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args5);
-
-        /*
-        struct copy_args copy_args4;
-        copy_args4.from = temp;
-        copy_args4.to = current_softmax_buffer;
-        copy_args4.size = L*L;
-
-        pi_cl_team_fork(NUM_CORES, copy, &copy_args4);
-        */
-
-        //  Multiply softmax result with the i-th head's Vt chunk
-        struct matMul_args matMul_args3;
-        matMul_args3.A = v + L*i*H;
-        matMul_args3.B = temp;
-        matMul_args3.C = attention_map + L*i*H;
-        matMul_args3.N = H;
-        matMul_args3.K = L;
-        matMul_args3.M = L;
-        matMul_args3.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm, &matMul_args3);
-        #else
-        struct mm_manager_args man_args3;
-        man_args3.mm_args = &matMul_args3;
-        man_args3.layer_type = LAYER_LINEAR;
-        man_args3.step_type = STEP_FW;
-        man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args3);
-        #endif
     }
 
     #ifdef DEBUG
@@ -290,14 +347,14 @@ void pulp_mhsa_fp32_fw_cl(void* Mhsa_args){
     matMul_args4.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args4);
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args4);
     #else
     struct mm_manager_args man_args4;
     man_args4.mm_args = &matMul_args4;
     man_args4.layer_type = LAYER_LINEAR;
     man_args4.step_type = STEP_FW;
     man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args4);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args4);
     #endif
 
     #ifdef DEBUG
@@ -372,14 +429,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args1);
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1);
     #else
     struct mm_manager_args man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args1);
     #endif
 
     #ifdef DEBUG
@@ -398,14 +455,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     transp_args1.N = L;
     transp_args1.M = 3*F;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+    pulp_team_fork(NUM_CORES, transpose, &transp_args1);
 
     struct copy_args copy_args1;
     copy_args1.from = temp;
     copy_args1.to = qkv;
     copy_args1.size = L*3*F;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args1);
+    pulp_team_fork(NUM_CORES, copy, &copy_args1);
 
     // Separate Q, K and V entry points in the QKV matrix
     q = qkv;
@@ -422,7 +479,7 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
         transp_args2.N = H;
         transp_args2.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args2);
+        pulp_team_fork(NUM_CORES, transpose, &transp_args2);
 
         // Multiply it with the i-th head's Q chunk
         struct matMul_args matMul_args2;
@@ -435,14 +492,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
         matMul_args2.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm, &matMul_args2);
+        pulp_team_fork(NUM_CORES,  mm, &matMul_args2);
         #else
         struct mm_manager_args man_args2;
         man_args2.mm_args = &matMul_args2;
         man_args2.layer_type = LAYER_LINEAR;
         man_args2.step_type = STEP_FW;
         man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args2);
+        pulp_team_fork(NUM_CORES, mm_manager, &man_args2);
         #endif
 
 
@@ -451,7 +508,7 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
         s_m_args.scalar = scaling;
         s_m_args.dim = L*L;
 
-        pi_cl_team_fork(NUM_CORES,  pulp_scalar_mul_fp32_cl, &s_m_args);
+        pulp_team_fork(NUM_CORES,  pulp_scalar_mul_fp32_cl, &s_m_args);
 
         #ifdef DEBUG
         printf("\nCurrent head buffer Data: %d %d\n", L, L);
@@ -470,7 +527,7 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     d_args.n = exp_max;
     d_args.dim = L*L*n_heads;
 
-    pi_cl_team_fork(NUM_CORES, pulp_div_fp32_cl, &d_args);
+    pulp_team_fork(NUM_CORES, pulp_div_fp32_cl, &d_args);
 
     #ifdef DEBUG
     printf("\nSoftmax inputs: %d %d %d\n", L, L, n_heads);
@@ -516,7 +573,7 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     pi_perf_start();
     */
 
-    pi_cl_team_fork(NUM_CORES, pulp_partial_softmax_fp32_fw_cl, &softmax_arg);
+    pulp_team_fork(NUM_CORES, pulp_partial_softmax_fp32_fw_cl, &softmax_arg);
 
     /*
     pi_perf_stop(); 
@@ -557,14 +614,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
         matMul_args3.trans_B = 0;
 
         #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm, &matMul_args3);
+        pulp_team_fork(NUM_CORES,  mm, &matMul_args3);
         #else
         struct mm_manager_args man_args3;
         man_args3.mm_args = &matMul_args3;
         man_args3.layer_type = LAYER_LINEAR;
         man_args3.step_type = STEP_FW;
         man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args3);
+        pulp_team_fork(NUM_CORES, mm_manager, &man_args3);
         #endif
     }
 
@@ -579,14 +636,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     matMul_args4.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args4);
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args4);
     #else
     struct mm_manager_args man_args4;
     man_args4.mm_args = &matMul_args4;
     man_args4.layer_type = LAYER_LINEAR;
     man_args4.step_type = STEP_FW;
     man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args4);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args4);
     #endif
 
     #ifdef DEBUG
@@ -605,14 +662,14 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
     transp_args3.N = E;
     transp_args3.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args3);
+    pulp_team_fork(NUM_CORES, transpose, &transp_args3);
 
     struct copy_args copy_args2;
     copy_args2.from = temp;
     copy_args2.to = outData;
     copy_args2.size = L*E;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args2);
+    pulp_team_fork(NUM_CORES, copy, &copy_args2);
     
     #ifdef DEBUG
     printf("\nOutput Data map Data: %d %d\n", E, L);
@@ -626,6 +683,339 @@ void pulp_mhsa_fp32_fw_cl_2(void* Mhsa_args){
 }
 
 
+//FORWARD WITH TILED (FLASH) ATTENTION
+void pulp_mhsa_flash_fp32_fw_cl(void* Mhsa_args){
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+    float *coeffDataWin = mhsa_args->coeff_in->data;            //  Input Projection Weights
+    float *coeffDataWout = mhsa_args->coeff_out->data;          //  Output Projection Weights (Already transposed from GM)
+    float *attention_map = mhsa_args->attention_map->data;      //  Buffer saving the MHSA map before output projection
+    float *outData = mhsa_args->output->data;                   //  Output sequence (Transposed, E x L)
+    float *inputData = mhsa_args->input->data;                  //  Input vector (Transposed, E x L)
+    float *temp = mhsa_args->temp_buffer;                       //  Per-core running statistics and score tile
+    float *lse = mhsa_args->lse;                                //  Row-wise log-sum-exp (n_heads x L), saved for backward
+    float *qkv = mhsa_args->qkv->data;                          //  Matrix containing the transposed Q, K and V (3*F x L)
+    int n_heads = mhsa_args->n_heads;                           //  Number of heads used for MHSA
+
+    int opt_matmul_type = mhsa_args->opt_matmul_type_fw;        //  Matmul type used
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length    
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    int H = F / n_heads;                                        //  Head dimension
+    float scaling = 1/sqrt(H);                                  //  Scaling factor to avoid vanishing gradients
+
+    // Projecting input sequence into Q, K, V
+    struct matMul_args matMul_args1;
+    matMul_args1.A = coeffDataWin;                              //  3F x E
+    matMul_args1.B = inputData;                                 //  E x L 
+    matMul_args1.C = qkv;                                       
+    matMul_args1.N = 3*F;                                       
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 0;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1);
+    #else
+    struct mm_manager_args man_args1;
+    man_args1.mm_args = &matMul_args1;
+    man_args1.layer_type = LAYER_LINEAR;
+    man_args1.step_type = STEP_FW;
+    man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args1);
+    #endif
+
+    //  All the heads are computed within a single fork, the scores are never materialized
+    struct mhsa_flash_args flash_args;
+    flash_args.q = qkv;
+    flash_args.k = qkv + L*F;
+    flash_args.v = qkv + L*2*F;
+    flash_args.attention_map = attention_map;
+    flash_args.lse = lse;
+    flash_args.scratch = temp;
+    flash_args.L = L;
+    flash_args.H = H;
+    flash_args.n_heads = n_heads;
+    flash_args.scaling = scaling;
+    flash_args.causal = mhsa_args->causal;
+    flash_args.valid_len = mhsa_args->valid_len;
+
+    pulp_team_fork(NUM_CORES, mhsa_flash_core_fw_fp32, &flash_args);
+
+    #ifdef DEBUG
+    printf("\nAttention map Data: %d %d\n", F, L);
+    for (int j=0; j<L*F; j++){
+        if(!(j%(L))) printf("\n");
+        printf("%.8f ", attention_map[j]);
+    }
+    printf("\n");
+    #endif
+
+    //  Final attention map projection
+    struct matMul_args matMul_args2;
+    matMul_args2.A = coeffDataWout;
+    matMul_args2.B = attention_map;
+    matMul_args2.C = outData;
+    matMul_args2.N = E;
+    matMul_args2.K = F;
+    matMul_args2.M = L;
+    matMul_args2.trans_B = 0;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args2);
+    #else
+    struct mm_manager_args man_args2;
+    man_args2.mm_args = &matMul_args2;
+    man_args2.layer_type = LAYER_LINEAR;
+    man_args2.step_type = STEP_FW;
+    man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args2);
+    #endif
+}
+
+
+void mhsa_flash_core_fw_fp32(void * flash_args){
+    struct mhsa_flash_args *args = (struct mhsa_flash_args *) flash_args;
+    int L = args->L;
+    int H = args->H;
+    float scaling = args->scaling;
+
+    // Per-core scratch: output accumulator (H) and score tile (MHSA_FLASH_TILE)
+    float *acc = args->scratch + pi_core_id()*(H + MHSA_FLASH_TILE);
+    float *s = acc + H;
+
+    // Parallelize over the n_heads*L (head, query) rows
+    int rows = args->n_heads * L;
+    int blockSize = (rows+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > rows ? rows : start+blockSize;
+
+    for (int r=start; r<stop; r++) {
+        int head = r / L;
+        int l = r % L;
+        float *q = args->q + head*H*L + l;
+        float *k = args->k + head*H*L;
+        float *v = args->v + head*H*L;
+        float *out = args->attention_map + head*H*L + l;
+
+        // Key tiles beyond the causal/padding limit are fully masked and skipped
+        int n_keys = mhsa_key_limit(l, L, args->causal, args->valid_len);
+
+        float max = -340282346638528859811704183484516925440.0f;
+        float sum = 0.0f;
+        for (int h=0; h<H; h++) acc[h] = 0.0f;
+
+        for (int j0=0; j0<n_keys; j0+=MHSA_FLASH_TILE) {
+            int tile = n_keys-j0 < MHSA_FLASH_TILE ? n_keys-j0 : MHSA_FLASH_TILE;
+
+            // Scores of the current query against the key tile
+            for (int j=0; j<tile; j++) s[j] = 0.0f;
+            for (int h=0; h<H; h++) {
+                float qh = q[h*L] * scaling;
+                float *k_row = k + h*L + j0;
+                for (int j=0; j<tile; j++) s[j] += qh * k_row[j];
+            }
+
+            // Update the running max, rescaling sum and accumulator only when it grows
+            float tile_max = s[0];
+            for (int j=1; j<tile; j++) if (s[j] > tile_max) tile_max = s[j];
+            if (tile_max > max) {
+                float rescale = expf(max - tile_max);
+                sum *= rescale;
+                for (int h=0; h<H; h++) acc[h] *= rescale;
+                max = tile_max;
+            }
+
+            for (int j=0; j<tile; j++) {
+                s[j] = fastexp_gist(s[j] - max);
+                sum += s[j];
+            }
+
+            for (int h=0; h<H; h++) {
+                float *v_row = v + h*L + j0;
+                float a = 0.0f;
+                for (int j=0; j<tile; j++) a += s[j] * v_row[j];
+                acc[h] += a;
+            }
+        }
+
+        float inv_sum = 1.0f / sum;
+        for (int h=0; h<H; h++) out[h*L] = acc[h] * inv_sum;
+        if (args->lse != NULL) args->lse[r] = max + logf(sum);
+    }
+}
+
+
+//INCREMENTAL DECODE WITH KV-CACHE
+void pulp_mhsa_fp32_decode_cl(void* Mhsa_decode_args){
+    struct Mhsa_decode_args *dec_args = (struct Mhsa_decode_args *) Mhsa_decode_args;
+    float *coeffDataWin = dec_args->coeff_in->data;             //  Input Projection Weights (3F x E)
+    float *coeffDataWout = dec_args->coeff_out->data;           //  Output Projection Weights (E x F)
+    float *inputData = dec_args->input->data;                   //  New token (E)
+    float *outData = dec_args->output->data;                    //  Output for the new token (E)
+    float *qkv = dec_args->qkv;                                 //  Query, Key and Value of the new token (3F)
+    float *attention_map = dec_args->attention_map;             //  Attention output of the new token (F)
+    int opt_matmul_type = dec_args->opt_matmul_type_fw;         //  Matmul type used
+
+    int E = dec_args->input->dim;                               //  Input Sequence element size
+    int F = dec_args->coeff_out->W;                             //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    //  No room left in the caches
+    if (dec_args->cur_len >= dec_args->max_len) return;
+
+    //  Projecting the new token into q, k, v
+    struct matMul_args matMul_args1;
+    matMul_args1.A = coeffDataWin;
+    matMul_args1.B = inputData;
+    matMul_args1.C = qkv;
+    matMul_args1.N = 3*F;
+    matMul_args1.K = E;
+    matMul_args1.M = 1;
+    matMul_args1.trans_B = 0;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1);
+    #else
+    struct mm_manager_args man_args1;
+    man_args1.mm_args = &matMul_args1;
+    man_args1.layer_type = LAYER_LINEAR;
+    man_args1.step_type = STEP_FW;
+    man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args1);
+    #endif
+
+    //  Append k, v to the caches and attend to all the cached tokens
+    pulp_team_fork(NUM_CORES, mhsa_decode_core_fp32, dec_args);
+
+    //  Output projection of the new token
+    struct matMul_args matMul_args2;
+    matMul_args2.A = coeffDataWout;
+    matMul_args2.B = attention_map;
+    matMul_args2.C = outData;
+    matMul_args2.N = E;
+    matMul_args2.K = F;
+    matMul_args2.M = 1;
+    matMul_args2.trans_B = 0;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args2);
+    #else
+    struct mm_manager_args man_args2;
+    man_args2.mm_args = &matMul_args2;
+    man_args2.layer_type = LAYER_LINEAR;
+    man_args2.step_type = STEP_FW;
+    man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args2);
+    #endif
+
+    //  Inside pulp_team_run, a single core updates the cache length, visible to the others after the barrier
+    if (!pulp_team_active || pi_core_id() == 0) dec_args->cur_len++;
+    if (pulp_team_active) pi_cl_team_barrier();
+}
+
+
+void pulp_mhsa_fp32_prefill_cl(void* Mhsa_prefill_args){
+    struct mhsa_prefill_args *args = (struct mhsa_prefill_args *) Mhsa_prefill_args;
+    struct Mhsa_decode_args *dec_args = args->dec_args;
+    int L = args->mhsa_args->input->H;
+
+    int n_tokens = args->n_tokens;
+    if (n_tokens > L) n_tokens = L;
+    if (n_tokens > dec_args->max_len) n_tokens = dec_args->max_len;
+    if (!pulp_team_active || pi_core_id() == 0) args->n_tokens = n_tokens;
+
+    pulp_team_fork(NUM_CORES, mhsa_prefill_core_fp32, args);
+
+    if (!pulp_team_active || pi_core_id() == 0) dec_args->cur_len = args->n_tokens;
+    if (pulp_team_active) pi_cl_team_barrier();
+}
+
+
+void mhsa_prefill_core_fp32(void * Mhsa_prefill_args){
+    struct mhsa_prefill_args *args = (struct mhsa_prefill_args *) Mhsa_prefill_args;
+    struct Mhsa_args *mhsa_args = args->mhsa_args;
+    int L = mhsa_args->input->H;
+    int F = mhsa_args->attention_map->W;
+    int max_len = args->dec_args->max_len;
+    int n_tokens = args->n_tokens;
+
+    float *k = mhsa_args->qkv->data + L*F;
+    float *v = mhsa_args->qkv->data + 2*L*F;
+
+    // Parallelize over the F rows of K and V
+    int blockSize = (F+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > F ? F : start+blockSize;
+
+    for (int r=start; r<stop; r++) {
+        float *k_cache = args->dec_args->k_cache + r*max_len;
+        float *v_cache = args->dec_args->v_cache + r*max_len;
+        for (int j=0; j<n_tokens; j++) {
+            k_cache[j] = k[r*L + j];
+            v_cache[j] = v[r*L + j];
+        }
+    }
+}
+
+
+void mhsa_decode_core_fp32(void * Mhsa_decode_args){
+    struct Mhsa_decode_args *args = (struct Mhsa_decode_args *) Mhsa_decode_args;
+    int n_heads = args->n_heads;
+    int F = args->coeff_out->W;
+    int H = F / n_heads;
+    int max_len = args->max_len;
+    int pos = args->cur_len;                                    //  Column of the new token in the caches
+    int n_keys = pos + 1;
+    float scaling = 1/sqrt(H);
+
+    float *q = args->qkv;
+    float *k_new = args->qkv + F;
+    float *v_new = args->qkv + 2*F;
+    float *s = args->temp_buffer + pi_core_id()*max_len;        //  Per-core scores
+
+    // Parallelize over the heads, each core only touches the cache rows of its heads
+    int blockSize = (n_heads+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > n_heads ? n_heads : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+        float *k = args->k_cache + i*H*max_len;
+        float *v = args->v_cache + i*H*max_len;
+
+        for (int h=0; h<H; h++) {
+            k[h*max_len + pos] = k_new[i*H + h];
+            v[h*max_len + pos] = v_new[i*H + h];
+        }
+
+        // Scores of the new query against the cached keys
+        for (int j=0; j<n_keys; j++) s[j] = 0.0f;
+        for (int h=0; h<H; h++) {
+            float qh = q[i*H + h] * scaling;
+            float *k_row = k + h*max_len;
+            for (int j=0; j<n_keys; j++) s[j] += qh * k_row[j];
+        }
+
+        float max = s[0];
+        for (int j=1; j<n_keys; j++) if (s[j] > max) max = s[j];
+
+        float sum = 0.0f;
+        for (int j=0; j<n_keys; j++) {
+            s[j] = fastexp_gist(s[j] - max);
+            sum += s[j];
+        }
+        float inv_sum = 1.0f / sum;
+
+        for (int h=0; h<H; h++) {
+            float *v_row = v + h*max_len;
+            float a = 0.0f;
+            for (int j=0; j<n_keys; j++) a += s[j] * v_row[j];
+            args->attention_map[i*H + h] = a * inv_sum;
+        }
+    }
+}
+
+
 //BACKWARD
 void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
@@ -650,6 +1040,8 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     int n_heads = mhsa_args->n_heads; // Number of heads of the mhsa
     int H = F / n_heads;
     int opt_matmul_type = mhsa_args->opt_matmul_type_wg;
+    int recompute = mhsa_args->recompute_softmax; // Recompute each head's softmax from lse, softmax_buffer holds a single head
+    float scaling = 1/sqrt(H);
 
     float *q = mhsa_args->qkv->data; // 3F x L
     float *k = mhsa_args->qkv->data + F*L;
@@ -699,14 +1091,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     matMul_args1.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args1); // Gradient of attention map: (L x E)*(E x F) - > (L x F)
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1); // Gradient of attention map: (L x E)*(E x F) - > (L x F)
     #else
     struct mm_manager_args man_args1;
     man_args1.mm_args = &matMul_args1;
     man_args1.layer_type = LAYER_LINEAR;
     man_args1.step_type = STEP_FW;
     man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args1);
     #endif
 
     //Transpose map gradients (copy required because transpose can't be done inplace)
@@ -716,14 +1108,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     transp_args1.N = L;
     transp_args1.M = F;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+    pulp_team_fork(NUM_CORES, transpose, &transp_args1);
 
     struct copy_args copy_args1;
     copy_args1.from = temp;
     copy_args1.to = attention_map_diff;
     copy_args1.size = F*L;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args1); // Transposed gradient of attention map: (L x F) - > (F x L)
+    pulp_team_fork(NUM_CORES, copy, &copy_args1); // Transposed gradient of attention map: (L x F) - > (F x L)
 
     // Output Projection Weights
 
@@ -756,14 +1148,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     #endif
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args2); // Output weight gradient: (F x L)*(L x E) - > (F x E)
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args2); // Output weight gradient: (F x L)*(L x E) - > (F x E)
     #else
     struct mm_manager_args man_args2;
     man_args2.mm_args = &matMul_args2;
     man_args2.layer_type = LAYER_LINEAR;
     man_args2.step_type = STEP_FW;
     man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args2);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args2);
     #endif
 
 
@@ -774,14 +1166,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     transp_args9.N = F;
     transp_args9.M = E;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args9);
+    pulp_team_fork(NUM_CORES, transpose, &transp_args9);
 
     struct copy_args copy_args9;
     copy_args9.from = temp;
     copy_args9.to = coeffDiffWout;
     copy_args9.size = E*F;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args9); // Transposed output weight gradient: (F x E) - > (E x F)
+    pulp_team_fork(NUM_CORES, copy, &copy_args9); // Transposed output weight gradient: (F x E) - > (E x F)
 
 
     #ifdef DEBUG
@@ -793,146 +1185,346 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     printf("\n");
     #endif
 
-    // Cycle on the heads
-    for(int i=0; i<n_heads; i++){
-        // I-th head Value Gradient
-
-        // matmul setup 3
-        struct matMul_args matMul_args3;
-        matMul_args3.A = attention_map_diff + i*L*H; 
-        matMul_args3.B = softmax_buffer + i*L*L; 
-        matMul_args3.C = v_diff + i*L*H;
-        matMul_args3.N = H;
-        matMul_args3.K = L;
-        matMul_args3.M = L;
-        matMul_args3.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm, &matMul_args3); // i-th head Value gradient: (H x L)*(L x L) - > (H x L)
-        #else
-        struct mm_manager_args man_args3;
-        man_args3.mm_args = &matMul_args3;
-        man_args3.layer_type = LAYER_LINEAR;
-        man_args3.step_type = STEP_FW;
-        man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args3);
-        #endif
-
-
-        // I-th head Buffer Gradient
-
-        // Transpose output gradients
-        struct transp_args transp_args3;
-        transp_args3.matrix = attention_map_diff + i*L*H;
-        transp_args3.transp_matrix = temp;
-        transp_args3.N = H;
-        transp_args3.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args3); // Transpose i-th head attention map gradient: (H x L) - > (L x H) 
-
-
-        // matmul setup 4
-        struct matMul_args matMul_args4;
-        matMul_args4.A = temp; 
-        matMul_args4.B = v + i*L*H; 
-        matMul_args4.C = head_buffer_diff + i*L*L;
-        matMul_args4.N = L;
-        matMul_args4.K = H;
-        matMul_args4.M = L;
-        matMul_args4.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm, &matMul_args4); // i-th head Buffer gradient: (L x H)*(H x L) - > (L x L)
-        #else
-        struct mm_manager_args man_args4;
-        man_args4.mm_args = &matMul_args4;
-        man_args4.layer_type = LAYER_LINEAR;
-        man_args4.step_type = STEP_FW;
-        man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args4);
-        #endif
-
-
-        struct act_args softmax_arg;
-        struct blob input;
-        struct blob output;
-        input.diff = grad;
-        input.dim = L*L;
-        output.data = softmax_buffer + i*L*L;
-        output.diff = head_buffer_diff + i*L*L;
-        output.dim = i;
-        softmax_arg.input = &input;
-        softmax_arg.output = &output;
-        // Back propagation of i-th head Buffer gradient through the softmax operation
-
-        
-        pi_cl_team_fork(1, pulp_softmax_fp32_bw_cl, &softmax_arg);
-
-
-
-
-        // I-th head Query Gradient
-        
-        // Transpose softmax gradients
-        struct transp_args transp_args4;
-        transp_args4.matrix = grad;
-        transp_args4.transp_matrix = temp;
-        transp_args4.N = L;
-        transp_args4.M = L;
-
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args4); 
-
-        struct copy_args copy_args3;
-        copy_args3.from = temp;
-        copy_args3.to = grad;
-        copy_args3.size = L*L;
-
-        pi_cl_team_fork(NUM_CORES, copy, &copy_args3); // Still (L x L). Unsure if it is needed.
-
-        // matmul setup 5
-        struct matMul_args matMul_args5;
-        matMul_args5.A = k + i*L*H; 
-        matMul_args5.B = grad; 
-        matMul_args5.C = q_diff + i*L*H;
-        matMul_args5.N = H;
-        matMul_args5.K = L;
-        matMul_args5.M = L;
-        matMul_args5.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm, &matMul_args5); // i-th head Query gradient: (H x L)*(L x L) - > (H x L)
-        #else
-        struct mm_manager_args man_args5;
-        man_args5.mm_args = &matMul_args5;
-        man_args5.layer_type = LAYER_LINEAR;
-        man_args5.step_type = STEP_FW;
-        man_args5.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args5);
-        #endif
-
-
-        // I-th head Key Gradients
+    if (mhsa_args->parallel_heads && n_heads >= NUM_CORES) {
+        // Whole heads are assigned to the cores within a single fork, streaming over the query rows
+        struct mhsa_heads_args heads_args;
+        heads_args.mhsa_args = mhsa_args;
+        heads_args.L = L;
+        heads_args.H = H;
+        heads_args.F = F;
+        heads_args.scaling = scaling;
 
-        // matmul setup 6
-        struct matMul_args matMul_args6;
-        matMul_args6.A = q + i*L*H; 
-        matMul_args6.B = grad; 
-        matMul_args6.C = k_diff + i*L*H;
-        matMul_args6.N = H;
-        matMul_args6.K = L;
-        matMul_args6.M = L;
-        matMul_args6.trans_B = 0;
-
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES, mm, &matMul_args6); // i-th head Key gradient: (H x L)*(L x L) - > (H x L)
-        #else
-        struct mm_manager_args man_args6;
-        man_args6.mm_args = &matMul_args6;
-        man_args6.layer_type = LAYER_LINEAR;
-        man_args6.step_type = STEP_FW;
-        man_args6.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args6);
-        #endif
+        pulp_team_fork(NUM_CORES, mhsa_heads_core_bw_fp32, &heads_args);
+    }
+    else {
+        // Cycle on the heads
+        for(int i=0; i<n_heads; i++){
+            float *head_softmax = softmax_buffer + i*L*L;
+
+            if (mhsa_args->causal || mhsa_args->valid_len > 0) {
+                // Masked head, by blocks of MHSA_MASK_TILE queries: the GEMMs of each block stop at its last unmasked key,
+                // then the key and value gradients only visit the queries attending to each key
+                if (recompute) head_softmax = softmax_buffer;
+
+                float *qt = temp;                               // Transposed Q chunk (L x H), overwritten block by block with the transposed Q gradient
+                float *kt = qt + L*H;
+                float *vt = kt + L*H;
+                float *dot = vt + L*H;                          // Transposed attention map gradient of the head (L x H)
+                float *s_tile = dot + L*H;                      // Recomputed scores of a block (MHSA_MASK_TILE x n_keys)
+                float *ds_tile = s_tile + MHSA_MASK_TILE*L;     // Probability gradient of a block, turned into its score gradient
+
+                struct transp_args transp_args11;
+                transp_args11.matrix = q + i*L*H;
+                transp_args11.transp_matrix = qt;
+                transp_args11.N = H;
+                transp_args11.M = L;
+
+                if (recompute) pulp_team_fork(NUM_CORES, transpose, &transp_args11);
+
+                struct transp_args transp_args12;
+                transp_args12.matrix = k + i*L*H;
+                transp_args12.transp_matrix = kt;
+                transp_args12.N = H;
+                transp_args12.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args12);
+
+                struct transp_args transp_args13;
+                transp_args13.matrix = v + i*L*H;
+                transp_args13.transp_matrix = vt;
+                transp_args13.N = H;
+                transp_args13.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args13);
+
+                struct transp_args transp_args14;
+                transp_args14.matrix = attention_map_diff + i*L*H;
+                transp_args14.transp_matrix = dot;
+                transp_args14.N = H;
+                transp_args14.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args14);
+
+                struct mhsa_mask_bw_args mask_bw_args;
+                mask_bw_args.scores = recompute ? s_tile : NULL;
+                mask_bw_args.grad_tile = ds_tile;
+                mask_bw_args.softmax = head_softmax;
+                mask_bw_args.grad = grad;
+                mask_bw_args.lse = mhsa_args->lse + i*L;
+                mask_bw_args.q = q + i*L*H;
+                mask_bw_args.att_diff = attention_map_diff + i*L*H;
+                mask_bw_args.k_diff = k_diff + i*L*H;
+                mask_bw_args.v_diff = v_diff + i*L*H;
+                mask_bw_args.L = L;
+                mask_bw_args.H = H;
+                mask_bw_args.scaling = scaling;
+                mask_bw_args.causal = mhsa_args->causal;
+                mask_bw_args.valid_len = mhsa_args->valid_len;
+
+                for (int r0 = 0; r0 < L; r0 += MHSA_MASK_TILE) {
+                    int n_rows = (r0 + MHSA_MASK_TILE > L) ? L - r0 : MHSA_MASK_TILE;
+                    int n_keys = mhsa_key_limit(r0 + n_rows - 1, L, mhsa_args->causal, mhsa_args->valid_len);
+
+                    // Recomputed scores of the block: (n_rows x H) * (n_keys x H)t -> (n_rows x n_keys)
+                    struct matMul_args matMul_args11;
+                    matMul_args11.A = qt + r0*H;
+                    matMul_args11.B = kt;
+                    matMul_args11.C = s_tile;
+                    matMul_args11.N = n_rows;
+                    matMul_args11.K = H;
+                    matMul_args11.M = n_keys;
+                    matMul_args11.trans_B = 1;
+
+                    if (recompute) {
+                        #ifndef OPTIMIZE
+                        pulp_team_fork(NUM_CORES, mm, &matMul_args11);
+                        #else
+                        struct mm_manager_args man_args11;
+                        man_args11.mm_args = &matMul_args11;
+                        man_args11.layer_type = LAYER_LINEAR;
+                        man_args11.step_type = STEP_FW;
+                        man_args11.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                        pulp_team_fork(NUM_CORES, mm_manager, &man_args11);
+                        #endif
+                    }
+
+                    // Probability gradient of the block: (n_rows x H) * (n_keys x H)t -> (n_rows x n_keys)
+                    struct matMul_args matMul_args12;
+                    matMul_args12.A = dot + r0*H;
+                    matMul_args12.B = vt;
+                    matMul_args12.C = ds_tile;
+                    matMul_args12.N = n_rows;
+                    matMul_args12.K = H;
+                    matMul_args12.M = n_keys;
+                    matMul_args12.trans_B = 1;
+
+                    #ifndef OPTIMIZE
+                    pulp_team_fork(NUM_CORES, mm, &matMul_args12);
+                    #else
+                    struct mm_manager_args man_args12;
+                    man_args12.mm_args = &matMul_args12;
+                    man_args12.layer_type = LAYER_LINEAR;
+                    man_args12.step_type = STEP_FW;
+                    man_args12.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                    pulp_team_fork(NUM_CORES, mm_manager, &man_args12);
+                    #endif
+
+                    // Back propagation through the masked softmax, rows interleaved among the cores
+                    mask_bw_args.row0 = r0;
+                    mask_bw_args.n_rows = n_rows;
+                    mask_bw_args.n_keys = n_keys;
+
+                    pulp_team_fork(NUM_CORES, mhsa_masked_softmax_bw_fp32, &mask_bw_args);
+
+                    // Transposed Q gradient of the block: (n_rows x n_keys) * (n_keys x H) -> (n_rows x H)
+                    struct matMul_args matMul_args13;
+                    matMul_args13.A = ds_tile;
+                    matMul_args13.B = kt;
+                    matMul_args13.C = qt + r0*H;
+                    matMul_args13.N = n_rows;
+                    matMul_args13.K = n_keys;
+                    matMul_args13.M = H;
+                    matMul_args13.trans_B = 0;
+
+                    #ifndef OPTIMIZE
+                    pulp_team_fork(NUM_CORES, mm, &matMul_args13);
+                    #else
+                    struct mm_manager_args man_args13;
+                    man_args13.mm_args = &matMul_args13;
+                    man_args13.layer_type = LAYER_LINEAR;
+                    man_args13.step_type = STEP_FW;
+                    man_args13.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                    pulp_team_fork(NUM_CORES, mm_manager, &man_args13);
+                    #endif
+                }
+
+                struct transp_args transp_args15;
+                transp_args15.matrix = qt;
+                transp_args15.transp_matrix = q_diff + i*L*H;
+                transp_args15.N = L;
+                transp_args15.M = H;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args15); // i-th head Query gradient: (L x H) - > (H x L)
+
+                // i-th head Key and Value gradients, keys interleaved among the cores
+                pulp_team_fork(NUM_CORES, mhsa_masked_kv_bw_fp32, &mask_bw_args);
+                continue;
+            }
+
+            if (recompute) {
+                // Recompute the i-th head's softmax: Q * Kt, as in the forward, then exp(scaling*s - lse) row-wise
+                head_softmax = softmax_buffer;
+
+                struct transp_args transp_args10;
+                transp_args10.matrix = q + i*L*H;
+                transp_args10.transp_matrix = temp;
+                transp_args10.N = H;
+                transp_args10.M = L;
+
+                pulp_team_fork(NUM_CORES, transpose, &transp_args10); // Transpose i-th head Query: (H x L) - > (L x H)
+
+                struct matMul_args matMul_args10;
+                matMul_args10.A = temp;
+                matMul_args10.B = k + i*L*H;
+                matMul_args10.C = head_softmax;
+                matMul_args10.N = L;
+                matMul_args10.K = H;
+                matMul_args10.M = L;
+                matMul_args10.trans_B = 0;
+
+                #ifndef OPTIMIZE
+                pulp_team_fork(NUM_CORES, mm, &matMul_args10); // i-th head scores: (L x H)*(H x L) - > (L x L)
+                #else
+                struct mm_manager_args man_args10;
+                man_args10.mm_args = &matMul_args10;
+                man_args10.layer_type = LAYER_LINEAR;
+                man_args10.step_type = STEP_FW;
+                man_args10.matmul_type = opt_matmul_type; //MATMUL_TYPE
+                pulp_team_fork(NUM_CORES, mm_manager, &man_args10);
+                #endif
+
+                struct mhsa_recompute_args recompute_args;
+                recompute_args.scores = head_softmax;
+                recompute_args.lse = mhsa_args->lse + i*L;
+                recompute_args.L = L;
+                recompute_args.scaling = scaling;
+                recompute_args.causal = mhsa_args->causal;
+                recompute_args.valid_len = mhsa_args->valid_len;
+
+                pulp_team_fork(NUM_CORES, mhsa_softmax_recompute_fp32, &recompute_args);
+            }
+
+            // I-th head Value Gradient
+
+            // matmul setup 3
+            struct matMul_args matMul_args3;
+            matMul_args3.A = attention_map_diff + i*L*H; 
+            matMul_args3.B = head_softmax; 
+            matMul_args3.C = v_diff + i*L*H;
+            matMul_args3.N = H;
+            matMul_args3.K = L;
+            matMul_args3.M = L;
+            matMul_args3.trans_B = 0;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES,  mm, &matMul_args3); // i-th head Value gradient: (H x L)*(L x L) - > (H x L)
+            #else
+            struct mm_manager_args man_args3;
+            man_args3.mm_args = &matMul_args3;
+            man_args3.layer_type = LAYER_LINEAR;
+            man_args3.step_type = STEP_FW;
+            man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager, &man_args3);
+            #endif
+
+
+            // I-th head Buffer Gradient
+
+            // Transpose output gradients
+            struct transp_args transp_args3;
+            transp_args3.matrix = attention_map_diff + i*L*H;
+            transp_args3.transp_matrix = temp;
+            transp_args3.N = H;
+            transp_args3.M = L;
+
+            pulp_team_fork(NUM_CORES, transpose, &transp_args3); // Transpose i-th head attention map gradient: (H x L) - > (L x H) 
+
+
+            // matmul setup 4
+            struct matMul_args matMul_args4;
+            matMul_args4.A = temp; 
+            matMul_args4.B = v + i*L*H; 
+            matMul_args4.C = head_buffer_diff; // Single L x L slot, reused by every head
+            matMul_args4.N = L;
+            matMul_args4.K = H;
+            matMul_args4.M = L;
+            matMul_args4.trans_B = 0;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES, mm, &matMul_args4); // i-th head Buffer gradient: (L x H)*(H x L) - > (L x L)
+            #else
+            struct mm_manager_args man_args4;
+            man_args4.mm_args = &matMul_args4;
+            man_args4.layer_type = LAYER_LINEAR;
+            man_args4.step_type = STEP_FW;
+            man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager, &man_args4);
+            #endif
+
+
+            struct softmax_bw_args softmax_arg;
+            struct blob input;
+            struct blob output;
+            input.diff = grad;
+            input.dim = L*L;
+            output.data = head_softmax;
+            output.diff = head_buffer_diff;
+            output.dim = L*L;
+            softmax_arg.input = &input;
+            softmax_arg.output = &output;
+            softmax_arg.n_rows = L;
+            softmax_arg.dim = L;
+            // Back propagation of i-th head Buffer gradient through the softmax operation (row-wise, parallel on the rows)
+            pulp_row_softmax_fp32_bw_cl(&softmax_arg);
+
+
+
+
+            // Scores were scaled in the forward
+            struct scalar_mul_args s_m_args;
+            s_m_args.input = grad;
+            s_m_args.scalar = scaling;
+            s_m_args.dim = L*L;
+
+            pulp_team_fork(NUM_CORES,  pulp_scalar_mul_fp32_cl, &s_m_args);
+
+            // I-th head Query Gradient (grad has one row per query, read transposed)
+
+            // matmul setup 5
+            struct matMul_args matMul_args5;
+            matMul_args5.A = k + i*L*H; 
+            matMul_args5.B = grad; 
+            matMul_args5.C = q_diff + i*L*H;
+            matMul_args5.N = H;
+            matMul_args5.K = L;
+            matMul_args5.M = L;
+            matMul_args5.trans_B = 1;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES, mm, &matMul_args5); // i-th head Query gradient: (H x L)*(L x L)t - > (H x L)
+            #else
+            struct mm_manager_args man_args5;
+            man_args5.mm_args = &matMul_args5;
+            man_args5.layer_type = LAYER_LINEAR;
+            man_args5.step_type = STEP_FW;
+            man_args5.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager, &man_args5);
+            #endif
+
+
+            // I-th head Key Gradients
+
+            // matmul setup 6
+            struct matMul_args matMul_args6;
+            matMul_args6.A = q + i*L*H; 
+            matMul_args6.B = grad; 
+            matMul_args6.C = k_diff + i*L*H;
+            matMul_args6.N = H;
+            matMul_args6.K = L;
+            matMul_args6.M = L;
+            matMul_args6.trans_B = 0;
+
+            #ifndef OPTIMIZE
+            pulp_team_fork(NUM_CORES, mm, &matMul_args6); // i-th head Key gradient: (H x L)*(L x L) - > (H x L)
+            #else
+            struct mm_manager_args man_args6;
+            man_args6.mm_args = &matMul_args6;
+            man_args6.layer_type = LAYER_LINEAR;
+            man_args6.step_type = STEP_FW;
+            man_args6.matmul_type = opt_matmul_type; //MATMUL_TYPE
+            pulp_team_fork(NUM_CORES, mm_manager, &man_args6);
+            #endif
+        }
     }
 
     // Input projection Gradients
@@ -948,14 +1540,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     matMul_args7.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args7); // Input weight gradient: (3F x L)*(L x E) - > (3F x E)
+    pulp_team_fork(NUM_CORES, mm, &matMul_args7); // Input weight gradient: (3F x L)*(L x E) - > (3F x E)
     #else
     struct mm_manager_args man_args7;
     man_args7.mm_args = &matMul_args7;
     man_args7.layer_type = LAYER_LINEAR;
     man_args7.step_type = STEP_FW;
     man_args7.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args7);
     #endif
 
     // Transpose input weight gradients
@@ -965,14 +1557,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     transp_args5.N = 3*F;
     transp_args5.M = E;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args5); 
+    pulp_team_fork(NUM_CORES, transpose, &transp_args5); 
 
     struct copy_args copy_args4;
     copy_args4.from = temp;
     copy_args4.to = coeffDiffWin;
     copy_args4.size = E*3*F;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args4); // Transpose input weight gradient: (3F x E) - > (E x 3F)
+    pulp_team_fork(NUM_CORES, copy, &copy_args4); // Transpose input weight gradient: (3F x E) - > (E x 3F)
 
 
 
@@ -990,14 +1582,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     matMul_args8.trans_B = 0;
 
     #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args8); // Input gradients: (E x 3F)*(3F x L) - > (E x L)
+    pulp_team_fork(NUM_CORES, mm, &matMul_args8); // Input gradients: (E x 3F)*(3F x L) - > (E x L)
     #else
     struct mm_manager_args man_args8;
     man_args8.mm_args = &matMul_args8;
     man_args8.layer_type = LAYER_LINEAR;
     man_args8.step_type = STEP_FW;
     man_args8.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8);
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args8);
     #endif
 
     // Transpose input weight gradients
@@ -1007,14 +1599,14 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
     transp_args6.N = E;
     transp_args6.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args6); 
+    pulp_team_fork(NUM_CORES, transpose, &transp_args6); 
 
     struct copy_args copy_args5;
     copy_args5.from = temp;
     copy_args5.to = inDiff;
     copy_args5.size = L*E;
 
-    pi_cl_team_fork(NUM_CORES, copy, &copy_args5); // Input gradients transpose: (E x L) - > (L x E)
+    pulp_team_fork(NUM_CORES, copy, &copy_args5); // Input gradients transpose: (E x L) - > (L x E)
 
 
 }
@@ -1022,3 +1614,269 @@ void pulp_mhsa_fp32_bw_cl(void * Mhsa_args) {
 
 
 
+void mhsa_softmax_recompute_fp32(void * recompute_args){
+    struct mhsa_recompute_args *args = (struct mhsa_recompute_args *) recompute_args;
+    float *scores = args->scores;
+    float *lse = args->lse;
+    int L = args->L;
+    float scaling = args->scaling;
+
+    const int blockSize = (L+NUM_CORES-1) / NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > L ? L : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+        float *row = scores + i*L;
+        float row_lse = lse[i];
+        int n_keys = mhsa_key_limit(i, L, args->causal, args->valid_len);
+        for (int j=0; j<n_keys; j++)
+            row[j] = fastexp_gist(row[j]*scaling - row_lse);
+        for (int j=n_keys; j<L; j++)
+            row[j] = 0.0f;
+    }
+}
+
+
+
+void mhsa_masked_softmax_fp32(void * mask_args){
+    struct mhsa_mask_args *args = (struct mhsa_mask_args *) mask_args;
+    int L = args->L;
+    int n_keys = args->n_keys;
+    float scaling = args->scaling;
+
+    // Rows are interleaved among the cores, since their number of unmasked keys grows along the block under the causal mask
+    for (int t=pi_core_id(); t<args->n_rows; t+=NUM_CORES) {
+        int l = args->row0 + t;
+        float *s = args->scores + t*n_keys;
+        float *row = args->softmax + l*L;
+        int n = mhsa_key_limit(l, L, args->causal, args->valid_len);
+
+        float max = s[0] * scaling;
+        for (int j=1; j<n; j++) if (s[j] * scaling > max) max = s[j] * scaling;
+
+        float sum = 0.0f;
+        for (int j=0; j<n; j++) {
+            s[j] = fastexp_gist(s[j] * scaling - max);
+            sum += s[j];
+        }
+
+        // Probabilities are kept in the block for the product with V, and saved in the head's rows with zeros on the masked keys
+        float inv_sum = 1.0f / sum;
+        for (int j=0; j<n; j++) {
+            s[j] *= inv_sum;
+            row[j] = s[j];
+        }
+        for (int j=n; j<n_keys; j++) s[j] = 0.0f;
+        for (int j=n; j<L; j++) row[j] = 0.0f;
+
+        args->maxes[l] = max;
+        args->sums[l] = sum;
+        if (args->lse != NULL) args->lse[l] = max + logf(sum);
+    }
+}
+
+
+void mhsa_masked_softmax_bw_fp32(void * mask_bw_args){
+    struct mhsa_mask_bw_args *args = (struct mhsa_mask_bw_args *) mask_bw_args;
+    int L = args->L;
+    int n_keys = args->n_keys;
+    float scaling = args->scaling;
+
+    for (int t=pi_core_id(); t<args->n_rows; t+=NUM_CORES) {
+        int l = args->row0 + t;
+        float *p = args->softmax + l*L;
+        float *ds = args->grad_tile + t*n_keys;
+        float *g = args->grad + l*L;
+        int n = mhsa_key_limit(l, L, args->causal, args->valid_len);
+
+        // Recompute the probabilities of the unmasked keys from the saved log-sum-exp
+        if (args->scores != NULL) {
+            float *s = args->scores + t*n_keys;
+            float row_lse = args->lse[l];
+            for (int j=0; j<n; j++) p[j] = fastexp_gist(s[j]*scaling - row_lse);
+        }
+
+        // ds_j = scaling * p_j * (dp_j - sum_z(dp_z * p_z)), zero on the masked keys
+        float dot = 0.0f;
+        for (int j=0; j<n; j++) dot += p[j] * ds[j];
+        for (int j=0; j<n; j++) {
+            ds[j] = scaling * p[j] * (ds[j] - dot);
+            g[j] = ds[j];
+        }
+        for (int j=n; j<n_keys; j++) ds[j] = 0.0f;
+    }
+}
+
+
+void mhsa_masked_kv_bw_fp32(void * mask_bw_args){
+    struct mhsa_mask_bw_args *args = (struct mhsa_mask_bw_args *) mask_bw_args;
+    int L = args->L;
+    int H = args->H;
+    int n_valid = (args->valid_len > 0 && args->valid_len < L) ? args->valid_len : L;
+
+    // Keys are interleaved among the cores, since under the causal mask the j-th key is only seen by the queries from j on
+    for (int j=pi_core_id(); j<L; j+=NUM_CORES) {
+        int l0 = (j >= n_valid) ? L : (args->causal ? j : 0);
+
+        for (int h=0; h<H; h++) {
+            float *q_row = args->q + h*L;
+            float *do_row = args->att_diff + h*L;
+            float dk = 0.0f;
+            float dv = 0.0f;
+            for (int l=l0; l<L; l++) {
+                dk += q_row[l] * args->grad[l*L+j];
+                dv += do_row[l] * args->softmax[l*L+j];
+            }
+            args->k_diff[h*L+j] = dk;
+            args->v_diff[h*L+j] = dv;
+        }
+    }
+}
+
+
+
+void mhsa_heads_core_fw_fp32(void * heads_args){
+    struct mhsa_heads_args *args = (struct mhsa_heads_args *) heads_args;
+    struct Mhsa_args *mhsa_args = args->mhsa_args;
+    int L = args->L;
+    int H = args->H;
+    int F = args->F;
+    float scaling = args->scaling;
+    int n_heads = mhsa_args->n_heads;
+    int store = !mhsa_args->recompute_softmax;
+
+    float *q = mhsa_args->qkv->data;
+    float *k = mhsa_args->qkv->data + L*F;
+    float *v = mhsa_args->qkv->data + 2*L*F;
+    float *s = mhsa_args->temp_buffer + pi_core_id()*L;         // Per-core scores row
+
+    const int blockSize = (n_heads+NUM_CORES-1) / NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > n_heads ? n_heads : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+        float *q_h = q + i*L*H;
+        float *k_h = k + i*L*H;
+        float *v_h = v + i*L*H;
+        float *out = mhsa_args->attention_map->data + i*L*H;
+
+        for (int l=0; l<L; l++) {
+            float *row = store ? mhsa_args->softmax_buffer->data + i*L*L + l*L : s;
+            int n_keys = mhsa_key_limit(l, L, mhsa_args->causal, mhsa_args->valid_len);
+
+            for (int j=0; j<n_keys; j++) row[j] = 0.0f;
+            for (int h=0; h<H; h++) {
+                float qh = q_h[h*L + l] * scaling;
+                float *k_row = k_h + h*L;
+                for (int j=0; j<n_keys; j++) row[j] += qh * k_row[j];
+            }
+
+            float max = row[0];
+            for (int j=1; j<n_keys; j++) if (row[j] > max) max = row[j];
+
+            float sum = 0.0f;
+            for (int j=0; j<n_keys; j++) {
+                row[j] = fastexp_gist(row[j] - max);
+                sum += row[j];
+            }
+
+            float inv_sum = 1.0f / sum;
+            for (int j=0; j<n_keys; j++) row[j] *= inv_sum;
+            for (int j=n_keys; j<L; j++) row[j] = 0.0f;
+
+            for (int h=0; h<H; h++) {
+                float *v_row = v_h + h*L;
+                float a = 0.0f;
+                for (int j=0; j<n_keys; j++) a += row[j] * v_row[j];
+                out[h*L + l] = a;
+            }
+
+            if (mhsa_args->lse != NULL) mhsa_args->lse[i*L + l] = max + logf(sum);
+        }
+    }
+}
+
+
+void mhsa_heads_core_bw_fp32(void * heads_args){
+    struct mhsa_heads_args *args = (struct mhsa_heads_args *) heads_args;
+    struct Mhsa_args *mhsa_args = args->mhsa_args;
+    int L = args->L;
+    int H = args->H;
+    int F = args->F;
+    float scaling = args->scaling;
+    int n_heads = mhsa_args->n_heads;
+    int recompute = mhsa_args->recompute_softmax;
+
+    float *q = mhsa_args->qkv->data;
+    float *k = mhsa_args->qkv->data + L*F;
+    float *v = mhsa_args->qkv->data + 2*L*F;
+    float *q_diff = mhsa_args->qkv->diff;
+    float *k_diff = mhsa_args->qkv->diff + L*F;
+    float *v_diff = mhsa_args->qkv->diff + 2*L*F;
+    float *p_row = mhsa_args->temp_buffer + pi_core_id()*2*L;   // Per-core probabilities row (recompute mode)
+    float *ds = p_row + L;                                      // Per-core score gradients row
+
+    const int blockSize = (n_heads+NUM_CORES-1) / NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > n_heads ? n_heads : start+blockSize;
+
+    for (int i=start; i<stop; i++) {
+        float *q_h = q + i*L*H;
+        float *k_h = k + i*L*H;
+        float *v_h = v + i*L*H;
+        float *dq_h = q_diff + i*L*H;
+        float *dk_h = k_diff + i*L*H;
+        float *dv_h = v_diff + i*L*H;
+        float *dout = mhsa_args->attention_map->diff + i*L*H;
+
+        for (int j=0; j<L*H; j++) { dk_h[j] = 0.0f; dv_h[j] = 0.0f; }
+
+        for (int l=0; l<L; l++) {
+            int n_keys = mhsa_key_limit(l, L, mhsa_args->causal, mhsa_args->valid_len);
+            float *p = mhsa_args->softmax_buffer->data + i*L*L + l*L;
+
+            if (recompute) {
+                // Probabilities of the l-th query from the scores and the saved log-sum-exp
+                p = p_row;
+                float row_lse = mhsa_args->lse[i*L + l];
+                for (int j=0; j<n_keys; j++) p[j] = 0.0f;
+                for (int h=0; h<H; h++) {
+                    float qh = q_h[h*L + l];
+                    float *k_row = k_h + h*L;
+                    for (int j=0; j<n_keys; j++) p[j] += qh * k_row[j];
+                }
+                for (int j=0; j<n_keys; j++) p[j] = fastexp_gist(p[j]*scaling - row_lse);
+            }
+
+            // Probabilities gradient, and Value gradient accumulation
+            for (int j=0; j<n_keys; j++) ds[j] = 0.0f;
+            for (int h=0; h<H; h++) {
+                float d = dout[h*L + l];
+                float *v_row = v_h + h*L;
+                float *dv_row = dv_h + h*L;
+                for (int j=0; j<n_keys; j++) {
+                    ds[j] += d * v_row[j];
+                    dv_row[j] += d * p[j];
+                }
+            }
+
+            // Through the softmax and the scaling
+            float dot = 0.0f;
+            for (int j=0; j<n_keys; j++) dot += p[j] * ds[j];
+            for (int j=0; j<n_keys; j++) ds[j] = scaling * p[j] * (ds[j] - dot);
+
+            // Query gradient, and Key gradient accumulation
+            for (int h=0; h<H; h++) {
+                float qh = q_h[h*L + l];
+                float *k_row = k_h + h*L;
+                float *dk_row = dk_h + h*L;
+                float a = 0.0f;
+                for (int j=0; j<n_keys; j++) {
+                    a += k_row[j] * ds[j];
+                    dk_row[j] += qh * ds[j];
+                }
+                dq_h[h*L + l] = a;
+            }
+        }
+    }
+}
@@ -21,6 +21,7 @@
 #include "pmsis.h"
 #include "pulp_train_utils_fp16.h"
 #include "pulp_optimizers_fp16.h"
+#include <math.h>
 
 
 void pulp_gradient_descent_fp16 (void * optim_args_fp16) 
@@ -54,3 +55,349 @@ void pulp_gradient_descent_fp16 (void * optim_args_fp16)
     printf("\n\n");
     #endif
 }
+
+
+
+
+// STOCHASTIC ROUNDING
+
+// Xorshift32 PRNG step (the state must be non-zero)
+static inline uint32_t sr_xorshift32 (uint32_t * state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Rounds a FP32 value to FP16, up or down with probability proportional to the distance.
+// A random number is added to the 13 mantissa bits that FP16 drops, then they are truncated,
+// so that the final cast is exact (values in the FP16 subnormal range are rounded to nearest).
+static inline fp16 sr_round_fp16 (float val, uint32_t rnd)
+{
+    union { float f; uint32_t u; } bits;
+    bits.f = val;
+    bits.u = (bits.u + (rnd >> 19)) & 0xFFFFE000;
+    return (fp16) bits.f;
+}
+
+
+
+void pulp_sr_seed_fp16 (uint32_t * rng_state, uint32_t seed)
+{
+    // Decorrelate the cores by scrambling the seed with a different offset
+    for (int c=0; c<NUM_CORES; c++) 
+    {
+        uint32_t z = seed + (c+1) * 0x9E3779B9u;
+        z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+        z ^= z >> 16;
+        rng_state[c] = z != 0 ? z : 1;
+    }
+}
+
+
+
+void pulp_gradient_descent_sr_fp16 (void * optim_sr_args_fp16)
+{
+    struct optim_sr_args_fp16 * args = (struct optim_sr_args_fp16 *) optim_sr_args_fp16;
+    fp16 * __restrict__ weights = args->weights->data; 
+    fp16 * __restrict__ weight_grad = args->weights->diff;
+    const int wgt_size = args->weights->dim; 
+    float lr = args->learning_rate;
+    uint32_t state = args->rng_state[pi_core_id()];
+
+    int blockSize = (wgt_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > wgt_size ? wgt_size : start+blockSize;
+
+    for (int i=start; i<stop; i++) 
+    {
+        float w = (float) weights[i] - lr * (float) weight_grad[i];
+        weights[i] = sr_round_fp16(w, sr_xorshift32(&state));
+    }
+
+    args->rng_state[pi_core_id()] = state;
+}
+
+
+
+
+// MULTI-TENSOR OPTIMIZERS
+
+// Range of the flattened list of parameters assigned to the current core
+static inline void optim_multi_core_range_fp16 (struct blob_fp16 ** weights, int n_tensors, int * start, int * stop)
+{
+    int total = 0;
+    for (int n=0; n<n_tensors; n++)  total += weights[n]->dim;
+
+    int blockSize = (total+NUM_CORES-1) / NUM_CORES;
+    *start = pi_core_id()*blockSize;
+    *stop = *start+blockSize > total ? total : *start+blockSize;
+}
+
+
+
+// Clip-by-global-norm: multi-tensor reduction of the squared norms of the gradients, returns the scale of the gradients
+static inline float optim_clip_scale_fp16 (struct optim_multi_args_fp16 * args, int start, int stop, float inv_scale)
+{
+    float sumsq = 0.0f;
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        fp16 * __restrict__ weight_grad = args->weights[n]->diff;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++)  sumsq += (float) weight_grad[i] * (float) weight_grad[i];
+    }
+
+    float norm = sqrtf(pulp_team_sum_fp16(sumsq, args->norm_partials)) * inv_scale;
+    if (pi_core_id() == 0 && args->grad_norm != NULL)  *(args->grad_norm) = norm;
+
+    // Same coefficient of torch.nn.utils.clip_grad_norm_
+    float clip = args->max_grad_norm / (norm + 1e-6f);
+    return clip < 1.0f ? clip : 1.0f;
+}
+
+
+
+void pulp_momentum_sgd_fp16 (void * optim_multi_args_fp16)
+{
+    struct optim_multi_args_fp16 * args = (struct optim_multi_args_fp16 *) optim_multi_args_fp16;
+    float lr = args->learning_rate;
+    float mu = args->momentum;
+    float wd = args->weight_decay;
+    float inv_scale = 1.0f;
+
+    // Skip the step if the scaled gradients overflowed
+    if (args->scaler != NULL) 
+    {
+        if (args->scaler->overflow)  return;
+        inv_scale = 1.0f / args->scaler->scale;
+    }
+
+    uint32_t * rng = args->rng_state;
+    uint32_t state = rng != NULL ? rng[pi_core_id()] : 0;
+
+    int start, stop;
+    optim_multi_core_range_fp16(args->weights, args->n_tensors, &start, &stop);
+    // The clipping scale is applied together with the loss unscaling
+    if (args->max_grad_norm > 0.0f)  inv_scale *= optim_clip_scale_fp16(args, start, stop, inv_scale);
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        fp16 * __restrict__ weights = args->weights[n]->data;
+        fp16 * __restrict__ weight_grad = args->weights[n]->diff;
+        float * __restrict__ master = args->master_weights != NULL ? args->master_weights[n] : NULL;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++) 
+        {
+            float w = master != NULL ? master[i] : (float) weights[i];
+            float grad = (float) weight_grad[i] * inv_scale + wd * w;
+            if (mu != 0.0f) 
+            {
+                float v = mu * args->first_moment[n][i] + grad;
+                args->first_moment[n][i] = v;
+                grad = v;
+            }
+            w -= lr * grad;
+            if (master != NULL)  master[i] = w;
+            weights[i] = rng != NULL ? sr_round_fp16(w, sr_xorshift32(&state)) : (fp16) w;
+        }
+    }
+
+    if (rng != NULL)  rng[pi_core_id()] = state;
+}
+
+
+
+// Adam update, with L2 penalty on the gradient (decoupled=0) or decoupled weight decay (decoupled=1)
+static inline void adam_core_fp16 (struct optim_multi_args_fp16 * args, int decoupled)
+{
+    float lr = args->learning_rate;
+    float beta1 = args->beta1;
+    float beta2 = args->beta2;
+    float eps = args->epsilon;
+    float l2 = decoupled ? 0.0f : args->weight_decay;
+    float decay = decoupled ? 1.0f - lr * args->weight_decay : 1.0f;
+    // Bias corrections
+    float step_size = lr / (1.0f - powf(beta1, (float) args->step));
+    float inv_sqrt_bc2 = 1.0f / sqrtf(1.0f - powf(beta2, (float) args->step));
+    float inv_scale = 1.0f;
+
+    // Skip the step if the scaled gradients overflowed
+    if (args->scaler != NULL) 
+    {
+        if (args->scaler->overflow)  return;
+        inv_scale = 1.0f / args->scaler->scale;
+    }
+
+    uint32_t * rng = args->rng_state;
+    uint32_t state = rng != NULL ? rng[pi_core_id()] : 0;
+
+    int start, stop;
+    optim_multi_core_range_fp16(args->weights, args->n_tensors, &start, &stop);
+    // The clipping scale is applied together with the loss unscaling
+    if (args->max_grad_norm > 0.0f)  inv_scale *= optim_clip_scale_fp16(args, start, stop, inv_scale);
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        fp16 * __restrict__ weights = args->weights[n]->data;
+        fp16 * __restrict__ weight_grad = args->weights[n]->diff;
+        float * __restrict__ m = args->first_moment[n];
+        float * __restrict__ v = args->second_moment[n];
+        float * __restrict__ master = args->master_weights != NULL ? args->master_weights[n] : NULL;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++) 
+        {
+            float w = master != NULL ? master[i] : (float) weights[i];
+            float grad = (float) weight_grad[i] * inv_scale + l2 * w;
+            float m_i = beta1 * m[i] + (1.0f - beta1) * grad;
+            float v_i = beta2 * v[i] + (1.0f - beta2) * grad * grad;
+            m[i] = m_i;
+            v[i] = v_i;
+            w = w * decay - step_size * m_i / (sqrtf(v_i) * inv_sqrt_bc2 + eps);
+            if (master != NULL)  master[i] = w;
+            weights[i] = rng != NULL ? sr_round_fp16(w, sr_xorshift32(&state)) : (fp16) w;
+        }
+    }
+
+    if (rng != NULL)  rng[pi_core_id()] = state;
+}
+
+
+
+void pulp_adam_fp16 (void * optim_multi_args_fp16)
+{
+    adam_core_fp16((struct optim_multi_args_fp16 *) optim_multi_args_fp16, 0);
+}
+
+
+
+void pulp_adamw_fp16 (void * optim_multi_args_fp16)
+{
+    adam_core_fp16((struct optim_multi_args_fp16 *) optim_multi_args_fp16, 1);
+}
+
+
+
+
+// MIXED-PRECISION TRAINING
+
+void pulp_loss_scale_fp16 (void * loss_scaler_args_fp16)
+{
+    struct loss_scaler_args_fp16 * args = (struct loss_scaler_args_fp16 *) loss_scaler_args_fp16;
+    fp16 * outDiff = args->output->diff;
+    int size = args->output->dim;
+    // The scale is applied in FP32, since it does not need to be representable in FP16
+    float scale = args->scale;
+
+    int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > size ? size : start+blockSize;
+
+    for (int i=start; i<stop; i++)  outDiff[i] = (fp16) ((float) outDiff[i] * scale);
+}
+
+
+
+void pulp_grad_overflow_check_fp16 (void * loss_scaler_args_fp16)
+{
+    struct loss_scaler_args_fp16 * args = (struct loss_scaler_args_fp16 *) loss_scaler_args_fp16;
+
+    int start, stop;
+    optim_multi_core_range_fp16(args->weights, args->n_tensors, &start, &stop);
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        // Inf and NaN have all the exponent bits set
+        uint16_t * __restrict__ grad = (uint16_t *) args->weights[n]->diff;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++) 
+        {
+            if ((grad[i] & 0x7C00) == 0x7C00) 
+            {
+                // All the cores can only set the flag, so no synchronization is needed
+                args->overflow = 1;
+                return;
+            }
+        }
+    }
+}
+
+
+
+void pulp_loss_scaler_update_fp16 (void * loss_scaler_args_fp16)
+{
+    struct loss_scaler_args_fp16 * args = (struct loss_scaler_args_fp16 *) loss_scaler_args_fp16;
+
+    // Inside pulp_team_run, the update is executed once, by core 0
+    if (!pulp_team_active || pi_core_id() == 0) 
+    {
+        if (args->overflow) 
+        {
+            args->scale *= args->backoff_factor;
+            args->good_steps = 0;
+        }
+        else 
+        {
+            args->good_steps++;
+            if (args->good_steps >= args->growth_interval) 
+            {
+                // Keep the scaled gradients representable in FP16
+                if (args->scale * args->growth_factor <= 65504.0f)  args->scale *= args->growth_factor;
+                args->good_steps = 0;
+            }
+        }
+        args->overflow = 0;
+    }
+    if (pulp_team_active)  pi_cl_team_barrier();
+}
+
+
+
+void pulp_init_master_weights_fp16 (void * optim_multi_args_fp16)
+{
+    struct optim_multi_args_fp16 * args = (struct optim_multi_args_fp16 *) optim_multi_args_fp16;
+
+    int start, stop;
+    optim_multi_core_range_fp16(args->weights, args->n_tensors, &start, &stop);
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        fp16 * __restrict__ weights = args->weights[n]->data;
+        float * __restrict__ master = args->master_weights[n];
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++)  master[i] = (float) weights[i];
+    }
+}
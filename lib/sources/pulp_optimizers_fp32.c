@@ -21,6 +21,7 @@
 #include "pmsis.h"
 #include "pulp_train_utils_fp32.h"
 #include "pulp_optimizers_fp32.h"
+#include <math.h>
 
 
 void pulp_gradient_descent_fp32 (void * optim_args) 
@@ -54,3 +55,151 @@ void pulp_gradient_descent_fp32 (void * optim_args)
     printf("\n\n");
     #endif
 }
+
+
+
+
+// MULTI-TENSOR OPTIMIZERS
+
+// Range of the flattened list of parameters assigned to the current core
+static inline void optim_multi_core_range_fp32 (struct blob ** weights, int n_tensors, int * start, int * stop)
+{
+    int total = 0;
+    for (int n=0; n<n_tensors; n++)  total += weights[n]->dim;
+
+    int blockSize = (total+NUM_CORES-1) / NUM_CORES;
+    *start = pi_core_id()*blockSize;
+    *stop = *start+blockSize > total ? total : *start+blockSize;
+}
+
+
+
+// Clip-by-global-norm: multi-tensor reduction of the squared norms of the gradients, returns the scale of the gradients
+static inline float optim_clip_scale_fp32 (struct optim_multi_args * args, int start, int stop)
+{
+    float sumsq = 0.0f;
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        float * __restrict__ weight_grad = args->weights[n]->diff;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++)  sumsq += weight_grad[i] * weight_grad[i];
+    }
+
+    float norm = sqrtf(pulp_team_sum(sumsq, args->norm_partials));
+    if (pi_core_id() == 0 && args->grad_norm != NULL)  *(args->grad_norm) = norm;
+
+    // Same coefficient of torch.nn.utils.clip_grad_norm_
+    float clip = args->max_grad_norm / (norm + 1e-6f);
+    return clip < 1.0f ? clip : 1.0f;
+}
+
+
+
+void pulp_momentum_sgd_fp32 (void * optim_multi_args)
+{
+    struct optim_multi_args * args = (struct optim_multi_args *) optim_multi_args;
+    float lr = args->learning_rate;
+    float mu = args->momentum;
+    float wd = args->weight_decay;
+
+    int start, stop;
+    optim_multi_core_range_fp32(args->weights, args->n_tensors, &start, &stop);
+    float clip = args->max_grad_norm > 0.0f ? optim_clip_scale_fp32(args, start, stop) : 1.0f;
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        float * __restrict__ weights = args->weights[n]->data;
+        float * __restrict__ weight_grad = args->weights[n]->diff;
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        if (mu == 0.0f) 
+        {
+            for (int i=lo; i<hi; i++) 
+            {
+                float grad = clip * weight_grad[i] + wd * weights[i];
+                weights[i] -= lr * grad;
+            }
+        }
+        else 
+        {
+            float * __restrict__ velocity = args->first_moment[n];
+            for (int i=lo; i<hi; i++) 
+            {
+                float grad = clip * weight_grad[i] + wd * weights[i];
+                float v = mu * velocity[i] + grad;
+                velocity[i] = v;
+                weights[i] -= lr * v;
+            }
+        }
+    }
+}
+
+
+
+// Adam update, with L2 penalty on the gradient (decoupled=0) or decoupled weight decay (decoupled=1)
+static inline void adam_core_fp32 (struct optim_multi_args * args, int decoupled)
+{
+    float lr = args->learning_rate;
+    float beta1 = args->beta1;
+    float beta2 = args->beta2;
+    float eps = args->epsilon;
+    float l2 = decoupled ? 0.0f : args->weight_decay;
+    float decay = decoupled ? 1.0f - lr * args->weight_decay : 1.0f;
+    // Bias corrections
+    float step_size = lr / (1.0f - powf(beta1, (float) args->step));
+    float inv_sqrt_bc2 = 1.0f / sqrtf(1.0f - powf(beta2, (float) args->step));
+
+    int start, stop;
+    optim_multi_core_range_fp32(args->weights, args->n_tensors, &start, &stop);
+    float clip = args->max_grad_norm > 0.0f ? optim_clip_scale_fp32(args, start, stop) : 1.0f;
+
+    int offset = 0;
+    for (int n=0; n<args->n_tensors && offset<stop; n++) 
+    {
+        float * __restrict__ weights = args->weights[n]->data;
+        float * __restrict__ weight_grad = args->weights[n]->diff;
+        float * __restrict__ m = args->first_moment[n];
+        float * __restrict__ v = args->second_moment[n];
+        int dim = args->weights[n]->dim;
+        // Intersection of the core range with the current tensor
+        int lo = start > offset ? start-offset : 0;
+        int hi = stop-offset < dim ? stop-offset : dim;
+        offset += dim;
+
+        for (int i=lo; i<hi; i++) 
+        {
+            float w = weights[i];
+            float grad = clip * weight_grad[i] + l2 * w;
+            float m_i = beta1 * m[i] + (1.0f - beta1) * grad;
+            float v_i = beta2 * v[i] + (1.0f - beta2) * grad * grad;
+            m[i] = m_i;
+            v[i] = v_i;
+            weights[i] = w * decay - step_size * m_i / (sqrtf(v_i) * inv_sqrt_bc2 + eps);
+        }
+    }
+}
+
+
+
+void pulp_adam_fp32 (void * optim_multi_args)
+{
+    adam_core_fp32((struct optim_multi_args *) optim_multi_args, 0);
+}
+
+
+
+void pulp_adamw_fp32 (void * optim_multi_args)
+{
+    adam_core_fp32((struct optim_multi_args *) optim_multi_args, 1);
+}
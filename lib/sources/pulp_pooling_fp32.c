@@ -21,47 +21,127 @@
 #include "pulp_train_utils_fp32.h"
 #include "pulp_pooling_fp32.h"
 
+// Range [*start, *stop) of the kernel rows (or columns) of a window at position x0 falling inside an input of size X
+static inline void pool_window_range(int x0, int ker, int X, int * start, int * stop) {
+  *start = x0 < 0 ? -x0 : 0;
+  *stop = x0+ker > X ? X-x0 : ker;
+}
+
+// Range [*start, *stop) of the outputs whose window covers the input row (or column) x
+static inline void pool_output_range(int x, int ker, int str, int pad, int Xo, int * start, int * stop) {
+  int first = x + pad - ker + 1;
+  *start = first <= 0 ? 0 : (first + str - 1) / str;
+  int last = (x + pad) / str + 1;
+  *stop = last > Xo ? Xo : last;
+}
+
+// Sum of a pooling window (restricted to its non-padded part), unrolled for full 2x2 and 3x3 windows
+static inline float pulp_avgpool_window_fp32(float * in, int W, int pixStride, int h0, int w0, int hk_start, int hk_stop, int wk_start, int wk_stop, int Hker, int Wker) {
+  float * p = in + (h0*W + w0)*pixStride;
+  int rowStride = W*pixStride;
+  if (hk_start == 0 && wk_start == 0 && hk_stop == Hker && wk_stop == Wker) {
+    if (Hker == 2 && Wker == 2) {
+      return p[0] + p[pixStride] + p[rowStride] + p[rowStride+pixStride];
+    }
+    if (Hker == 3 && Wker == 3) {
+      float s0 = p[0] + p[pixStride] + p[2*pixStride];
+      float s1 = p[rowStride] + p[rowStride+pixStride] + p[rowStride+2*pixStride];
+      float s2 = p[2*rowStride] + p[2*rowStride+pixStride] + p[2*rowStride+2*pixStride];
+      return s0 + s1 + s2;
+    }
+  }
+  float sum = 0;
+  for (int hk=hk_start; hk<hk_stop; hk++) {
+    for (int wk=wk_start; wk<wk_stop; wk++) {
+      sum += p[hk*rowStride + wk*pixStride];
+    }
+  }
+  return sum;
+}
+
+// Finds the maximum of a pooling window (restricted to its non-padded part), returning its position inside the window. Unrolled for full 2x2 and 3x3 windows.
+static inline int pulp_maxpool_window_fp32(float * in, int W, int pixStride, int h0, int w0, int hk_start, int hk_stop, int wk_start, int wk_stop, int Hker, int Wker, float * max) {
+  float * p = in + (h0*W + w0)*pixStride;
+  int rowStride = W*pixStride;
+  float maxpool = p[hk_start*rowStride + wk_start*pixStride];
+  int maxidx = wk_start + hk_start*Wker;
+  if (hk_start == 0 && wk_start == 0 && hk_stop == Hker && wk_stop == Wker && ((Hker == 2 && Wker == 2) || (Hker == 3 && Wker == 3))) {
+    float v;
+    v = p[pixStride];                     if (v > maxpool)  {maxpool = v; maxidx = 1;}
+    if (Wker == 2) {
+      v = p[rowStride];                   if (v > maxpool)  {maxpool = v; maxidx = 2;}
+      v = p[rowStride+pixStride];         if (v > maxpool)  {maxpool = v; maxidx = 3;}
+    }
+    else {
+      v = p[2*pixStride];                 if (v > maxpool)  {maxpool = v; maxidx = 2;}
+      v = p[rowStride];                   if (v > maxpool)  {maxpool = v; maxidx = 3;}
+      v = p[rowStride+pixStride];         if (v > maxpool)  {maxpool = v; maxidx = 4;}
+      v = p[rowStride+2*pixStride];       if (v > maxpool)  {maxpool = v; maxidx = 5;}
+      v = p[2*rowStride];                 if (v > maxpool)  {maxpool = v; maxidx = 6;}
+      v = p[2*rowStride+pixStride];       if (v > maxpool)  {maxpool = v; maxidx = 7;}
+      v = p[2*rowStride+2*pixStride];     if (v > maxpool)  {maxpool = v; maxidx = 8;}
+    }
+    *max = maxpool;
+    return maxidx;
+  }
+  for (int hk=hk_start; hk<hk_stop; hk++) {
+    for (int wk=wk_start; wk<wk_stop; wk++) {
+      float newData = p[hk*rowStride + wk*pixStride];
+      if (newData > maxpool)  {maxpool = newData; maxidx = wk + hk*Wker;}
+    }
+  }
+  *max = maxpool;
+  return maxidx;
+}
+
+
+
 void pulp_avgpool_fp32_fw_cl(void * pool_args) {
 
   struct pool_args * args = (struct pool_args *) pool_args;
   float * inData = args->input->data;
   float * outData = args->output->data;
-  uint16_t W = args->input->W;
-  uint16_t H = args->input->H;
-  uint16_t C = args->input->C;
-  uint16_t Ho = args->output->H;
-  uint16_t Wo = args->output->W;
-  uint16_t Hker = args->Hker;
-  uint16_t Wker = args->Wker;
-  uint16_t Hstr = args->Hstride;
-  uint16_t Wstr = args->Wstride;
+  int W = args->input->W;
+  int H = args->input->H;
+  int C = args->input->C;
+  int Ho = args->output->H;
+  int Wo = args->output->W;
+  int Hker = args->Hker;
+  int Wker = args->Wker;
+  int Hstr = args->Hstride;
+  int Wstr = args->Wstride;
+  int Lpad = args->Lpad;
+  int Upad = args->Upad;
+  int HWC = args->HWC;
 
   // Internal variables
-  uint32_t Hact = (H-Hker+Hstr)/Hstr; //H / Hker;
-  uint32_t Wact = (W-Wker+Hstr)/Wstr; //W / Wker;
+  int Hact = (H+Upad+args->Dpad-Hker+Hstr)/Hstr;
+  int Wact = (W+Lpad+args->Rpad-Wker+Wstr)/Wstr;
   if (Hact!=Ho || Wact!=Wo)   {printf("\n[pulp_avgpool_fp32_fw_cl] Invalid pooling kernel size or output size!\n"); return;}
-  int HW = H*W;
-  int HWk = Hker*Wker;
-  int HWo = Ho*Wo;
+  float invHWk = 1.0f / (Hker*Wker);
+  // Strides between channels and between pixels (CHW or HWC)
+  int inChStride = HWC ? 1 : H*W;
+  int outChStride = HWC ? 1 : Ho*Wo;
+  int pixStride = HWC ? C : 1;
 
-  const int blockSize = (C+NUM_CORES-1) / NUM_CORES;
+  // Parallelize over the C*Ho output rows, so that all the cores work also when C < NUM_CORES
+  const int blockSize = (C*Ho+NUM_CORES-1) / NUM_CORES;
   const int start = pi_core_id()*blockSize;
-  const int stop = start+blockSize > C ? C : start+blockSize;
+  const int stop = start+blockSize > C*Ho ? C*Ho : start+blockSize;
 
-  for (int k=start; k<stop; k++) {
-    for (int ha=0; ha<Hact; ha++) {
-      for (int wa=0; wa<Wact; wa++) {
-        float avgpool = 0;
-        for (int hk=0; hk<Hker; hk++) {
-          for (int wk=0; wk<Wker; wk++) {
-            uint32_t  in_idx = wk + wa*Wstr + (hk + ha*Hstr)*W + k*HW;
-            avgpool += inData[in_idx];
-          }
-        }
-        avgpool = avgpool / HWk;
-        uint32_t out_idx = wa + ha*Wo + k*HWo;
-        outData[out_idx] = avgpool;
-      }
+  for (int row=start; row<stop; row++) {
+    int k = HWC ? row % C : row / Ho;
+    int ha = HWC ? row / C : row % Ho;
+    int h0 = ha*Hstr - Upad;
+    int hk_start, hk_stop;
+    pool_window_range(h0, Hker, H, &hk_start, &hk_stop);
+    for (int wa=0; wa<Wact; wa++) {
+      int w0 = wa*Wstr - Lpad;
+      int wk_start, wk_stop;
+      pool_window_range(w0, Wker, W, &wk_start, &wk_stop);
+      float avgpool = pulp_avgpool_window_fp32(inData + k*inChStride, W, pixStride, h0, w0, hk_start, hk_stop, wk_start, wk_stop, Hker, Wker);
+      uint32_t out_idx = k*outChStride + (wa + ha*Wo)*pixStride;
+      outData[out_idx] = avgpool * invHWk;
     }
   }
 }
@@ -71,47 +151,49 @@ void pulp_avgpool_fp32_bw_cl(void * pool_args){
   struct pool_args * args = (struct pool_args *) pool_args;
   float * inDiff = args->input->diff;
   float * outDiff = args->output->diff;
-  uint16_t W = args->input->W;
-  uint16_t H = args->input->H;
-  uint16_t C = args->input->C;
-  uint16_t Ho = args->output->H;
-  uint16_t Wo = args->output->W;
-  uint16_t Hker = args->Hker;
-  uint16_t Wker = args->Wker;
-  uint16_t Hstr = args->Hstride;
-  uint16_t Wstr = args->Wstride;
+  int W = args->input->W;
+  int H = args->input->H;
+  int C = args->input->C;
+  int Ho = args->output->H;
+  int Wo = args->output->W;
+  int Hker = args->Hker;
+  int Wker = args->Wker;
+  int Hstr = args->Hstride;
+  int Wstr = args->Wstride;
+  int Lpad = args->Lpad;
+  int Upad = args->Upad;
+  int HWC = args->HWC;
 
   // Internal variables
-  uint32_t Hact = (H-Hker+Hstr)/Hstr; //H / Hker;
-  uint32_t Wact = (W-Wker+Hstr)/Wstr; //W / Wker;
+  int Hact = (H+Upad+args->Dpad-Hker+Hstr)/Hstr;
+  int Wact = (W+Lpad+args->Rpad-Wker+Wstr)/Wstr;
   if (Hact!=Ho || Wact!=Wo)   {printf("\n[pulp_avgpool_fp32_bw_cl] Invalid pooling kernel size or output size!\n"); return;}
-  int HW = H*W;
-  int HWk = Hker*Wker;
-  int HWo = Ho*Wo;
+  float invHWk = 1.0f / (Hker*Wker);
+  // Strides between channels and between pixels (CHW or HWC)
+  int inChStride = HWC ? 1 : H*W;
+  int outChStride = HWC ? 1 : Ho*Wo;
+  int pixStride = HWC ? C : 1;
 
-  const int blockSize = (C+NUM_CORES-1) / NUM_CORES;
+  // Parallelize over the C*H input rows: each input gradient gathers the outputs whose window covers it (no races with overlapping windows)
+  const int blockSize = (C*H+NUM_CORES-1) / NUM_CORES;
   const int start = pi_core_id()*blockSize;
-  const int stop = start+blockSize > C ? C : start+blockSize;
+  const int stop = start+blockSize > C*H ? C*H : start+blockSize;
 
-  // Initialize gradient
-  for (int k=start; k<stop; k++) {
-    for (int hw=0; hw<HW; hw++) {
-      inDiff[k*HW+hw] = 0;
-    }
-  }
-
-  // Compute input gradient
-  for (int k=start; k<stop; k++) {
-    for (int ho=0; ho<Ho; ho++) {
-      for (int wo=0; wo<Wo; wo++) {
-        for (int hact=0; hact<Hker; hact++) {
-          for (int wact=0; wact<Wker; wact++) {
-            int in_idx = (wact+wo*Wstr) + (hact+ho*Hstr)*W + k*HW;
-            int out_idx = wo + ho*Wo + k*HWo;
-            inDiff[in_idx] += outDiff[out_idx] / HWk;
-          }
+  for (int row=start; row<stop; row++) {
+    int k = HWC ? row % C : row / H;
+    int h = HWC ? row / C : row % H;
+    int ho_start, ho_stop;
+    pool_output_range(h, Hker, Hstr, Upad, Ho, &ho_start, &ho_stop);
+    for (int w=0; w<W; w++) {
+      int wo_start, wo_stop;
+      pool_output_range(w, Wker, Wstr, Lpad, Wo, &wo_start, &wo_stop);
+      float grad = 0;
+      for (int ho=ho_start; ho<ho_stop; ho++) {
+        for (int wo=wo_start; wo<wo_stop; wo++) {
+          grad += outDiff[k*outChStride + (wo + ho*Wo)*pixStride];
         }
       }
+      inDiff[k*inChStride + (h*W + w)*pixStride] = grad * invHWk;
     }
   }
 }
@@ -125,42 +207,53 @@ void pulp_maxpool_fp32_fw_cl(void * pool_args) {
   struct pool_args * args = (struct pool_args *) pool_args;
   float * inData = args->input->data;
   float * outData = args->output->data;
-  uint16_t W = args->input->W;
-  uint16_t H = args->input->H;
-  uint16_t C = args->input->C;
-  uint16_t Ho = args->output->H;
-  uint16_t Wo = args->output->W;
-  uint16_t Hker = args->Hker;
-  uint16_t Wker = args->Wker;
-  uint16_t Hstr = args->Hstride;
-  uint16_t Wstr = args->Wstride;
+  int W = args->input->W;
+  int H = args->input->H;
+  int C = args->input->C;
+  int Ho = args->output->H;
+  int Wo = args->output->W;
+  int Hker = args->Hker;
+  int Wker = args->Wker;
+  int Hstr = args->Hstride;
+  int Wstr = args->Wstride;
+  int Lpad = args->Lpad;
+  int Upad = args->Upad;
+  int HWC = args->HWC;
 
   // Internal variables
-  uint32_t Hact = (H-Hker+Hstr)/Hstr; //H / Hker;
-  uint32_t Wact = (W-Wker+Hstr)/Wstr; //W / Wker;
+  int Hact = (H+Upad+args->Dpad-Hker+Hstr)/Hstr;
+  int Wact = (W+Lpad+args->Rpad-Wker+Wstr)/Wstr;
   if (Hact!=Ho || Wact!=Wo)   {printf("\n[pulp_maxpool_fp32_fw_cl] Invalid pooling kernel size or output size!\n"); return;}
-  int HW = H*W;
   int HWk = Hker*Wker;
-  int HWo = Ho*Wo;
+  // Strides between channels and between pixels (CHW or HWC)
+  int inChStride = HWC ? 1 : H*W;
+  int outChStride = HWC ? 1 : Ho*Wo;
+  int pixStride = HWC ? C : 1;
+  // Argmax of each window, 8 bits are enough up to 16x16 kernels
+  uint8_t * argmax8 = (HWk <= 256) ? (uint8_t *) args->argmax : NULL;
+  uint16_t * argmax16 = (HWk > 256) ? (uint16_t *) args->argmax : NULL;
 
-  const int blockSize = (C+NUM_CORES-1) / NUM_CORES;
+  // Parallelize over the C*Ho output rows, so that all the cores work also when C < NUM_CORES
+  const int blockSize = (C*Ho+NUM_CORES-1) / NUM_CORES;
   const int start = pi_core_id()*blockSize;
-  const int stop = start+blockSize > C ? C : start+blockSize;
+  const int stop = start+blockSize > C*Ho ? C*Ho : start+blockSize;
 
-  for (int k=start; k<stop; k++) {
-    for (int ha=0; ha<Hact; ha++) {
-      for (int wa=0; wa<Wact; wa++) {
-        float maxpool = inData[wa*Wstr + ha*Hstr*W + k*HW];
-        for (int hk=0; hk<Hker; hk++) {
-          for (int wk=0; wk<Wker; wk++) {
-            uint32_t  in_idx = wk + wa*Wstr + (hk + ha*Hstr)*W + k*HW;
-            float newData = inData[in_idx];
-            if (newData > maxpool)  {maxpool = newData;}
-          }
-        }
-        uint32_t out_idx = wa + ha*Wo + k*HWo;
-        outData[out_idx] = maxpool;
-      }
+  for (int row=start; row<stop; row++) {
+    int k = HWC ? row % C : row / Ho;
+    int ha = HWC ? row / C : row % Ho;
+    int h0 = ha*Hstr - Upad;
+    int hk_start, hk_stop;
+    pool_window_range(h0, Hker, H, &hk_start, &hk_stop);
+    for (int wa=0; wa<Wact; wa++) {
+      int w0 = wa*Wstr - Lpad;
+      int wk_start, wk_stop;
+      pool_window_range(w0, Wker, W, &wk_start, &wk_stop);
+      float maxpool;
+      int maxidx = pulp_maxpool_window_fp32(inData + k*inChStride, W, pixStride, h0, w0, hk_start, hk_stop, wk_start, wk_stop, Hker, Wker, &maxpool);
+      uint32_t out_idx = k*outChStride + (wa + ha*Wo)*pixStride;
+      outData[out_idx] = maxpool;
+      if (argmax8 != NULL)        argmax8[out_idx] = maxidx;
+      else if (argmax16 != NULL)  argmax16[out_idx] = maxidx;
     }
   }
 }
@@ -171,68 +264,152 @@ void pulp_maxpool_fp32_bw_cl(void * pool_args){
   float * inData = args->input->data;
   float * inDiff = args->input->diff;
   float * outDiff = args->output->diff;
-  uint16_t W = args->input->W;
-  uint16_t H = args->input->H;
-  uint16_t C = args->input->C;
-  uint16_t Ho = args->output->H;
-  uint16_t Wo = args->output->W;
-  uint16_t Hker = args->Hker;
-  uint16_t Wker = args->Wker;
-  uint16_t Hstr = args->Hstride;
-  uint16_t Wstr = args->Wstride;
+  int W = args->input->W;
+  int H = args->input->H;
+  int C = args->input->C;
+  int Ho = args->output->H;
+  int Wo = args->output->W;
+  int Hker = args->Hker;
+  int Wker = args->Wker;
+  int Hstr = args->Hstride;
+  int Wstr = args->Wstride;
+  int Lpad = args->Lpad;
+  int Upad = args->Upad;
+  int HWC = args->HWC;
 
   // Internal variables
-  uint32_t Hact = (H-Hker+Hstr)/Hstr;
-  uint32_t Wact = (W-Wker+Hstr)/Wstr;
+  int Hact = (H+Upad+args->Dpad-Hker+Hstr)/Hstr;
+  int Wact = (W+Lpad+args->Rpad-Wker+Wstr)/Wstr;
   if (Hact!=Ho || Wact!=Wo)   {printf("\n[pulp_maxpool_fp32_bw_cl] Invalid pooling kernel size or output size!\n"); return;}
-  int HW = H*W;
   int HWk = Hker*Wker;
-  int HWo = Ho*Wo;
+  // Strides between channels and between pixels (CHW or HWC)
+  int inChStride = HWC ? 1 : H*W;
+  int outChStride = HWC ? 1 : Ho*Wo;
+  int pixStride = HWC ? C : 1;
+  // Argmax stored by the forward, if any
+  uint8_t * argmax8 = (HWk <= 256) ? (uint8_t *) args->argmax : NULL;
+  uint16_t * argmax16 = (HWk > 256) ? (uint16_t *) args->argmax : NULL;
+
+  // Parallelize over the C*H input rows: each core only writes its own rows, gathering the outputs whose maximum falls in them
+  const int blockSize = (C*H+NUM_CORES-1) / NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start+blockSize > C*H ? C*H : start+blockSize;
+
+  for (int row=start; row<stop; row++) {
+    int k = HWC ? row % C : row / H;
+    int h = HWC ? row / C : row % H;
+    float * inDiffRow = inDiff + k*inChStride + h*W*pixStride;
 
+    // Initialize gradient
+    for (int w=0; w<W; w++)   inDiffRow[w*pixStride] = 0;
+
+    int ho_start, ho_stop;
+    pool_output_range(h, Hker, Hstr, Upad, Ho, &ho_start, &ho_stop);
+    for (int ho=ho_start; ho<ho_stop; ho++) {
+      int h0 = ho*Hstr - Upad;
+      int hk_start, hk_stop;
+      pool_window_range(h0, Hker, H, &hk_start, &hk_stop);
+      for (int wo=0; wo<Wo; wo++) {
+        int w0 = wo*Wstr - Lpad;
+        int out_idx = k*outChStride + (wo + ho*Wo)*pixStride;
+        int maxidx;
+        if (argmax8 != NULL)        maxidx = argmax8[out_idx];
+        else if (argmax16 != NULL)  maxidx = argmax16[out_idx];
+        else {
+          int wk_start, wk_stop;
+          pool_window_range(w0, Wker, W, &wk_start, &wk_stop);
+          float max;
+          maxidx = pulp_maxpool_window_fp32(inData + k*inChStride, W, pixStride, h0, w0, hk_start, hk_stop, wk_start, wk_stop, Hker, Wker, &max);
+        }
+        if (h0 + maxidx/Wker == h)  inDiffRow[(w0 + maxidx%Wker)*pixStride] += outDiff[out_idx];
+      }
+    }
+  }
+}
+
+
+
+
+void pulp_gap_linear_fp32_fw_cl(void * gap_linear_args) {
+
+  struct gap_linear_args * args = (struct gap_linear_args *) gap_linear_args;
+  float * inData = args->input->data;
+  float * pooled = args->pooled->data;
+  float * coeffData = args->coeff->data;
+  float * outData = args->output->data;
+  int HW = args->input->H * args->input->W;
+  int C = args->input->C;
+  int Out = args->output->dim;
+  float invHW = 1.0f / HW;
+  // Strides between channels and between pixels (CHW or HWC)
+  int chStride = args->HWC ? 1 : HW;
+  int pixStride = args->HWC ? C : 1;
+
+  // Channel averages, parallelized over the channels
   const int blockSize = (C+NUM_CORES-1) / NUM_CORES;
   const int start = pi_core_id()*blockSize;
   const int stop = start+blockSize > C ? C : start+blockSize;
 
-  // Initialize gradient and mask
   for (int k=start; k<stop; k++) {
-    for (int hw=0; hw<HW; hw++) {
-      inDiff[k*HW+hw] = 0;
-    }
+    float * in = inData + k*chStride;
+    float sum = 0;
+    for (int hw=0; hw<HW; hw++)   sum += in[hw*pixStride];
+    pooled[k] = sum * invHW;
   }
+  pi_cl_team_barrier();
 
-  // Mask for the update
-  uint8_t maxmask[HWk];
-  uint32_t maxidx = 0;
+  // Fully-Connected layer, parallelized over the rows of the weights
+  const int outBlockSize = (Out+NUM_CORES-1) / NUM_CORES;
+  const int outStart = pi_core_id()*outBlockSize;
+  const int outStop = outStart+outBlockSize > Out ? Out : outStart+outBlockSize;
 
-  // Compute input gradient
-  for (int k=start; k<stop; k++) {
-    for (int ho=0; ho<Ho; ho++) {
-      for (int wo=0; wo<Wo; wo++) {
-        // Create local mask
-        float max = inData[wo*Wstr + ho*Hstr*W + k*HW];
-        maxidx = 0;
-        // Find maximum location and set mask
-        for (int hact=0; hact<Hker; hact++) {
-          for (int wact=0; wact<Wker; wact++) {
-            maxmask[wact+hact*Wker] = 0;
-            uint32_t  in_idx = wact + wo*Wstr + (hact + ho*Hstr)*W + k*HW;
-            float newData = inData[in_idx];
-            if (newData > max)  {
-              max = newData;
-              maxidx = wact + hact*Wker;
-            }          
-          }
-        }        
-        maxmask[maxidx] = 1;
-        // Update gradients
-        for (int hact=0; hact<Hker; hact++) {
-          for (int wact=0; wact<Wker; wact++) {
-            int in_idx = (wact+wo*Wstr) + (hact+ho*Hstr)*W + k*HW;
-            int out_idx = wo + ho*Wo + k*HWo;
-            inDiff[in_idx] += maxmask[wact+hact*Wker]*outDiff[out_idx];
-          }
-        }
-      }
+  for (int o=outStart; o<outStop; o++) {
+    float * w = coeffData + o*C;
+    float acc = 0;
+    for (int k=0; k<C; k++)   acc += w[k] * pooled[k];
+    outData[o] = acc;
+  }
+}
+
+void pulp_gap_linear_fp32_bw_cl(void * gap_linear_args) {
+
+  struct gap_linear_args * args = (struct gap_linear_args *) gap_linear_args;
+  float * inDiff = args->input->diff;
+  float * pooled = args->pooled->data;
+  float * coeffData = args->coeff->data;
+  float * coeffDiff = args->coeff->diff;
+  float * outDiff = args->output->diff;
+  int HW = args->input->H * args->input->W;
+  int C = args->input->C;
+  int Out = args->output->dim;
+  float invHW = 1.0f / HW;
+  // Strides between channels and between pixels (CHW or HWC)
+  int chStride = args->HWC ? 1 : HW;
+  int pixStride = args->HWC ? C : 1;
+
+  // Weight gradient (outer product of the output gradient and of the channel averages), parallelized over the rows
+  const int outBlockSize = (Out+NUM_CORES-1) / NUM_CORES;
+  const int outStart = pi_core_id()*outBlockSize;
+  const int outStop = outStart+outBlockSize > Out ? Out : outStart+outBlockSize;
+
+  for (int o=outStart; o<outStop; o++) {
+    float * wgtDiff = coeffDiff + o*C;
+    float grad = outDiff[o];
+    for (int k=0; k<C; k++)   wgtDiff[k] = grad * pooled[k];
+  }
+
+  if (args->skip_in_grad == 0) {
+    // Input gradient: each core computes the gradient of its channel averages and broadcasts it over the pixels of the channel
+    const int blockSize = (C+NUM_CORES-1) / NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > C ? C : start+blockSize;
+
+    for (int k=start; k<stop; k++) {
+      float grad = 0;
+      for (int o=0; o<Out; o++)   grad += coeffData[o*C+k] * outDiff[o];
+      grad = grad * invHW;
+      float * in = inDiff + k*chStride;
+      for (int hw=0; hw<HW; hw++)   in[hw*pixStride] = grad;
     }
   }
-}
\ No newline at end of file
+}
@@ -47,7 +47,7 @@ void pulp_residualconn_fp16_fw( void * SkipConn_args_fp16 )
     args_sum.dest = out->data;
     args_sum.size = out->dim;
 
-    pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &args_sum);
+    pulp_team_fork(NUM_CORES, vect_sum_fp16, &args_sum);
 }
 
 
@@ -77,7 +77,7 @@ void pulp_sumnode_fp16_bw( void * SkipConn_args_fp16 )
     args_sum.dest = skip->diff;
     args_sum.size = skip->dim;
 
-    pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &args_sum);
+    pulp_team_fork(NUM_CORES, vect_sum_fp16, &args_sum);
    }
 }
 
@@ -95,15 +95,183 @@ void pulp_residualconn_fp16_bw( void * SkipConn_args_fp16 )
 return;
     }
 
+    // Zero-copy: the gradient buffer is shared with the output
+    if (lout->diff == out->diff) return;
+
     // Copy gradient into the input
     struct copy_args_fp16 cpy_args;
     cpy_args.from = out->diff;
     //cpy_args.to = skip->diff;
     cpy_args.size = out->dim;
-    //pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);
+    //pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);
     cpy_args.to = lout->diff;
-    pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);
+    pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);
+}
+
+
+
+
+
+// FUSED AND MULTI-INPUT PRIMITIVES
+
+void pulp_residualconn_relu_fp16_fw( void * SkipConn_args )
+{
+    struct SkipConn_args_fp16 * args = (struct SkipConn_args_fp16 *) SkipConn_args;
+    struct blob_fp16 * inputs[2] = {args->skip, args->lout};
+
+    struct SumNode_args_fp16 sum_args;
+    sum_args.inputs = inputs;
+    sum_args.n_inputs = 2;
+    sum_args.output = args->output;
+    sum_args.relu = 1;
+    sum_args.accumulate = 0;
+
+    pulp_sumnode_multi_fp16_fw(&sum_args);
+}
+
+
+
+void pulp_residualconn_relu_fp16_bw( void * SkipConn_args )
+{
+    struct SkipConn_args_fp16 * args = (struct SkipConn_args_fp16 *) SkipConn_args;
+    struct blob_fp16 * inputs[1] = {args->lout};
+
+    struct SumNode_args_fp16 sum_args;
+    sum_args.inputs = inputs;
+    sum_args.n_inputs = 1;
+    sum_args.output = args->output;
+    sum_args.relu = 1;
+    sum_args.accumulate = 0;
+
+    pulp_sumnode_multi_fp16_bw(&sum_args);
+}
+
+
+
+static void sumnode_multi_fw_kernel_fp16( void * SumNode_args )
+{
+    struct SumNode_args_fp16 * args = (struct SumNode_args_fp16 *) SumNode_args;
+    struct blob_fp16 ** inputs = args->inputs;
+    int N = args->n_inputs;
+    int size = args->output->dim;
+    fp16 * dest = args->output->data;
+    v2f16 zero = (v2f16) {0, 0};
+
+    // Even blocks, so that each core works on aligned pairs
+    int blockSize = ((size+NUM_CORES-1) / NUM_CORES + 1) & ~0x1;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > size ? size : start+blockSize;
+    int stop_pairs = start + ((stop > start ? stop-start : 0) & ~0x1);
+
+    // First pair of inputs, ReLU fused if there are no other inputs
+    fp16 * op_1 = inputs[0]->data;
+    fp16 * op_2 = inputs[1]->data;
+    int relu_now = args->relu && N == 2;
+    for (int i=start; i<stop_pairs; i+=2) {
+        v2f16 temp = *((v2f16 *) &op_1[i]) + *((v2f16 *) &op_2[i]);
+        if (relu_now)   temp = (v2f16) ((v2s) temp & (v2s) (temp > zero));
+        *((v2f16 *) &dest[i]) = temp;
+    }
+    if (stop_pairs < stop) {
+        fp16 temp = op_1[stop-1] + op_2[stop-1];
+        dest[stop-1] = (relu_now && temp < 0) ? 0 : temp;
+    }
+
+    // Remaining inputs, ReLU fused with the last one
+    for (int n=2; n<N; n++) {
+        fp16 * op = inputs[n]->data;
+        relu_now = args->relu && n == N-1;
+        for (int i=start; i<stop_pairs; i+=2) {
+            v2f16 temp = *((v2f16 *) &dest[i]) + *((v2f16 *) &op[i]);
+            if (relu_now)   temp = (v2f16) ((v2s) temp & (v2s) (temp > zero));
+            *((v2f16 *) &dest[i]) = temp;
+        }
+        if (stop_pairs < stop) {
+            fp16 temp = dest[stop-1] + op[stop-1];
+            dest[stop-1] = (relu_now && temp < 0) ? 0 : temp;
+        }
+    }
+}
+
+
+
+static void sumnode_multi_bw_kernel_fp16( void * SumNode_args )
+{
+    struct SumNode_args_fp16 * args = (struct SumNode_args_fp16 *) SumNode_args;
+    struct blob_fp16 ** inputs = args->inputs;
+    int N = args->n_inputs;
+    int size = args->output->dim;
+    fp16 * outData = args->output->data;
+    fp16 * outDiff = args->output->diff;
+    v2f16 zero = (v2f16) {0, 0};
+
+    // Even blocks, so that each core works on aligned pairs
+    int blockSize = ((size+NUM_CORES-1) / NUM_CORES + 1) & ~0x1;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > size ? size : start+blockSize;
+    int stop_pairs = start + ((stop > start ? stop-start : 0) & ~0x1);
+
+    // Mask the output gradient in place, so that aliased inputs see the masked gradient
+    if (args->relu) {
+        for (int i=start; i<stop_pairs; i+=2) {
+            v2s mask = (v2s) (*((v2f16 *) &outData[i]) > zero);
+            *((v2f16 *) &outDiff[i]) = (v2f16) ((v2s) *((v2f16 *) &outDiff[i]) & mask);
+        }
+        if (stop_pairs < stop && outData[stop-1] <= 0)   outDiff[stop-1] = 0;
+    }
+
+    for (int n=0; n<N; n++) {
+        fp16 * inDiff = inputs[n]->diff;
+        if (inDiff == outDiff) continue;
+        if (args->accumulate) {
+            for (int i=start; i<stop_pairs; i+=2)
+                *((v2f16 *) &inDiff[i]) += *((v2f16 *) &outDiff[i]);
+            if (stop_pairs < stop)   inDiff[stop-1] += outDiff[stop-1];
+        }
+        else {
+            for (int i=start; i<stop_pairs; i+=2)
+                *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]);
+            if (stop_pairs < stop)   inDiff[stop-1] = outDiff[stop-1];
+        }
+    }
+}
+
+
+
+void pulp_sumnode_multi_fp16_fw( void * SumNode_args )
+{
+    struct SumNode_args_fp16 * args = (struct SumNode_args_fp16 *) SumNode_args;
+    struct blob_fp16 * out = args->output;
+
+    if (args->n_inputs < 2) {
+        printf("\n[pulp_sumnode_multi_fp16_fw]: At least 2 inputs are needed, got %d!!\n", args->n_inputs);
+        return;
+    }
+    for (int n=0; n<args->n_inputs; n++) {
+        if (args->inputs[n]->dim != out->dim) {
+            printf("\n[pulp_sumnode_multi_fp16_fw]: Sizes of input and output activations not matching!!");
+            printf("\ngot (NCHW) Input %d: %d,%d,%d,%d Out:%d,%d,%d,%d\n",n,args->inputs[n]->dim,args->inputs[n]->C,args->inputs[n]->H,args->inputs[n]->W,out->dim,out->C,out->H,out->W);
+            return;
+        }
+    }
+
+    pulp_team_fork(NUM_CORES, sumnode_multi_fw_kernel_fp16, args);
 }
 
 
 
+void pulp_sumnode_multi_fp16_bw( void * SumNode_args )
+{
+    struct SumNode_args_fp16 * args = (struct SumNode_args_fp16 *) SumNode_args;
+    struct blob_fp16 * out = args->output;
+
+    for (int n=0; n<args->n_inputs; n++) {
+        if (args->inputs[n]->dim != out->dim) {
+            printf("\n[pulp_sumnode_multi_fp16_bw]: Sizes of input and output activations not matching!!");
+            printf("\ngot (NCHW) Input %d: %d,%d,%d,%d Out:%d,%d,%d,%d\n",n,args->inputs[n]->dim,args->inputs[n]->C,args->inputs[n]->H,args->inputs[n]->W,out->dim,out->C,out->H,out->W);
+            return;
+        }
+    }
+
+    pulp_team_fork(NUM_CORES, sumnode_multi_bw_kernel_fp16, args);
+}
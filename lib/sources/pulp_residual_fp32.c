@@ -43,7 +43,7 @@ void pulp_residualconn_fp32_fw( void * SkipConn_args )
     args_sum.dest = out->data;
     args_sum.size = out->dim;
 
-    pi_cl_team_fork(NUM_CORES, vect_sum, &args_sum);
+    pulp_team_fork(NUM_CORES, vect_sum, &args_sum);
 
 }
 
@@ -76,7 +76,7 @@ void pulp_sumnode_fp32_bw( void * SkipConn_args )
     args_sum.dest = skip->diff;
     args_sum.size = skip->dim;
 
-    pi_cl_team_fork(NUM_CORES, vect_sum, &args_sum);
+    pulp_team_fork(NUM_CORES, vect_sum, &args_sum);
    }
 }
 
@@ -95,12 +95,168 @@ void pulp_residualconn_fp32_bw( void * SkipConn_args )
         printf("\ngot (NCHW)  Lout: %d,%d,%d,%d Out:%d,%d,%d,%d\n",lout->dim,lout->C,lout->H,lout->W,out->dim,out->C,out->H,out->W); return;
     }
 
+    // Zero-copy: the gradient buffer is shared with the output
+    if (lout->diff == out->diff) return;
+
     // Copy gradient into the input
     struct copy_args cpy_args;
     cpy_args.from = out->diff;
     //cpy_args.to = skip->diff;
     cpy_args.size = out->dim;
-    //pi_cl_team_fork(NUM_CORES, copy, &cpy_args);
+    //pulp_team_fork(NUM_CORES, copy, &cpy_args);
     cpy_args.to = lout->diff;
-    pi_cl_team_fork(NUM_CORES, copy, &cpy_args);
+    pulp_team_fork(NUM_CORES, copy, &cpy_args);
+}
+
+
+
+
+
+// FUSED AND MULTI-INPUT PRIMITIVES
+
+void pulp_residualconn_relu_fp32_fw( void * SkipConn_args )
+{
+    struct SkipConn_args * args = (struct SkipConn_args *) SkipConn_args;
+    struct blob * inputs[2] = {args->skip, args->lout};
+
+    struct SumNode_args sum_args;
+    sum_args.inputs = inputs;
+    sum_args.n_inputs = 2;
+    sum_args.output = args->output;
+    sum_args.relu = 1;
+    sum_args.accumulate = 0;
+
+    pulp_sumnode_multi_fp32_fw(&sum_args);
+}
+
+
+
+void pulp_residualconn_relu_fp32_bw( void * SkipConn_args )
+{
+    struct SkipConn_args * args = (struct SkipConn_args *) SkipConn_args;
+    struct blob * inputs[1] = {args->lout};
+
+    struct SumNode_args sum_args;
+    sum_args.inputs = inputs;
+    sum_args.n_inputs = 1;
+    sum_args.output = args->output;
+    sum_args.relu = 1;
+    sum_args.accumulate = 0;
+
+    pulp_sumnode_multi_fp32_bw(&sum_args);
+}
+
+
+
+static void sumnode_multi_fw_kernel_fp32( void * SumNode_args )
+{
+    struct SumNode_args * args = (struct SumNode_args *) SumNode_args;
+    struct blob ** inputs = args->inputs;
+    int N = args->n_inputs;
+    int size = args->output->dim;
+    float * dest = args->output->data;
+
+    int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > size ? size : start+blockSize;
+
+    // First pair of inputs, ReLU fused if there are no other inputs
+    float * op_1 = inputs[0]->data;
+    float * op_2 = inputs[1]->data;
+    if (args->relu && N == 2) {
+        for (int i=start; i<stop; i++) {
+            float temp = op_1[i] + op_2[i];
+            dest[i] = temp > 0.0f ? temp : 0.0f;
+        }
+    }
+    else {
+        for (int i=start; i<stop; i++)   dest[i] = op_1[i] + op_2[i];
+    }
+
+    // Remaining inputs, ReLU fused with the last one
+    for (int n=2; n<N; n++) {
+        float * op = inputs[n]->data;
+        if (args->relu && n == N-1) {
+            for (int i=start; i<stop; i++) {
+                float temp = dest[i] + op[i];
+                dest[i] = temp > 0.0f ? temp : 0.0f;
+            }
+        }
+        else {
+            for (int i=start; i<stop; i++)   dest[i] += op[i];
+        }
+    }
+}
+
+
+
+static void sumnode_multi_bw_kernel_fp32( void * SumNode_args )
+{
+    struct SumNode_args * args = (struct SumNode_args *) SumNode_args;
+    struct blob ** inputs = args->inputs;
+    int N = args->n_inputs;
+    int size = args->output->dim;
+    float * outData = args->output->data;
+    float * outDiff = args->output->diff;
+
+    int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > size ? size : start+blockSize;
+
+    // Mask the output gradient in place, so that aliased inputs see the masked gradient
+    if (args->relu) {
+        for (int i=start; i<stop; i++)
+            if (outData[i] <= 0.0f)   outDiff[i] = 0.0f;
+    }
+
+    for (int n=0; n<N; n++) {
+        float * inDiff = inputs[n]->diff;
+        if (inDiff == outDiff) continue;
+        if (args->accumulate) {
+            for (int i=start; i<stop; i++)   inDiff[i] += outDiff[i];
+        }
+        else {
+            for (int i=start; i<stop; i++)   inDiff[i] = outDiff[i];
+        }
+    }
+}
+
+
+
+void pulp_sumnode_multi_fp32_fw( void * SumNode_args )
+{
+    struct SumNode_args * args = (struct SumNode_args *) SumNode_args;
+    struct blob * out = args->output;
+
+    if (args->n_inputs < 2) {
+        printf("\n[pulp_sumnode_multi_fp32_fw]: At least 2 inputs are needed, got %d!!\n", args->n_inputs);
+        return;
+    }
+    for (int n=0; n<args->n_inputs; n++) {
+        if (args->inputs[n]->dim != out->dim) {
+            printf("\n[pulp_sumnode_multi_fp32_fw]: Sizes of input and output activations not matching!!");
+            printf("\ngot (NCHW) Input %d: %d,%d,%d,%d Out:%d,%d,%d,%d\n",n,args->inputs[n]->dim,args->inputs[n]->C,args->inputs[n]->H,args->inputs[n]->W,out->dim,out->C,out->H,out->W);
+            return;
+        }
+    }
+
+    pulp_team_fork(NUM_CORES, sumnode_multi_fw_kernel_fp32, args);
+}
+
+
+
+void pulp_sumnode_multi_fp32_bw( void * SumNode_args )
+{
+    struct SumNode_args * args = (struct SumNode_args *) SumNode_args;
+    struct blob * out = args->output;
+
+    for (int n=0; n<args->n_inputs; n++) {
+        if (args->inputs[n]->dim != out->dim) {
+            printf("\n[pulp_sumnode_multi_fp32_bw]: Sizes of input and output activations not matching!!");
+            printf("\ngot (NCHW) Input %d: %d,%d,%d,%d Out:%d,%d,%d,%d\n",n,args->inputs[n]->dim,args->inputs[n]->C,args->inputs[n]->H,args->inputs[n]->W,out->dim,out->C,out->H,out->W);
+            return;
+        }
+    }
+
+    pulp_team_fork(NUM_CORES, sumnode_multi_bw_kernel_fp32, args);
 }
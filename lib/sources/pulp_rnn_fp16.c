@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "pulp_train_utils_fp16.h"
+#include "pulp_rnn_fp16.h"
+#include "pulp_matmul_fp16.h"
+#include <math.h>
+
+
+//FULL-SEQUENCE FORWARD
+void pulp_rnn_seq_fp16_fw_cl(void * Rnn_seq_args_fp16)
+{
+    pulp_team_fork(NUM_CORES, rnn_seq_core_fw_fp16, Rnn_seq_args_fp16);
+}
+
+void rnn_seq_core_fw_fp16(void * Rnn_seq_args_fp16)
+{
+    struct Rnn_seq_args_fp16 *rnn_args = (struct Rnn_seq_args_fp16 *) Rnn_seq_args_fp16;
+    fp16 *coeffDataWx = rnn_args->coeff_x->data; // Input Weights
+    fp16 *coeffDataWs = rnn_args->coeff_s->data; // State Weights
+    fp16 *outData = rnn_args->output->data;      // Hidden states of all the timesteps
+    fp16 *inputData = rnn_args->input->data;
+    fp16 *stateData = rnn_args->state->data;     // Initial hidden state
+
+    int N = rnn_args->input->H; // Input/Output Sequence length
+    int K = rnn_args->input->W; // Input Sequence element length
+    int M = rnn_args->output->W; // Output Sequence element length
+
+    // Input projection of all the timesteps with a single matmul, straight into the output
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.A = inputData;
+    matMul_args1.B = coeffDataWx;
+    matMul_args1.C = outData;
+    matMul_args1.N = N;
+    matMul_args1.K = K;
+    matMul_args1.M = M;
+    matMul_args1.trans_B = 0;
+
+    mm_fp16(&matMul_args1);
+    pi_cl_team_barrier();
+
+    // Time loop: each core updates its own block of pairs of hidden units, overwriting the projection of the current timestep
+    const int n_pairs = (M+1)/2;
+    const int blockSize=(n_pairs+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        fp16 *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        fp16 *currState = outData + t*M;
+
+        for(int p=start; p<stop; p++){
+            int j = 2*p;
+            if(j+1 < M){
+                v2f16 acc = *((v2f16 *) &currState[j]);
+                for(int m=0; m<M; m++)
+                    acc += (v2f16) {prevState[m], prevState[m]} * *((v2f16 *) &coeffDataWs[m*M+j]);
+                currState[j] = tanhf(acc[0]);
+                currState[j+1] = tanhf(acc[1]);
+            }
+            else {
+                fp16 acc = currState[j];
+                for(int m=0; m<M; m++)
+                    acc += prevState[m] * coeffDataWs[m*M+j];
+                currState[j] = tanhf(acc);
+            }
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
+//FULL-SEQUENCE BACKWARD (BPTT)
+void pulp_rnn_seq_fp16_bw_cl(void * Rnn_seq_args_fp16)
+{
+    struct Rnn_seq_args_fp16 *rnn_args = (struct Rnn_seq_args_fp16 *) Rnn_seq_args_fp16;
+
+    int N = rnn_args->input->H; // Input sequence length
+    int window = (rnn_args->bptt_window > 0 && rnn_args->bptt_window < N) ? rnn_args->bptt_window : N;
+
+    struct Rnn_bptt_args_fp16 bptt_args;
+    bptt_args.rnn_args = rnn_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, rnn_seq_core_bw_fp16, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+// Dot product of two fp16 vectors, two elements at a time
+static inline fp16 rnn_dot_fp16(fp16 * a, fp16 * b, int dim)
+{
+    v2f16 acc = (v2f16) {0, 0};
+    int m = 0;
+    for(; m<dim-1; m+=2)
+        acc += *((v2f16 *) &a[m]) * *((v2f16 *) &b[m]);
+    fp16 res = acc[0] + acc[1];
+    if(dim & 1)
+        res += a[dim-1] * b[dim-1];
+    return res;
+}
+
+void rnn_seq_core_bw_fp16(void * Rnn_bptt_args_fp16)
+{
+    struct Rnn_bptt_args_fp16 *bptt_args = (struct Rnn_bptt_args_fp16 *) Rnn_bptt_args_fp16;
+    struct Rnn_seq_args_fp16 *rnn_args = bptt_args->rnn_args;
+
+    fp16 *coeffDataWx = rnn_args->coeff_x->data;
+    fp16 *coeffDataWs = rnn_args->coeff_s->data;
+    fp16 *coeffDiffWx = rnn_args->coeff_x->diff;
+    fp16 *coeffDiffWs = rnn_args->coeff_s->diff;
+    fp16 *inData = rnn_args->input->data;
+    fp16 *inDiff = rnn_args->input->diff;
+    fp16 *outData = rnn_args->output->data;
+    fp16 *outDiff = rnn_args->output->diff;
+    fp16 *stateData = rnn_args->state->data;
+    fp16 *stateDiff = rnn_args->state->diff;
+    fp16 *grad = rnn_args->grad_buffer; // Pre-activation gradients of the window
+
+    int K = rnn_args->input->W; // Input sequence element size
+    int M = rnn_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards: dPre_t = (1 - h_t^2) * (dL/dh_t + dPre_(t+1) * Ws^T), no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        fp16 *currState = outData + t*M;
+        fp16 *currDiff = outDiff + t*M;
+        fp16 *currGrad = grad + (t-t_start)*M;
+        fp16 *nextGrad = currGrad + M;
+
+        for(int j=start; j<stop; j++){
+            fp16 acc = currDiff[j];
+            if(t < t_stop-1)
+                acc += rnn_dot_fp16(nextGrad, coeffDataWs + j*M, M);
+            currGrad[j] = (1 - currState[j] * currState[j]) * acc;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial state
+    if(t_start == 0 && stateDiff != NULL){
+        for(int j=start; j<stop; j++)
+            stateDiff[j] = rnn_dot_fp16(grad, coeffDataWs + j*M, M);
+    }
+
+    // Weight gradients of the whole window: dWx = X^T * dPre and dWs = H_prev^T * dPre, parallelized over their K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        fp16 *wgtDiff = (r < K) ? coeffDiffWx + r*M : coeffDiffWs + (r-K)*M;
+        if(!bptt_args->accumulate)
+            for(int j=0; j<M; j++)
+                wgtDiff[j] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            fp16 a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            fp16 *currGrad = grad + (t-t_start)*M;
+            v2f16 av = (v2f16) {a, a};
+            int j = 0;
+            for(; j<M-1; j+=2)
+                *((v2f16 *) &wgtDiff[j]) += av * *((v2f16 *) &currGrad[j]);
+            if(M & 1)
+                wgtDiff[M-1] += a * currGrad[M-1];
+        }
+    }
+
+    // Input gradients of the window: dX = dPre * Wx^T
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.A = grad;
+    matMul_args1.B = coeffDataWx;
+    matMul_args1.C = inDiff + t_start*K;
+    matMul_args1.N = T;
+    matMul_args1.K = M;
+    matMul_args1.M = K;
+    matMul_args1.trans_B = 1;
+
+    mm_fp16(&matMul_args1);
+}
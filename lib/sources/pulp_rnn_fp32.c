@@ -13,6 +13,7 @@
 #include "pulp_matmul_fp32.h"
 #include "pulp_train_utils_fp32.h"
 #include "pulp_act_fp32.h"
+#include <math.h>
 
 
 //FORWARD
@@ -54,7 +55,7 @@ void pulp_rnn_fp32_fw_cl(void* Rnn_args)
     printf("\n");
     #endif
 
-    pi_cl_team_fork(NUM_CORES,  mm, &matMul_args1);
+    pulp_team_fork(NUM_CORES,  mm, &matMul_args1);
 
 
     #ifdef DEBUG
@@ -94,7 +95,7 @@ void pulp_rnn_fp32_fw_cl(void* Rnn_args)
     #endif
 
 
-    pi_cl_team_fork(NUM_CORES, mm_add, &matMul_args2);
+    pulp_team_fork(NUM_CORES, mm_add, &matMul_args2);
 
 
     #ifdef DEBUG
@@ -110,7 +111,7 @@ void pulp_rnn_fp32_fw_cl(void* Rnn_args)
     tanh_arg.dim = N*M;
     tanh_arg.output = matMul_args2.C;
 
-    pi_cl_team_fork(NUM_CORES, tanh_prll, &tanh_arg);
+    pulp_team_fork(NUM_CORES, tanh_prll, &tanh_arg);
 
 
     #ifdef DEBUG
@@ -134,6 +135,59 @@ void pulp_rnn_fp32_fw_cl(void* Rnn_args)
 
 
 
+//FULL-SEQUENCE FORWARD
+void pulp_rnn_seq_fp32_fw_cl(void * Rnn_seq_args)
+{
+    pulp_team_fork(NUM_CORES, rnn_seq_core_fw_fp32, Rnn_seq_args);
+}
+
+void rnn_seq_core_fw_fp32(void * Rnn_seq_args)
+{
+    struct Rnn_seq_args *rnn_args = (struct Rnn_seq_args *) Rnn_seq_args;
+    float *coeffDataWx = rnn_args->coeff_x->data; // Input Weights
+    float *coeffDataWs = rnn_args->coeff_s->data; // State Weights
+    float *outData = rnn_args->output->data;      // Hidden states of all the timesteps
+    float *inputData = rnn_args->input->data;
+    float *stateData = rnn_args->state->data;     // Initial hidden state
+
+    int N = rnn_args->input->H; // Input/Output Sequence length
+    int K = rnn_args->input->W; // Input Sequence element length
+    int M = rnn_args->output->W; // Output Sequence element length
+
+    // Input projection of all the timesteps with a single matmul, straight into the output
+    struct matMul_args matMul_args1;
+    matMul_args1.A = inputData;
+    matMul_args1.B = coeffDataWx;
+    matMul_args1.C = outData;
+    matMul_args1.N = N;
+    matMul_args1.K = K;
+    matMul_args1.M = M;
+    matMul_args1.trans_B = 0;
+
+    mm(&matMul_args1);
+    pi_cl_team_barrier();
+
+    // Time loop: each core updates its own block of hidden units, overwriting the projection of the current timestep
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    for(int t=0; t<N; t++){
+        float *prevState = (t == 0) ? stateData : outData + (t-1)*M;
+        float *currState = outData + t*M;
+
+        for(int j=start; j<stop; j++){
+            float acc = currState[j];
+            for(int m=0; m<M; m++)
+                acc += prevState[m] * coeffDataWs[m*M+j];
+            currState[j] = tanhf(acc);
+        }
+        pi_cl_team_barrier();
+    }
+}
+
+
+
 //BACKWARD
 void pulp_rnn_fp32_bw_cl(void * Rnn_args) 
 {
@@ -197,7 +251,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     transp_args1.N = N;
     transp_args1.M = K;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+    pulp_team_fork(NUM_CORES, transpose, &transp_args1);
 
 
     // matmul setup 1
@@ -228,7 +282,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     #endif
 
   
-    pi_cl_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args1);
+    pulp_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args1);
 
 
     #ifdef DEBUG
@@ -249,7 +303,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     transp_args2.N = N;
     transp_args2.M = M;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args2); 
+    pulp_team_fork(NUM_CORES, transpose, &transp_args2); 
 
 
     // matmul setup 2
@@ -262,7 +316,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     matMul_args2.M = M;
     matMul_args2.trans_B = 0;
   
-    pi_cl_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args2);
+    pulp_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args2);
 
 
 
@@ -302,7 +356,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     transp_args3.N = K;
     transp_args3.M = M;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args3); 
+    pulp_team_fork(NUM_CORES, transpose, &transp_args3); 
 
 
     // matmul setup 3
@@ -316,7 +370,7 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
     matMul_args3.trans_B = 0;
 
 
-    pi_cl_team_fork(NUM_CORES, mm_M_unroll_4x1, &matMul_args3);
+    pulp_team_fork(NUM_CORES, mm_M_unroll_4x1, &matMul_args3);
 
  
     #ifdef DEBUG
@@ -346,3 +400,112 @@ void pulp_rnn_fp32_bw_cl(void * Rnn_args)
 
 
 
+//FULL-SEQUENCE BACKWARD (BPTT)
+void pulp_rnn_seq_fp32_bw_cl(void * Rnn_seq_args)
+{
+    struct Rnn_seq_args *rnn_args = (struct Rnn_seq_args *) Rnn_seq_args;
+
+    int N = rnn_args->input->H; // Input sequence length
+    int window = (rnn_args->bptt_window > 0 && rnn_args->bptt_window < N) ? rnn_args->bptt_window : N;
+
+    struct Rnn_bptt_args bptt_args;
+    bptt_args.rnn_args = rnn_args;
+    bptt_args.accumulate = 0;
+
+    // Windows are independent: start from the last (possibly shorter) one, accumulating the weight gradients
+    for(int t_start=((N-1)/window)*window; t_start>=0; t_start-=window){
+        bptt_args.t_start = t_start;
+        bptt_args.t_stop = t_start + window > N ? N : t_start + window;
+        pulp_team_fork(NUM_CORES, rnn_seq_core_bw_fp32, &bptt_args);
+        bptt_args.accumulate = 1;
+    }
+}
+
+void rnn_seq_core_bw_fp32(void * Rnn_bptt_args)
+{
+    struct Rnn_bptt_args *bptt_args = (struct Rnn_bptt_args *) Rnn_bptt_args;
+    struct Rnn_seq_args *rnn_args = bptt_args->rnn_args;
+
+    float *coeffDataWx = rnn_args->coeff_x->data;
+    float *coeffDataWs = rnn_args->coeff_s->data;
+    float *coeffDiffWx = rnn_args->coeff_x->diff;
+    float *coeffDiffWs = rnn_args->coeff_s->diff;
+    float *inData = rnn_args->input->data;
+    float *inDiff = rnn_args->input->diff;
+    float *outData = rnn_args->output->data;
+    float *outDiff = rnn_args->output->diff;
+    float *stateData = rnn_args->state->data;
+    float *stateDiff = rnn_args->state->diff;
+    float *grad = rnn_args->grad_buffer; // Pre-activation gradients of the window
+
+    int K = rnn_args->input->W; // Input sequence element size
+    int M = rnn_args->output->W; // Output sequence element size
+    int t_start = bptt_args->t_start;
+    int t_stop = bptt_args->t_stop;
+    int T = t_stop - t_start;
+
+    const int blockSize=(M+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > M ? M : start+blockSize;
+
+    // Time loop backwards: dPre_t = (1 - h_t^2) * (dL/dh_t + dPre_(t+1) * Ws^T), no gradient enters from after the window
+    for(int t=t_stop-1; t>=t_start; t--){
+        float *currState = outData + t*M;
+        float *currDiff = outDiff + t*M;
+        float *currGrad = grad + (t-t_start)*M;
+        float *nextGrad = currGrad + M;
+
+        for(int j=start; j<stop; j++){
+            float acc = currDiff[j];
+            if(t < t_stop-1)
+                for(int m=0; m<M; m++)
+                    acc += nextGrad[m] * coeffDataWs[j*M+m];
+            currGrad[j] = (1 - currState[j] * currState[j]) * acc;
+        }
+        pi_cl_team_barrier();
+    }
+
+    // Gradient of the initial state
+    if(t_start == 0 && stateDiff != NULL){
+        for(int j=start; j<stop; j++){
+            float acc = 0;
+            for(int m=0; m<M; m++)
+                acc += grad[m] * coeffDataWs[j*M+m];
+            stateDiff[j] = acc;
+        }
+    }
+
+    // Weight gradients of the whole window: dWx = X^T * dPre and dWs = H_prev^T * dPre, parallelized over their K+M rows
+    const int rowBlockSize=(K+M+NUM_CORES-1)/NUM_CORES;
+    const int rowStart = pi_core_id()*rowBlockSize;
+    const int rowStop = rowStart + rowBlockSize > K+M ? K+M : rowStart+rowBlockSize;
+
+    for(int r=rowStart; r<rowStop; r++){
+        float *wgtDiff = (r < K) ? coeffDiffWx + r*M : coeffDiffWs + (r-K)*M;
+        if(!bptt_args->accumulate)
+            for(int j=0; j<M; j++)
+                wgtDiff[j] = 0;
+
+        for(int t=t_start; t<t_stop; t++){
+            float a;
+            if(r < K)           a = inData[t*K+r];
+            else if(t == 0)     a = stateData[r-K];
+            else                a = outData[(t-1)*M+r-K];
+            float *currGrad = grad + (t-t_start)*M;
+            for(int j=0; j<M; j++)
+                wgtDiff[j] += a * currGrad[j];
+        }
+    }
+
+    // Input gradients of the window: dX = dPre * Wx^T
+    struct matMul_args matMul_args1;
+    matMul_args1.A = grad;
+    matMul_args1.B = coeffDataWx;
+    matMul_args1.C = inDiff + t_start*K;
+    matMul_args1.N = T;
+    matMul_args1.K = M;
+    matMul_args1.M = K;
+    matMul_args1.trans_B = 1;
+
+    mm(&matMul_args1);
+}
@@ -185,11 +185,11 @@ void HWC_to_CHW_fp16 (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = H*W;
         tr_args.M = C;
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = data;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);
+        pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);
     }
 
     if (transpose_grad == 1) {
@@ -198,11 +198,11 @@ void HWC_to_CHW_fp16 (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = H*W;
         tr_args.M = C;
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = grad;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);    
+        pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);    
     }
 }
 
@@ -230,11 +230,11 @@ void CHW_to_HWC_fp16 (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = C;
         tr_args.M = H*W;
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = data;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);
+        pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);
     }
 
     if (transpose_grad == 1) {
@@ -243,11 +243,11 @@ void CHW_to_HWC_fp16 (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = C;
         tr_args.M = H*W;
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose_fp16, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = grad;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy_fp16, &cpy_args);    
+        pulp_team_fork(NUM_CORES, copy_fp16, &cpy_args);    
     }
 }
 
@@ -397,7 +397,7 @@ void pulp_exp_sum_fp16_cl(void* void_args){
     for(int i=start; i<stop; i++){
         sums[i] = 0;
         for(int j=0; j<dim; j++){
-            fp16 o = fastexp_gist(*input - maxes[i]);
+            fp16 o = fastexp_gist_fp16(*input - maxes[i]);
             //float o = expf(*input - maxes[i]);
             *output = o;
             sums[i] += o;
@@ -428,6 +428,90 @@ void pulp_row_div_fp16_cl(void* void_args){
     }
 }
 
+void pulp_online_softmax_fp16_cl(void* void_args){
+    struct online_softmax_args_fp16* args = (struct online_softmax_args_fp16 *) void_args;
+
+    fp16* input = args->input;
+    fp16* output = args->output;
+    fp16* maxes = args->maxes;
+    fp16* sums = args->sums;
+    int n_rows = args->n_rows;
+    int dim = args->dim;
+
+    const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+    for(int i=start; i<stop; i++){
+        fp16* in_row = input + i*dim;
+        fp16* out_row = output + i*dim;
+
+        // Single sweep: the running sum is rescaled each time a new max is found
+        fp16 max = -65504.0f;
+        fp16 sum = 0;
+        for(int j=0; j<dim; j++){
+            fp16 x = in_row[j];
+            if(x > max){
+                sum = sum * expf(max - x) + 1;
+                max = x;
+            }
+            else
+                sum += fastexp_gist_fp16(x - max);
+        }
+
+        // Normalize by multiplying with the reciprocal of the sum
+        fp16 inv_sum = 1 / sum;
+        for(int j=0; j<dim; j++)
+            out_row[j] = fastexp_gist_fp16(in_row[j] - max) * inv_sum;
+
+        maxes[i] = max;
+        sums[i] = sum;
+    }
+}
+
+fp16 fastexp_gist_fp16(fp16 x) {
+    float a = GIST_A_FP16 * (float) x + GIST_B_FP16;
+    a = (a < GIST_C_FP16) ? 0.0f : ((a > GIST_D_FP16) ? GIST_D_FP16 : a);
+
+    uint16_t n = (uint16_t) a;
+    return *(fp16*) &n;
+}
+
+v2f16 fastexp_gist_v2f16(v2f16 x) {
+    // The FP16 bit pattern needs 15 bits of integer precision, so the affine map is computed in FP32
+    float a = GIST_A_FP16 * (float) x[0] + GIST_B_FP16;
+    float b = GIST_A_FP16 * (float) x[1] + GIST_B_FP16;
+
+    a = (a < GIST_C_FP16) ? 0.0f : ((a > GIST_D_FP16) ? GIST_D_FP16 : a);
+    b = (b < GIST_C_FP16) ? 0.0f : ((b > GIST_D_FP16) ? GIST_D_FP16 : b);
+
+    uint32_t n = ((uint32_t) b << 16) | (uint32_t) a;
+    return *(v2f16*) &n;
+}
+
+v2f16 threshold_v2f16(v2f16 x) {
+    v2f16 r = (v2f16) {THR_C4_FP16, THR_C4_FP16} - (v2f16) {THR_C5_FP16, THR_C5_FP16} * x;
+    r = (v2f16) {-THR_C3_FP16, -THR_C3_FP16} + x * r;
+    r = (v2f16) {THR_C2_FP16, THR_C2_FP16} + x * r;
+    r = (v2f16) {-THR_C1_FP16, -THR_C1_FP16} + x * r;
+    r = (v2f16) {1.0f, 1.0f} + x * r;
+
+    if (x[0] >= THR_SAT_FP16) r[0] = 0.0f;
+    if (x[1] >= THR_SAT_FP16) r[1] = 0.0f;
+    return r;
+}
+
+v2f16 pow2_shift_v2f16(v2f16 x) {
+    int a = (int) x[0];
+    int b = (int) x[1];
+    a += ((fp16) a < x[0]);
+    b += ((fp16) b < x[1]);
+
+    // 1/2^n has a zero mantissa and exponent 15-n, flushed to zero below the normal range
+    uint32_t n = ((b < 15) ? (uint32_t) (15 - b) << 26 : 0) | ((a < 15) ? (uint32_t) (15 - a) << 10 : 0);
+    return *(v2f16*) &n;
+}
+
 void pulp_div_fp16_cl(void* void_args){
     struct div_args_fp16* args = (struct div_args_fp16 *) void_args;
 
@@ -697,6 +781,79 @@ void mm_manager_fp16 (void * void_args)
 
 
 
+void fused_update_tile_fp16 (void * fused_update_tile_args)
+{
+  struct fused_update_tile_args_fp16 * args = (struct fused_update_tile_args_fp16 *) fused_update_tile_args;
+  struct fused_update_args_fp16 * update = args->update;
+  fp16 * __restrict__ weights = args->weights + args->offset;
+  fp16 * __restrict__ grad = update->buffer;
+  float lr = update->learning_rate;
+  float mu = update->momentum;
+
+  int blockSize = (args->size+NUM_CORES-1) / NUM_CORES;
+  int start = pi_core_id()*blockSize;
+  int stop = start+blockSize > args->size ? args->size : start+blockSize;
+
+  if (mu == 0.0f) {
+    for (int i=start; i<stop; i++)  weights[i] = (fp16) ((float) weights[i] - lr * (float) grad[i]);
+  }
+  else {
+    float * __restrict__ velocity = update->velocity + args->offset;
+    for (int i=start; i<stop; i++) {
+      float v = mu * velocity[i] + (float) grad[i];
+      velocity[i] = v;
+      weights[i] = (fp16) ((float) weights[i] - lr * v);
+    }
+  }
+}
+
+
+
+void mm_fused_update_fp16 (struct matMul_args_fp16 * mm_args, struct fused_update_args_fp16 * update, fp16 * weights, int layer_type, int matmul_type)
+{
+  int N = mm_args->N;
+  int M = mm_args->M;
+  int K = mm_args->K;
+  // Rows of the weight gradient fitting the scratch buffer
+  int tile_rows = update->buffer_size / M;
+  if (tile_rows < 1) {
+    printf("\n[mm_fused_update_fp16]: Scratch buffer too small for one row of the weight gradient (%d < %d elements)!!\n", update->buffer_size, M);
+    return;
+  }
+
+  struct matMul_args_fp16 tile_args = *mm_args;
+  tile_args.C = update->buffer;
+
+  struct fused_update_tile_args_fp16 upd_args;
+  upd_args.update = update;
+  upd_args.weights = weights;
+
+  for (int row=0; row<N; row+=tile_rows) {
+    int rows = N-row < tile_rows ? N-row : tile_rows;
+    // The rows of the weight gradient only depend on the same rows of A
+    tile_args.A = mm_args->A + row*K;
+    tile_args.N = rows;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES, mm_fp16, &tile_args);
+    #else
+    struct mm_manager_args_fp16 man_args;
+    man_args.mm_args = &tile_args;
+    man_args.layer_type = layer_type;
+    man_args.step_type = STEP_WGT_GRAD;
+    man_args.matmul_type = matmul_type;
+    pulp_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    #endif
+
+    upd_args.offset = row*M;
+    upd_args.size = rows*M;
+    pulp_team_fork(NUM_CORES, fused_update_tile_fp16, &upd_args);
+  }
+}
+
+
+
+
 // FP16 dot product in floating point
 inline fp16 vfdotp(v2f16 a, v2f16 b) {
   fp16 result;
@@ -759,4 +916,231 @@ void pulp_mean_std_fp16_cl(void * mean_std_args)
         *mean = m;
         *var = v;
         *std = (fp16)sqrtf(v);
-}
\ No newline at end of file
+}
+
+
+
+// CLUSTER-WIDE REDUCTIONS
+
+float pulp_team_sum_fp16 (float value, float * partials)
+{
+    int id = pi_core_id();
+    partials[id] = value;
+    pi_cl_team_barrier();
+
+    // Tree combine: at each level, a core merges the partial of the core at distance stride
+    for (int stride=1; stride<NUM_CORES; stride*=2) 
+    {
+        if ((id % (2*stride)) == 0 && id+stride < NUM_CORES)  partials[id] += partials[id+stride];
+        pi_cl_team_barrier();
+    }
+
+    // The buffer can be reused only after all the cores read the result
+    float result = partials[0];
+    pi_cl_team_barrier();
+    return result;
+}
+
+
+float pulp_team_max_fp16 (float value, float * partials)
+{
+    int id = pi_core_id();
+    partials[id] = value;
+    pi_cl_team_barrier();
+
+    for (int stride=1; stride<NUM_CORES; stride*=2) 
+    {
+        if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && partials[id+stride] > partials[id])  partials[id] = partials[id+stride];
+        pi_cl_team_barrier();
+    }
+
+    float result = partials[0];
+    pi_cl_team_barrier();
+    return result;
+}
+
+
+void pulp_reduce_parallelized_fp16_cl (void * reduce_args_fp16)
+{
+    struct reduce_args_fp16 * args = (struct reduce_args_fp16 *) reduce_args_fp16;
+    fp16 * input = args->input;
+    int dim = args->dim;
+    int op = args->op;
+    int id = pi_core_id();
+    float * p0 = args->partials;
+    float * p1 = args->partials + NUM_CORES;
+    float * p2 = args->partials + 2*NUM_CORES;
+
+    // Per-core reduction of the slice of the tensor (even start, for the v2f16 loads)
+    int blockSize = (((dim+NUM_CORES-1) / NUM_CORES) + 1) & ~1;
+    int start = id*blockSize;
+    int stop = start+blockSize > dim ? dim : start+blockSize;
+    if (start > dim)  start = dim;
+
+    if (op == REDUCE_SUM) 
+    {
+        float acc = 0.0f;
+        int i = start;
+        while (i+1 < stop) 
+        {
+            // Short v2f16 accumulations, flushed to FP32
+            v2f16 vacc = (v2f16) {0, 0};
+            int chunk_stop = i+2*REDUCE_FP16_CHUNK < stop ? i+2*REDUCE_FP16_CHUNK : stop;
+            for (; i+1<chunk_stop; i+=2)  vacc += *((v2f16 *) &input[i]);
+            acc += (float) vacc[0] + (float) vacc[1];
+        }
+        if (i < stop)  acc += (float) input[i];
+        acc = pulp_team_sum_fp16(acc, p0);
+        if (id == 0)  *(args->result) = acc;
+    }
+    else if (op == REDUCE_SUMSQ) 
+    {
+        float acc = 0.0f;
+        for (int i=start; i<stop; i++)  acc += (float) input[i] * (float) input[i];
+        acc = pulp_team_sum_fp16(acc, p0);
+        if (id == 0)  *(args->result) = acc;
+    }
+    else if (op == REDUCE_MAX) 
+    {
+        float max = -INFINITY;
+        int i = start;
+        if (i+1 < stop) 
+        {
+            v2f16 vmax = *((v2f16 *) &input[i]);
+            for (i+=2; i+1<stop; i+=2) 
+            {
+                v2f16 x = *((v2f16 *) &input[i]);
+                // Lane-wise select of the new maxima
+                v2s mask = (v2s) (x > vmax);
+                vmax = (v2f16) (((v2s) x & mask) | ((v2s) vmax & ~mask));
+            }
+            max = (float) vmax[0] > (float) vmax[1] ? (float) vmax[0] : (float) vmax[1];
+        }
+        if (i < stop && (float) input[i] > max)  max = (float) input[i];
+        max = pulp_team_max_fp16(max, p0);
+        if (id == 0)  *(args->result) = max;
+    }
+    else if (op == REDUCE_ARGMAX) 
+    {
+        // Strict comparisons keep the first occurrence of the max, also in the combine (lower cores first)
+        float max = -INFINITY;
+        int idx = -1;
+        for (int i=start; i<stop; i++)  if ((float) input[i] > max)  { max = (float) input[i];  idx = i; }
+        p0[id] = max;
+        p1[id] = (float) idx;   // exact up to 2^24 elements
+        pi_cl_team_barrier();
+        for (int stride=1; stride<NUM_CORES; stride*=2) 
+        {
+            if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && p0[id+stride] > p0[id]) 
+            {
+                p0[id] = p0[id+stride];
+                p1[id] = p1[id+stride];
+            }
+            pi_cl_team_barrier();
+        }
+        if (id == 0) 
+        {
+            *(args->result) = p0[0];
+            if (args->index != NULL)  *(args->index) = (int) p1[0];
+        }
+    }
+    else if (op == REDUCE_MEAN_VAR) 
+    {
+        // Per-core count, mean and sum of squared deviations, merged with Chan's parallel formula
+        // (the data is shifted by its first element, to avoid cancellations when the mean is large wrt the deviation)
+        float n = (float) (stop - start);
+        float shift = n > 0.0f ? (float) input[start] : 0.0f;
+        float sum = 0.0f;
+        float sumsq = 0.0f;
+        for (int i=start; i<stop; i++) 
+        {
+            float x = (float) input[i] - shift;
+            sum += x;
+            sumsq += x * x;
+        }
+        float mean = n > 0.0f ? sum / n : 0.0f;
+        p0[id] = n;
+        p1[id] = shift + mean;
+        p2[id] = sumsq - sum * mean;
+        pi_cl_team_barrier();
+        for (int stride=1; stride<NUM_CORES; stride*=2) 
+        {
+            if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && p0[id+stride] > 0.0f) 
+            {
+                float na = p0[id];
+                float nb = p0[id+stride];
+                float delta = p1[id+stride] - p1[id];
+                float n_ab = na + nb;
+                p0[id] = n_ab;
+                p1[id] += delta * nb / n_ab;
+                p2[id] += p2[id+stride] + delta * delta * na * nb / n_ab;
+            }
+            pi_cl_team_barrier();
+        }
+        if (id == 0) 
+        {
+            *(args->result) = p1[0];
+            if (args->var != NULL)  *(args->var) = p2[0] / (float) dim;
+        }
+    }
+
+    // Results visible to all the cores
+    pi_cl_team_barrier();
+}
+
+
+void pulp_reduce_fp16_cl (void * reduce_args_fp16)
+{
+    pulp_team_fork(NUM_CORES, pulp_reduce_parallelized_fp16_cl, reduce_args_fp16);
+}
+
+
+
+// PERSISTENT CLUSTER TEAM
+
+// Weak definitions: pulp_train_utils_fp32.c and pulp_train_utils_fp16.c both define them, so that a single copy is linked in mixed FP32/FP16 builds
+PI_L1 int pulp_team_active __attribute__((weak)) = 0;
+// Slot used by core 0 to publish a buffer to the other cores of the team
+PI_L1 static void * team_shared_ptr;
+
+__attribute__((weak)) void pulp_team_fork (int nb_cores, void (*fn)(void *), void * args)
+{
+    if (!pulp_team_active) 
+    {
+        pi_cl_team_fork(nb_cores, fn, args);
+        return;
+    }
+
+    // The barriers inside fn involve the whole team: a stage on part of the team would deadlock on them
+    if (nb_cores != NUM_CORES) {
+        if (pi_core_id() == 0)  printf("\n[pulp_team_fork]: Inside pulp_team_run, the stages must run on all the cores (NUM_CORES = %d), got nb_cores = %d!!\n", NUM_CORES, nb_cores);
+        return;
+    }
+
+    // The serial code between two stages is executed by all the cores: wait for it before starting the stage
+    pi_cl_team_barrier();
+    fn(args);
+    // Results of the stage visible to all the cores
+    pi_cl_team_barrier();
+}
+
+
+__attribute__((weak)) void pulp_team_run (void (*step)(void *), void * args)
+{
+    pulp_team_active = 1;
+    pi_cl_team_fork(NUM_CORES, step, args);
+    pulp_team_active = 0;
+}
+
+
+__attribute__((weak)) void * pulp_team_share (void * ptr)
+{
+    if (!pulp_team_active)  return ptr;
+
+    if (pi_core_id() == 0)  team_shared_ptr = ptr;
+    pi_cl_team_barrier();
+    void * shared = team_shared_ptr;
+    // The slot can be reused only after all the cores read it
+    pi_cl_team_barrier();
+    return shared;
+}
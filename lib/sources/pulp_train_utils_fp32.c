@@ -162,11 +162,11 @@ void HWC_to_CHW (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = H*W;
         tr_args.M = C;
-        pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = data;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy, &cpy_args);
+        pulp_team_fork(NUM_CORES, copy, &cpy_args);
     }
 
     if (transpose_grad == 1) {
@@ -175,11 +175,11 @@ void HWC_to_CHW (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = H*W;
         tr_args.M = C;
-        pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = grad;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy, &cpy_args);    
+        pulp_team_fork(NUM_CORES, copy, &cpy_args);    
     }
 }
 
@@ -207,11 +207,11 @@ void CHW_to_HWC (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = C;
         tr_args.M = H*W;
-        pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = data;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy, &cpy_args);
+        pulp_team_fork(NUM_CORES, copy, &cpy_args);
     }
 
     if (transpose_grad == 1)  {
@@ -220,11 +220,11 @@ void CHW_to_HWC (void * layout_args)
         tr_args.transp_matrix = buff;
         tr_args.N = C;
         tr_args.M = H*W;
-        pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+        pulp_team_fork(NUM_CORES, transpose, &tr_args);
         cpy_args.from = buff;
         cpy_args.to = grad;
         cpy_args.size = C*H*W;
-        pi_cl_team_fork(NUM_CORES, copy, &cpy_args);    
+        pulp_team_fork(NUM_CORES, copy, &cpy_args);    
     }
 }
 
@@ -481,6 +481,49 @@ void pulp_row_div_fp32_cl(void* void_args){
     }
 }
 
+void pulp_online_softmax_fp32_cl(void* void_args){
+    struct online_softmax_args* args = (struct online_softmax_args *) void_args;
+
+    float* input = args->input;
+    float* output = args->output;
+    float* maxes = args->maxes;
+    float* sums = args->sums;
+    float* lse = args->lse;
+    int n_rows = args->n_rows;
+    int dim = args->dim;
+
+    const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+    for(int i=start; i<stop; i++){
+        float* in_row = input + i*dim;
+        float* out_row = output + i*dim;
+
+        // Single sweep: the running sum is rescaled each time a new max is found
+        float max = -340282346638528859811704183484516925440.0f;
+        float sum = 0.0f;
+        for(int j=0; j<dim; j++){
+            float x = in_row[j];
+            if(x > max){
+                sum = sum * expf(max - x) + 1.0f;
+                max = x;
+            }
+            else
+                sum += fastexp_gist(x - max);
+        }
+
+        // Normalize by multiplying with the reciprocal of the sum
+        float inv_sum = 1.0f / sum;
+        for(int j=0; j<dim; j++)
+            out_row[j] = fastexp_gist(in_row[j] - max) * inv_sum;
+
+        maxes[i] = max;
+        sums[i] = sum;
+        if (lse != NULL) lse[i] = max + logf(sum);
+    }
+}
+
 void pulp_scalar_mul_fp32_cl(void* void_args){
     struct scalar_mul_args* args = (struct scalar_mul_args *) void_args;
 
@@ -893,6 +936,79 @@ void mm_manager (void * void_args)
 
 }
 
+
+
+
+void fused_update_tile (void * fused_update_tile_args)
+{
+  struct fused_update_tile_args * args = (struct fused_update_tile_args *) fused_update_tile_args;
+  struct fused_update_args * update = args->update;
+  float * __restrict__ weights = args->weights + args->offset;
+  float * __restrict__ grad = update->buffer;
+  float lr = update->learning_rate;
+  float mu = update->momentum;
+
+  int blockSize = (args->size+NUM_CORES-1) / NUM_CORES;
+  int start = pi_core_id()*blockSize;
+  int stop = start+blockSize > args->size ? args->size : start+blockSize;
+
+  if (mu == 0.0f) {
+    for (int i=start; i<stop; i++)  weights[i] -= lr * grad[i];
+  }
+  else {
+    float * __restrict__ velocity = update->velocity + args->offset;
+    for (int i=start; i<stop; i++) {
+      float v = mu * velocity[i] + grad[i];
+      velocity[i] = v;
+      weights[i] -= lr * v;
+    }
+  }
+}
+
+
+
+void mm_fused_update (struct matMul_args * mm_args, struct fused_update_args * update, float * weights, int layer_type, int matmul_type)
+{
+  int N = mm_args->N;
+  int M = mm_args->M;
+  int K = mm_args->K;
+  // Rows of the weight gradient fitting the scratch buffer
+  int tile_rows = update->buffer_size / M;
+  if (tile_rows < 1) {
+    printf("\n[mm_fused_update]: Scratch buffer too small for one row of the weight gradient (%d < %d elements)!!\n", update->buffer_size, M);
+    return;
+  }
+
+  struct matMul_args tile_args = *mm_args;
+  tile_args.C = update->buffer;
+
+  struct fused_update_tile_args upd_args;
+  upd_args.update = update;
+  upd_args.weights = weights;
+
+  for (int row=0; row<N; row+=tile_rows) {
+    int rows = N-row < tile_rows ? N-row : tile_rows;
+    // The rows of the weight gradient only depend on the same rows of A
+    tile_args.A = mm_args->A + row*K;
+    tile_args.N = rows;
+
+    #ifndef OPTIMIZE
+    pulp_team_fork(NUM_CORES, mm, &tile_args);
+    #else
+    struct mm_manager_args man_args;
+    man_args.mm_args = &tile_args;
+    man_args.layer_type = layer_type;
+    man_args.step_type = STEP_WGT_GRAD;
+    man_args.matmul_type = matmul_type;
+    pulp_team_fork(NUM_CORES, mm_manager, &man_args);
+    #endif
+
+    upd_args.offset = row*M;
+    upd_args.size = rows*M;
+    pulp_team_fork(NUM_CORES, fused_update_tile, &upd_args);
+  }
+}
+
 void pulp_mean_std_fp32_cl(void * mean_std_args)
 {
     struct mean_std_args * args = (struct mean_std_args *) mean_std_args;
@@ -942,3 +1058,200 @@ void pulp_mean_std_fp32_cl(void * mean_std_args)
 }
 
 
+
+// CLUSTER-WIDE REDUCTIONS
+
+float pulp_team_sum (float value, float * partials)
+{
+    int id = pi_core_id();
+    partials[id] = value;
+    pi_cl_team_barrier();
+
+    // Tree combine: at each level, a core merges the partial of the core at distance stride
+    for (int stride=1; stride<NUM_CORES; stride*=2) 
+    {
+        if ((id % (2*stride)) == 0 && id+stride < NUM_CORES)  partials[id] += partials[id+stride];
+        pi_cl_team_barrier();
+    }
+
+    // The buffer can be reused only after all the cores read the result
+    float result = partials[0];
+    pi_cl_team_barrier();
+    return result;
+}
+
+
+float pulp_team_max (float value, float * partials)
+{
+    int id = pi_core_id();
+    partials[id] = value;
+    pi_cl_team_barrier();
+
+    for (int stride=1; stride<NUM_CORES; stride*=2) 
+    {
+        if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && partials[id+stride] > partials[id])  partials[id] = partials[id+stride];
+        pi_cl_team_barrier();
+    }
+
+    float result = partials[0];
+    pi_cl_team_barrier();
+    return result;
+}
+
+
+void pulp_reduce_parallelized_cl (void * reduce_args)
+{
+    struct reduce_args * args = (struct reduce_args *) reduce_args;
+    float * input = args->input;
+    int dim = args->dim;
+    int op = args->op;
+    int id = pi_core_id();
+    float * p0 = args->partials;
+    float * p1 = args->partials + NUM_CORES;
+    float * p2 = args->partials + 2*NUM_CORES;
+
+    // Per-core reduction of the slice of the tensor
+    int blockSize = (dim+NUM_CORES-1) / NUM_CORES;
+    int start = id*blockSize;
+    int stop = start+blockSize > dim ? dim : start+blockSize;
+    if (start > dim)  start = dim;
+
+    if (op == REDUCE_SUM || op == REDUCE_SUMSQ) 
+    {
+        float acc = 0.0f;
+        if (op == REDUCE_SUM)   for (int i=start; i<stop; i++)  acc += input[i];
+        else                    for (int i=start; i<stop; i++)  acc += input[i] * input[i];
+        acc = pulp_team_sum(acc, p0);
+        if (id == 0)  *(args->result) = acc;
+    }
+    else if (op == REDUCE_MAX) 
+    {
+        float max = -INFINITY;
+        for (int i=start; i<stop; i++)  if (input[i] > max)  max = input[i];
+        max = pulp_team_max(max, p0);
+        if (id == 0)  *(args->result) = max;
+    }
+    else if (op == REDUCE_ARGMAX) 
+    {
+        // Strict comparisons keep the first occurrence of the max, also in the combine (lower cores first)
+        float max = -INFINITY;
+        int idx = -1;
+        for (int i=start; i<stop; i++)  if (input[i] > max)  { max = input[i];  idx = i; }
+        p0[id] = max;
+        p1[id] = (float) idx;   // exact up to 2^24 elements
+        pi_cl_team_barrier();
+        for (int stride=1; stride<NUM_CORES; stride*=2) 
+        {
+            if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && p0[id+stride] > p0[id]) 
+            {
+                p0[id] = p0[id+stride];
+                p1[id] = p1[id+stride];
+            }
+            pi_cl_team_barrier();
+        }
+        if (id == 0) 
+        {
+            *(args->result) = p0[0];
+            if (args->index != NULL)  *(args->index) = (int) p1[0];
+        }
+    }
+    else if (op == REDUCE_MEAN_VAR) 
+    {
+        // Per-core count, mean and sum of squared deviations, merged with Chan's parallel formula
+        // (the data is shifted by its first element, to avoid cancellations when the mean is large wrt the deviation)
+        float n = (float) (stop - start);
+        float shift = n > 0.0f ? input[start] : 0.0f;
+        float sum = 0.0f;
+        float sumsq = 0.0f;
+        for (int i=start; i<stop; i++) 
+        {
+            float x = input[i] - shift;
+            sum += x;
+            sumsq += x * x;
+        }
+        float mean = n > 0.0f ? sum / n : 0.0f;
+        p0[id] = n;
+        p1[id] = shift + mean;
+        p2[id] = sumsq - sum * mean;
+        pi_cl_team_barrier();
+        for (int stride=1; stride<NUM_CORES; stride*=2) 
+        {
+            if ((id % (2*stride)) == 0 && id+stride < NUM_CORES && p0[id+stride] > 0.0f) 
+            {
+                float na = p0[id];
+                float nb = p0[id+stride];
+                float delta = p1[id+stride] - p1[id];
+                float n_ab = na + nb;
+                p0[id] = n_ab;
+                p1[id] += delta * nb / n_ab;
+                p2[id] += p2[id+stride] + delta * delta * na * nb / n_ab;
+            }
+            pi_cl_team_barrier();
+        }
+        if (id == 0) 
+        {
+            *(args->result) = p1[0];
+            if (args->var != NULL)  *(args->var) = p2[0] / (float) dim;
+        }
+    }
+
+    // Results visible to all the cores
+    pi_cl_team_barrier();
+}
+
+
+void pulp_reduce_cl (void * reduce_args)
+{
+    pulp_team_fork(NUM_CORES, pulp_reduce_parallelized_cl, reduce_args);
+}
+
+
+
+// PERSISTENT CLUSTER TEAM
+
+// Weak definitions: pulp_train_utils_fp32.c and pulp_train_utils_fp16.c both define them, so that a single copy is linked in mixed FP32/FP16 builds
+PI_L1 int pulp_team_active __attribute__((weak)) = 0;
+// Slot used by core 0 to publish a buffer to the other cores of the team
+PI_L1 static void * team_shared_ptr;
+
+__attribute__((weak)) void pulp_team_fork (int nb_cores, void (*fn)(void *), void * args)
+{
+    if (!pulp_team_active) 
+    {
+        pi_cl_team_fork(nb_cores, fn, args);
+        return;
+    }
+
+    // The barriers inside fn involve the whole team: a stage on part of the team would deadlock on them
+    if (nb_cores != NUM_CORES) {
+        if (pi_core_id() == 0)  printf("\n[pulp_team_fork]: Inside pulp_team_run, the stages must run on all the cores (NUM_CORES = %d), got nb_cores = %d!!\n", NUM_CORES, nb_cores);
+        return;
+    }
+
+    // The serial code between two stages is executed by all the cores: wait for it before starting the stage
+    pi_cl_team_barrier();
+    fn(args);
+    // Results of the stage visible to all the cores
+    pi_cl_team_barrier();
+}
+
+
+__attribute__((weak)) void pulp_team_run (void (*step)(void *), void * args)
+{
+    pulp_team_active = 1;
+    pi_cl_team_fork(NUM_CORES, step, args);
+    pulp_team_active = 0;
+}
+
+
+__attribute__((weak)) void * pulp_team_share (void * ptr)
+{
+    if (!pulp_team_active)  return ptr;
+
+    if (pi_core_id() == 0)  team_shared_ptr = ptr;
+    pi_cl_team_barrier();
+    void * shared = team_shared_ptr;
+    // The slot can be reused only after all the cores read it
+    pi_cl_team_barrier();
+    return shared;
+}
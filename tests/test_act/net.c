@@ -25,6 +25,8 @@
 #if DATA_TYPE == FP32
 // Inout data
 PI_L1 struct act_args act_args;
+PI_L1 struct act_approx_args act_approx_args;
+PI_L1 struct leakyrelu_args leakyrelu_args;
 
 PI_L1 struct blob reluin_blob;
 PI_L1 struct blob reluout_blob;
@@ -34,9 +36,13 @@ PI_L1 float reluin_grad[IN_SIZE];
 
 PI_L1 struct blob softmin_blob;
 PI_L1 struct blob softmout_blob;
-PI_L1 float softmout[OUT_SIZE];
-PI_L1 float softmout_grad[OUT_SIZE];
-PI_L1 float softmin_grad[IN_SIZE];
+PI_L1 struct softmax_args softmax_args;
+PI_L1 struct softmax_bw_args softmax_bw_args;
+PI_L1 float softmout[SOFTM_SIZE];
+PI_L1 float softmout_grad[SOFTM_SIZE];
+PI_L1 float softmin_grad[SOFTM_SIZE];
+PI_L1 float softm_maxes[SOFTM_L];
+PI_L1 float softm_sums[SOFTM_L];
 
 PI_L1 struct blob sigmoidin_blob;
 PI_L1 struct blob sigmoidout_blob;
@@ -44,9 +50,35 @@ PI_L1 float sigmoidout[OUT_SIZE];
 PI_L1 float sigmoidout_grad[OUT_SIZE];
 PI_L1 float sigmoidin_grad[IN_SIZE];
 
+PI_L1 struct blob geluin_blob;
+PI_L1 struct blob geluout_blob;
+PI_L1 float geluout[OUT_SIZE];
+PI_L1 float geluout_grad[OUT_SIZE];
+PI_L1 float geluin_grad[IN_SIZE];
+
+PI_L1 struct blob siluin_blob;
+PI_L1 struct blob siluout_blob;
+PI_L1 float siluout[OUT_SIZE];
+PI_L1 float siluout_grad[OUT_SIZE];
+PI_L1 float siluin_grad[IN_SIZE];
+
+PI_L1 struct blob lreluin_blob;
+PI_L1 struct blob lreluout_blob;
+PI_L1 float lreluout[OUT_SIZE];
+PI_L1 float lreluout_grad[OUT_SIZE];
+PI_L1 float lreluin_grad[IN_SIZE];
+
+PI_L1 struct blob hswishin_blob;
+PI_L1 struct blob hswishout_blob;
+PI_L1 float hswishout[OUT_SIZE];
+PI_L1 float hswishout_grad[OUT_SIZE];
+PI_L1 float hswishin_grad[IN_SIZE];
+
 #elif DATA_TYPE == FP16
 // Inout data
 PI_L1 struct act_args_fp16 act_args;
+PI_L1 struct act_approx_args_fp16 act_approx_args;
+PI_L1 struct leakyrelu_args_fp16 leakyrelu_args;
 
 PI_L1 struct blob_fp16 reluin_blob;
 PI_L1 struct blob_fp16 reluout_blob;
@@ -56,9 +88,13 @@ PI_L1 fp16 reluin_grad[IN_SIZE];
 
 PI_L1 struct blob_fp16 softmin_blob;
 PI_L1 struct blob_fp16 softmout_blob;
-PI_L1 fp16 softmout[OUT_SIZE];
-PI_L1 fp16 softmout_grad[OUT_SIZE];
-PI_L1 fp16 softmin_grad[IN_SIZE];
+PI_L1 struct softmax_args_fp16 softmax_args;
+PI_L1 struct softmax_bw_args_fp16 softmax_bw_args;
+PI_L1 fp16 softmout[SOFTM_SIZE];
+PI_L1 fp16 softmout_grad[SOFTM_SIZE];
+PI_L1 fp16 softmin_grad[SOFTM_SIZE];
+PI_L1 fp16 softm_maxes[SOFTM_L];
+PI_L1 fp16 softm_sums[SOFTM_L];
 
 PI_L1 struct blob_fp16 sigmoidin_blob;
 PI_L1 struct blob_fp16 sigmoidout_blob;
@@ -66,6 +102,30 @@ PI_L1 fp16 sigmoidout[OUT_SIZE];
 PI_L1 fp16 sigmoidout_grad[OUT_SIZE];
 PI_L1 fp16 sigmoidin_grad[IN_SIZE];
 
+PI_L1 struct blob_fp16 geluin_blob;
+PI_L1 struct blob_fp16 geluout_blob;
+PI_L1 fp16 geluout[OUT_SIZE];
+PI_L1 fp16 geluout_grad[OUT_SIZE];
+PI_L1 fp16 geluin_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 siluin_blob;
+PI_L1 struct blob_fp16 siluout_blob;
+PI_L1 fp16 siluout[OUT_SIZE];
+PI_L1 fp16 siluout_grad[OUT_SIZE];
+PI_L1 fp16 siluin_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 lreluin_blob;
+PI_L1 struct blob_fp16 lreluout_blob;
+PI_L1 fp16 lreluout[OUT_SIZE];
+PI_L1 fp16 lreluout_grad[OUT_SIZE];
+PI_L1 fp16 lreluin_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 hswishin_blob;
+PI_L1 struct blob_fp16 hswishout_blob;
+PI_L1 fp16 hswishout[OUT_SIZE];
+PI_L1 fp16 hswishout_grad[OUT_SIZE];
+PI_L1 fp16 hswishin_grad[IN_SIZE];
+
 #else
 
 #endif
@@ -78,6 +138,9 @@ void prepare_data ()
     {
         reluout[i] = 0;
         reluin_grad[i] = 0;
+    }
+    for (int i=0; i<SOFTM_SIZE; i++) 
+    {
         softmout[i] = 0;
         softmin_grad[i] = 0;
     }
@@ -97,20 +160,20 @@ void prepare_data ()
     reluout_blob.W = Tout_W;
     reluout_blob.C = Tout_C;
 
-    // Softmax args
+    // Softmax args (row-wise on a L x L matrix, the blob dim is L)
     softmin_blob.data = SOFTMIN;
     softmin_blob.diff = softmin_grad;
-    softmin_blob.dim = Tin_C*Tin_H*Tin_W;
-    softmin_blob.H = Tin_H;
-    softmin_blob.W = Tin_W;
-    softmin_blob.C = Tin_C;
+    softmin_blob.dim = SOFTM_L;
+    softmin_blob.H = SOFTM_L;
+    softmin_blob.W = SOFTM_L;
+    softmin_blob.C = 1;
 
     softmout_blob.data = softmout;
     softmout_blob.diff = SOFTMOUTPUT_GRAD;
-    softmout_blob.dim = Tout_C*Tout_H*Tout_W;
-    softmout_blob.H = Tout_H;
-    softmout_blob.W = Tout_W;
-    softmout_blob.C = Tout_C;
+    softmout_blob.dim = SOFTM_L;
+    softmout_blob.H = SOFTM_L;
+    softmout_blob.W = SOFTM_L;
+    softmout_blob.C = 1;
 
     // Sigmoid args
     sigmoidin_blob.data = SIGMOIDIN;
@@ -126,6 +189,66 @@ void prepare_data ()
     sigmoidout_blob.H = Tout_H;
     sigmoidout_blob.W = Tout_W;
     sigmoidout_blob.C = Tout_C;
+
+    // Gelu args
+    geluin_blob.data = GELUIN;
+    geluin_blob.diff = geluin_grad;
+    geluin_blob.dim = Tin_C*Tin_H*Tin_W;
+    geluin_blob.H = Tin_H;
+    geluin_blob.W = Tin_W;
+    geluin_blob.C = Tin_C;
+
+    geluout_blob.data = geluout;
+    geluout_blob.diff = GELUOUTPUT_GRAD;
+    geluout_blob.dim = Tout_C*Tout_H*Tout_W;
+    geluout_blob.H = Tout_H;
+    geluout_blob.W = Tout_W;
+    geluout_blob.C = Tout_C;
+
+    // Silu args
+    siluin_blob.data = SILUIN;
+    siluin_blob.diff = siluin_grad;
+    siluin_blob.dim = Tin_C*Tin_H*Tin_W;
+    siluin_blob.H = Tin_H;
+    siluin_blob.W = Tin_W;
+    siluin_blob.C = Tin_C;
+
+    siluout_blob.data = siluout;
+    siluout_blob.diff = SILUOUTPUT_GRAD;
+    siluout_blob.dim = Tout_C*Tout_H*Tout_W;
+    siluout_blob.H = Tout_H;
+    siluout_blob.W = Tout_W;
+    siluout_blob.C = Tout_C;
+
+    // Leaky Relu args
+    lreluin_blob.data = LRELUIN;
+    lreluin_blob.diff = lreluin_grad;
+    lreluin_blob.dim = Tin_C*Tin_H*Tin_W;
+    lreluin_blob.H = Tin_H;
+    lreluin_blob.W = Tin_W;
+    lreluin_blob.C = Tin_C;
+
+    lreluout_blob.data = lreluout;
+    lreluout_blob.diff = LRELUOUTPUT_GRAD;
+    lreluout_blob.dim = Tout_C*Tout_H*Tout_W;
+    lreluout_blob.H = Tout_H;
+    lreluout_blob.W = Tout_W;
+    lreluout_blob.C = Tout_C;
+
+    // Hardswish args
+    hswishin_blob.data = HSWISHIN;
+    hswishin_blob.diff = hswishin_grad;
+    hswishin_blob.dim = Tin_C*Tin_H*Tin_W;
+    hswishin_blob.H = Tin_H;
+    hswishin_blob.W = Tin_W;
+    hswishin_blob.C = Tin_C;
+
+    hswishout_blob.data = hswishout;
+    hswishout_blob.diff = HSWISHOUTPUT_GRAD;
+    hswishout_blob.dim = Tout_C*Tout_H*Tout_W;
+    hswishout_blob.H = Tout_H;
+    hswishout_blob.W = Tout_W;
+    hswishout_blob.C = Tout_C;
 }
 
 
@@ -205,9 +328,16 @@ void net_step () {
 
     printf("\n----- SOFTMAX RESULTS -----\n");
 
-    // Prepare ReLU struct
-    act_args.input = &softmin_blob;
-    act_args.output = &softmout_blob;
+    // Prepare Softmax structs
+    softmax_args.input = &softmin_blob;
+    softmax_args.output = &softmout_blob;
+    softmax_args.maxes = softm_maxes;
+    softmax_args.sums = softm_sums;
+
+    softmax_bw_args.input = &softmin_blob;
+    softmax_bw_args.output = &softmout_blob;
+    softmax_bw_args.n_rows = SOFTM_L;
+    softmax_bw_args.dim = SOFTM_L;
 
     #ifdef PROF_NET
     printf("Forward stats: \n");
@@ -215,9 +345,9 @@ void net_step () {
     #endif
 
     #if DATA_TYPE == FP32
-    pulp_softmax_fp32_fw_cl(&act_args);
+    pulp_softmax_fp32_fw_cl(&softmax_args);
     #elif DATA_TYPE == FP16
-    pulp_softmax_fp16_fw_cl(&act_args);
+    pulp_softmax_fp16_fw_cl(&softmax_args);
     #else
 
     #endif
@@ -229,9 +359,9 @@ void net_step () {
 
     printf("\nChecking output..\n");
     #if DATA_TYPE == FP32
-    verify_tensor(softmout, SOFTMOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    verify_tensor(softmout, SOFTMOUTPUT, SOFTM_SIZE, SOFTMAX_TOLERANCE);
     #elif DATA_TYPE == FP16
-    verify_tensor_fp16(softmout, SOFTMOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    verify_tensor_fp16(softmout, SOFTMOUTPUT, SOFTM_SIZE, SOFTMAX_TOLERANCE);
     #else
 
     #endif
@@ -243,9 +373,9 @@ void net_step () {
     #endif
     
     #if DATA_TYPE == FP32
-    pulp_softmax_fp32_bw_cl(&act_args);
+    pulp_row_softmax_fp32_bw_cl(&softmax_bw_args);
     #elif DATA_TYPE == FP16
-    pulp_softmax_fp16_bw_cl(&act_args);
+    pulp_row_softmax_fp16_bw_cl(&softmax_bw_args);
     #else
 
     #endif
@@ -257,9 +387,9 @@ void net_step () {
 
     printf("\nChecking in grad..\n");
     #if DATA_TYPE == FP32
-    verify_tensor(softmin_grad, SOFTMIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    verify_tensor(softmin_grad, SOFTMIN_GRAD, SOFTM_SIZE, SOFTMAX_TOLERANCE);
     #elif DATA_TYPE == FP16
-    verify_tensor_fp16(softmin_grad, SOFTMIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    verify_tensor_fp16(softmin_grad, SOFTMIN_GRAD, SOFTM_SIZE, SOFTMAX_TOLERANCE);
     #else 
 
     #endif
@@ -329,5 +459,264 @@ void net_step () {
 
     #endif
 
+
+
+
+    printf("\n----- GELU RESULTS -----\n");
+
+    // Prepare gelu struct
+    act_approx_args.input = &geluin_blob;
+    act_approx_args.output = &geluout_blob;
+    act_approx_args.approx = APPROX;
+
+    #ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+    #endif
+
+    #if DATA_TYPE == FP32
+    pulp_gelu_fp32_fw_cl(&act_approx_args);
+    #elif DATA_TYPE == FP16
+    pulp_gelu_fp16_fw_cl(&act_approx_args);
+    #else
+
+    #endif
+    
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(geluout, GELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(geluout, GELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+    #endif
+    
+    #if DATA_TYPE == FP32
+    pulp_gelu_fp32_bw_cl(&act_approx_args);
+    #elif DATA_TYPE == FP16
+    pulp_gelu_fp16_bw_cl(&act_approx_args);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(geluin_grad, GELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(geluin_grad, GELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #else 
+
+    #endif
+
+
+
+
+    printf("\n----- SILU RESULTS -----\n");
+
+    // Prepare silu struct
+    act_approx_args.input = &siluin_blob;
+    act_approx_args.output = &siluout_blob;
+    act_approx_args.approx = APPROX;
+
+    #ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+    #endif
+
+    #if DATA_TYPE == FP32
+    pulp_silu_fp32_fw_cl(&act_approx_args);
+    #elif DATA_TYPE == FP16
+    pulp_silu_fp16_fw_cl(&act_approx_args);
+    #else
+
+    #endif
+    
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(siluout, SILUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(siluout, SILUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+    #endif
+    
+    #if DATA_TYPE == FP32
+    pulp_silu_fp32_bw_cl(&act_approx_args);
+    #elif DATA_TYPE == FP16
+    pulp_silu_fp16_bw_cl(&act_approx_args);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(siluin_grad, SILUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(siluin_grad, SILUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #else 
+
+    #endif
+
+
+
+
+    printf("\n----- LEAKY RELU RESULTS -----\n");
+
+    // Prepare leaky relu struct
+    leakyrelu_args.input = &lreluin_blob;
+    leakyrelu_args.output = &lreluout_blob;
+    leakyrelu_args.negative_slope = LEAKY_SLOPE;
+
+    #ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+    #endif
+
+    #if DATA_TYPE == FP32
+    pulp_leakyrelu_fp32_fw_cl(&leakyrelu_args);
+    #elif DATA_TYPE == FP16
+    pulp_leakyrelu_fp16_fw_cl(&leakyrelu_args);
+    #else
+
+    #endif
+    
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(lreluout, LRELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(lreluout, LRELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+    #endif
+    
+    #if DATA_TYPE == FP32
+    pulp_leakyrelu_fp32_bw_cl(&leakyrelu_args);
+    #elif DATA_TYPE == FP16
+    pulp_leakyrelu_fp16_bw_cl(&leakyrelu_args);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(lreluin_grad, LRELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(lreluin_grad, LRELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #else 
+
+    #endif
+
+
+
+
+    printf("\n----- HARDSWISH RESULTS -----\n");
+
+    // Prepare hardswish struct
+    act_args.input = &hswishin_blob;
+    act_args.output = &hswishout_blob;
+
+    #ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+    #endif
+
+    #if DATA_TYPE == FP32
+    pulp_hardswish_fp32_fw_cl(&act_args);
+    #elif DATA_TYPE == FP16
+    pulp_hardswish_fp16_fw_cl(&act_args);
+    #else
+
+    #endif
+    
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(hswishout, HSWISHOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(hswishout, HSWISHOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+    #endif
+    
+    #if DATA_TYPE == FP32
+    pulp_hardswish_fp32_bw_cl(&act_args);
+    #elif DATA_TYPE == FP16
+    pulp_hardswish_fp16_bw_cl(&act_args);
+    #else
+
+    #endif
+
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(hswishin_grad, HSWISHIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(hswishin_grad, HSWISHIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #else 
+
+    #endif
+
     return;
 }
\ No newline at end of file
@@ -36,6 +36,7 @@ parser.add_argument( '--in_w', type=int, default=16 )
 parser.add_argument( '--in_c', type=int, default=8 )
 parser.add_argument( '--value', type=float, default=0.5 )
 parser.add_argument( '--data_type', type=str, default='FP32')
+parser.add_argument( '--leaky_slope', type=float, default=0.01 )
 
 args = parser.parse_args()
 
@@ -44,6 +45,9 @@ in_w = args.in_w
 in_c = args.in_c
 value = args.value
 data_type = args.data_type
+LEAKY_SLOPE = args.leaky_slope
+# The softmax is row-wise on a L x L score matrix, as in the MHSA
+softm_l = in_h*in_w
 
 
 
@@ -55,19 +59,34 @@ if data_type == 'FP32':
 
     # Fake output tensor
     reluinput = torch.ones(in_c, in_h, in_w)
-    softminput = torch.ones(in_c, in_h, in_w)
+    softminput = torch.ones(softm_l, softm_l)
     sigmoidinput = torch.ones(in_c, in_h, in_w)
+    geluinput = -2*torch.ones(in_c, in_h, in_w)
+    siluinput = -2*torch.ones(in_c, in_h, in_w)
+    lreluinput = -2*torch.ones(in_c, in_h, in_w)
+    hswishinput = -2*torch.ones(in_c, in_h, in_w)
     with torch.no_grad():
         for k in range(in_c):
             for i in range(in_w):
                 for j in range(in_h):
                     reluinput[k, i, j] += (i+j+k)*value
-                    softminput[k, i, j] += (i+j+k)*value
                     sigmoidinput[k, i, j] += (i+j+k)*value
+                    geluinput[k, i, j] += (i+j+k)*value
+                    siluinput[k, i, j] += (i+j+k)*value
+                    lreluinput[k, i, j] += (i+j+k)*value
+                    hswishinput[k, i, j] += (i+j+k)*value
     # Fake label
     relulabel = torch.ones(in_c, int((in_h)), int((in_w)))
-    softmlabel = torch.flatten(torch.ones(in_c, int((in_h)), int((in_w))))
+    softmlabel = torch.ones(softm_l, softm_l)
+    with torch.no_grad():
+        for i in range(softm_l):
+            for j in range(softm_l):
+                softminput[i, j] += (i+j)*value
     sigmoidlabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    gelulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    silulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    lrelulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    hswishlabel = torch.ones(in_c, int((in_h)), int((in_w)))
 
     print("relulabel:")
     print(relulabel.size())
@@ -79,6 +98,10 @@ if data_type == 'FP32':
     reluinput.requires_grad = True
     softminput.requires_grad = True
     sigmoidinput.requires_grad = True
+    geluinput.requires_grad = True
+    siluinput.requires_grad = True
+    lreluinput.requires_grad = True
+    hswishinput.requires_grad = True
 
     # Loss function
     loss_fn = nn.MSELoss()
@@ -95,11 +118,9 @@ if data_type == 'FP32':
     class SoftMax (nn.Module):
         def __init__(self):
             super(SoftMax, self).__init__()
-            self.softmax = nn.Softmax(dim=0)
+            self.softmax = nn.Softmax(dim=-1)
         def forward(self, x):
-            x = torch.flatten(x, start_dim=0, end_dim=-1)
             out = self.softmax(x)
-            #out = F.softmax(x, dim=0)
             return out
         
     class Sigmoid (nn.Module):
@@ -114,15 +135,27 @@ if data_type == 'FP32':
     relu = ReLU()
     softmax = SoftMax()
     sigmoid = Sigmoid()
+    gelu = nn.GELU()
+    silu = nn.SiLU()
+    lrelu = nn.LeakyReLU(negative_slope=LEAKY_SLOPE)
+    hswish = nn.Hardswish()
 
     # Compute the output and the backward of both
     reluout = relu(reluinput)
     softmout = softmax(softminput)
     sigmoidout = sigmoid(sigmoidinput)
+    geluout = gelu(geluinput)
+    siluout = silu(siluinput)
+    lreluout = lrelu(lreluinput)
+    hswishout = hswish(hswishinput)
 
     reluout.retain_grad()
     softmout.retain_grad()
     sigmoidout.retain_grad()
+    geluout.retain_grad()
+    siluout.retain_grad()
+    lreluout.retain_grad()
+    hswishout.retain_grad()
 
     print("reluout: ")
     print(reluout.size())
@@ -134,10 +167,18 @@ if data_type == 'FP32':
     reluloss = loss_fn(reluout, relulabel)
     softmloss = loss_fn(softmout, softmlabel)
     sigmoidloss = loss_fn(sigmoidout, sigmoidlabel)
+    geluloss = loss_fn(geluout, gelulabel)
+    siluloss = loss_fn(siluout, silulabel)
+    lreluloss = loss_fn(lreluout, lrelulabel)
+    hswishloss = loss_fn(hswishout, hswishlabel)
 
     reluloss.backward()
     softmloss.backward()
     sigmoidloss.backward()
+    geluloss.backward()
+    siluloss.backward()
+    lreluloss.backward()
+    hswishloss.backward()
 
     print("\n*** RELU DATA ***")
     print("ReLU out is:")
@@ -173,6 +214,7 @@ if data_type == 'FP32':
     f.write("#define Tout_H Tin_H\n")
     f.write("#define Tout_W Tin_W\n")
     f.write("#define Tout_C Tin_C\n")
+    f.write("#define LEAKY_SLOPE "+str(LEAKY_SLOPE)+"\n")
 
     f.close()
 
@@ -181,6 +223,8 @@ if data_type == 'FP32':
 
     f.write("#define IN_SIZE "+str(in_c*in_h*in_w)+"\n")
     f.write("#define OUT_SIZE "+str(in_c*int(in_h)*int(in_w))+"\n")
+    f.write("#define SOFTM_L "+str(softm_l)+"\n")
+    f.write("#define SOFTM_SIZE "+str(softm_l*softm_l)+"\n")
 
     f.write("PI_L2 float RELULOSS = {"+str(reluloss.data.item())+"};\n")
     f.write("PI_L2 float RELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(reluout)+"};\n")
@@ -190,11 +234,11 @@ if data_type == 'FP32':
     f.write("PI_L1 float RELULABEL[OUT_SIZE] = {"+dump.tensor_to_string(relulabel)+"};\n")
 
     f.write("PI_L2 float SOFTMLOSS = {"+str(softmloss.data.item())+"};\n")
-    f.write("PI_L2 float SOFTMOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(softmout)+"};\n")
-    f.write("PI_L2 float SOFTMOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(softmout.grad)+"};\n")
-    f.write("PI_L1 float SOFTMIN[IN_SIZE] = {"+dump.tensor_to_string(softminput)+"};\n")
-    f.write("PI_L2 float SOFTMIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(softminput.grad)+"};\n")
-    f.write("PI_L1 float SOFTMLABEL[OUT_SIZE] = {"+dump.tensor_to_string(softmlabel)+"};\n")
+    f.write("PI_L2 float SOFTMOUTPUT[SOFTM_SIZE] = {"+dump.tensor_to_string(softmout)+"};\n")
+    f.write("PI_L2 float SOFTMOUTPUT_GRAD[SOFTM_SIZE] = {"+dump.tensor_to_string(softmout.grad)+"};\n")
+    f.write("PI_L1 float SOFTMIN[SOFTM_SIZE] = {"+dump.tensor_to_string(softminput)+"};\n")
+    f.write("PI_L2 float SOFTMIN_GRAD[SOFTM_SIZE] = {"+dump.tensor_to_string(softminput.grad)+"};\n")
+    f.write("PI_L1 float SOFTMLABEL[SOFTM_SIZE] = {"+dump.tensor_to_string(softmlabel)+"};\n")
 
     f.write("PI_L2 float SIGMOIDLOSS = {"+str(sigmoidloss.data.item())+"};\n")
     f.write("PI_L2 float SIGMOIDOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(sigmoidout)+"};\n")
@@ -203,6 +247,26 @@ if data_type == 'FP32':
     f.write("PI_L2 float SIGMOIDIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(sigmoidinput.grad)+"};\n")
     f.write("PI_L1 float SIGMOIDLABEL[OUT_SIZE] = {"+dump.tensor_to_string(sigmoidlabel)+"};\n")
 
+    f.write("PI_L2 float GELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(geluout)+"};\n")
+    f.write("PI_L2 float GELUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(geluout.grad)+"};\n")
+    f.write("PI_L1 float GELUIN[IN_SIZE] = {"+dump.tensor_to_string(geluinput)+"};\n")
+    f.write("PI_L2 float GELUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(geluinput.grad)+"};\n")
+
+    f.write("PI_L2 float SILUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(siluout)+"};\n")
+    f.write("PI_L2 float SILUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(siluout.grad)+"};\n")
+    f.write("PI_L1 float SILUIN[IN_SIZE] = {"+dump.tensor_to_string(siluinput)+"};\n")
+    f.write("PI_L2 float SILUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(siluinput.grad)+"};\n")
+
+    f.write("PI_L2 float LRELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(lreluout)+"};\n")
+    f.write("PI_L2 float LRELUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(lreluout.grad)+"};\n")
+    f.write("PI_L1 float LRELUIN[IN_SIZE] = {"+dump.tensor_to_string(lreluinput)+"};\n")
+    f.write("PI_L2 float LRELUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(lreluinput.grad)+"};\n")
+
+    f.write("PI_L2 float HSWISHOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(hswishout)+"};\n")
+    f.write("PI_L2 float HSWISHOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(hswishout.grad)+"};\n")
+    f.write("PI_L1 float HSWISHIN[IN_SIZE] = {"+dump.tensor_to_string(hswishinput)+"};\n")
+    f.write("PI_L2 float HSWISHIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(hswishinput.grad)+"};\n")
+
     f.close()
 
 
@@ -215,19 +279,34 @@ if data_type == 'FP16':
 
     # Fake output tensor
     reluinput = torch.ones(in_c, in_h, in_w)
-    softminput = torch.ones(in_c, in_h, in_w)
+    softminput = torch.ones(softm_l, softm_l)
     sigmoidinput = torch.ones(in_c, in_h, in_w)
+    geluinput = -2*torch.ones(in_c, in_h, in_w)
+    siluinput = -2*torch.ones(in_c, in_h, in_w)
+    lreluinput = -2*torch.ones(in_c, in_h, in_w)
+    hswishinput = -2*torch.ones(in_c, in_h, in_w)
     with torch.no_grad():
         for k in range(in_c):
             for i in range(in_w):
                 for j in range(in_h):
                     reluinput[k, i, j] += (i+j+k)*value
-                    softminput[k, i, j] += (i+j+k)*value
                     sigmoidinput[k, i, j] += (i+j+k)*value
+                    geluinput[k, i, j] += (i+j+k)*value
+                    siluinput[k, i, j] += (i+j+k)*value
+                    lreluinput[k, i, j] += (i+j+k)*value
+                    hswishinput[k, i, j] += (i+j+k)*value
     # Fake label
     relulabel = torch.ones(in_c, int((in_h)), int((in_w)))
-    softmlabel = torch.flatten(torch.ones(in_c, int((in_h)), int((in_w))))
+    softmlabel = torch.ones(softm_l, softm_l)
+    with torch.no_grad():
+        for i in range(softm_l):
+            for j in range(softm_l):
+                softminput[i, j] += (i+j)*value
     sigmoidlabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    gelulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    silulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    lrelulabel = torch.ones(in_c, int((in_h)), int((in_w)))
+    hswishlabel = torch.ones(in_c, int((in_h)), int((in_w)))
 
     print("relulabel:")
     print(relulabel.size())
@@ -239,6 +318,10 @@ if data_type == 'FP16':
     reluinput.requires_grad = True
     softminput.requires_grad = True
     sigmoidinput.requires_grad = True
+    geluinput.requires_grad = True
+    siluinput.requires_grad = True
+    lreluinput.requires_grad = True
+    hswishinput.requires_grad = True
 
     # Loss function
     loss_fn = nn.MSELoss()
@@ -255,11 +338,9 @@ if data_type == 'FP16':
     class SoftMax (nn.Module):
         def __init__(self):
             super(SoftMax, self).__init__()
-            self.softmax = nn.Softmax(dim=0)
+            self.softmax = nn.Softmax(dim=-1)
         def forward(self, x):
-            x = torch.flatten(x, start_dim=0, end_dim=-1)
             out = self.softmax(x)
-            #out = F.softmax(x, dim=0)
             return out
         
     class Sigmoid (nn.Module):
@@ -274,15 +355,27 @@ if data_type == 'FP16':
     relu = ReLU()
     softmax = SoftMax()
     sigmoid = Sigmoid()
+    gelu = nn.GELU()
+    silu = nn.SiLU()
+    lrelu = nn.LeakyReLU(negative_slope=LEAKY_SLOPE)
+    hswish = nn.Hardswish()
 
     # Compute the output and the backward of both
     reluout = relu(reluinput)
     softmout = softmax(softminput)
     sigmoidout = sigmoid(sigmoidinput)
+    geluout = gelu(geluinput)
+    siluout = silu(siluinput)
+    lreluout = lrelu(lreluinput)
+    hswishout = hswish(hswishinput)
 
     reluout.retain_grad()
     softmout.retain_grad()
     sigmoidout.retain_grad()
+    geluout.retain_grad()
+    siluout.retain_grad()
+    lreluout.retain_grad()
+    hswishout.retain_grad()
 
     print("reluout: ")
     print(reluout.size())
@@ -294,10 +387,18 @@ if data_type == 'FP16':
     reluloss = loss_fn(reluout, relulabel)
     softmloss = loss_fn(softmout, softmlabel)
     sigmoidloss = loss_fn(sigmoidout, sigmoidlabel)
+    geluloss = loss_fn(geluout, gelulabel)
+    siluloss = loss_fn(siluout, silulabel)
+    lreluloss = loss_fn(lreluout, lrelulabel)
+    hswishloss = loss_fn(hswishout, hswishlabel)
 
     reluloss.backward()
     softmloss.backward()
     sigmoidloss.backward()
+    geluloss.backward()
+    siluloss.backward()
+    lreluloss.backward()
+    hswishloss.backward()
 
     print("\n*** RELU DATA ***")
     print("ReLU out is:")
@@ -333,6 +434,7 @@ if data_type == 'FP16':
     f.write("#define Tout_H Tin_H\n")
     f.write("#define Tout_W Tin_W\n")
     f.write("#define Tout_C Tin_C\n")
+    f.write("#define LEAKY_SLOPE "+str(LEAKY_SLOPE)+"\n")
 
     f.close()
 
@@ -341,6 +443,8 @@ if data_type == 'FP16':
 
     f.write("#define IN_SIZE "+str(in_c*in_h*in_w)+"\n")
     f.write("#define OUT_SIZE "+str(in_c*int(in_h)*int(in_w))+"\n")
+    f.write("#define SOFTM_L "+str(softm_l)+"\n")
+    f.write("#define SOFTM_SIZE "+str(softm_l*softm_l)+"\n")
 
     f.write("PI_L2 fp16 RELULOSS = {"+str(reluloss.data.item())+"};\n")
     f.write("PI_L2 fp16 RELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(reluout.half())+"};\n")
@@ -350,11 +454,11 @@ if data_type == 'FP16':
     f.write("PI_L1 fp16 RELULABEL[OUT_SIZE] = {"+dump.tensor_to_string(relulabel.half())+"};\n")
 
     f.write("PI_L2 fp16 SOFTMLOSS = {"+str(softmloss.data.item())+"};\n")
-    f.write("PI_L2 fp16 SOFTMOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(softmout.half())+"};\n")
-    f.write("PI_L2 fp16 SOFTMOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(softmout.grad.half())+"};\n")
-    f.write("PI_L1 fp16 SOFTMIN[IN_SIZE] = {"+dump.tensor_to_string(softminput.half())+"};\n")
-    f.write("PI_L2 fp16 SOFTMIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(softminput.grad.half())+"};\n")
-    f.write("PI_L1 fp16 SOFTMLABEL[OUT_SIZE] = {"+dump.tensor_to_string(softmlabel.half())+"};\n")
+    f.write("PI_L2 fp16 SOFTMOUTPUT[SOFTM_SIZE] = {"+dump.tensor_to_string(softmout.half())+"};\n")
+    f.write("PI_L2 fp16 SOFTMOUTPUT_GRAD[SOFTM_SIZE] = {"+dump.tensor_to_string(softmout.grad.half())+"};\n")
+    f.write("PI_L1 fp16 SOFTMIN[SOFTM_SIZE] = {"+dump.tensor_to_string(softminput.half())+"};\n")
+    f.write("PI_L2 fp16 SOFTMIN_GRAD[SOFTM_SIZE] = {"+dump.tensor_to_string(softminput.grad.half())+"};\n")
+    f.write("PI_L1 fp16 SOFTMLABEL[SOFTM_SIZE] = {"+dump.tensor_to_string(softmlabel.half())+"};\n")
 
     f.write("PI_L2 fp16 SIGMOIDLOSS = {"+str(sigmoidloss.data.item())+"};\n")
     f.write("PI_L2 fp16 SIGMOIDOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(sigmoidout.half())+"};\n")
@@ -363,4 +467,24 @@ if data_type == 'FP16':
     f.write("PI_L2 fp16 SIGMOIDIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(sigmoidinput.grad.half())+"};\n")
     f.write("PI_L1 fp16 SIGMOIDLABEL[OUT_SIZE] = {"+dump.tensor_to_string(sigmoidlabel.half())+"};\n")
 
+    f.write("PI_L2 fp16 GELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(geluout.half())+"};\n")
+    f.write("PI_L2 fp16 GELUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(geluout.grad.half())+"};\n")
+    f.write("PI_L1 fp16 GELUIN[IN_SIZE] = {"+dump.tensor_to_string(geluinput.half())+"};\n")
+    f.write("PI_L2 fp16 GELUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(geluinput.grad.half())+"};\n")
+
+    f.write("PI_L2 fp16 SILUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(siluout.half())+"};\n")
+    f.write("PI_L2 fp16 SILUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(siluout.grad.half())+"};\n")
+    f.write("PI_L1 fp16 SILUIN[IN_SIZE] = {"+dump.tensor_to_string(siluinput.half())+"};\n")
+    f.write("PI_L2 fp16 SILUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(siluinput.grad.half())+"};\n")
+
+    f.write("PI_L2 fp16 LRELUOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(lreluout.half())+"};\n")
+    f.write("PI_L2 fp16 LRELUOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(lreluout.grad.half())+"};\n")
+    f.write("PI_L1 fp16 LRELUIN[IN_SIZE] = {"+dump.tensor_to_string(lreluinput.half())+"};\n")
+    f.write("PI_L2 fp16 LRELUIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(lreluinput.grad.half())+"};\n")
+
+    f.write("PI_L2 fp16 HSWISHOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(hswishout.half())+"};\n")
+    f.write("PI_L2 fp16 HSWISHOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(hswishout.grad.half())+"};\n")
+    f.write("PI_L1 fp16 HSWISHIN[IN_SIZE] = {"+dump.tensor_to_string(hswishinput.half())+"};\n")
+    f.write("PI_L2 fp16 HSWISHIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(hswishinput.grad.half())+"};\n")
+
     f.close()
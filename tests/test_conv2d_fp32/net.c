@@ -66,7 +66,16 @@ PI_L1 float l1_out_diff[Tout_H_l1*Tout_W_l1*Tout_C_l1];
 #define IM2COL_SIZE (Tker_W_l1*Tker_H_l1*Tout_W_l1*Tout_H_l1*Tin_C_l1)
 PI_L1 float l1_in[Tin_H_l1*Tin_W_l1*Tin_C_l1];
 PI_L1 float im2col_buffer[IM2COL_SIZE];
+#if FUSED == 1
+// The weights are updated in place, tiles of FUSED_ROWS output channels at a time
+#define FUSED_ROWS 3
+PI_L1 float l1_ker[Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1];
+PI_L1 float l1_velocity[Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1];
+PI_L1 float fused_buffer[FUSED_ROWS*Tker_H_l1*Tker_W_l1*Tin_C_l1];
+PI_L1 struct fused_update_args fused_args;
+#else
 PI_L1 float l1_ker_diff[Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1];
+#endif
 PI_L1 float l1_out_diff[Tout_H_l1*Tout_W_l1*Tout_C_l1];
 PI_L1 float bt_buffer[Tout_H_l1*Tout_W_l1*Tout_C_l1];
 #endif
@@ -127,6 +136,7 @@ static inline void connect_blobs(){
   C2D_args.opt_matmul_type_ig = MATMUL_TYPE;
   C2D_args.USE_IM2COL = IM2COL;
   C2D_args.USE_DMA_IM2COL = DMA;
+  C2D_args.fused_update = NULL;
 }
 
 static inline void compute_memory_occupation(){
@@ -176,7 +186,12 @@ static inline void print_data() {
 #ifdef BACKWARD_GRAD
 static inline void tensor_init(){
   for (int i=0; i<Tin_H_l1*Tin_W_l1*Tin_C_l1; i++)                             l1_in[i] = INPUT[i]; 
+  #if FUSED == 1
+  for (int i=0; i<Tout_C_l1*Tker_H_l1*Tker_W_l1*Tin_C_l1; i++)                 l1_ker[i] = WEIGHTS[i];
+  for (int i=0; i<Tout_C_l1*Tker_H_l1*Tker_W_l1*Tin_C_l1; i++)                 l1_velocity[i] = zero_init;
+  #else
   for (int i=0; i<Tout_C_l1*Tker_H_l1*Tker_W_l1*Tin_C_l1; i++)                 l1_ker_diff[i] = zero_init;
+  #endif
   for (int i=0; i<IM2COL_SIZE; i++)                                            im2col_buffer[i] = zero_init; 
   for (int i=0; i<Tout_H_l1*Tout_W_l1*Tout_C_l1; i++)                          l1_out_diff[i] = OUTPUT_GRAD[i]; 
 }
@@ -196,7 +211,12 @@ static inline void connect_blobs(){
   layer1_out.H = Tout_H_l1;
   layer1_out.C = Tout_C_l1;
 
+  #if FUSED == 1
+  layer1_wgt.data = l1_ker;
+  layer1_wgt.diff = NULL;
+  #else
   layer1_wgt.diff = l1_ker_diff;
+  #endif
   layer1_wgt.dim = Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1;
   layer1_wgt.W = Tker_W_l1;
   layer1_wgt.H = Tker_H_l1;
@@ -220,6 +240,16 @@ static inline void connect_blobs(){
   C2D_args.opt_matmul_type_ig = MATMUL_TYPE;
   C2D_args.USE_IM2COL = IM2COL;
   C2D_args.USE_DMA_IM2COL = DMA;
+  #if FUSED == 1
+  fused_args.buffer = fused_buffer;
+  fused_args.buffer_size = FUSED_ROWS*Tker_H_l1*Tker_W_l1*Tin_C_l1;
+  fused_args.learning_rate = FUSED_LR;
+  fused_args.momentum = FUSED_MOMENTUM;
+  fused_args.velocity = l1_velocity;
+  C2D_args.fused_update = &fused_args;
+  #else
+  C2D_args.fused_update = NULL;
+  #endif
 }
 
 static inline void compute_memory_occupation(){
@@ -230,6 +260,11 @@ static inline void compute_memory_occupation(){
   //printf("Im2Col: %d bytes\n", IM2COL_SIZE*sizeof(float));
   L1_memocc_bytes += Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1*sizeof(float);
   //printf("Weights: %d bytes\n", Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1*sizeof(float));
+  #if FUSED == 1
+  // Weights, momentum and fused update buffer
+  L1_memocc_bytes += Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1*sizeof(float);
+  L1_memocc_bytes += FUSED_ROWS*Tker_H_l1*Tker_W_l1*Tin_C_l1*sizeof(float);
+  #endif
   L1_memocc_bytes += Tout_H_l1*Tout_W_l1*Tout_C_l1*sizeof(float);
   //printf("Output: %d bytes\n", Tout_H_l1*Tout_W_l1*Tout_C_l1*sizeof(float));
   L1_memocc_bytes += G_OUTPUT_SIZE*sizeof(float);
@@ -299,6 +334,7 @@ static inline void connect_blobs(){
   C2D_args.opt_matmul_type_ig = MATMUL_TYPE;
   C2D_args.USE_IM2COL = IM2COL;
   C2D_args.USE_DMA_IM2COL = DMA;
+  C2D_args.fused_update = NULL;
 }
 
 static inline void compute_memory_occupation(){
@@ -370,6 +406,28 @@ int check_tensor(float * tensor_out, float * tensor_ref, int size){
 }
 
 
+#if TEAM == 1
+// Executed by all the cores: the stages of the primitive synchronize with barriers instead of forking
+static void team_step(void * args)
+{
+  #ifdef FORWARD
+  pulp_conv2d_fp32_fw_cl(&C2D_args);
+  #endif
+
+  #ifdef BACKWARD_GRAD
+  #if FUSED == 1
+  for (int step=0; step<FUSED_STEPS; step++)
+  #endif
+  pulp_conv2d_fp32_bw_param_grads_cl(&C2D_args);
+  #endif
+
+  #ifdef BACKWARD_ERROR
+  pulp_conv2d_fp32_bw_input_grads_cl(&C2D_args);
+  #endif
+}
+#endif
+
+
 static inline void train(){
 
   #ifdef PROF_FWD
@@ -378,8 +436,12 @@ static inline void train(){
   #endif
 
   #ifdef FORWARD
+  #if TEAM == 1
+  pulp_team_run(team_step, NULL);
+  #else
   pulp_conv2d_fp32_fw_cl(&C2D_args);
   #endif
+  #endif
 
   #ifdef PROF_FWD
   STOP_STATS();
@@ -391,13 +453,20 @@ static inline void train(){
   START_STATS();
   #endif
 
+  #if TEAM == 1 && !defined(FORWARD)
+  pulp_team_run(team_step, NULL);
+  #else
   #ifdef BACKWARD_GRAD
+  #if FUSED == 1
+  for (int step=0; step<FUSED_STEPS; step++)
+  #endif
   pulp_conv2d_fp32_bw_param_grads_cl(&C2D_args);
   #endif
 
   #ifdef BACKWARD_ERROR
   pulp_conv2d_fp32_bw_input_grads_cl(&C2D_args);
   #endif
+  #endif
 
   #ifdef PROF_BKWD
   STOP_STATS();
@@ -424,6 +493,11 @@ static inline void train(){
   #endif
 
   #ifdef BACKWARD_GRAD
+  #if FUSED == 1
+  printf("UPDATED WEIGHTS CHECK: \n");
+  compare_tensors(l1_ker, WEIGHTS_UPDATED, Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1);
+  check_tensor(l1_ker, WEIGHTS_UPDATED, Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1);
+  #else
   printf("WEIGHTS GRADIENT CHECK: \n");
   compare_tensors(l1_ker_diff, WEIGHT_GRAD, Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1);
   check_tensor(l1_ker_diff, WEIGHT_GRAD, Tker_H_l1*Tker_W_l1*Tin_C_l1*Tout_C_l1);
@@ -440,6 +514,7 @@ static inline void train(){
   }
   printf("\n");
   #endif
+  #endif
 
   #ifdef BACKWARD_ERROR
   printf("INPUTS GRADIENT CHECK: \n");
@@ -42,6 +42,10 @@ parser.add_argument( '--w_pad', type=int, default=0)
 parser.add_argument( '--h_str', type=int, default=1)
 parser.add_argument( '--w_str', type=int, default=1)
 parser.add_argument( '--HWC', type=int, default=0)
+parser.add_argument( '--fused', type=int, default=0)            # 1: golden weights after the fused backward-and-update steps
+parser.add_argument( '--fused_steps', type=int, default=2)      # Steps of SGD, on the same gradient
+parser.add_argument( '--learning_rate', type=float, default=1e3)
+parser.add_argument( '--momentum', type=float, default=0.9)
 
 args = parser.parse_args()
 
@@ -299,6 +303,21 @@ net.zero_grad()
 
 loss.backward()
 
+# Golden weights of the fused backward-and-update (SGD with momentum, the weight gradient does not depend on the weights)
+if args.fused == 1:
+  optimizer = optim.SGD([net.conv.weight], lr=args.learning_rate, momentum=args.momentum)
+  for fused_step in range(args.fused_steps):
+    optimizer.step()
+  f = open("conv2d-grads.h", 'a')
+  f.write('#define FUSED_STEPS '+str(args.fused_steps)+'\n')
+  f.write('#define FUSED_LR '+str(args.learning_rate)+'f\n')
+  f.write('#define FUSED_MOMENTUM '+str(args.momentum)+'f\n')
+  if HWC_layout == 0:
+    f.write('PI_L2 float WEIGHTS_UPDATED[WGT_SIZE] = {'+dump.tensor_to_string(net.conv.weight.data)+'};\n')
+  else:
+    f.write('PI_L2 float WEIGHTS_UPDATED[WGT_SIZE] = {'+dump.tensor_to_string(net.conv.weight.data.permute(0,2,3,1))+'};\n')
+  f.close()
+
 if HWC_layout == 0:
   print("\n\nCHW data layout:")
   print("Input Size: [{}, {}, {}] \t\t(GM CHW Data: {})".format(in_ch, image_height, image_width, inp.size()))
@@ -46,10 +46,31 @@ PI_L1 float l0_out_diff [Tout_l0];
 
 #ifdef BACKWARD_GRAD
 PI_L1 float l0_in[Tin_l0];
+#if FUSED == 1
+// The weights are updated in place, tiles of FUSED_ROWS output channels at a time
+#define FUSED_ROWS 3
+PI_L1 float l0_ker[Tker_l0];
+PI_L1 float l0_velocity[Tker_l0];
+PI_L1 float fused_buffer[FUSED_ROWS*Tin_l0];
+PI_L1 struct fused_update_args fused_args;
+#else
 PI_L1 float l0_ker_diff[Tker_l0];
+#endif
 PI_L1 float l0_out_diff [Tout_l0];
 #endif
 
+#if TEAM == 1
+// Whole training step of the layer, executed by a single team
+PI_L1 float team_in[Tin_l0], team_in_diff[Tin_l0];
+PI_L1 float team_ker[Tker_l0], team_ker_diff[Tker_l0];
+PI_L1 float team_out[Tout_l0], team_out_diff[Tout_l0];
+PI_L1 float team_loss;
+PI_L1 struct blob team_in_blob, team_wgt_blob, team_out_blob;
+PI_L1 struct Linear_args team_FC_args;
+PI_L1 struct loss_args team_loss_args;
+PI_L1 struct optim_args team_opt_args;
+#endif
+
 
 
 #ifdef FORWARD
@@ -75,6 +96,7 @@ static inline void connect_blobs()
   FC_args.coeff = &layer0_wgt;
   FC_args.output = &layer0_out;
   FC_args.skip_in_grad = 0;
+  FC_args.fused_update = NULL;
   FC_args.opt_matmul_type_fw = MATMUL_TYPE;
   FC_args.opt_matmul_type_wg = MATMUL_TYPE;
   FC_args.opt_matmul_type_ig = MATMUL_TYPE;
@@ -127,6 +149,7 @@ static inline void connect_blobs()
   FC_args.coeff = &layer0_wgt;
   FC_args.output = &layer0_out;
   FC_args.skip_in_grad = 0;
+  FC_args.fused_update = NULL;
   FC_args.opt_matmul_type_fw = MATMUL_TYPE;
   FC_args.opt_matmul_type_wg = MATMUL_TYPE;
   FC_args.opt_matmul_type_ig = MATMUL_TYPE;
@@ -160,7 +183,12 @@ static inline void compute_memory_occupation(){
 static inline void tensor_init() 
 {
   for (int i=0; i<Tin_l0; i++)        l0_in[i] = INPUT_VECTOR[i];
+  #if FUSED == 1
+  for (int i=0; i<Tker_l0; i++)       l0_ker[i] = L0_WEIGHTS_params[i];
+  for (int i=0; i<Tker_l0; i++)       l0_velocity[i] = zero_init;
+  #else
   for (int i=0; i<Tker_l0; i++)       l0_ker_diff[i] = zero_init;
+  #endif
   for (int i=0; i<Tout_l0; i++)       l0_out_diff[i] = L0_OUT_GRAD[i];   
 }
 
@@ -169,7 +197,12 @@ static inline void connect_blobs()
   layer0_in.data = l0_in;
   layer0_in.dim = Tin_l0;
 
+  #if FUSED == 1
+  layer0_wgt.data = l0_ker;
+  layer0_wgt.diff = NULL;
+  #else
   layer0_wgt.diff = l0_ker_diff;
+  #endif
   layer0_wgt.dim = Tker_l0;
 
   layer0_out.diff = l0_out_diff;
@@ -179,6 +212,16 @@ static inline void connect_blobs()
   FC_args.coeff = &layer0_wgt;
   FC_args.output = &layer0_out;
   FC_args.skip_in_grad = 0;
+  #if FUSED == 1
+  fused_args.buffer = fused_buffer;
+  fused_args.buffer_size = FUSED_ROWS*Tin_l0;
+  fused_args.learning_rate = FUSED_LR;
+  fused_args.momentum = FUSED_MOMENTUM;
+  fused_args.velocity = l0_velocity;
+  FC_args.fused_update = &fused_args;
+  #else
+  FC_args.fused_update = NULL;
+  #endif
   FC_args.opt_matmul_type_fw = MATMUL_TYPE;
   FC_args.opt_matmul_type_wg = MATMUL_TYPE;
   FC_args.opt_matmul_type_ig = MATMUL_TYPE;
@@ -187,8 +230,14 @@ static inline void connect_blobs()
 static inline void compute_memory_occupation(){
   // Input
   L1_memocc_bytes += Tin_l0*sizeof(float);
+  #if FUSED == 1
+  // Kernel, momentum and fused update buffer
+  L1_memocc_bytes += 2*Tker_l0*sizeof(float); 
+  L1_memocc_bytes += FUSED_ROWS*Tin_l0*sizeof(float); 
+  #else
   // Kernel grad
   L1_memocc_bytes += Tker_l0*sizeof(float); 
+  #endif
   // Output grad
   L1_memocc_bytes += Tout_l0*sizeof(float);
 
@@ -287,6 +336,9 @@ static inline void train(){
   #endif
 
   #ifdef BACKWARD_GRAD
+  #if FUSED == 1
+  for (int step=0; step<FUSED_STEPS; step++)
+  #endif
   pulp_linear_fp32_bw_param_grads_cl(&FC_args);
   #endif
 
@@ -309,14 +361,84 @@ static inline void train(){
   #endif
 
   #ifdef BACKWARD_GRAD
+  #if FUSED == 1
+  printf("UPDATED WEIGHTS CHECK: \n");
+  compare_tensors(l0_ker, L0_WEIGHTS_UPDATED, Tker_l0);
+  check_tensor(l0_ker, L0_WEIGHTS_UPDATED, Tker_l0);
+  #else
   printf("WEIGHTS GRADIENT CHECK: \n");
   compare_tensors(l0_ker_diff, L0_WEIGHT_GRAD, Tker_l0);
   check_tensor(l0_ker_diff, L0_WEIGHT_GRAD, Tker_l0);
+  #endif
   #endif   
 
 }
 
 
+#if TEAM == 1
+// Executed by all the cores: the primitives synchronize with barriers instead of forking
+static void team_step(void * args)
+{
+  pulp_linear_fp32_fw_cl(&team_FC_args);
+  pulp_MSELoss(&team_loss_args);
+  pulp_linear_fp32_bw_cl(&team_FC_args);
+  pulp_team_fork(NUM_CORES, pulp_gradient_descent_fp32, &team_opt_args);
+}
+
+static inline void team_train(){
+
+  for (int i=0; i<Tin_l0; i++)        { team_in[i] = INPUT_VECTOR[i];  team_in_diff[i] = zero_init; }
+  for (int i=0; i<Tker_l0; i++)       { team_ker[i] = L0_WEIGHTS_params[i];  team_ker_diff[i] = zero_init; }
+  for (int i=0; i<Tout_l0; i++)       { team_out[i] = zero_init;  team_out_diff[i] = zero_init; }
+
+  team_in_blob.data = team_in;        team_in_blob.diff = team_in_diff;     team_in_blob.dim = Tin_l0;
+  team_wgt_blob.data = team_ker;      team_wgt_blob.diff = team_ker_diff;   team_wgt_blob.dim = Tker_l0;
+  team_out_blob.data = team_out;      team_out_blob.diff = team_out_diff;   team_out_blob.dim = Tout_l0;
+
+  team_FC_args.input = &team_in_blob;
+  team_FC_args.coeff = &team_wgt_blob;
+  team_FC_args.output = &team_out_blob;
+  team_FC_args.skip_in_grad = 0;
+  team_FC_args.fused_update = NULL;
+  team_FC_args.opt_matmul_type_fw = MATMUL_TYPE;
+  team_FC_args.opt_matmul_type_wg = MATMUL_TYPE;
+  team_FC_args.opt_matmul_type_ig = MATMUL_TYPE;
+
+  team_loss_args.output = &team_out_blob;
+  team_loss_args.target = L0_LABEL;
+  team_loss_args.wr_loss = &team_loss;
+
+  team_opt_args.weights = &team_wgt_blob;
+  team_opt_args.learning_rate = TEAM_LR;
+
+  printf("\nTraining step in a single team\n");
+  #ifdef PROF_NET
+  START_STATS();
+  #endif
+
+  pulp_team_run(team_step, NULL);
+
+  #ifdef PROF_NET
+  STOP_STATS();
+  #endif
+
+  printf("FORWARD CHECK: \n");
+  check_tensor(team_out, L0_OUT_FW, Tout_l0);
+  printf("LOSS CHECK: \n");
+  check_tensor(&team_loss, &L0_LOSS, 1);
+  printf("OUTPUT GRADIENT CHECK: \n");
+  check_tensor(team_out_diff, L0_OUT_GRAD, Tout_l0);
+  printf("INPUTS GRADIENT CHECK: \n");
+  check_tensor(team_in_diff, L0_IN_GRAD, Tin_l0);
+  printf("WEIGHTS GRADIENT CHECK: \n");
+  check_tensor(team_ker_diff, L0_WEIGHT_GRAD, Tker_l0);
+  printf("UPDATED WEIGHTS CHECK: \n");
+  compare_tensors(team_ker, L0_WEIGHTS_TEAM, Tker_l0);
+  check_tensor(team_ker, L0_WEIGHTS_TEAM, Tker_l0);
+}
+#endif
+
+
 // Most important function: it connects each passage to step the net and perform training
 void net_step()
 {
@@ -337,5 +459,9 @@ void net_step()
 
   train();
 
+  #if TEAM == 1
+  team_train();
+  #endif
+
   return;
 }
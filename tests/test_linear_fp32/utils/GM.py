@@ -34,6 +34,11 @@ parser.add_argument( '--in_size', type=int, default=1024 )
 parser.add_argument( '--out_size', type=int, default=8 )
 parser.add_argument( '--file_name', type=str, default='linear-data.h')
 parser.add_argument( '--step', type=str, default='FORWARD')     # Possible steps: FORWARD, BACKWARD_GRAD, BACKWARD_ERROR
+parser.add_argument( '--fused', type=int, default=0)            # 1: golden weights after the fused backward-and-update steps
+parser.add_argument( '--fused_steps', type=int, default=2)      # Steps of SGD, on the same gradient
+parser.add_argument( '--learning_rate', type=float, default=1e5)
+parser.add_argument( '--momentum', type=float, default=0.9)
+parser.add_argument( '--team', type=int, default=0)             # 1: golden weights after a gradient descent step, for the whole training step in a single team
 args = parser.parse_args()
 
 # Network parametersin_size
@@ -133,4 +138,24 @@ for i in range(1):
 
     f.write('\n\n')
 
+# Golden weights of the training step executed in a single team (forward, MSE loss, backward and gradient descent)
+if args.team == 1:
+    f.write('#define TEAM_LR '+str(args.learning_rate)+'f\n')
+    f.write('PI_L1 float L0_LABEL [L0_OUT_CH] = {'+dump.tensor_to_string(label)+'};\n')
+    team_weights = net.lin.weight.detach().clone()
+    team_weights.requires_grad = True
+    team_weights.grad = net.lin.weight.grad.clone()
+    optim.SGD([team_weights], lr=args.learning_rate).step()
+    f.write('PI_L2 float L0_WEIGHTS_TEAM [L0_WEIGHTS] = {'+dump.tensor_to_string(team_weights)+'};\n')
+
+# Golden weights of the fused backward-and-update (SGD with momentum, the weight gradient does not depend on the weights)
+if args.fused == 1:
+    f.write('#define FUSED_STEPS '+str(args.fused_steps)+'\n')
+    f.write('#define FUSED_LR '+str(args.learning_rate)+'f\n')
+    f.write('#define FUSED_MOMENTUM '+str(args.momentum)+'f\n')
+    optimizer = optim.SGD(net.parameters(), lr=args.learning_rate, momentum=args.momentum)
+    for step in range(args.fused_steps):
+        optimizer.step()
+    f.write('PI_L2 float L0_WEIGHTS_UPDATED [L0_WEIGHTS] = {'+dump.tensor_to_string(net.lin.weight)+'};\n')
+
 f.close()
\ No newline at end of file
@@ -60,6 +60,18 @@ void compute_loss ()
     pulp_MSELoss(&loss_args);
     #elif LOSS_FN == CrossEntropy
     pulp_CrossEntropyLoss(&loss_args);
+    #elif LOSS_FN == SoftmaxCrossEntropy
+    pulp_SoftmaxCrossEntropyLoss(&loss_args);
+    #elif LOSS_FN == L1
+    pulp_L1Loss(&loss_args);
+    #elif LOSS_FN == Huber
+    pulp_HuberLoss(&loss_args);
+    #elif LOSS_FN == SmoothL1
+    pulp_SmoothL1Loss(&loss_args);
+    #elif LOSS_FN == BCEWithLogits
+    pulp_BCEWithLogitsLoss(&loss_args);
+    #elif LOSS_FN == KLDiv
+    pulp_KLDivLoss(&loss_args);
     #else 
     printf("\nInvalid Loss Function selection!!\n");
     #endif
@@ -29,5 +29,11 @@
 // Loss defines
 #define MSE 0
 #define CrossEntropy 1
+#define SoftmaxCrossEntropy 2
+#define L1 3
+#define Huber 4
+#define SmoothL1 5
+#define BCEWithLogits 6
+#define KLDiv 7
 
 void net_step();
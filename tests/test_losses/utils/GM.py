@@ -41,7 +41,7 @@ value = args.value
 loss_type = args.loss_fn
 
 # Fake output tensor
-if loss_type == 'MSE':
+if loss_type in ['MSE', 'L1', 'Huber', 'SmoothL1']:
     output = torch.ones(out_size)
     with torch.no_grad():
         for i in range(out_size):
@@ -49,7 +49,7 @@ if loss_type == 'MSE':
     # Fake label
     label = torch.ones(out_size)
 
-elif loss_type == 'CrossEntropy':
+elif loss_type in ['CrossEntropy', 'SoftmaxCrossEntropy']:
     output = torch.ones(1, out_size)
     with torch.no_grad():
         for i in range(out_size):
@@ -57,14 +57,46 @@ elif loss_type == 'CrossEntropy':
     # Fake label
     label = torch.ones(1, out_size)
 
+elif loss_type == 'BCEWithLogits':
+    # Logits centered in zero
+    output = torch.zeros(out_size)
+    with torch.no_grad():
+        for i in range(out_size):
+            output[i] += (i - out_size/2)*value
+    # Fake label
+    label = torch.zeros(out_size)
+    for i in range(0, out_size, 2):
+        label[i] = 1
+
+elif loss_type == 'KLDiv':
+    # Log-probabilities of the student and probabilities of the teacher
+    output = torch.zeros(1, out_size)
+    label = torch.zeros(1, out_size)
+    with torch.no_grad():
+        for i in range(out_size):
+            output[0][i] += i*value
+            label[0][i] += (out_size-i)*value
+    output = torch.log_softmax(output, dim=1)
+    label = torch.softmax(label, dim=1)
+
 
 output.requires_grad = True
 
 # Loss function
 if loss_type == 'MSE':
     loss_fn = nn.MSELoss()
-if loss_type == 'CrossEntropy':
+if loss_type in ['CrossEntropy', 'SoftmaxCrossEntropy']:
     loss_fn = nn.CrossEntropyLoss()
+if loss_type == 'L1':
+    loss_fn = nn.L1Loss()
+if loss_type == 'Huber':
+    loss_fn = nn.HuberLoss()
+if loss_type == 'SmoothL1':
+    loss_fn = nn.SmoothL1Loss()
+if loss_type == 'BCEWithLogits':
+    loss_fn = nn.BCEWithLogitsLoss()
+if loss_type == 'KLDiv':
+    loss_fn = nn.KLDivLoss(reduction='batchmean')
 
 loss = loss_fn(output, label)
 loss.backward()
@@ -49,7 +49,7 @@ PI_L1 fp16 l0_ker_out[Tatt_dim_l1*Tin_W_l1];
 PI_L1 fp16 l0_qkv[Tin_H_l1*Tatt_dim_l1*3];
 PI_L1 fp16 l0_att_map[Tin_H_l1*Tatt_dim_l1];
 //PI_L1 float l0_h_buffer[Tin_H_l1*Tin_H_l1*Tn_heads_l1];
-PI_L1 fp16 l0_softmax_buffer[Tin_H_l1*Tin_H_l1];
+PI_L1 fp16 l0_softmax_buffer[Tin_H_l1*Tin_H_l1*Tn_heads_l1];
 PI_L1 fp16 l0_out[Tin_H_l1*Tin_W_l1];
 PI_L1 fp16 l0_temp[Tin_H_l1*Tin_H_l1]; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
 PI_L1 fp16 l0_sums[Tin_H_l1]; 
@@ -89,7 +89,7 @@ static inline void tensor_init()
   for (int i=0; i<Tin_H_l1*Tatt_dim_l1*3; i++)          l0_qkv[i] = zero_init;
   for (int i=0; i<Tin_H_l1*Tatt_dim_l1; i++)            l0_att_map[i] = zero_init; 
   //for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)   l0_h_buffer[i] = zero_init;
-  for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)               l0_softmax_buffer[i] = zero_init;
+  for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)   l0_softmax_buffer[i] = zero_init;
   for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)               l0_temp[i] = zero_init; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
   for (int i=0; i<Tin_H_l1; i++)                        l0_sums[i] = zero_init;
   for (int i=0; i<Tin_H_l1; i++)                        l0_maxes[i] = min_float;
@@ -165,6 +165,7 @@ static inline void connect_blobs()
   mhsa_args.temp_buffer = l0_temp;
   mhsa_args.sums = l0_sums;
   mhsa_args.maxes = l0_maxes;
+  mhsa_args.softmax_type = SOFTMAX_TYPE;
   mhsa_args.opt_matmul_type_fw = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_wg = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_ig = MATMUL_TYPE;
@@ -186,7 +187,7 @@ static inline void compute_memory_occupation(){
   // Heads Scores
   //L1_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
   // Heads Softmax Output
-  L1_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(fp16);
+  L1_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(fp16);
   // Tmp buffer
   L1_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(fp16);
   // sums buffer
@@ -211,7 +212,7 @@ static inline void compute_memory_occupation(){
   // Heads Scores
   //L2_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
   // Heads Softmax Output
-  L2_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(fp16);
+  L2_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(fp16);
   // Tmp buffer
   L2_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(fp16);
   // sums buffer
@@ -45,6 +45,7 @@ parser.add_argument( '--weight', type=float, default=0.1)
 parser.add_argument( '--att_dim', type=int, default=8)
 parser.add_argument( '--bf16_format', type=int, default=1) # if == 1, data format if bfloat16, if 0 is float16
 parser.add_argument( '--step', type=str, default='FORWARD')     # Possible steps: FORWARD, BACKWARD_GRAD, BACKWARD_ERROR
+parser.add_argument( '--softmax_type', type=int, default=0)   # 0: online, 1: partial, 2: partial shift, 3: partial approximate, 4: simple
 
 args = parser.parse_args()
 
@@ -59,6 +60,7 @@ weight_init = args.weight
 att_dim = args.att_dim
 head_dim = (int) (att_dim / n_heads);
 bf16_format = args.bf16_format
+softmax_type = args.softmax_type
 
 # Net step
 f_step = open('step-check.h', 'w')
@@ -82,7 +84,7 @@ f.close()
 class myNet(nn.Module):
   def __init__(self, in_h, in_w, n_heads, att_dim):
     super().__init__()
-    self.mhsa = mhsa.MultiHeadedSelfAttention(dim=in_w, num_heads=n_heads, att_dim=att_dim)
+    self.mhsa = mhsa.MultiHeadedSelfAttention(dim=in_w, num_heads=n_heads, att_dim=att_dim, softmax_type=softmax_type)
 
   def forward(self, x, tgt_len):
     return self.mhsa(x=x, tgt_len=tgt_len)
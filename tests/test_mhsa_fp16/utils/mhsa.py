@@ -14,9 +14,38 @@ def own_softmax(x):
 
     return x_exp/x_exp_sum
 
+def threshold(x):
+    log2 = 0.6931471805599453
+    log2_2 = 0.4804530139182014
+    log2_3 = 0.3330246519889294
+    log2_4 = 0.2308350985830834
+    log2_5 = 0.1600026977571413
+    x[x < 3.14 ] = (1 - log2 * x + 0.5 * np.power(x, 2) * log2_2 - 0.16 * np.power(x, 3) * log2_3 + 0.0416 * np.power(x, 4) * log2_4 - 0.008 * np.power(x, 5) * log2_5)[x < 3.14]
+    x[x >= 3.14] = 0
+    return x
+
+# Row-wise partial softmax variants of pulp_act_fp16.c (1: partial, 2: partial shift, 3: partial approximate, 4: simple)
+def own_partial_softmax(x, softmax_type):
+    eps_max = 0.03125
+    x_copy = x.detach().float().numpy().astype(np.float32)
+
+    lines_max = np.max(x_copy, axis = -1, keepdims = True)
+    diff = lines_max - x_copy
+
+    if softmax_type == 1:
+        x_exp = 1 / 2**(diff * eps_max)
+    elif softmax_type == 2:
+        x_exp = 1 / 2**np.ceil(diff * eps_max)
+    elif softmax_type == 3:
+        x_exp = threshold(diff * eps_max)
+    else:
+        x_exp = threshold(diff)
+
+    return torch.from_numpy(x_exp / np.sum(x_exp, axis = -1, keepdims = True)).type(x.dtype)
+
 class MultiHeadedSelfAttention(nn.Module):
     """Multi-Headed Dot Product Attention"""
-    def __init__(self, dim, num_heads, att_dim):
+    def __init__(self, dim, num_heads, att_dim, softmax_type=0):
         super().__init__()
         self.proj_in = nn.Linear(dim, 3*att_dim, bias=False)
         self.proj_out = nn.Linear(att_dim, dim, bias=False)
@@ -27,6 +56,8 @@ class MultiHeadedSelfAttention(nn.Module):
         self.scaling = (self.head_dim) ** -0.5
         self.scores = None # for visualization
         self.softmax = own_softmax
+        if softmax_type != 0:
+            self.softmax = lambda x: own_partial_softmax(x, softmax_type)
 
     def forward(self, x, tgt_len):
         q, k, v = self.proj_in(x).chunk(3, dim=-1)
@@ -44,6 +44,15 @@ PI_L2 int L1_memocc_bytes = 0;
 PI_L2 int L2_memocc_bytes = 0;
 
 #ifdef FORWARD
+#if FLASH == 1
+#define L0_TEMP_SIZE (NUM_CORES*(Tatt_dim_l1/Tn_heads_l1+MHSA_FLASH_TILE))
+#elif CAUSAL == 1 || VALID_LEN > 0
+#define L0_TEMP_SIZE (3*Tin_H_l1*(Tatt_dim_l1/Tn_heads_l1)+MHSA_MASK_TILE*Tin_H_l1)
+#elif PARALLEL_HEADS == 1
+#define L0_TEMP_SIZE (Tin_H_l1*Tin_H_l1+NUM_CORES*Tin_H_l1)
+#else
+#define L0_TEMP_SIZE (Tin_H_l1*Tin_H_l1)
+#endif
 PI_L1 float l0_in[Tin_H_l1*Tin_W_l1];
 PI_L1 float l0_ker_in[Tin_W_l1*Tatt_dim_l1*3];
 PI_L1 float l0_ker_out[Tatt_dim_l1*Tin_W_l1]; 
@@ -52,12 +61,38 @@ PI_L1 float l0_att_map[Tin_H_l1*Tatt_dim_l1];
 //PI_L1 float l0_h_buffer[Tin_H_l1*Tin_H_l1*Tn_heads_l1];
 PI_L1 float l0_softmax_buffer[Tin_H_l1*Tin_H_l1];
 PI_L1 float l0_out[Tin_H_l1*Tin_W_l1];
-PI_L1 float l0_temp[Tin_H_l1*Tin_H_l1]; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
+PI_L1 float l0_temp[L0_TEMP_SIZE]; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
 PI_L1 float l0_sums[Tin_H_l1]; 
 PI_L1 float l0_maxes[Tin_H_l1]; 
+PI_L1 float l0_lse[Tin_H_l1*Tn_heads_l1];
+#if DECODE == 1
+// KV-cache decode of the second half of the sequence, checked against the causal forward
+#define DEC_PREFILL (Tin_H_l1/2)
+PI_L1 struct Mhsa_decode_args dec_args;
+PI_L1 struct mhsa_prefill_args prefill_args;
+PI_L1 struct blob dec_in, dec_out;
+PI_L1 float l0_k_cache[Tatt_dim_l1*Tin_H_l1];
+PI_L1 float l0_v_cache[Tatt_dim_l1*Tin_H_l1];
+PI_L1 float l0_dec_qkv[Tatt_dim_l1*3];
+PI_L1 float l0_dec_att_map[Tatt_dim_l1];
+PI_L1 float l0_dec_temp[NUM_CORES*Tin_H_l1];
+PI_L1 float l0_dec_in[Tin_W_l1];
+PI_L1 float l0_dec_out[Tin_W_l1];
+PI_L1 float l0_dec_ref[Tin_W_l1];
+#endif
 #endif
 
 #ifdef BACKWARD
+#if RECOMPUTE == 1
+#define L0_SOFTMAX_SIZE (Tin_H_l1*Tin_H_l1)
+#else
+#define L0_SOFTMAX_SIZE (Tin_H_l1*Tin_H_l1*Tn_heads_l1)
+#endif
+#if CAUSAL == 1 || VALID_LEN > 0
+#define L0_TEMP_SIZE (Tin_H_l1*Tatt_dim_l1*3+Tin_H_l1*(Tatt_dim_l1/Tn_heads_l1)+2*MHSA_MASK_TILE*Tin_H_l1)
+#else
+#define L0_TEMP_SIZE (Tin_H_l1*Tatt_dim_l1*3)
+#endif
 PI_L1 float l0_in[Tin_H_l1*Tin_W_l1];
 PI_L1 float l0_in_diff[Tin_H_l1*Tin_W_l1];
 PI_L1 float l0_ker_in[Tin_W_l1*Tatt_dim_l1*3];
@@ -70,11 +105,14 @@ PI_L1 float l0_att_map[Tin_H_l1*Tatt_dim_l1];
 PI_L1 float l0_att_map_diff[Tin_H_l1*Tatt_dim_l1]; 
 PI_L1 float l0_out[Tin_H_l1*Tin_W_l1]; 
 PI_L1 float l0_out_diff[Tin_H_l1*Tin_W_l1];
-PI_L1 float l0_temp[Tin_H_l1*Tatt_dim_l1*3]; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required) 
+PI_L1 float l0_temp[L0_TEMP_SIZE]; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required) 
 PI_L1 float l0_grad[Tin_H_l1*Tin_H_l1]; // Buffer containing the pre-softmax head buffer gradient, necessary in the backward process
 PI_L1 float l0_h_buffer[Tin_H_l1*Tin_H_l1*Tn_heads_l1]; 
-PI_L1 float l0_h_buffer_diff[Tin_H_l1*Tin_H_l1*Tn_heads_l1];
-PI_L1 float l0_softmax_buffer[Tin_H_l1*Tin_H_l1*Tn_heads_l1];
+PI_L1 float l0_h_buffer_diff[Tin_H_l1*Tin_H_l1]; // Score gradient of a single head
+PI_L1 float l0_softmax_buffer[L0_SOFTMAX_SIZE];
+PI_L1 float l0_maxes[Tin_H_l1];
+PI_L1 float l0_sums[Tin_H_l1];
+PI_L1 float l0_lse[Tin_H_l1*Tn_heads_l1];
 #endif
 
 
@@ -91,9 +129,16 @@ static inline void tensor_init()
   for (int i=0; i<Tin_H_l1*Tatt_dim_l1; i++)            l0_att_map[i] = zero_init; 
   //for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)   l0_h_buffer[i] = zero_init;
   for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)               l0_softmax_buffer[i] = zero_init;
-  for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)               l0_temp[i] = zero_init; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
+  for (int i=0; i<L0_TEMP_SIZE; i++)                    l0_temp[i] = zero_init; // TODO: THIS HAS TO BE DYNAMIC (calculate the max capacity required)
   for (int i=0; i<Tin_H_l1; i++)                        l0_sums[i] = zero_init;
   for (int i=0; i<Tin_H_l1; i++)                        l0_maxes[i] = min_float;
+  #if DECODE == 1
+  for (int i=0; i<Tatt_dim_l1*Tin_H_l1; i++)            l0_k_cache[i] = zero_init;
+  for (int i=0; i<Tatt_dim_l1*Tin_H_l1; i++)            l0_v_cache[i] = zero_init;
+  for (int i=0; i<Tatt_dim_l1*3; i++)                   l0_dec_qkv[i] = zero_init;
+  for (int i=0; i<Tatt_dim_l1; i++)                     l0_dec_att_map[i] = zero_init;
+  for (int i=0; i<NUM_CORES*Tin_H_l1; i++)              l0_dec_temp[i] = zero_init;
+  #endif
   printf("Finished initializing the things\n");
 }
 
@@ -166,9 +211,39 @@ static inline void connect_blobs()
   mhsa_args.temp_buffer = l0_temp;
   mhsa_args.sums = l0_sums;
   mhsa_args.maxes = l0_maxes;
+  mhsa_args.lse = l0_lse;
+  mhsa_args.causal = CAUSAL;
+  mhsa_args.valid_len = VALID_LEN;
+  mhsa_args.parallel_heads = PARALLEL_HEADS;
+  mhsa_args.recompute_softmax = 1; // Forward only: softmax_buffer holds a single head, instead of every head's probabilities
   mhsa_args.opt_matmul_type_fw = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_wg = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_ig = MATMUL_TYPE;
+
+  #if DECODE == 1
+  dec_in.data = l0_dec_in;
+  dec_in.dim = Tin_W_l1;
+  dec_out.data = l0_dec_out;
+  dec_out.dim = Tin_W_l1;
+
+  dec_args.input = &dec_in;
+  dec_args.output = &dec_out;
+  dec_args.coeff_in = &layer0_wgt_in;
+  dec_args.coeff_out = &layer0_wgt_out;
+  dec_args.k_cache = l0_k_cache;
+  dec_args.v_cache = l0_v_cache;
+  dec_args.qkv = l0_dec_qkv;
+  dec_args.attention_map = l0_dec_att_map;
+  dec_args.temp_buffer = l0_dec_temp;
+  dec_args.n_heads = Tn_heads_l1;
+  dec_args.max_len = Tin_H_l1;
+  dec_args.cur_len = 0;
+  dec_args.opt_matmul_type_fw = MATMUL_TYPE;
+
+  prefill_args.mhsa_args = &mhsa_args;
+  prefill_args.dec_args = &dec_args;
+  prefill_args.n_tokens = DEC_PREFILL;
+  #endif
 }
 
 static inline void compute_memory_occupation(){
@@ -180,6 +255,12 @@ static inline void compute_memory_occupation(){
   L1_memocc_bytes += Tin_W_l1*Tatt_dim_l1*sizeof(float);
   // QKV
   L1_memocc_bytes += Tatt_dim_l1*Tin_H_l1*3*sizeof(float);
+  #if DECODE == 1
+  // KV-caches
+  L1_memocc_bytes += 2*Tatt_dim_l1*Tin_H_l1*sizeof(float);
+  // Decode QKV, attention map, scores, input and outputs
+  L1_memocc_bytes += (4*Tatt_dim_l1 + NUM_CORES*Tin_H_l1 + 3*Tin_W_l1)*sizeof(float);
+  #endif
   // Output
   L1_memocc_bytes += Tin_W_l1*Tin_H_l1*sizeof(float);
   // Attention Map
@@ -189,11 +270,13 @@ static inline void compute_memory_occupation(){
   // Heads Softmax Output
   L1_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
   // Tmp buffer
-  L1_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
+  L1_memocc_bytes += L0_TEMP_SIZE*sizeof(float);
   // sums buffer
   L1_memocc_bytes += Tin_H_l1*sizeof(float);
   // maxes buffer
   L1_memocc_bytes += Tin_H_l1*sizeof(float);
+  // log-sum-exp buffer
+  L1_memocc_bytes += Tin_H_l1*Tn_heads_l1*sizeof(float);
 
 
 
@@ -214,11 +297,13 @@ static inline void compute_memory_occupation(){
   // Heads Softmax Output
   L2_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
   // Tmp buffer
-  L2_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
+  L2_memocc_bytes += L0_TEMP_SIZE*sizeof(float);
   // sums buffer
   L2_memocc_bytes += Tin_H_l1*sizeof(float);
   // maxes buffer
   L2_memocc_bytes += Tin_H_l1*sizeof(float);
+  // log-sum-exp buffer
+  L2_memocc_bytes += Tin_H_l1*Tn_heads_l1*sizeof(float);
 }
 #endif
 
@@ -239,7 +324,7 @@ static inline void tensor_init()
   for (int i=0; i<Tin_W_l1*Tin_H_l1; i++)                    l0_out_diff[i] = OUTPUT_GRAD[i];  
   for (int i=0; i<Tin_W_l1*Tin_H_l1; i++)                    l0_out[i] = OUTPUT[i];
 
-  for (int i=0; i<Tin_H_l1*Tatt_dim_l1*3; i++)               l0_temp[i] = zero_init; 
+  for (int i=0; i<L0_TEMP_SIZE; i++)                    l0_temp[i] = zero_init; 
 
   for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)                    l0_grad[i] = zero_init;
 
@@ -250,9 +335,9 @@ static inline void tensor_init()
   for (int i=0; i<Tin_H_l1*Tatt_dim_l1; i++)                 l0_att_map_diff[i] = zero_init;
 
   for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)        l0_h_buffer[i] = zero_init;
-  for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)        l0_h_buffer_diff[i] = zero_init;
+  for (int i=0; i<Tin_H_l1*Tin_H_l1; i++)                    l0_h_buffer_diff[i] = zero_init;
 
-  for (int i=0; i<Tin_H_l1*Tin_H_l1*Tn_heads_l1; i++)        l0_softmax_buffer[i] = zero_init;
+  for (int i=0; i<L0_SOFTMAX_SIZE; i++)                      l0_softmax_buffer[i] = zero_init;
 }
 
 static inline void connect_blobs() 
@@ -307,7 +392,7 @@ static inline void connect_blobs()
   layer0_h_buffer.diff = l0_h_buffer_diff;
 
   layer0_softmax_buffer.data = l0_softmax_buffer;
-  layer0_softmax_buffer.dim = Tin_H_l1*Tin_H_l1*Tn_heads_l1;
+  layer0_softmax_buffer.dim = L0_SOFTMAX_SIZE;
   layer0_softmax_buffer.H = Tn_heads_l1;
   layer0_softmax_buffer.W = Tin_H_l1*Tin_H_l1;
   layer0_softmax_buffer.C = Tin_C_l1;
@@ -323,6 +408,13 @@ static inline void connect_blobs()
   mhsa_args.head_buffer = &layer0_h_buffer;
   mhsa_args.softmax_buffer = &layer0_softmax_buffer;
   mhsa_args.n_heads = Tn_heads_l1;
+  mhsa_args.maxes = l0_maxes;
+  mhsa_args.sums = l0_sums;
+  mhsa_args.lse = l0_lse;
+  mhsa_args.causal = CAUSAL;
+  mhsa_args.valid_len = VALID_LEN;
+  mhsa_args.parallel_heads = PARALLEL_HEADS;
+  mhsa_args.recompute_softmax = RECOMPUTE;
   mhsa_args.opt_matmul_type_fw = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_wg = MATMUL_TYPE;
   mhsa_args.opt_matmul_type_ig = MATMUL_TYPE;
@@ -343,13 +435,13 @@ static inline void compute_memory_occupation(){
   // Attention Map + grad
   L1_memocc_bytes += 2*Tatt_dim_l1*Tin_H_l1*sizeof(float);
   // Heads Scores + grad
-  L1_memocc_bytes += 2*Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
+  L1_memocc_bytes += Tin_H_l1*Tin_H_l1*(Tn_heads_l1+1)*sizeof(float);
   // Tmp buffer
-  L1_memocc_bytes += Tin_H_l1*Tatt_dim_l1*3*sizeof(float);
+  L1_memocc_bytes += L0_TEMP_SIZE*sizeof(float);
   // Gradient buffer
   L1_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
   // Heads Softmax Output
-  L1_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
+  L1_memocc_bytes += L0_SOFTMAX_SIZE*sizeof(float);
 
 
 
@@ -366,13 +458,13 @@ static inline void compute_memory_occupation(){
   // Attention Map + grad
   L2_memocc_bytes += 2*Tatt_dim_l1*Tin_H_l1*sizeof(float);
   // Heads Scores + grad
-  L2_memocc_bytes += 2*Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
+  L2_memocc_bytes += Tin_H_l1*Tin_H_l1*(Tn_heads_l1+1)*sizeof(float);
   // Tmp buffer
-  L2_memocc_bytes += Tin_H_l1*Tatt_dim_l1*3*sizeof(float);
+  L2_memocc_bytes += L0_TEMP_SIZE*sizeof(float);
   // Gradient buffer
   L2_memocc_bytes += Tin_H_l1*Tin_H_l1*sizeof(float);
   // Heads Softmax Output
-  L2_memocc_bytes += Tin_H_l1*Tin_H_l1*Tn_heads_l1*sizeof(float);
+  L2_memocc_bytes += L0_SOFTMAX_SIZE*sizeof(float);
 }
 #endif
 
@@ -409,6 +501,50 @@ int check_tensor(float * tensor_out, float * tensor_ref, int size){
 
 
 
+#if DECODE == 1
+PI_L1 int decode_error = 0;
+
+// Resume from the prompt keys and values of the causal forward, then decode each remaining token (column of the E x L input)
+static void decode_tokens(){
+  pulp_mhsa_fp32_prefill_cl(&prefill_args);
+
+  for (int l=DEC_PREFILL; l<Tin_H_l1; l++) {
+    // Inside pulp_team_run, the token is copied and checked by core 0 only (the decode stages start and end with a barrier)
+    if (!pulp_team_active || pi_core_id() == 0)
+      for (int e=0; e<Tin_W_l1; e++)  l0_dec_in[e] = l0_in[e*Tin_H_l1 + l];
+    pulp_mhsa_fp32_decode_cl(&dec_args);
+    if (!pulp_team_active || pi_core_id() == 0) {
+      for (int e=0; e<Tin_W_l1; e++)  l0_dec_ref[e] = l0_out[e*Tin_H_l1 + l];
+      decode_error |= check_tensor(l0_dec_out, l0_dec_ref, Tin_W_l1);
+    }
+  }
+}
+#endif
+
+
+#if TEAM == 1
+// Executed by all the cores: the stages of the primitives synchronize with barriers instead of forking
+static void team_step(void * args)
+{
+  #ifdef FORWARD
+  #if FLASH == 1
+  pulp_mhsa_flash_fp32_fw_cl(&mhsa_args);
+  #else
+  pulp_mhsa_fp32_fw_cl(&mhsa_args);
+  #endif
+  #if DECODE == 1
+  decode_tokens();
+  #endif
+  #endif
+
+  #ifdef BACKWARD
+  pulp_mhsa_fp32_fw_cl(&mhsa_args);
+  pulp_mhsa_fp32_bw_cl(&mhsa_args);
+  #endif
+}
+#endif
+
+
 static inline void train(){
 
   
@@ -424,15 +560,23 @@ static inline void train(){
   START_STATS();
   #endif
 
+  #if TEAM == 1
+  pulp_team_run(team_step, NULL);
+  #else
   #ifdef FORWARD
+  #if FLASH == 1
+  pulp_mhsa_flash_fp32_fw_cl(&mhsa_args);
+  #else
   pulp_mhsa_fp32_fw_cl(&mhsa_args);
   #endif
+  #endif
+  #endif
 
   #ifdef PROF_FWD
   STOP_STATS();
   #endif
 
-  #ifdef BACKWARD
+  #if defined(BACKWARD) && TEAM == 0
 
   pulp_mhsa_fp32_fw_cl(&mhsa_args);
 
@@ -480,10 +624,29 @@ static inline void train(){
   printf("\nFORWARD CHECK: \n");
   compare_tensors(l0_out, OUTPUT, OUTPUT_SIZE);
   check_tensor(l0_out, OUTPUT, OUTPUT_SIZE);
+
+  #if DECODE == 1
+  #if TEAM == 0
+  decode_tokens();
+  #endif
+  printf("\nDECODE CHECK (vs causal forward): \n");
+  if (decode_error == 0 && dec_args.cur_len == Tin_H_l1) printf("\n>>>TENSOR MATCHING!\n");
+  else printf("\n>>>TENSOR NOT MATCHING!\n");
+  #endif
   #endif
 
 
   #ifdef BACKWARD
+  #if TEAM == 1
+  printf("\nFORWARD CHECK: \n");
+  compare_tensors(l0_out, OUTPUT, OUTPUT_SIZE);
+  check_tensor(l0_out, OUTPUT, OUTPUT_SIZE);
+
+  printf("\nATTENTION SCORE CHECK: \n");
+  compare_tensors(l0_att_map, ATTENTION_SCORES, ATTENTION_S_LENGTH);
+  check_tensor(l0_att_map, ATTENTION_SCORES, ATTENTION_S_LENGTH);
+  #endif
+
   printf("\nFINAL WEIGHTS GRADIENT CHECK: \n");
   printf("\nINPUT WEIGHTS GRADIENT CHECK: \n");
   compare_tensors(l0_ker_in_diff, INPUT_WGT_GRAD, G_INPUT_WGT_SIZE);  
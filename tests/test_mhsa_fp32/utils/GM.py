@@ -44,6 +44,8 @@ parser.add_argument( '--n_heads', type=int, default=8)
 parser.add_argument( '--weight', type=float, default=0.1)
 parser.add_argument( '--att_dim', type=int, default=8)
 parser.add_argument( '--step', type=str, default='FORWARD')     # Possible steps: FORWARD, BACKWARD_GRAD, BACKWARD_ERROR
+parser.add_argument( '--causal', type=int, default=0)           # 1 = causal mask
+parser.add_argument( '--valid_len', type=int, default=0)        # Key-padding mask: keys >= valid_len are masked (0 = no padding)
 
 args = parser.parse_args()
 
@@ -56,6 +58,8 @@ n_heads = args.n_heads
 current_step = args.step
 weight_init = args.weight
 att_dim = args.att_dim
+causal = args.causal
+valid_len = args.valid_len
 head_dim = (int) (att_dim / n_heads);
 
 # Net step
@@ -80,7 +84,7 @@ f.close()
 class myNet(nn.Module):
   def __init__(self, in_h, in_w, n_heads, att_dim):
     super().__init__()
-    self.mhsa = mhsa.MultiHeadedSelfAttention(dim=in_w, num_heads=n_heads, att_dim=att_dim)
+    self.mhsa = mhsa.MultiHeadedSelfAttention(dim=in_w, num_heads=n_heads, att_dim=att_dim, causal=(causal==1), valid_len=valid_len)
 
   def forward(self, x, tgt_len):
     return self.mhsa(x=x, tgt_len=tgt_len)
@@ -87,7 +87,7 @@ def own_partial_softmax_simple_approximate(x):
 
 class MultiHeadedSelfAttention(nn.Module):
     """Multi-Headed Dot Product Attention"""
-    def __init__(self, dim, num_heads, att_dim):
+    def __init__(self, dim, num_heads, att_dim, causal=False, valid_len=0):
         super().__init__()
         self.proj_in = nn.Linear(dim, 3*att_dim, bias=False)
         self.proj_out = nn.Linear(att_dim, dim, bias=False)
@@ -97,6 +97,8 @@ class MultiHeadedSelfAttention(nn.Module):
         self.head_dim = att_dim // num_heads
         self.scaling = (self.head_dim) ** -0.5
         self.scores = None # for visualization
+        self.causal = causal
+        self.valid_len = valid_len # Key-padding mask: keys >= valid_len are masked (0 = no padding)
         #self.softmax = own_softmax
         #self.softmax = own_partial_softmax_simple
         self.softmax = own_softmax_fastexp
@@ -112,6 +114,16 @@ class MultiHeadedSelfAttention(nn.Module):
         assert list(scores.size()) == [self.n_heads, tgt_len, tgt_len]
 
         scores = scores * self.scaling
+
+        # Masked scores are pushed far below the row max, so that their exponential flushes to zero
+        if self.causal or self.valid_len > 0:
+            mask = torch.zeros(tgt_len, tgt_len, dtype=torch.bool)
+            if self.causal:
+                mask = mask | torch.triu(torch.ones(tgt_len, tgt_len, dtype=torch.bool), diagonal=1)
+            if self.valid_len > 0:
+                mask[:, self.valid_len:] = True
+            scores = scores.masked_fill(mask, -1e4)
+
         scores = self.softmax(scores)
 
         scores = torch.bmm(scores, v)
@@ -0,0 +1,428 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train.h"
+#include "math.h"
+
+#include "net.h"
+#include "stats.h"
+#include "optim_data.h"
+
+
+// DATA DEFINITION
+#if TEST == MIXED_PRECISION
+// The network is the identity: the weights are the output of the MSE loss, whose gradient is their gradient
+PI_L1 fp16 wgt[WGT_SIZE];
+PI_L1 fp16 wgt_diff[WGT_SIZE];
+PI_L1 float master[WGT_SIZE];
+PI_L1 float velocity[WGT_SIZE];
+PI_L1 fp16 loss = 0;
+PI_L1 struct blob_fp16 wgt_blob;
+PI_L1 struct loss_args_fp16 loss_args;
+PI_L1 struct loss_scaler_args_fp16 scaler;
+PI_L1 struct optim_multi_args_fp16 opt_args;
+PI_L1 struct blob_fp16 * wgt_list[1];
+PI_L1 float * master_list[1];
+PI_L1 float * velocity_list[1];
+PI_L1 float scale_log[STEPS];
+PI_L1 int skip_log[STEPS];
+#elif TEST == STOCHASTIC_ROUNDING
+PI_L1 fp16 wgt[WGT_SIZE];
+PI_L1 fp16 first_run[WGT_SIZE];
+PI_L1 float exact[WGT_SIZE];
+PI_L1 uint32_t rng_state[NUM_CORES];
+PI_L1 struct blob_fp16 wgt_blob;
+PI_L1 struct optim_sr_args_fp16 sr_args;
+// Rounding error of each update, in FP16 ulps of the exact FP32 update
+PI_L1 float sr_bias = 0;
+PI_L1 int sr_errors = 0;
+#elif TEST == GRAD_CLIP
+// The same gradients are clipped and applied by the FP32 and FP16 optimizers, on two tensors
+PI_L1 float wgt32_0[WGT_SIZE], wgt32_1[WGT_SIZE_1];
+PI_L1 float diff32_0[WGT_SIZE], diff32_1[WGT_SIZE_1];
+PI_L1 float velocity32_0[WGT_SIZE], velocity32_1[WGT_SIZE_1];
+PI_L1 fp16 wgt16_0[WGT_SIZE], wgt16_1[WGT_SIZE_1];
+PI_L1 fp16 diff16_0[WGT_SIZE], diff16_1[WGT_SIZE_1];
+PI_L1 float velocity16_0[WGT_SIZE], velocity16_1[WGT_SIZE_1];
+PI_L1 struct blob wgt32_blob[2];
+PI_L1 struct blob_fp16 wgt16_blob[2];
+PI_L1 struct blob * wgt32_list[2];
+PI_L1 struct blob_fp16 * wgt16_list[2];
+PI_L1 float * velocity32_list[2];
+PI_L1 float * velocity16_list[2];
+PI_L1 struct optim_multi_args opt32_args;
+PI_L1 struct optim_multi_args_fp16 opt16_args;
+PI_L1 float norm_partials[NUM_CORES];
+PI_L1 float grad_norm32 = 0;
+PI_L1 float grad_norm16 = 0;
+#elif TEST == ADAM || TEST == ADAMW
+// The FP32 and FP16 optimizers update two tensors, whose boundary falls inside the slice of a core
+PI_L1 float wgt32_0[WGT_SIZE], wgt32_1[WGT_SIZE_1];
+PI_L1 float diff32_0[WGT_SIZE], diff32_1[WGT_SIZE_1];
+PI_L1 float m32_0[WGT_SIZE], m32_1[WGT_SIZE_1];
+PI_L1 float v32_0[WGT_SIZE], v32_1[WGT_SIZE_1];
+PI_L1 fp16 wgt16_0[WGT_SIZE], wgt16_1[WGT_SIZE_1];
+PI_L1 fp16 diff16_0[WGT_SIZE], diff16_1[WGT_SIZE_1];
+PI_L1 float m16_0[WGT_SIZE], m16_1[WGT_SIZE_1];
+PI_L1 float v16_0[WGT_SIZE], v16_1[WGT_SIZE_1];
+PI_L1 struct blob wgt32_blob[2];
+PI_L1 struct blob_fp16 wgt16_blob[2];
+PI_L1 struct blob * wgt32_list[2];
+PI_L1 struct blob_fp16 * wgt16_list[2];
+PI_L1 float * m32_list[2];
+PI_L1 float * v32_list[2];
+PI_L1 float * m16_list[2];
+PI_L1 float * v16_list[2];
+PI_L1 struct optim_multi_args opt32_args;
+PI_L1 struct optim_multi_args_fp16 opt16_args;
+#if TEST == ADAM
+#define OPTIMIZER_FP32 pulp_adam_fp32
+#define OPTIMIZER_FP16 pulp_adam_fp16
+#else
+#define OPTIMIZER_FP32 pulp_adamw_fp32
+#define OPTIMIZER_FP16 pulp_adamw_fp16
+#endif
+#endif
+
+
+void prepare_data ()
+{
+    #if TEST == MIXED_PRECISION
+    for (int i=0; i<WGT_SIZE; i++)
+    {
+        wgt[i] = INIT_WEIGHTS[i];
+        wgt_diff[i] = 0;
+        velocity[i] = 0;
+    }
+
+    wgt_blob.data = wgt;
+    wgt_blob.diff = wgt_diff;
+    wgt_blob.dim = WGT_SIZE;
+
+    loss_args.output = &wgt_blob;
+    loss_args.target = LABEL;
+    loss_args.wr_loss = &loss;
+
+    wgt_list[0] = &wgt_blob;
+    master_list[0] = master;
+    velocity_list[0] = velocity;
+
+    scaler.weights = wgt_list;
+    scaler.n_tensors = 1;
+    scaler.output = &wgt_blob;
+    scaler.scale = INIT_SCALE;
+    scaler.growth_factor = GROWTH_FACTOR;
+    scaler.backoff_factor = BACKOFF_FACTOR;
+    scaler.growth_interval = GROWTH_INTERVAL;
+    scaler.good_steps = 0;
+    scaler.overflow = 0;
+
+    opt_args.weights = wgt_list;
+    opt_args.first_moment = velocity_list;
+    opt_args.second_moment = NULL;
+    opt_args.n_tensors = 1;
+    opt_args.learning_rate = LEARNING_RATE;
+    opt_args.momentum = MOMENTUM;
+    opt_args.weight_decay = 0;
+    opt_args.step = 1;
+    opt_args.master_weights = master_list;
+    opt_args.scaler = &scaler;
+    opt_args.rng_state = NULL;
+    opt_args.max_grad_norm = 0;
+    opt_args.grad_norm = NULL;
+    opt_args.norm_partials = NULL;
+
+    pi_cl_team_fork(NUM_CORES, pulp_init_master_weights_fp16, &opt_args);
+    #elif TEST == STOCHASTIC_ROUNDING
+    for (int i=0; i<WGT_SIZE; i++)  wgt[i] = INIT_WEIGHT;
+
+    wgt_blob.data = wgt;
+    wgt_blob.diff = GRADS;
+    wgt_blob.dim = WGT_SIZE;
+
+    sr_args.weights = &wgt_blob;
+    sr_args.learning_rate = LEARNING_RATE;
+    sr_args.rng_state = rng_state;
+
+    // Same seed, same rounding
+    pulp_sr_seed_fp16(rng_state, SEED);
+    #elif TEST == GRAD_CLIP
+    for (int i=0; i<WGT_SIZE; i++)
+    {
+        wgt32_0[i] = INIT_WEIGHTS_0[i];     wgt16_0[i] = INIT_WEIGHTS_0[i];
+        diff32_0[i] = GRADS_0[i];           diff16_0[i] = GRADS_0[i];
+        velocity32_0[i] = 0;                velocity16_0[i] = 0;
+    }
+    for (int i=0; i<WGT_SIZE_1; i++)
+    {
+        wgt32_1[i] = INIT_WEIGHTS_1[i];     wgt16_1[i] = INIT_WEIGHTS_1[i];
+        diff32_1[i] = GRADS_1[i];           diff16_1[i] = GRADS_1[i];
+        velocity32_1[i] = 0;                velocity16_1[i] = 0;
+    }
+
+    wgt32_blob[0].data = wgt32_0;   wgt32_blob[0].diff = diff32_0;  wgt32_blob[0].dim = WGT_SIZE;
+    wgt32_blob[1].data = wgt32_1;   wgt32_blob[1].diff = diff32_1;  wgt32_blob[1].dim = WGT_SIZE_1;
+    wgt16_blob[0].data = wgt16_0;   wgt16_blob[0].diff = diff16_0;  wgt16_blob[0].dim = WGT_SIZE;
+    wgt16_blob[1].data = wgt16_1;   wgt16_blob[1].diff = diff16_1;  wgt16_blob[1].dim = WGT_SIZE_1;
+    for (int n=0; n<2; n++)
+    {
+        wgt32_list[n] = &wgt32_blob[n];
+        wgt16_list[n] = &wgt16_blob[n];
+    }
+    velocity32_list[0] = velocity32_0;  velocity32_list[1] = velocity32_1;
+    velocity16_list[0] = velocity16_0;  velocity16_list[1] = velocity16_1;
+
+    opt32_args.weights = wgt32_list;
+    opt32_args.first_moment = velocity32_list;
+    opt32_args.second_moment = NULL;
+    opt32_args.n_tensors = 2;
+    opt32_args.learning_rate = LEARNING_RATE;
+    opt32_args.momentum = MOMENTUM;
+    opt32_args.weight_decay = 0;
+    opt32_args.step = 1;
+    opt32_args.max_grad_norm = MAX_GRAD_NORM;
+    opt32_args.grad_norm = &grad_norm32;
+    opt32_args.norm_partials = norm_partials;
+
+    opt16_args.weights = wgt16_list;
+    opt16_args.first_moment = velocity16_list;
+    opt16_args.second_moment = NULL;
+    opt16_args.n_tensors = 2;
+    opt16_args.learning_rate = LEARNING_RATE;
+    opt16_args.momentum = MOMENTUM;
+    opt16_args.weight_decay = 0;
+    opt16_args.step = 1;
+    opt16_args.master_weights = NULL;
+    opt16_args.scaler = NULL;
+    opt16_args.rng_state = NULL;
+    opt16_args.max_grad_norm = MAX_GRAD_NORM;
+    opt16_args.grad_norm = &grad_norm16;
+    opt16_args.norm_partials = norm_partials;
+    #elif TEST == ADAM || TEST == ADAMW
+    for (int i=0; i<WGT_SIZE; i++)
+    {
+        wgt32_0[i] = INIT_WEIGHTS_0[i];     wgt16_0[i] = INIT_WEIGHTS_0[i];
+        m32_0[i] = 0;   v32_0[i] = 0;       m16_0[i] = 0;   v16_0[i] = 0;
+    }
+    for (int i=0; i<WGT_SIZE_1; i++)
+    {
+        wgt32_1[i] = INIT_WEIGHTS_1[i];     wgt16_1[i] = INIT_WEIGHTS_1[i];
+        m32_1[i] = 0;   v32_1[i] = 0;       m16_1[i] = 0;   v16_1[i] = 0;
+    }
+
+    wgt32_blob[0].data = wgt32_0;   wgt32_blob[0].diff = diff32_0;  wgt32_blob[0].dim = WGT_SIZE;
+    wgt32_blob[1].data = wgt32_1;   wgt32_blob[1].diff = diff32_1;  wgt32_blob[1].dim = WGT_SIZE_1;
+    wgt16_blob[0].data = wgt16_0;   wgt16_blob[0].diff = diff16_0;  wgt16_blob[0].dim = WGT_SIZE;
+    wgt16_blob[1].data = wgt16_1;   wgt16_blob[1].diff = diff16_1;  wgt16_blob[1].dim = WGT_SIZE_1;
+    for (int n=0; n<2; n++)
+    {
+        wgt32_list[n] = &wgt32_blob[n];
+        wgt16_list[n] = &wgt16_blob[n];
+    }
+    m32_list[0] = m32_0;    m32_list[1] = m32_1;
+    v32_list[0] = v32_0;    v32_list[1] = v32_1;
+    m16_list[0] = m16_0;    m16_list[1] = m16_1;
+    v16_list[0] = v16_0;    v16_list[1] = v16_1;
+
+    opt32_args.weights = wgt32_list;
+    opt32_args.first_moment = m32_list;
+    opt32_args.second_moment = v32_list;
+    opt32_args.n_tensors = 2;
+    opt32_args.learning_rate = LEARNING_RATE;
+    opt32_args.momentum = 0;
+    opt32_args.beta1 = BETA1;
+    opt32_args.beta2 = BETA2;
+    opt32_args.epsilon = ADAM_EPSILON;
+    opt32_args.weight_decay = WEIGHT_DECAY;
+    opt32_args.step = 1;
+    opt32_args.max_grad_norm = 0;
+    opt32_args.grad_norm = NULL;
+    opt32_args.norm_partials = NULL;
+
+    opt16_args.weights = wgt16_list;
+    opt16_args.first_moment = m16_list;
+    opt16_args.second_moment = v16_list;
+    opt16_args.n_tensors = 2;
+    opt16_args.learning_rate = LEARNING_RATE;
+    opt16_args.momentum = 0;
+    opt16_args.beta1 = BETA1;
+    opt16_args.beta2 = BETA2;
+    opt16_args.epsilon = ADAM_EPSILON;
+    opt16_args.weight_decay = WEIGHT_DECAY;
+    opt16_args.step = 1;
+    opt16_args.master_weights = NULL;
+    opt16_args.scaler = NULL;
+    opt16_args.rng_state = NULL;
+    opt16_args.max_grad_norm = 0;
+    opt16_args.grad_norm = NULL;
+    opt16_args.norm_partials = NULL;
+    #endif
+}
+
+
+void train_step (int step)
+{
+    #if TEST == MIXED_PRECISION
+    // Forward and backward of the identity network
+    pulp_MSELoss_fp16(&loss_args);
+    pi_cl_team_fork(NUM_CORES, pulp_loss_scale_fp16, &scaler);
+    // Scaled gradients that overflowed skip the optimizer step
+    pi_cl_team_fork(NUM_CORES, pulp_grad_overflow_check_fp16, &scaler);
+    skip_log[step] = scaler.overflow;
+    pi_cl_team_fork(NUM_CORES, pulp_momentum_sgd_fp16, &opt_args);
+    pulp_loss_scaler_update_fp16(&scaler);
+    scale_log[step] = scaler.scale;
+    #elif TEST == STOCHASTIC_ROUNDING
+    for (int i=0; i<WGT_SIZE; i++)  exact[i] = (float) wgt[i] - LEARNING_RATE * (float) GRADS[i];
+    pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_sr_fp16, &sr_args);
+    // Each weight is one of the two FP16 neighbours of the exact update
+    for (int i=0; i<WGT_SIZE; i++)
+    {
+        int exp;
+        frexpf(exact[i], &exp);
+        float ulp = ldexpf(1.0f, exp-11);
+        float err = ((float) wgt[i] - exact[i]) / ulp;
+        if (err <= -1.0f || err >= 1.0f)
+        {
+            if (sr_errors == 0)  printf("Error at step %d, index %d: %f (Exact = %f)\n", step, i, (float) wgt[i], exact[i]);
+            sr_errors++;
+        }
+        sr_bias += err;
+    }
+    #elif TEST == GRAD_CLIP
+    // The gradients are not modified by the clipping, so that each step clips the same ones
+    pi_cl_team_fork(NUM_CORES, pulp_momentum_sgd_fp32, &opt32_args);
+    pi_cl_team_fork(NUM_CORES, pulp_momentum_sgd_fp16, &opt16_args);
+    #elif TEST == ADAM || TEST == ADAMW
+    // Gradient of 0.5*||w - target||^2, from the current weights
+    for (int i=0; i<WGT_SIZE; i++)
+    {
+        diff32_0[i] = wgt32_0[i] - TARGETS_0[i];
+        diff16_0[i] = (fp16) ((float) wgt16_0[i] - TARGETS_0[i]);
+    }
+    for (int i=0; i<WGT_SIZE_1; i++)
+    {
+        diff32_1[i] = wgt32_1[i] - TARGETS_1[i];
+        diff16_1[i] = (fp16) ((float) wgt16_1[i] - TARGETS_1[i]);
+    }
+    // Bias corrections of the (step+1)-th update
+    opt32_args.step = step+1;
+    opt16_args.step = step+1;
+    pi_cl_team_fork(NUM_CORES, OPTIMIZER_FP32, &opt32_args);
+    pi_cl_team_fork(NUM_CORES, OPTIMIZER_FP16, &opt16_args);
+    #endif
+}
+
+
+void net_step () {
+
+    #ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+    #endif
+
+    prepare_data();
+
+    #ifdef PROF_NET
+    START_STATS();
+    #endif
+
+    for (int step=0; step<STEPS; step++)  train_step(step);
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    #if TEST == MIXED_PRECISION
+    printf("\nChecking skipped steps and loss scale..\n");
+    int errors = 0;
+    for (int step=0; step<STEPS; step++)
+    {
+        printf("Step %d: scale %f, %s\n", step, scale_log[step], skip_log[step] ? "skipped" : "applied");
+        if (skip_log[step] != SKIPPED[step] || scale_log[step] != SCALES[step])
+        {
+            printf("Error at step %d: (Ideal = %s, scale %f)\n", step, SKIPPED[step] ? "skipped" : "applied", SCALES[step]);
+            errors++;
+        }
+    }
+    if (errors == 0)  printf("Loss scaling matches.\n");
+
+    printf("\nChecking master weights..\n");
+    verify_tensor(master, MASTER_WEIGHTS, WGT_SIZE, CHECK_TOLERANCE);
+
+    printf("\nChecking FP16 weights..\n");
+    verify_tensor_fp16(wgt, WEIGHTS, WGT_SIZE, FP16_TOLERANCE);
+
+    #elif TEST == STOCHASTIC_ROUNDING
+    // The rounding errors are in (-1, 1) ulps, with a standard deviation of at most 0.5 ulps: allow 4 sigmas of bias
+    const int samples = WGT_SIZE*STEPS;
+    float bias_tolerance = 2.0f / sqrtf((float) samples);
+    float mean = 0;
+    for (int i=0; i<WGT_SIZE; i++)  mean += (float) wgt[i];
+    mean /= WGT_SIZE;
+    float mean_tolerance = 2.0f * sqrtf((float) STEPS / WGT_SIZE) * WGT_ULP;
+
+    printf("\nChecking stochastic rounding..\n");
+    if (sr_errors > 0)  printf("%d updates are not within 1 ulp of the exact update!\n", sr_errors);
+    sr_bias /= samples;
+    printf("Mean rounding error: %f ulps (Tolerance = %f)\n", sr_bias, bias_tolerance);
+    if (fabsf(sr_bias) > bias_tolerance)  printf("Stochastic rounding is biased!\n");
+    printf("Mean weight: %f (Ideal = %f, Tolerance = %f)\n", mean, EXPECTED_MEAN, mean_tolerance);
+    if (fabsf(mean - EXPECTED_MEAN) > mean_tolerance)  printf("Mean weight does not match!\n");
+
+    // Rerun with the same seed
+    printf("\nChecking reproducibility..\n");
+    for (int i=0; i<WGT_SIZE; i++)  first_run[i] = wgt[i];
+    prepare_data();
+    for (int step=0; step<STEPS; step++)  train_step(step);
+    int mismatches = 0;
+    for (int i=0; i<WGT_SIZE; i++)  if (wgt[i] != first_run[i])  mismatches++;
+    if (mismatches > 0)  printf("%d weights differ with the same seed!\n", mismatches);
+    else  printf("Same seed, same weights.\n");
+
+    #elif TEST == GRAD_CLIP
+    printf("\nChecking the gradient norm (max_grad_norm = %f)..\n", MAX_GRAD_NORM);
+    printf("FP32: %f, FP16: %f (Ideal = %f)\n", grad_norm32, grad_norm16, GRAD_NORM);
+    if (fabsf(grad_norm32 - GRAD_NORM) > CHECK_TOLERANCE * GRAD_NORM)  printf("FP32 gradient norm does not match!\n");
+    if (fabsf(grad_norm16 - GRAD_NORM) > CHECK_TOLERANCE * GRAD_NORM)  printf("FP16 gradient norm does not match!\n");
+
+    printf("\nChecking FP32 weights..\n");
+    verify_tensor(wgt32_0, WEIGHTS_0, WGT_SIZE, CHECK_TOLERANCE);
+    verify_tensor(wgt32_1, WEIGHTS_1, WGT_SIZE_1, CHECK_TOLERANCE);
+
+    printf("\nChecking FP16 weights..\n");
+    verify_tensor_fp16(wgt16_0, WEIGHTS16_0, WGT_SIZE, FP16_TOLERANCE);
+    verify_tensor_fp16(wgt16_1, WEIGHTS16_1, WGT_SIZE_1, FP16_TOLERANCE);
+
+    #elif TEST == ADAM || TEST == ADAMW
+    printf("\nChecking FP32 weights..\n");
+    verify_tensor(wgt32_0, WEIGHTS_0, WGT_SIZE, CHECK_TOLERANCE);
+    verify_tensor(wgt32_1, WEIGHTS_1, WGT_SIZE_1, CHECK_TOLERANCE);
+
+    printf("\nChecking FP32 moments..\n");
+    verify_tensor(m32_0, FIRST_MOMENT_0, WGT_SIZE, CHECK_TOLERANCE);
+    verify_tensor(m32_1, FIRST_MOMENT_1, WGT_SIZE_1, CHECK_TOLERANCE);
+    verify_tensor(v32_0, SECOND_MOMENT_0, WGT_SIZE, CHECK_TOLERANCE);
+    verify_tensor(v32_1, SECOND_MOMENT_1, WGT_SIZE_1, CHECK_TOLERANCE);
+
+    printf("\nChecking FP16 weights..\n");
+    verify_tensor_fp16(wgt16_0, WEIGHTS16_0, WGT_SIZE, FP16_TOLERANCE);
+    verify_tensor_fp16(wgt16_1, WEIGHTS16_1, WGT_SIZE_1, FP16_TOLERANCE);
+    #endif
+
+    return;
+}
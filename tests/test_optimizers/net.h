@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensor checksum definition (FP32 master weights and their FP16 copies)
+#define CHECK_TOLERANCE 1e-4
+#define ERROR_TOLERANCE 1e-4
+#define FP16_TOLERANCE 1e-2
+
+// PULP DEFINES
+#define STACK_SIZE      4096
+#define MOUNT           1
+#define UNMOUNT         0
+#define CID             0
+
+// Test defines
+#define MIXED_PRECISION 0
+#define STOCHASTIC_ROUNDING 1
+#define GRAD_CLIP 2
+#define ADAM 3
+#define ADAMW 4
+
+void net_step();
@@ -0,0 +1,259 @@
+'''
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+'''
+
+
+"""
+    This script generates the golden model of the optimizer tests
+"""
+
+import torch
+import torch.nn as nn
+import torch.optim as optim
+import argparse
+import dump_utils as dump
+
+
+parser = argparse.ArgumentParser("Optimizers test")
+parser.add_argument( '--wgt_size', type=int, default=16 )
+parser.add_argument( '--steps', type=int, default=8 )
+parser.add_argument( '--test', type=str, default='MIXED_PRECISION')
+parser.add_argument( '--num_cores', type=int, default=8 )
+
+args = parser.parse_args()
+
+wgt_size = args.wgt_size
+steps = args.steps
+test = args.test
+num_cores = args.num_cores
+
+f = open("optim_data.h", "w")
+
+f.write("#define WGT_SIZE "+str(wgt_size)+"\n")
+f.write("#define STEPS "+str(steps)+"\n")
+
+if test == 'MIXED_PRECISION':
+    # Momentum SGD on FP32 master weights, with the same dynamic loss scaling of torch.cuda.amp.GradScaler
+    learning_rate = 0.5
+    momentum = 0.9
+    init_scale = 32768.0
+    growth_factor = 2.0
+    backoff_factor = 0.5
+    growth_interval = 2
+
+    # Identity network: the FP16 weights are the output of the MSE loss.
+    # The largest gradients (about 3) overflow in FP16 when scaled by 32768, but not by 16384.
+    weights = torch.zeros(wgt_size)
+    label = torch.zeros(wgt_size)
+    for i in range(wgt_size):
+        weights[i] = 0.25*(i%16) - 2
+        label[i] = weights[i] + (24 - 48*i/(wgt_size-1))*wgt_size/16
+    weights = weights.half().float()
+    label = label.half().float()
+
+    master = weights.clone()
+    master.requires_grad = True
+    optimizer = optim.SGD([master], lr=learning_rate, momentum=momentum)
+    loss_fn = nn.MSELoss()
+
+    scale = init_scale
+    good_steps = 0
+    skipped = []
+    scales = []
+    for step in range(steps):
+        # FP16 forward and backward, with the scaled FP16 gradient
+        wgt16 = master.detach().half().float()
+        wgt16.requires_grad = True
+        loss = loss_fn(wgt16, label)
+        loss.backward()
+        grad16 = wgt16.grad.half().float()
+        scaled = (grad16 * scale).half()
+        overflow = bool(torch.isinf(scaled).any() or torch.isnan(scaled).any())
+        skipped.append(1 if overflow else 0)
+        # Unscale in FP32 and update the master weights, unless the step overflowed
+        if not overflow:
+            master.grad = scaled.float() * (1.0 / scale)
+            optimizer.step()
+            good_steps += 1
+            if good_steps >= growth_interval:
+                # The PULP scaler keeps the scale representable in FP16
+                if scale * growth_factor <= 65504.0:
+                    scale *= growth_factor
+                good_steps = 0
+        else:
+            scale *= backoff_factor
+            good_steps = 0
+        scales.append(scale)
+
+    print("Skipped steps: ", skipped)
+    print("Scales: ", scales)
+
+    f.write("#define LEARNING_RATE "+str(learning_rate)+"f\n")
+    f.write("#define MOMENTUM "+str(momentum)+"f\n")
+    f.write("#define INIT_SCALE "+str(init_scale)+"f\n")
+    f.write("#define GROWTH_FACTOR "+str(growth_factor)+"f\n")
+    f.write("#define BACKOFF_FACTOR "+str(backoff_factor)+"f\n")
+    f.write("#define GROWTH_INTERVAL "+str(growth_interval)+"\n")
+    f.write("PI_L2 fp16 INIT_WEIGHTS[WGT_SIZE] = {"+dump.tensor_to_string(weights)+"};\n")
+    f.write("PI_L1 fp16 LABEL[WGT_SIZE] = {"+dump.tensor_to_string(label)+"};\n")
+    f.write("PI_L2 int SKIPPED[STEPS] = {"+", ".join(str(s) for s in skipped)+"};\n")
+    f.write("PI_L2 float SCALES[STEPS] = {"+", ".join(str(s)+"f" for s in scales)+"};\n")
+    f.write("PI_L2 float MASTER_WEIGHTS[WGT_SIZE] = {"+dump.tensor_to_string(master.detach())+"};\n")
+    f.write("PI_L2 fp16 WEIGHTS[WGT_SIZE] = {"+dump.tensor_to_string(master.detach().half().float())+"};\n")
+
+elif test == 'STOCHASTIC_ROUNDING':
+    # Updates of 0.25-0.44 FP16 ulps, that round to nearest would always discard
+    seed = 1234
+    init_weight = 1.5
+    ulp = 2.0**-10      # FP16 ulp in [1, 2)
+    learning_rate = 2.0**-12
+    grads = torch.zeros(wgt_size)
+    for i in range(wgt_size):
+        grads[i] = 1 + (i%7)/8
+    # Stochastic rounding is unbiased: the expected weights follow the FP32 updates
+    expected = init_weight - steps*learning_rate*grads
+    if init_weight - steps*learning_rate*2 < 1:
+        print("[GM.py] Too many steps, the weights leave [1, 2)!!")
+        exit()
+
+    f.write("#define SEED "+str(seed)+"\n")
+    f.write("#define INIT_WEIGHT "+str(init_weight)+"f\n")
+    f.write("#define WGT_ULP "+str(ulp)+"f\n")
+    f.write("#define LEARNING_RATE "+str(learning_rate)+"f\n")
+    f.write("PI_L1 fp16 GRADS[WGT_SIZE] = {"+dump.tensor_to_string(grads)+"};\n")
+    f.write("#define EXPECTED_MEAN "+str(torch.mean(expected).item())+"f\n")
+
+elif test == 'GRAD_CLIP':
+    # Momentum SGD on two tensors, whose global gradient norm is above max_grad_norm
+    learning_rate = 0.1
+    momentum = 0.9
+    sizes = [wgt_size, wgt_size//2 + 3]
+    weights = []
+    grads = []
+    for n in range(2):
+        w = torch.zeros(sizes[n])
+        g = torch.zeros(sizes[n])
+        for i in range(sizes[n]):
+            w[i] = ((i+n) % 8 - 4) * 0.125
+            g[i] = ((7*i + 3*n) % 13 - 6) * 0.125
+        weights.append(w)
+        grads.append(g)
+    norm = torch.sqrt(sum(torch.sum(g*g) for g in grads)).item()
+    max_grad_norm = 0.25 * norm
+
+    # FP32: torch.nn.utils.clip_grad_norm_ before each step, with the same gradients
+    params = [w.clone().requires_grad_(True) for w in weights]
+    optimizer = optim.SGD(params, lr=learning_rate, momentum=momentum)
+    for step in range(steps):
+        for p, g in zip(params, grads):
+            p.grad = g.clone()
+        grad_norm = nn.utils.clip_grad_norm_(params, max_grad_norm).item()
+        optimizer.step()
+
+    # FP16: same clipped gradients, updates computed in FP32 and rounded to FP16 (no master weights)
+    wgt16 = [w.half().float() for w in weights]
+    velocity = [torch.zeros(sz) for sz in sizes]
+    params16 = [torch.zeros(sz, requires_grad=True) for sz in sizes]
+    for p, g in zip(params16, grads):
+        p.grad = g.clone()
+    nn.utils.clip_grad_norm_(params16, max_grad_norm)
+    for step in range(steps):
+        for n in range(2):
+            velocity[n] = momentum * velocity[n] + params16[n].grad
+            wgt16[n] = (wgt16[n] - learning_rate * velocity[n]).half().float()
+
+    print("Gradient norm: ", grad_norm, ", max_grad_norm: ", max_grad_norm)
+
+    f.write("#define WGT_SIZE_1 "+str(sizes[1])+"\n")
+    f.write("#define LEARNING_RATE "+str(learning_rate)+"f\n")
+    f.write("#define MOMENTUM "+str(momentum)+"f\n")
+    f.write("#define MAX_GRAD_NORM "+str(max_grad_norm)+"f\n")
+    f.write("#define GRAD_NORM "+str(grad_norm)+"f\n")
+    for n in range(2):
+        size = "WGT_SIZE" if n == 0 else "WGT_SIZE_1"
+        f.write("PI_L2 float INIT_WEIGHTS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(weights[n])+"};\n")
+        f.write("PI_L2 float GRADS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(grads[n])+"};\n")
+        f.write("PI_L2 float WEIGHTS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(params[n].detach())+"};\n")
+        f.write("PI_L2 fp16 WEIGHTS16_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(wgt16[n])+"};\n")
+
+elif test in ['ADAM', 'ADAMW']:
+    # Adam or AdamW with weight decay, on two tensors whose boundary falls inside the slice of a core
+    learning_rate = 0.01
+    beta1 = 0.9
+    beta2 = 0.999
+    epsilon = 1e-8
+    weight_decay = 0.1
+    sizes = [wgt_size, wgt_size//2 + 3]
+    block = (sum(sizes) + num_cores - 1) // num_cores
+    if sizes[0] % block == 0:
+        print("[GM.py] The tensor boundary is aligned to the slices of "+str(num_cores)+" cores, change wgt_size!!")
+        exit()
+    weights = []
+    targets = []
+    for n in range(2):
+        w = torch.zeros(sizes[n])
+        t = torch.zeros(sizes[n])
+        for i in range(sizes[n]):
+            w[i] = ((i+n) % 8 - 4) * 0.125
+            t[i] = ((7*i + 3*n) % 13 - 6) * 0.125
+        weights.append(w)
+        targets.append(t)
+
+    def make_optimizer(params):
+        if test == 'ADAM':
+            return optim.Adam(params, lr=learning_rate, betas=(beta1, beta2), eps=epsilon, weight_decay=weight_decay)
+        return optim.AdamW(params, lr=learning_rate, betas=(beta1, beta2), eps=epsilon, weight_decay=weight_decay)
+
+    # Each step uses the gradient of 0.5*||w - target||^2, computed from the current weights
+    # FP32 weights
+    params = [w.clone().requires_grad_(True) for w in weights]
+    optimizer = make_optimizer(params)
+    for step in range(steps):
+        for p, t in zip(params, targets):
+            p.grad = p.detach() - t
+        optimizer.step()
+
+    # FP16 weights (no master weights): FP16 gradients, updates computed in FP32 and rounded to FP16
+    params16 = [w.half().float().requires_grad_(True) for w in weights]
+    optimizer16 = make_optimizer(params16)
+    for step in range(steps):
+        for p, t in zip(params16, targets):
+            p.grad = (p.detach() - t).half().float()
+        optimizer16.step()
+        with torch.no_grad():
+            for p in params16:
+                p.copy_(p.half().float())
+
+    f.write("#define WGT_SIZE_1 "+str(sizes[1])+"\n")
+    f.write("#define LEARNING_RATE "+str(learning_rate)+"f\n")
+    f.write("#define BETA1 "+str(beta1)+"f\n")
+    f.write("#define BETA2 "+str(beta2)+"f\n")
+    f.write("#define ADAM_EPSILON "+str(epsilon)+"f\n")
+    f.write("#define WEIGHT_DECAY "+str(weight_decay)+"f\n")
+    for n in range(2):
+        size = "WGT_SIZE" if n == 0 else "WGT_SIZE_1"
+        state = optimizer.state[params[n]]
+        f.write("PI_L2 float INIT_WEIGHTS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(weights[n])+"};\n")
+        f.write("PI_L2 float TARGETS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(targets[n])+"};\n")
+        f.write("PI_L2 float WEIGHTS_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(params[n].detach())+"};\n")
+        f.write("PI_L2 float FIRST_MOMENT_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(state['exp_avg'])+"};\n")
+        f.write("PI_L2 float SECOND_MOMENT_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(state['exp_avg_sq'])+"};\n")
+        f.write("PI_L2 fp16 WEIGHTS16_"+str(n)+"["+size+"] = {"+dump.tensor_to_string(params16[n].detach())+"};\n")
+
+else:
+    print("[GM.py] Invalid test selection!!")
+    exit()
+
+f.close()
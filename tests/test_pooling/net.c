@@ -23,8 +23,10 @@
 #include "pool_data.h"
 
 // Inout data
+#if DATA_TYPE == FP32
 PI_L1 struct pool_args maxargs; 
 PI_L1 struct pool_args avgargs;
+PI_L1 struct gap_linear_args gapargs;
 
 PI_L1 struct blob maxin_blob;
 PI_L1 struct blob maxout_blob;
@@ -38,6 +40,45 @@ PI_L1 float avgout[OUT_SIZE];
 PI_L1 float avgout_grad[OUT_SIZE];
 PI_L1 float avgin_grad[IN_SIZE];
 
+PI_L1 struct blob gapin_blob;
+PI_L1 struct blob gappooled_blob;
+PI_L1 struct blob gapwgt_blob;
+PI_L1 struct blob gapout_blob;
+PI_L1 float gappooled[Tin_C];
+PI_L1 float gapout[Tgap_out];
+PI_L1 float gapwgt_grad[Tgap_out*Tin_C];
+PI_L1 float gapin_grad[IN_SIZE];
+#elif DATA_TYPE == FP16
+PI_L1 struct pool_args_fp16 maxargs; 
+PI_L1 struct pool_args_fp16 avgargs;
+PI_L1 struct gap_linear_args_fp16 gapargs;
+
+PI_L1 struct blob_fp16 maxin_blob;
+PI_L1 struct blob_fp16 maxout_blob;
+PI_L1 fp16 maxout[OUT_SIZE];
+PI_L1 fp16 maxout_grad[OUT_SIZE];
+PI_L1 fp16 maxin_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 avgin_blob;
+PI_L1 struct blob_fp16 avgout_blob;
+PI_L1 fp16 avgout[OUT_SIZE];
+PI_L1 fp16 avgout_grad[OUT_SIZE];
+PI_L1 fp16 avgin_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 gapin_blob;
+PI_L1 struct blob_fp16 gappooled_blob;
+PI_L1 struct blob_fp16 gapwgt_blob;
+PI_L1 struct blob_fp16 gapout_blob;
+PI_L1 fp16 gappooled[Tin_C];
+PI_L1 fp16 gapout[Tgap_out];
+PI_L1 fp16 gapwgt_grad[Tgap_out*Tin_C];
+PI_L1 fp16 gapin_grad[IN_SIZE];
+#endif
+
+#if ARGMAX == 1
+PI_L1 uint16_t maxout_argmax[OUT_SIZE];   // Large enough for both uint8_t and uint16_t indices
+#endif
+
 
 
 void prepare_data ()
@@ -45,10 +86,17 @@ void prepare_data ()
     for (int i=0; i<OUT_SIZE; i++) 
     {
         maxout[i] = 0;
-        maxin_grad[i] = 0;
         avgout[i] = 0;
+    }
+    for (int i=0; i<IN_SIZE; i++) 
+    {
+        maxin_grad[i] = 0;
         avgin_grad[i] = 0;
+        gapin_grad[i] = 0;
     }
+    for (int i=0; i<Tin_C; i++)             gappooled[i] = 0;
+    for (int i=0; i<Tgap_out; i++)          gapout[i] = 0;
+    for (int i=0; i<Tgap_out*Tin_C; i++)    gapwgt_grad[i] = 0;
 
     // Maxpool args
     maxin_blob.data = MAXIN;
@@ -71,6 +119,16 @@ void prepare_data ()
     maxargs.Wker = Tker_W;
     maxargs.Hstride = H_STR;
     maxargs.Wstride = W_STR;
+    maxargs.Lpad = PAD;
+    maxargs.Rpad = PAD;
+    maxargs.Upad = PAD;
+    maxargs.Dpad = PAD;
+    maxargs.HWC = HWC_LAYOUT;
+    #if ARGMAX == 1
+    maxargs.argmax = maxout_argmax;
+    #else
+    maxargs.argmax = NULL;
+    #endif
 
     // Avgpool args
     avgin_blob.data = AVGIN;
@@ -93,6 +151,47 @@ void prepare_data ()
     avgargs.Wker = Tker_W;
     avgargs.Hstride = H_STR;
     avgargs.Wstride = W_STR;
+    avgargs.Lpad = PAD;
+    avgargs.Rpad = PAD;
+    avgargs.Upad = PAD;
+    avgargs.Dpad = PAD;
+    avgargs.HWC = HWC_LAYOUT;
+    avgargs.argmax = NULL;
+
+    // Global Average Pooling + Fully-Connected args (same input as the average pooling)
+    gapin_blob.data = AVGIN;
+    gapin_blob.diff = gapin_grad;
+    gapin_blob.dim = Tin_C*Tin_H*Tin_W;
+    gapin_blob.H = Tin_H;
+    gapin_blob.W = Tin_W;
+    gapin_blob.C = Tin_C;
+
+    gappooled_blob.data = gappooled;
+    gappooled_blob.dim = Tin_C;
+    gappooled_blob.H = 1;
+    gappooled_blob.W = 1;
+    gappooled_blob.C = Tin_C;
+
+    gapwgt_blob.data = GAPWGT;
+    gapwgt_blob.diff = gapwgt_grad;
+    gapwgt_blob.dim = Tgap_out*Tin_C;
+    gapwgt_blob.H = Tgap_out;
+    gapwgt_blob.W = Tin_C;
+    gapwgt_blob.C = 1;
+
+    gapout_blob.data = gapout;
+    gapout_blob.diff = GAPOUTPUT_GRAD;
+    gapout_blob.dim = Tgap_out;
+    gapout_blob.H = 1;
+    gapout_blob.W = 1;
+    gapout_blob.C = Tgap_out;
+
+    gapargs.input = &gapin_blob;
+    gapargs.pooled = &gappooled_blob;
+    gapargs.coeff = &gapwgt_blob;
+    gapargs.output = &gapout_blob;
+    gapargs.HWC = HWC_LAYOUT;
+    gapargs.skip_in_grad = 0;
 }
 
 
@@ -113,28 +212,44 @@ void net_step () {
     START_STATS();
     #endif
 
+    #if DATA_TYPE == FP32
     pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp32_fw_cl, &maxargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp16_fw_cl, &maxargs);
+    #endif
     
     #ifdef PROF_NET
     STOP_STATS();
     #endif
 
     printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
     verify_tensor(maxout, MAXOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(maxout, MAXOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #endif
 
     #ifdef PROF_NET
     printf("\nBackward stats: \n");
     START_STATS();
     #endif
     
+    #if DATA_TYPE == FP32
     pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp32_bw_cl, &maxargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_maxpool_fp16_bw_cl, &maxargs);
+    #endif
 
     #ifdef PROF_NET
     STOP_STATS();
     #endif
 
     printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
     verify_tensor(maxin_grad, MAXIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(maxin_grad, MAXIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #endif
 
 
 
@@ -147,28 +262,100 @@ void net_step () {
     START_STATS();
     #endif
 
+    #if DATA_TYPE == FP32
     pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp32_fw_cl, &avgargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp16_fw_cl, &avgargs);
+    #endif
     
     #ifdef PROF_NET
     STOP_STATS();
     #endif
 
     printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
     verify_tensor(avgout, AVGOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(avgout, AVGOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+    #endif
 
     #ifdef PROF_NET
     printf("\nBackward stats: \n");
     START_STATS();
     #endif
     
+    #if DATA_TYPE == FP32
     pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp32_bw_cl, &avgargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_avgpool_fp16_bw_cl, &avgargs);
+    #endif
 
     #ifdef PROF_NET
     STOP_STATS();
     #endif
 
     printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
     verify_tensor(avgin_grad, AVGIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(avgin_grad, AVGIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+    #endif
+
+
+
+
+    printf("\n----- GLOBAL AVGPOOL + LINEAR RESULTS -----\n");
+
+    #ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+    #endif
+
+    #if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp32_fw_cl, &gapargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp16_fw_cl, &gapargs);
+    #endif
+    
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking output..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(gapout, GAPOUTPUT, Tgap_out, GAP_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(gapout, GAPOUTPUT, Tgap_out, GAP_TOLERANCE);
+    #endif
+
+    #ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+    #endif
+    
+    #if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp32_bw_cl, &gapargs);
+    #elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_gap_linear_fp16_bw_cl, &gapargs);
+    #endif
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    printf("\nChecking weight grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(gapwgt_grad, GAPWGT_GRAD, Tgap_out*Tin_C, GAP_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(gapwgt_grad, GAPWGT_GRAD, Tgap_out*Tin_C, GAP_TOLERANCE);
+    #endif
+
+    printf("\nChecking in grad..\n");
+    #if DATA_TYPE == FP32
+    verify_tensor(gapin_grad, GAPIN_GRAD, IN_SIZE, GAP_TOLERANCE);
+    #elif DATA_TYPE == FP16
+    verify_tensor_fp16(gapin_grad, GAPIN_GRAD, IN_SIZE, GAP_TOLERANCE);
+    #endif
 
 
 
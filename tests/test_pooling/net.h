@@ -14,11 +14,20 @@
  * limitations under the License.
  */
 
-// User profiling flags
-#define FLOAT32
+// Data types
+#define FP32 32
+#define FP16 16
+
 // Tensor checksum definition
-#define CHECK_TOLERANCE 1e-12
-#define ERROR_TOLERANCE 1e-12
+#if DATA_TYPE == FP32
+    #define CHECK_TOLERANCE 1e-12
+    #define ERROR_TOLERANCE 1e-12
+    #define GAP_TOLERANCE 1e-5
+#elif DATA_TYPE == FP16
+    #define CHECK_TOLERANCE 1e-3
+    #define ERROR_TOLERANCE 1e-3
+    #define GAP_TOLERANCE 5e-2
+#endif
 
 // PULP DEFINES
 #define STACK_SIZE      4096
@@ -32,12 +32,16 @@ import dump_utils as dump
 parser = argparse.ArgumentParser("Pooling tests")
 parser.add_argument( '--in_h', type=int, default=16 )
 parser.add_argument( '--in_w', type=int, default=16 )
-parser.add_argument( '--in_c', type=int, default=8 )
+parser.add_argument( '--in_c', type=int, default=5 )
 parser.add_argument( '--ker_h', type=int, default=2 )
 parser.add_argument( '--ker_w', type=int, default=2 )
 parser.add_argument( '--stride_h', type=int, default=1 )
 parser.add_argument( '--stride_w', type=int, default=1 )
 parser.add_argument( '--value', type=float, default=0.5 )
+parser.add_argument( '--pad', type=int, default=0 )     # Padding on all sides
+parser.add_argument( '--hwc', type=int, default=0 )     # 1: dump the tensors in HWC layout
+parser.add_argument( '--gap_out', type=int, default=10 ) # Outputs of the Fully-Connected layer after the Global Average Pooling
+parser.add_argument( '--data_type', type=str, default='FP32' )  # FP32 or FP16
 
 args = parser.parse_args()
 
@@ -49,6 +53,13 @@ ker_w = args.ker_w
 stride_h = args.stride_h
 stride_w = args.stride_w
 value = args.value
+pad = args.pad
+hwc = args.hwc
+gap_out = args.gap_out
+data_type = args.data_type
+dtype = 'fp16' if data_type == 'FP16' else 'float'
+out_h = int((in_h+2*pad-ker_h+stride_h)/stride_h)
+out_w = int((in_w+2*pad-ker_w+stride_w)/stride_w)
 
 # Fake output tensor
 maxinput = torch.ones(in_c, in_h, in_w)
@@ -60,8 +71,8 @@ with torch.no_grad():
                 maxinput[k, i, j] += (i+j+k)*value
                 avginput[k, i, j] += (i+j+k)*value
 # Fake label
-maxlabel = torch.ones(in_c, int((in_h-ker_h+stride_h)/stride_h), int((in_w-ker_w+stride_w)/stride_w))
-avglabel = torch.ones(in_c, int((in_h-ker_h+stride_h)/stride_h), int((in_w-ker_w+stride_w)/stride_w))
+maxlabel = torch.ones(in_c, out_h, out_w)
+avglabel = torch.ones(in_c, out_h, out_w)
 
 print("maxlabel:")
 print(maxlabel.size())
@@ -78,7 +89,7 @@ loss_fn = nn.MSELoss()
 class MaxPool (nn.Module):
     def __init__(self):
         super(MaxPool, self).__init__()
-        self.maxpool = nn.MaxPool2d((ker_h, ker_w), (stride_h, stride_w))
+        self.maxpool = nn.MaxPool2d((ker_h, ker_w), (stride_h, stride_w), pad)
     def forward(self, x):
         out = self.maxpool(x)
         return out
@@ -86,7 +97,7 @@ class MaxPool (nn.Module):
 class AvgPool (nn.Module):
     def __init__(self):
         super(AvgPool, self).__init__()
-        self.avgpool = nn.AvgPool2d((ker_h, ker_w), (stride_h, stride_w))
+        self.avgpool = nn.AvgPool2d((ker_h, ker_w), (stride_h, stride_w), pad)
     def forward(self, x):
         out = self.avgpool(x)
         return out
@@ -113,6 +124,22 @@ avgloss = loss_fn(avgout, avglabel)
 maxloss.backward()
 avgloss.backward()
 
+# Global Average Pooling fused with a Fully-Connected layer (no bias), on the average pooling input
+gapinput = avginput.detach().clone()
+gapinput.requires_grad = True
+gapweight = torch.zeros(gap_out, in_c)
+with torch.no_grad():
+    for o in range(gap_out):
+        for k in range(in_c):
+            gapweight[o, k] = ((o+k)%7 - 3) * 0.125
+gapweight.requires_grad = True
+gaplabel = torch.ones(gap_out)
+
+gapout = torch.matmul(gapweight, torch.mean(gapinput, dim=(1, 2)))
+gapout.retain_grad()
+gaploss = loss_fn(gapout, gaplabel)
+gaploss.backward()
+
 # print("\n*** MAXPOOL DATA ***")
 # print("MaxPool out is:")
 # print(maxout)
@@ -140,9 +167,11 @@ f.write("#define Tker_H "+str(ker_h)+"\n")
 f.write("#define Tker_W "+str(ker_w)+"\n")
 f.write("#define H_STR "+str(stride_h)+"\n")
 f.write("#define W_STR "+str(stride_w)+"\n")
-f.write("#define Tout_H ((Tin_H-Tker_H+H_STR)/H_STR)\n")
-f.write("#define Tout_W ((Tin_W-Tker_W+W_STR)/W_STR)\n")
+f.write("#define PAD "+str(pad)+"\n")
+f.write("#define Tout_H ((Tin_H-Tker_H+2*PAD+H_STR)/H_STR)\n")
+f.write("#define Tout_W ((Tin_W-Tker_W+2*PAD+W_STR)/W_STR)\n")
 f.write("#define Tout_C Tin_C\n")
+f.write("#define Tgap_out "+str(gap_out)+"\n")
 
 f.close()
 
@@ -150,20 +179,31 @@ f.close()
 f = open("pool_data.h", "w")
 
 f.write("#define IN_SIZE "+str(in_c*in_h*in_w)+"\n")
-f.write("#define OUT_SIZE "+str(in_c*int((in_h-ker_h+stride_h)/stride_h)*int((in_w-ker_w+stride_w)/stride_w))+"\n")
-
-f.write("PI_L2 float MAXLOSS = {"+str(maxloss.data.item())+"};\n")
-f.write("PI_L2 float MAXOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(maxout)+"};\n")
-f.write("PI_L2 float MAXOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(maxout.grad)+"};\n")
-f.write("PI_L1 float MAXIN[IN_SIZE] = {"+dump.tensor_to_string(maxinput)+"};\n")
-f.write("PI_L2 float MAXIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(maxinput.grad)+"};\n")
-f.write("PI_L1 float MAXLABEL[OUT_SIZE] = {"+dump.tensor_to_string(maxlabel)+"};\n")
-
-f.write("PI_L2 float AVGLOSS = {"+str(avgloss.data.item())+"};\n")
-f.write("PI_L2 float AVGOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(avgout)+"};\n")
-f.write("PI_L2 float AVGOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(avgout.grad)+"};\n")
-f.write("PI_L1 float AVGIN[IN_SIZE] = {"+dump.tensor_to_string(avginput)+"};\n")
-f.write("PI_L2 float AVGIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(avginput.grad)+"};\n")
-f.write("PI_L1 float AVGLABEL[OUT_SIZE] = {"+dump.tensor_to_string(avglabel)+"};\n")
+f.write("#define OUT_SIZE "+str(in_c*out_h*out_w)+"\n")
+
+# CHW to HWC
+def layout(t):
+    return t.permute(1, 2, 0) if hwc == 1 else t
+
+
+f.write("PI_L2 "+dtype+" MAXLOSS = {"+str(maxloss.data.item())+"};\n")
+f.write("PI_L2 "+dtype+" MAXOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(layout(maxout))+"};\n")
+f.write("PI_L2 "+dtype+" MAXOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(layout(maxout.grad))+"};\n")
+f.write("PI_L1 "+dtype+" MAXIN[IN_SIZE] = {"+dump.tensor_to_string(layout(maxinput))+"};\n")
+f.write("PI_L2 "+dtype+" MAXIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(layout(maxinput.grad))+"};\n")
+f.write("PI_L1 "+dtype+" MAXLABEL[OUT_SIZE] = {"+dump.tensor_to_string(layout(maxlabel))+"};\n")
+
+f.write("PI_L2 "+dtype+" AVGLOSS = {"+str(avgloss.data.item())+"};\n")
+f.write("PI_L2 "+dtype+" AVGOUTPUT[OUT_SIZE] = {"+dump.tensor_to_string(layout(avgout))+"};\n")
+f.write("PI_L2 "+dtype+" AVGOUTPUT_GRAD[OUT_SIZE] = {"+dump.tensor_to_string(layout(avgout.grad))+"};\n")
+f.write("PI_L1 "+dtype+" AVGIN[IN_SIZE] = {"+dump.tensor_to_string(layout(avginput))+"};\n")
+f.write("PI_L2 "+dtype+" AVGIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(layout(avginput.grad))+"};\n")
+f.write("PI_L1 "+dtype+" AVGLABEL[OUT_SIZE] = {"+dump.tensor_to_string(layout(avglabel))+"};\n")
+
+f.write("PI_L2 "+dtype+" GAPOUTPUT[Tgap_out] = {"+dump.tensor_to_string(gapout)+"};\n")
+f.write("PI_L2 "+dtype+" GAPOUTPUT_GRAD[Tgap_out] = {"+dump.tensor_to_string(gapout.grad)+"};\n")
+f.write("PI_L1 "+dtype+" GAPWGT[Tgap_out*Tin_C] = {"+dump.tensor_to_string(gapweight)+"};\n")
+f.write("PI_L2 "+dtype+" GAPWGT_GRAD[Tgap_out*Tin_C] = {"+dump.tensor_to_string(gapweight.grad)+"};\n")
+f.write("PI_L2 "+dtype+" GAPIN_GRAD[IN_SIZE] = {"+dump.tensor_to_string(layout(gapinput.grad))+"};\n")
 
 f.close()
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train.h"
+#include "math.h"
+
+#include "net.h"
+#include "stats.h"
+#include "reduce_data.h"
+
+
+// DATA DEFINITION
+#if DATA_TYPE == FP32
+PI_L1 struct reduce_args red_args;
+#define REDUCE pulp_reduce_cl
+#elif DATA_TYPE == FP16
+PI_L1 struct reduce_args_fp16 red_args;
+#define REDUCE pulp_reduce_fp16_cl
+#endif
+PI_L1 float partials[REDUCE_PARTIALS*NUM_CORES];
+PI_L1 float result;
+PI_L1 float var;
+PI_L1 int max_index;
+PI_L1 int errors = 0;
+
+
+static void check_value (const char * name, float value, float ideal)
+{
+    if (fabsf(value - ideal) > CHECK_TOLERANCE * fmaxf(1.0f, fabsf(ideal)))
+    {
+        printf("%s: %f (Ideal = %f)\n", name, value, ideal);
+        errors++;
+    }
+}
+
+
+// Runs all the reductions on the first dim elements of the input
+static void reduce_and_check (int dim, float sum, float max, int argmax, float sumsq, float mean, float variance)
+{
+    red_args.dim = dim;
+
+    red_args.op = REDUCE_SUM;
+    REDUCE(&red_args);
+    check_value("Sum", result, sum);
+
+    red_args.op = REDUCE_MAX;
+    REDUCE(&red_args);
+    check_value("Max", result, max);
+
+    // Ties are resolved with the first occurrence
+    max_index = -1;
+    red_args.op = REDUCE_ARGMAX;
+    REDUCE(&red_args);
+    check_value("Argmax value", result, max);
+    if (max_index != argmax)
+    {
+        printf("Argmax index: %d (Ideal = %d)\n", max_index, argmax);
+        errors++;
+    }
+
+    red_args.op = REDUCE_SUMSQ;
+    REDUCE(&red_args);
+    check_value("Sum of squares", result, sumsq);
+
+    red_args.op = REDUCE_MEAN_VAR;
+    REDUCE(&red_args);
+    check_value("Mean", result, mean);
+    check_value("Variance", var, variance);
+}
+
+
+void net_step () {
+
+    #ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+    #endif
+
+    red_args.input = INPUT;
+    red_args.partials = partials;
+    red_args.result = &result;
+    red_args.var = &var;
+    red_args.index = &max_index;
+
+    printf("\nChecking the reductions of %d elements..\n", DIM);
+
+    #ifdef PROF_NET
+    START_STATS();
+    #endif
+
+    reduce_and_check(DIM, SUM, MAX, ARGMAX, SUMSQ, MEAN, VAR);
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    // Fewer elements than cores: some of the cores reduce an empty slice
+    printf("\nChecking the reductions of %d elements on %d cores..\n", SMALL_DIM, NUM_CORES);
+    reduce_and_check(SMALL_DIM, SMALL_SUM, SMALL_MAX, SMALL_ARGMAX, SMALL_SUMSQ, SMALL_MEAN, SMALL_VAR);
+
+    if (errors == 0)  printf("\nAll the reductions match.\n");
+    else  printf("\n%d reductions do not match!\n", errors);
+
+    return;
+}
@@ -0,0 +1,77 @@
+'''
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+'''
+
+
+"""
+    This script generates the golden model of the reduction tests
+"""
+
+import torch
+import argparse
+import dump_utils as dump
+
+
+parser = argparse.ArgumentParser("Reduction tests")
+parser.add_argument( '--dim', type=int, default=37 )
+parser.add_argument( '--small_dim', type=int, default=5 )
+parser.add_argument( '--data_type', type=str, default='FP32' )  # FP32 or FP16
+
+args = parser.parse_args()
+
+dim = args.dim
+small_dim = args.small_dim
+data_type = args.data_type
+dtype = 'fp16' if data_type == 'FP16' else 'float'
+
+if small_dim < 4 or dim < small_dim + 4:
+    print("[GM.py] Invalid sizes: SMALL_DIM must be at least 4 and DIM at least SMALL_DIM+4!!")
+    exit()
+
+# Values around 10, to check the shifted mean/var against cancellations (exact in FP16)
+data = torch.zeros(dim)
+for i in range(dim):
+    data[i] = 10 + ((5*i) % 11 - 5) * 0.25
+# Ties of the max: the first occurrence is at index 1 in the prefix and at dim//2 in the whole tensor
+data[1] = data[3] = 12
+data[dim//2] = data[dim//2+1] = data[dim-1] = 13
+data = data.half().float()
+
+def argmax_first(t):
+    idx = 0
+    for i in range(t.numel()):
+        if t[i] > t[idx]:
+            idx = i
+    return idx
+
+f = open("reduce_data.h", "w")
+
+f.write("#define DIM "+str(dim)+"\n")
+f.write("#define SMALL_DIM "+str(small_dim)+"\n")
+# The v2f16 loads of the FP16 reductions need a 4-byte aligned input
+align = " __attribute__((aligned(4)))" if data_type == 'FP16' else ""
+f.write("PI_L1 "+dtype+" INPUT[DIM]"+align+" = {"+dump.tensor_to_string(data)+"};\n")
+
+# Golden values, on the whole tensor and on its prefix
+for name, t in (("", data), ("SMALL_", data[:small_dim])):
+    t = t.double()
+    f.write("#define "+name+"SUM "+str(torch.sum(t).item())+"f\n")
+    f.write("#define "+name+"MAX "+str(torch.max(t).item())+"f\n")
+    f.write("#define "+name+"ARGMAX "+str(argmax_first(t))+"\n")
+    f.write("#define "+name+"SUMSQ "+str(torch.sum(t*t).item())+"f\n")
+    f.write("#define "+name+"MEAN "+str(torch.mean(t).item())+"f\n")
+    f.write("#define "+name+"VAR "+str(torch.var(t, unbiased=False).item())+"f\n")
+
+f.close()
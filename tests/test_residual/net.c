@@ -52,14 +52,32 @@ void forward()
 
     #ifdef FLOAT32 
     pulp_conv2d_fp32_fw_cl(&conv1_args);
+    #if SUM_INPUTS == 3
+    pulp_sumnode_multi_fp32_fw(&sumnode_args);
+    #if FUSED == 0
+    pulp_relu_fp32_fw_cl(&relu_args);
+    #endif
+    #elif FUSED == 1
+    pulp_residualconn_relu_fp32_fw(&residual_args);
+    #else
     pulp_residualconn_fp32_fw(&residual_args);
     pulp_relu_fp32_fw_cl(&relu_args);
+    #endif
     pulp_MSELoss(&loss_args);
     
     #else //FLOAT16
     pulp_conv2d_fp16_fw_cl(&conv1_args);
+    #if SUM_INPUTS == 3
+    pulp_sumnode_multi_fp16_fw(&sumnode_args);
+    #if FUSED == 0
+    pulp_relu_fp16_fw_cl(&relu_args);
+    #endif
+    #elif FUSED == 1
+    pulp_residualconn_relu_fp16_fw(&residual_args);
+    #else
     pulp_residualconn_fp16_fw(&residual_args);
     pulp_relu_fp16_fw_cl(&relu_args);
+    #endif
     pulp_MSELoss_fp16(&loss_args);
     #endif
 
@@ -95,16 +113,34 @@ void backward()
 {
  
     #ifdef FLOAT32
+    #if FUSED == 1
+    pulp_residualconn_relu_fp32_bw(&residual_args);
+    #else
     pulp_relu_fp32_bw_cl(&relu_args);
     pulp_residualconn_fp32_bw(&residual_args);
+    #endif
     pulp_conv2d_fp32_bw_input_grads_cl(&conv1_args);
+    #if SUM_INPUTS == 3
+    // The conv output gradient is aliased, the others are accumulated
+    pulp_sumnode_multi_fp32_bw(&sumnode_args);
+    #else
     pulp_sumnode_fp32_bw(&residual_args);
+    #endif
 
     #else //FLOAT16
+    #if FUSED == 1
+    pulp_residualconn_relu_fp16_bw(&residual_args);
+    #else
     pulp_relu_fp16_bw_cl(&relu_args);
     pulp_residualconn_fp16_bw(&residual_args);
+    #endif
     pulp_conv2d_fp16_bw_input_grads_cl(&conv1_args);
-    pulp_sumnode_fp16_bw(&residual_args);   
+    #if SUM_INPUTS == 3
+    // The conv output gradient is aliased, the others are accumulated
+    pulp_sumnode_multi_fp16_bw(&sumnode_args);
+    #else
+    pulp_sumnode_fp16_bw(&residual_args);
+    #endif
     #endif
 
     #ifdef PROF_NET
@@ -124,8 +160,14 @@ void backward()
 
     #ifdef FLOAT32
     verify_tensor(input.diff, expected_input.diff, input.dim, (float) 1e-5);
+    #if SUM_INPUTS == 3
+    verify_tensor(input2.diff, expected_input2.diff, input2.dim, (float) 1e-5);
+    #endif
     #else
     verify_tensor_fp16(input.diff, expected_input.diff, input.dim, (fp16) 1e-5);
+    #if SUM_INPUTS == 3
+    verify_tensor_fp16(input2.diff, expected_input2.diff, input2.dim, (fp16) 1e-5);
+    #endif
     #endif
 
     //Error calculation
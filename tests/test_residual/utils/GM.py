@@ -21,6 +21,7 @@ parser.add_argument("-DATA_TYPE", type=str, default='FLOAT32')
 parser.add_argument("-USE_IM2COL", type=int, default=1)
 parser.add_argument("-USE_DMA", type=int, default=0)
 parser.add_argument("-MATMUL_TYPE", type=int, default=0)
+parser.add_argument("-SUM_INPUTS", type=int, default=2)
 parser.parse_args()
 args = parser.parse_args()
 
@@ -52,6 +53,8 @@ USE_DMA = args.USE_DMA
 
 MATMUL_TYPE=args.MATMUL_TYPE
 
+SUM_INPUTS = args.SUM_INPUTS
+
 data_type = str()
 if(FORMAT == 'FLOAT32'):
     data_type = 'float'
@@ -61,6 +64,9 @@ else:
 test_data = 100*torch.rand(CI, HI, WI)
 test_data.requires_grad = True
 test_labels = torch.rand(CO, HO, WO)
+# Third input of the sum node
+test_data2 = 100*torch.rand(CI, HI, WI)
+test_data2.requires_grad = True
 
 class Net(nn.Module):
     def __init__(self):
@@ -72,7 +78,7 @@ class Net(nn.Module):
         self.L = 0
 
 
-    def forward(self, X):
+    def forward(self, X, X2=None):
         print("INPUT:\n")
         print(X)
         conv_out1 = self.conv1(X)
@@ -83,6 +89,8 @@ class Net(nn.Module):
         print("CONV1 OUT:\n")
         print(conv_out1)
         res_out = conv_out1 + X
+        if X2 is not None:
+            res_out = res_out + X2
         print("RES OUT:\n")
         print(res_out)
         relu_out = self.relu(res_out)
@@ -101,7 +109,10 @@ class Net(nn.Module):
 
 net = Net()
 
-out = net(test_data)
+if SUM_INPUTS == 3:
+    out = net(test_data, test_data2)
+else:
+    out = net(test_data)
 
 net.Loss(out, test_labels)
 
@@ -121,6 +132,7 @@ f.write("#define WO "+str(WO)+"\n")
 f.write("#define KER_SIZE "+str(KER)+"\n")
 f.write("#define KER_DIM "+str(CI*CO*KER*KER)+"\n")
 f.write("#define PAD_SIZE "+str(PAD)+"\n")
+f.write("#define SUM_INPUTS "+str(SUM_INPUTS)+"\n")
 f.write(f"#define MATMUL_TYPE {MATMUL_TYPE} \n")
 f.write("#define " + FORMAT + "\n")
 f.write("#define " + STEP + "\n")
@@ -156,6 +168,13 @@ WriteArray(labels_array, "labels", f, data_type)
 in_grad_array = TensorToArray(test_data.grad, HWC)
 WriteArray(in_grad_array, "expected_input_diff", f, data_type)
 
+if SUM_INPUTS == 3:
+    in_data2_array = TensorToArray(test_data2, HWC)
+    WriteArray(in_data2_array, "input2_data", f, "PI_L1 " + data_type)
+
+    in_grad2_array = TensorToArray(test_data2.grad, HWC)
+    WriteArray(in_grad2_array, "expected_input2_diff", f, data_type)
+
 f.write(f"\n{data_type} expected_loss = {net.L};\n")
 
 conv_filters_array = []
@@ -31,6 +31,14 @@ PI_L1 float output_residual_diff[CO*WO*HO];
  PI_L1 float im2col_buff[I2C_SIZE];
  PI_L1 float bt_buffer[KER_SIZE*KER_SIZE*CI*CO];
 
+ #if SUM_INPUTS == 3
+ PI_L1 struct blob input2;
+ PI_L1 float input2_diff[CI*WI*HI];
+ struct blob expected_input2;
+ PI_L1 struct blob * sumnode_inputs[3];
+ PI_L1 struct SumNode_args sumnode_args;
+ #endif
+
 
 
 
@@ -66,6 +74,14 @@ PI_L1 fp16 output_residual_diff[CO*WO*HO];
 
  PI_L1 fp16 im2col_buff[I2C_SIZE];
  PI_L1 fp16 bt_buffer[KER_SIZE*KER_SIZE*CI*CO];
+
+ #if SUM_INPUTS == 3
+ PI_L1 struct blob_fp16 input2;
+ PI_L1 fp16 input2_diff[CI*WI*HI];
+ struct blob_fp16 expected_input2;
+ PI_L1 struct blob_fp16 * sumnode_inputs[3];
+ PI_L1 struct SumNode_args_fp16 sumnode_args;
+ #endif
 #endif
 
 
@@ -155,6 +171,44 @@ void prepare_data()
     relu_args.input = residual_args.output;
     relu_args.output = &relu_output;
 
+    #if FUSED == 1
+    // Fused residual + ReLU, the gradient of the conv output shares the buffer of the output gradient (no copy)
+    residual_args.output = &relu_output;
+    output_conv1.diff = relu_output_diff;
+    #endif
+
+    #if ALIAS == 1 || SUM_INPUTS == 3
+    // The gradient of the conv output shares the buffer of the residual output gradient (no copy)
+    output_conv1.diff = residual_args.output->diff;
+    #endif
+
+    #if SUM_INPUTS == 3
+    // Third input of the sum node
+    expected_input2.diff = expected_input2_diff;
+    expected_input2.C = CI;
+    expected_input2.W = WI;
+    expected_input2.H = HI;
+    expected_input2.dim = CI*HI*WI;
+
+    input2.C = CI;
+    input2.H = HI;
+    input2.W = WI;
+    input2.dim = CI*HI*WI;
+    input2.data = input2_data;
+    input2.diff = input2_diff;
+    for (int i=0; i<input2.dim; i++) input2_diff[i] = 0;
+
+    sumnode_inputs[0] = &input;
+    sumnode_inputs[1] = &output_conv1;
+    sumnode_inputs[2] = &input2;
+
+    sumnode_args.inputs = sumnode_inputs;
+    sumnode_args.n_inputs = 3;
+    sumnode_args.output = residual_args.output;
+    sumnode_args.relu = FUSED;
+    sumnode_args.accumulate = 1;
+    #endif
+
     loss_args.target = labels;
     loss_args.output = &relu_output;
     loss_args.wr_loss = &calculated_loss;
@@ -0,0 +1,183 @@
+'''
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+'''
+
+from copy import deepcopy
+import torch
+import torch.nn as nn
+import argparse
+import dump_utils as dump
+import numpy as np  # Matrix and vector computation package
+
+# Set the seed for reproducability
+np.random.seed(seed=1)
+
+
+##################################################################################################################################
+
+#Visualize data with more precision
+torch.set_printoptions(precision=10, sci_mode=False)
+
+parser = argparse.ArgumentParser("RNN Layer Test (FP16)")
+parser.add_argument( '--in_width', type=int, default=6)
+parser.add_argument( '--in_height', type=int, default=4)
+parser.add_argument( '--ch_in', type=int, default=1)
+parser.add_argument( '--ch_out', type=int, default=1)
+parser.add_argument( '--out_width', type=int, default=8)
+parser.add_argument( '--weight', type=float, default=0.1)
+parser.add_argument( '--step', type=str, default='FORWARD')     # Possible steps: FORWARD, BACKWARD
+parser.add_argument( '--bptt_window', type=int, default=0)      # Truncated BPTT window of the full sequence (0 = full BPTT)
+parser.add_argument( '--cell', type=int, default=0)             # Recurrent cell: 0 = RNN, 1 = LSTM (pulp_lstm_fp16), 2 = GRU (pulp_gru_fp16)
+
+args = parser.parse_args()
+
+# Network parameters in_size
+in_h = args.in_height
+in_w = args.in_width
+ch_in = args.ch_in
+ch_out = args.ch_out
+out_w = args.out_width
+current_step = args.step
+weight_init = args.weight
+bptt_window = args.bptt_window
+cell = args.cell
+
+# Net step
+f_step = open('step-check.h', 'w')
+f_step.write('#define ' + str(current_step) + '\n')
+f_step.close()
+
+# Data file
+f = open("init-defines.h", "w")
+
+f.write('#define Tin_C_l1 '+str(ch_in)+'\n')
+f.write('#define Tin_H_l1 '+str(in_h)+'\n')
+f.write('#define Tin_W_l1 '+str(in_w)+'\n')
+f.write('#define Tout_C_l1 '+str(ch_out)+'\n')
+f.write('#define Tout_W_l1 '+str(out_w)+'\n')
+
+f.close()
+
+# The golden model runs in FP32 on FP16-representable data, the results are then dumped as FP16
+class myNet(nn.Module):
+  def __init__(self, in_w, out_w):
+    super().__init__()
+    if cell == 1:
+      self.rnn = nn.LSTM(input_size=in_w, hidden_size=out_w, bias=False)
+    elif cell == 2:
+      self.rnn = nn.GRU(input_size=in_w, hidden_size=out_w, bias=False)
+    else:
+      self.rnn = nn.RNN(input_size=in_w, hidden_size=out_w, bias=False)
+
+  def forward(self, x, state):
+    return self.rnn(x, state)
+
+net = myNet(in_w=in_w, out_w=out_w)
+net.zero_grad()
+
+inp = torch.div(torch.ones(in_h, in_w), 1000)
+for hi in range(in_h):
+  for wi in range(in_w):
+    inp[hi, wi] += (hi - wi)*(hi + wi) * 1/1e5
+inp = inp.half().float()
+inp.requires_grad = True
+
+# Single initial state for the whole sequence
+state_0 = torch.div(torch.ones(1, 1, out_w), 1000)
+for wi in range(out_w):
+  state_0[0, 0, wi] += (-wi)*(wi) * 1/1e5
+state_0 = state_0.half().float()
+state_0.requires_grad = True
+
+label = torch.ones(1, in_h, out_w)
+
+# Write input sequence and initial state
+f = open("input-sequence.h", "w")
+f.write("#define INPUT_SIZE "+str(inp.numel())+'\n')
+f.write('PI_L2 fp16 INPUT[INPUT_SIZE] = {'+dump.tensor_to_string(inp)+'};\n')
+f.write("#define STATE_SIZE "+str(state_0.numel())+'\n')
+f.write('PI_L2 fp16 STATE[STATE_SIZE] = {'+dump.tensor_to_string(state_0)+'};\n')
+if cell == 1:
+  # Initial cell state of the LSTM
+  cell_0 = torch.flip(state_0.detach(), [2])
+  cell_0.requires_grad = True
+  f.write('PI_L2 fp16 CELL_STATE[STATE_SIZE] = {'+dump.tensor_to_string(cell_0)+'};\n')
+f.close()
+
+
+# Input weights
+n_gates = net.rnn.weight_ih_l0.data.shape[0] // out_w
+in_wgt_init_tensor = torch.zeros(n_gates*out_w, in_w)
+for hk in range(n_gates*out_w):
+    for wk in range(in_w):
+        in_wgt_init_tensor[hk, wk] = (hk+wk)*weight_init
+with torch.no_grad():
+    net.rnn.weight_ih_l0.data = deepcopy(in_wgt_init_tensor.half().float())
+
+# State weights
+state_wgt_init_tensor = torch.zeros(n_gates*out_w, out_w)
+for hk in range(n_gates*out_w):
+    for wk in range(out_w):
+        state_wgt_init_tensor[hk, wk] = (hk+wk)*weight_init
+with torch.no_grad():
+    net.rnn.weight_hh_l0.data = deepcopy(state_wgt_init_tensor.half().float())
+
+# Print weights to init file, laid out as K x GM and M x GM (G being the number of gates)
+f = open("init-defines.h", 'a')
+f.write("\n\n// Weight initialization\n")
+f.write("#define INPUT_WGT_SIZE (Tin_W_l1*Tout_W_l1*"+str(n_gates)+")\n")
+f.write('PI_L2 fp16 INPUT_WEIGHTS[INPUT_WGT_SIZE] = {'+dump.tensor_to_string(torch.transpose(net.rnn.weight_ih_l0.data, 0, 1))+'};\n')
+f.write("\n\n")
+f.write("#define STATE_WGT_SIZE (Tout_W_l1*Tout_W_l1*"+str(n_gates)+")\n")
+f.write('PI_L2 fp16 STATE_WEIGHTS[STATE_WGT_SIZE] = {'+dump.tensor_to_string(torch.transpose(net.rnn.weight_hh_l0.data, 0, 1))+'};\n')
+f.close()
+
+# Sequence of in_h timesteps (batch of 1), split in the truncated BPTT windows
+criterion = nn.MSELoss()
+window = bptt_window if (bptt_window > 0 and bptt_window < in_h) else in_h
+seq_inp = inp.reshape(in_h, 1, in_w)
+h = (state_0, cell_0) if cell == 1 else state_0
+outs = []
+for t0 in range(0, in_h, window):
+  o, h = net(seq_inp[t0:t0+window], h)
+  h = tuple(s.detach() for s in h) if cell == 1 else h.detach()
+  outs.append(o)
+out = torch.cat(outs, 0).reshape(1, in_h, out_w)
+out.retain_grad()
+loss = criterion(out, label)
+
+net.zero_grad()
+loss.backward()
+
+print("------------Output------------")
+print(out)
+
+f = open("rnn-output.h", "w")
+f.write('#define OUTPUT_SIZE '+str(out.numel())+'\n')
+f.write('PI_L2 fp16 OUTPUT[OUTPUT_SIZE] = {'+dump.tensor_to_string(out)+'};\n')
+f.close()
+
+f = open("rnn-grads.h", "w")
+f.write('#define G_OUTPUT_SIZE '+str(out.grad.numel())+'\n')
+f.write('PI_L2 fp16 OUTPUT_GRAD[G_OUTPUT_SIZE] = {'+dump.tensor_to_string(out.grad)+'};\n')
+ih_wgt_grad = torch.transpose(net.rnn.weight_ih_l0.grad, 0, 1)
+hh_wgt_grad = torch.transpose(net.rnn.weight_hh_l0.grad, 0, 1)
+f.write('#define G_IH_WGT_SIZE '+str(ih_wgt_grad.numel())+'\n')
+f.write("PI_L2 fp16 IH_WGT_GRAD[G_IH_WGT_SIZE] = {"+dump.tensor_to_string(ih_wgt_grad)+"};\n")
+f.write('#define G_HH_WGT_SIZE '+str(hh_wgt_grad.numel())+'\n')
+f.write("PI_L2 fp16 HH_WGT_GRAD[G_HH_WGT_SIZE] = {"+dump.tensor_to_string(hh_wgt_grad)+"};\n")
+f.write("#define G_IN_SIZE "+str(inp.grad.numel())+ '\n')
+f.write("PI_L2 fp16 INPUT_GRAD[G_IN_SIZE] = {"+dump.tensor_to_string(inp.grad)+ "};\n")
+f.write("PI_L2 fp16 STATE_GRAD[STATE_SIZE] = {"+dump.tensor_to_string(state_0.grad)+ "};\n")
+if cell == 1:
+  f.write("PI_L2 fp16 CELL_STATE_GRAD[STATE_SIZE] = {"+dump.tensor_to_string(cell_0.grad)+ "};\n")
+f.close()
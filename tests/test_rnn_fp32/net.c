@@ -35,6 +35,7 @@
 // RNN
 PI_L1 float zero_init = 0.0f;
 PI_L1 struct Rnn_args rnn_args;
+PI_L1 struct Rnn_seq_args rnn_seq_args;
 PI_L1 struct blob layer0_in, layer0_wgt_in, layer0_wgt_h, layer0_state, layer0_out;
 
 // Memory occupation counter
@@ -60,6 +61,22 @@ PI_L1 float l0_state[Tout_W_l1*Tin_H_l1];
 PI_L1 float l0_out[Tout_W_l1*Tin_H_l1]; 
 PI_L1 float l0_out_diff[Tout_W_l1*Tin_H_l1];
 PI_L1 float l0_temp[Tin_H_l1*Tout_W_l1]; // Inaccuracy, dimension should be sequence length (Tin_H_l1) times the longest between Tout_W_l1 and Tin_W_l1
+PI_L1 float l0_grad[Tin_H_l1*Tout_W_l1];  // Pre-activation gradients of the BPTT window (SEQ == 1)
+#endif
+
+#if CELL != 0
+// Gated cells (SEQ == 1): input and state weights concatenated in a single (Tin_W_l1+Tout_W_l1) x GATES*Tout_W_l1 matrix
+PI_L1 struct Lstm_args lstm_args;
+PI_L1 struct Gru_args gru_args;
+PI_L1 struct blob layer0_wgt, layer0_cell_state;
+PI_L1 float l0_ker[(Tin_W_l1+Tout_W_l1)*GATES*Tout_W_l1];
+PI_L1 float l0_ker_diff[(Tin_W_l1+Tout_W_l1)*GATES*Tout_W_l1];
+PI_L1 float l0_state_diff[Tout_W_l1];
+PI_L1 float l0_cell_state[Tout_W_l1];
+PI_L1 float l0_cell_state_diff[Tout_W_l1];
+PI_L1 float l0_gates[Tin_H_l1*4*Tout_W_l1];       // Activations saved by the forward
+PI_L1 float l0_cells[Tin_H_l1*Tout_W_l1];
+PI_L1 float l0_cell_grad[Tin_H_l1*4*Tout_W_l1];   // Gate gradients of the BPTT window
 #endif
 
 
@@ -70,7 +87,7 @@ static inline void tensor_init()
   for (int i=0; i<Tin_H_l1*Tin_W_l1; i++)        l0_in[i] = INPUT[i];
   for (int i=0; i<Tin_W_l1*Tout_W_l1; i++)       l0_ker_in[i] = INPUT_WEIGHTS[i]; 
   for (int i=0; i<Tout_W_l1*Tout_W_l1; i++)      l0_ker_h[i] = STATE_WEIGHTS[i];
-  for (int i=0; i<Tout_W_l1*Tin_H_l1; i++)       l0_state[i] = STATE[i]; 
+  for (int i=0; i<STATE_SIZE; i++)               l0_state[i] = STATE[i]; 
   for (int i=0; i<Tout_W_l1*Tin_H_l1; i++)       l0_out[i] = zero_init; 
 }
 
@@ -112,6 +129,12 @@ static inline void connect_blobs()
   rnn_args.output = &layer0_out;
   rnn_args.coeff_x = &layer0_wgt_in;
   rnn_args.coeff_s = &layer0_wgt_h;
+
+  rnn_seq_args.input = &layer0_in;
+  rnn_seq_args.state = &layer0_state;
+  rnn_seq_args.output = &layer0_out;
+  rnn_seq_args.coeff_x = &layer0_wgt_in;
+  rnn_seq_args.coeff_s = &layer0_wgt_h;
 }
 
 static inline void compute_memory_occupation(){
@@ -154,7 +177,7 @@ static inline void tensor_init()
   for (int i=0; i<Tout_W_l1*Tout_W_l1; i++)      l0_ker_h[i] = STATE_WEIGHTS[i];
   for (int i=0; i<Tout_W_l1*Tout_W_l1; i++)      l0_ker_h_diff[i] = zero_init;
   
-  for (int i=0; i<Tout_W_l1*Tin_H_l1; i++)       l0_state[i] = STATE[i];
+  for (int i=0; i<STATE_SIZE; i++)               l0_state[i] = STATE[i];
 
   for (int i=0; i<Tout_W_l1*Tin_H_l1; i++)       l0_out_diff[i] = OUTPUT_GRAD[i];  
   for (int i=0; i<Tout_W_l1*Tin_H_l1; i++)       l0_out[i] = OUTPUT[i];
@@ -206,6 +229,13 @@ static inline void connect_blobs()
   rnn_args.temp_buffer = l0_temp;
   rnn_args.grad_buffer = l0_out_diff;
 
+  rnn_seq_args.input = &layer0_in;
+  rnn_seq_args.state = &layer0_state;
+  rnn_seq_args.output = &layer0_out;
+  rnn_seq_args.coeff_x = &layer0_wgt_in;
+  rnn_seq_args.coeff_s = &layer0_wgt_h;
+  rnn_seq_args.grad_buffer = l0_grad;
+  rnn_seq_args.bptt_window = BPTT_WINDOW;
 }
 
 static inline void compute_memory_occupation(){
@@ -240,6 +270,64 @@ static inline void compute_memory_occupation(){
   //L2_memocc_bytes += L0_OUT_CH*(RICORS+1)*sizeof(float);
   // Input gradient
   L2_memocc_bytes += Tin_H_l1*Tin_W_l1*sizeof(float);
+  #if SEQ == 1
+  // Pre-activation gradients
+  L1_memocc_bytes += Tin_H_l1*Tout_W_l1*sizeof(float);
+  #endif
+  #if CELL != 0
+  // Gates and cell states saved by the forward, gate gradients
+  L1_memocc_bytes += Tin_H_l1*9*Tout_W_l1*sizeof(float);
+  #endif
+}
+#endif
+
+
+
+#if CELL != 0
+static inline void cell_init()
+{
+  for (int i=0; i<INPUT_WGT_SIZE; i++)           l0_ker[i] = INPUT_WEIGHTS[i];
+  for (int i=0; i<STATE_WGT_SIZE; i++)           l0_ker[INPUT_WGT_SIZE+i] = STATE_WEIGHTS[i];
+  for (int i=0; i<INPUT_WGT_SIZE+STATE_WGT_SIZE; i++) l0_ker_diff[i] = zero_init;
+  #if CELL == 1
+  for (int i=0; i<STATE_SIZE; i++)               l0_cell_state[i] = CELL_STATE[i];
+  #endif
+
+  layer0_wgt.data = l0_ker;
+  layer0_wgt.dim = (Tin_W_l1+Tout_W_l1)*GATES*Tout_W_l1;
+  layer0_wgt.H = Tin_W_l1+Tout_W_l1;
+  layer0_wgt.W = GATES*Tout_W_l1;
+  layer0_wgt.C = Tout_C_l1;
+  layer0_wgt.diff = l0_ker_diff;
+
+  layer0_cell_state.data = l0_cell_state;
+  layer0_cell_state.dim = Tout_W_l1;
+  layer0_cell_state.H = 1;
+  layer0_cell_state.W = Tout_W_l1;
+  layer0_cell_state.C = Tout_C_l1;
+  layer0_cell_state.diff = l0_cell_state_diff;
+
+  layer0_state.diff = l0_state_diff;
+
+  lstm_args.input = &layer0_in;
+  lstm_args.state = &layer0_state;
+  lstm_args.cell_state = &layer0_cell_state;
+  lstm_args.output = &layer0_out;
+  lstm_args.coeff = &layer0_wgt;
+  lstm_args.gates = l0_gates;
+  lstm_args.cells = l0_cells;
+  lstm_args.grad_buffer = l0_cell_grad;
+  lstm_args.bptt_window = BPTT_WINDOW;
+  lstm_args.approx = ACT_EXACT;
+
+  gru_args.input = &layer0_in;
+  gru_args.state = &layer0_state;
+  gru_args.output = &layer0_out;
+  gru_args.coeff = &layer0_wgt;
+  gru_args.gates = l0_gates;
+  gru_args.grad_buffer = l0_cell_grad;
+  gru_args.bptt_window = BPTT_WINDOW;
+  gru_args.approx = ACT_EXACT;
 }
 #endif
 
@@ -292,8 +380,16 @@ static inline void train(){
   #endif
 
   #ifdef FORWARD
+  #if CELL == 1
+  pulp_lstm_fp32_fw_cl(&lstm_args);
+  #elif CELL == 2
+  pulp_gru_fp32_fw_cl(&gru_args);
+  #elif SEQ == 1
+  pulp_rnn_seq_fp32_fw_cl(&rnn_seq_args);
+  #else
   pulp_rnn_fp32_fw_cl(&rnn_args);
   #endif
+  #endif
 
   #ifdef PROF_FWD
   STOP_STATS();
@@ -305,8 +401,16 @@ static inline void train(){
   #endif
 
   #ifdef BACKWARD
+  #if CELL == 1
+  pulp_lstm_fp32_bw_cl(&lstm_args);
+  #elif CELL == 2
+  pulp_gru_fp32_bw_cl(&gru_args);
+  #elif SEQ == 1
+  pulp_rnn_seq_fp32_bw_cl(&rnn_seq_args);
+  #else
   pulp_rnn_fp32_bw_cl(&rnn_args);
   #endif
+  #endif
 
   #ifdef PROF_BCKWD
   STOP_STATS();
@@ -338,11 +442,19 @@ static inline void train(){
 
   #ifdef BACKWARD
   printf("\nFINAL WEIGHTS GRADIENT CHECK: \n");
+  #if CELL != 0
+  compare_tensors(l0_ker_diff, IH_WGT_GRAD, G_IH_WGT_SIZE);
+  check_tensor(l0_ker_diff, IH_WGT_GRAD, G_IH_WGT_SIZE);
+
+  compare_tensors(l0_ker_diff+INPUT_WGT_SIZE, HH_WGT_GRAD, G_HH_WGT_SIZE);
+  check_tensor(l0_ker_diff+INPUT_WGT_SIZE, HH_WGT_GRAD, G_HH_WGT_SIZE);
+  #else
   compare_tensors(l0_ker_in_diff, IH_WGT_GRAD, G_IH_WGT_SIZE);  
   check_tensor(l0_ker_in_diff, IH_WGT_GRAD, G_IH_WGT_SIZE);
 
   compare_tensors(l0_ker_h_diff, HH_WGT_GRAD, G_HH_WGT_SIZE);     
   check_tensor(l0_ker_h_diff, HH_WGT_GRAD, G_HH_WGT_SIZE);
+  #endif
 
   printf("\nINPUT GRADIENT CHECK: \n");
   compare_tensors(l0_in_diff, INPUT_GRAD, G_IN_SIZE);    
@@ -371,6 +483,18 @@ void net_step()
 
   connect_blobs();
 
+  #if CELL != 0
+  cell_init();
+  #ifdef BACKWARD
+  // The BPTT needs the gates saved by the forward
+  #if CELL == 1
+  pulp_lstm_fp32_fw_cl(&lstm_args);
+  #else
+  pulp_gru_fp32_fw_cl(&gru_args);
+  #endif
+  #endif
+  #endif
+
   train();
 
   return;
@@ -32,6 +32,15 @@
 
 #define Tker_l0     (Tin_l0*Tout_l0)
 
+// Number of gates of the recurrent cell
+#if CELL == 1
+#define GATES 4
+#elif CELL == 2
+#define GATES 3
+#else
+#define GATES 1
+#endif
+
 // Tensor checksum definition
 #define CHECK_TOLERANCE 1e-2
 #define ERROR_TOLERANCE 0.001
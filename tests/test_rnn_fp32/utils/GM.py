@@ -42,6 +42,9 @@ parser.add_argument( '--ch_out', type=int, default=1)
 parser.add_argument( '--out_width', type=int, default=8)
 parser.add_argument( '--weight', type=float, default=0.1)
 parser.add_argument( '--step', type=str, default='FORWARD')     # Possible steps: FORWARD, BACKWARD_GRAD, BACKWARD_ERROR
+parser.add_argument( '--seq', type=int, default=0)              # 1 = full sequence of in_height timesteps (pulp_rnn_seq_fp32), 0 = in_height independent steps
+parser.add_argument( '--bptt_window', type=int, default=0)      # Truncated BPTT window of the full sequence (0 = full BPTT)
+parser.add_argument( '--cell', type=int, default=0)             # Recurrent cell of the full sequence: 0 = RNN, 1 = LSTM (pulp_lstm_fp32), 2 = GRU (pulp_gru_fp32)
 
 args = parser.parse_args()
 
@@ -53,6 +56,9 @@ ch_out = args.ch_out
 out_w = args.out_width
 current_step = args.step
 weight_init = args.weight
+seq = args.seq
+bptt_window = args.bptt_window
+cell = args.cell if seq == 1 else 0
 
 # Net step
 f_step = open('step-check.h', 'w')
@@ -73,7 +79,12 @@ f.close()
 class myNet(nn.Module):
   def __init__(self, in_h, in_w, out_w):
     super().__init__()
-    self.rnn = nn.RNN(input_size=in_w, hidden_size=out_w, bias=False)
+    if cell == 1:
+      self.rnn = nn.LSTM(input_size=in_w, hidden_size=out_w, bias=False)
+    elif cell == 2:
+      self.rnn = nn.GRU(input_size=in_w, hidden_size=out_w, bias=False)
+    else:
+      self.rnn = nn.RNN(input_size=in_w, hidden_size=out_w, bias=False)
 
   def forward(self, x, state):
     return self.rnn(x, state)
@@ -152,8 +163,9 @@ def hook_fn2(m, i, o):
      f.close()
 
 
-gradsRnn = net.rnn.register_backward_hook(hook_fn1)
-outRnn = net.rnn.register_forward_hook(hook_fn2)
+if seq == 0:
+  gradsRnn = net.rnn.register_backward_hook(hook_fn1)
+  outRnn = net.rnn.register_forward_hook(hook_fn2)
 
 inp = torch.div(torch.ones(ch_in, in_h, in_w), 1000)
 for cin in range(ch_in):
@@ -167,6 +179,10 @@ for cin in range(ch_in):
     for wi in range(out_w):
       state_0[cin, hi, wi] += (cin + hi - wi)*(cin + hi + wi) * 1/1e5
 
+if seq == 1:
+  # Single initial state for the whole sequence
+  state_0 = state_0[:, 0:1, :]
+
 state = torch.zeros(ch_out, in_h, out_w)
 
 inp.requires_grad = True
@@ -189,6 +205,14 @@ f.write("#define STATE_SIZE "+str(state_0.numel())+'\n')
 print(state_0)
 f.write('PI_L2 float STATE[STATE_SIZE] = {'+dump.tensor_to_string(state_0)+'};\n')
 
+if cell == 1:
+  # Initial cell state of the LSTM
+  cell_0 = torch.flip(state_0, [2])
+  print("------------Initial Cell State------------")
+  print(cell_0)
+  f.write('PI_L2 float CELL_STATE[STATE_SIZE] = {'+dump.tensor_to_string(cell_0)+'};\n')
+  state_0 = (state_0, cell_0)
+
 f.close()
 
 
@@ -198,8 +222,9 @@ print("Shape input weights:")
 print(net.rnn.weight_ih_l0.data.shape)
 print(net.rnn.weight_ih_l0.data)
 print("\n")
-in_wgt_init_tensor = torch.zeros(out_w, in_w)
-for hk in range(out_w):
+n_gates = net.rnn.weight_ih_l0.data.shape[0] // out_w
+in_wgt_init_tensor = torch.zeros(n_gates*out_w, in_w)
+for hk in range(n_gates*out_w):
     for wk in range(in_w):
         in_wgt_init_tensor[hk, wk] = (hk+wk)*weight_init
 #Initialize input weights
@@ -213,7 +238,7 @@ in_wgt_init_tensor = torch.transpose(in_wgt_init_tensor, 0, 1)
 # Print input weights to init file
 f = open("init-defines.h", 'a')
 f.write("\n\n// Weight initialization\n")
-f.write("#define INPUT_WGT_SIZE (Tin_W_l1*Tout_W_l1)\n")
+f.write("#define INPUT_WGT_SIZE (Tin_W_l1*Tout_W_l1*"+str(n_gates)+")\n")
 f.write('PI_L2 float INPUT_WEIGHTS[INPUT_WGT_SIZE] = {'+dump.tensor_to_string(in_wgt_init_tensor)+'};\n')
 f.close()
 
@@ -224,8 +249,8 @@ print("Shape state weights:")
 print(net.rnn.weight_hh_l0.data.shape)
 print(net.rnn.weight_hh_l0.data)
 print("\n")
-state_wgt_init_tensor = torch.zeros(out_w, out_w)
-for hk in range(out_w):
+state_wgt_init_tensor = torch.zeros(n_gates*out_w, out_w)
+for hk in range(n_gates*out_w):
     for wk in range(out_w):
         state_wgt_init_tensor[hk, wk] = (hk+wk)*weight_init
 #Initialize state weights
@@ -239,12 +264,25 @@ state_wgt_init_tensor = torch.transpose(state_wgt_init_tensor, 0, 1)
 # Print input weights to init file
 f = open("init-defines.h", 'a')
 f.write("\n\n")
-f.write("#define STATE_WGT_SIZE (Tout_W_l1*Tout_W_l1)\n")
+f.write("#define STATE_WGT_SIZE (Tout_W_l1*Tout_W_l1*"+str(n_gates)+")\n")
 f.write('PI_L2 float STATE_WEIGHTS[STATE_WGT_SIZE] = {'+dump.tensor_to_string(state_wgt_init_tensor)+'};\n')
 f.close()
 
 criterion = nn.MSELoss()
-out, _ = net(inp, state_0)
+if seq == 0:
+  out, _ = net(inp, state_0)
+else:
+  # Sequence of in_h timesteps (batch of 1), split in the truncated BPTT windows
+  window = bptt_window if (bptt_window > 0 and bptt_window < in_h) else in_h
+  seq_inp = inp.reshape(in_h, 1, in_w)
+  h = state_0
+  outs = []
+  for t0 in range(0, in_h, window):
+    o, h = net(seq_inp[t0:t0+window], h)
+    h = tuple(s.detach() for s in h) if cell == 1 else h.detach()
+    outs.append(o)
+  out = torch.cat(outs, 0).reshape(1, in_h, out_w)
+  out.retain_grad()
 print(out.size)
 print(label.size)
 print(out)
@@ -258,6 +296,19 @@ ih_wgt_grad = net.rnn.weight_ih_l0.grad
 hh_wgt_grad = net.rnn.weight_hh_l0.grad
 input_grad = inp.grad
 
+if seq == 1:
+  # Outputs and output gradients of the whole sequence, weight gradients laid out as the weights (K x GM and M x GM, G being the number of gates)
+  f = open("rnn-output.h", "w")
+  f.write('#define OUTPUT_SIZE '+str(out.numel())+'\n')
+  f.write('PI_L2 float OUTPUT[OUTPUT_SIZE] = {'+dump.tensor_to_string(out)+'};\n')
+  f.close()
+  f = open("rnn-grads.h", "w")
+  f.write('#define G_OUTPUT_SIZE '+str(out.grad.numel())+'\n')
+  f.write('PI_L2 float OUTPUT_GRAD[G_OUTPUT_SIZE] = {'+dump.tensor_to_string(out.grad)+'};\n')
+  f.close()
+  ih_wgt_grad = torch.transpose(ih_wgt_grad, 0, 1)
+  hh_wgt_grad = torch.transpose(hh_wgt_grad, 0, 1)
+
 
 f = open("rnn-grads.h", 'a')
 f.write('#define G_IH_WGT_SIZE '+str(ih_wgt_grad.numel())+'\n')
@@ -32,6 +32,7 @@ Available DNN layer names:
 'Skipnode'  -> node at which data is taken and passes forward, to add an additional layer after the skip derivation simply substitute 'Skipnode' with any kind of layer
 'Sumnode'   -> node at which data from Skipnode is summed 
 'InstNorm'  -> instance Normalization layer
+'GroupNorm' -> group Normalization layer
 """
 
 import utils.DNN_Reader     as reader
@@ -50,8 +51,8 @@ proj_folder     = project_path + project_name + '/'
 epochs          = 10
 batch_size      = 1                   # BATCHING NOT IMPLEMENTED!!
 learning_rate   = 0.01
-optimizer       = "SGD"                # Name of PyTorch's optimizer
-loss_fn         = "MSELoss"            # Name of PyTorch's loss function
+optimizer       = "SGD"                # Name of PyTorch's optimizer ("SGD", "Adam" or "AdamW")
+loss_fn         = "MSELoss"            # Name of PyTorch's loss function ("MSELoss", "L1Loss", "HuberLoss", "SmoothL1Loss", "BCEWithLogitsLoss", "KLDivLoss" or "CrossEntropyLoss", which is fused with the Softmax)
 
 # ------- NETWORK GRAPH --------
 # Manually define the list of the network (each layer in the list has its own properties in the relative index of each list)
@@ -81,6 +82,8 @@ data_type_list      = ['FP16', 'FP16', 'FP16', 'FP16', 'FP16', 'FP16', 'FP16', '
 #data_type_list     = ['FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32', 'FP32']
 # Data layout list (CHW or HWC) 
 data_layout_list    = ['CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW', 'CHW']   # TO DO
+# Number of channel groups (for GroupNorm only, must divide in_ch; all other layers are ignored)
+num_groups_list     = [ 1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1 ]
 # ----- END OF NETWORK GRAPH -----
 
 
@@ -123,7 +126,7 @@ else:
     # Check if the network training fits L1
     memocc = composer.DNN_Size_Checker(layer_list, in_ch_list, out_ch_list, hk_list, wk_list, hin_list, win_list, 
                                 h_str_list, w_str_list, h_pad_list, w_pad_list,
-                                data_type_list, L1_SIZE_BYTES, USE_DMA)
+                                data_type_list, L1_SIZE_BYTES, USE_DMA, num_groups_list, NUM_CORES)
 
     print("DNN memory occupation: {} bytes of {} available L1 bytes ({}%).".format(memocc, L1_SIZE_BYTES, (memocc/L1_SIZE_BYTES)*100))
 
@@ -132,7 +135,7 @@ else:
                             layer_list, in_ch_list, out_ch_list, hk_list, wk_list, 
                             hin_list, win_list, h_str_list, w_str_list, h_pad_list, w_pad_list,
                             epochs, batch_size, learning_rate, optimizer, loss_fn,
-                            NUM_CORES, data_type_list, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list, sumnode_connections, USE_DMA)
+                            NUM_CORES, data_type_list, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list, sumnode_connections, num_groups_list, USE_DMA)
 
     print("PULP project generation successful!")
 
@@ -32,7 +32,7 @@ memory
 MAX_LAYER_DIM = 0
 
 def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_str_list, w_str_list, h_pad_list, w_pad_list,
-                        data_type_l, avail_mem_bytes, USE_DMA):
+                        data_type_l, avail_mem_bytes, USE_DMA, num_groups_l, NUM_CORES):
 
     total_memory_occupation_bytes = 0
     l2_occupation = 0
@@ -66,6 +66,13 @@ def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_s
     if mem_blocktransp > 0:
         print("Max transposition / block transposition buffer size of {} @layer {}".format(mem_blocktransp, idx_blocktransp))
 
+    # Compute GroupNorm partial sums memory occupation
+    mem_groupnorm = utils.compute_groupnorm_memocc_bytes(layers_l, num_groups_l, NUM_CORES)
+    total_memory_occupation_bytes += mem_groupnorm
+
+    if mem_groupnorm > 0:
+        print("GroupNorm partial sums buffer size of {} bytes".format(mem_groupnorm))
+
     # Compute additional mixed precision buffer memory occupation
     mem_cast_buffer = 0
     mem_cast_buffer, idx_max_act, max_act_inout = utils.compute_cast_buffer_memocc_bytes(layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_pad_list, w_pad_list, h_str_list, w_str_list, data_type_l)
@@ -91,6 +98,7 @@ def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_s
         l1_structs_mem += 8 # act_args
         l1_structs_mem += 16 # Skipconn_args
         l1_structs_mem += 16 # InstNorm_args
+        l1_structs_mem += 24 # GroupNorm_args
         l1_structs_mem += 2*4 # 2 pi_cl_dma_cmd_t
         l1_structs_mem += 2 # loss in fp16
         if data_type_l[0] == 'FP32':
@@ -113,6 +121,7 @@ def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_s
         l1_structs_mem += 36 # DW_args
         l1_structs_mem += 8 # act_args
         l1_structs_mem += 16 # Skipconn_args
+        l1_structs_mem += 24 # GroupNorm_args
         l1_structs_mem += 3*4 # 3 pi_cl_dma_cmd_t cmd_load, cmd_store and cmd_struct
         l1_structs_mem += 2 # loss in fp16
         if data_type_l[0] == 'FP32':
@@ -187,7 +196,7 @@ def DNN_Composer (proj_folder_path, project_name,
                   layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                   h_str_l, w_str_l, h_pad_l, w_pad_l,
                   epochs, batch_size, learning_rate, optimizer, loss_fn,
-                  NUM_CORES, data_type_l, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list, sumnode_connections, USE_DMA):
+                  NUM_CORES, data_type_l, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list, sumnode_connections, num_groups_l, USE_DMA):
 
     # Initialize project (copy the prefab files and create folder)
     utils.InitProject(proj_folder_path)
@@ -200,7 +209,7 @@ def DNN_Composer (proj_folder_path, project_name,
                         layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                         h_str_l, w_str_l, h_pad_l, w_pad_l,
                         epochs, batch_size, learning_rate, optimizer, loss_fn,
-                        data_type_l, sumnode_connections, USE_DMA)
+                        data_type_l, sumnode_connections, num_groups_l, USE_DMA)
 
 
     global MAX_LAYER_DIM
@@ -210,21 +219,21 @@ def DNN_Composer (proj_folder_path, project_name,
                     layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                     h_str_l, w_str_l, h_pad_l, w_pad_l,
                     epochs, batch_size, learning_rate, optimizer, loss_fn,
-                    data_type_l, sumnode_connections)
+                    data_type_l, sumnode_connections, num_groups_l)
         
     elif USE_DMA == 'SB':
         utilsSB.GenerateNet(proj_folder_path, project_name,
                     layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                     h_str_l, w_str_l, h_pad_l, w_pad_l,
                     epochs, batch_size, learning_rate, optimizer, loss_fn,
-                    data_type_l, sumnode_connections, MAX_LAYER_DIM)
+                    data_type_l, sumnode_connections, num_groups_l, MAX_LAYER_DIM)
         
     elif USE_DMA == 'DB':
         utilsDB.GenerateNet(proj_folder_path, project_name,
                     layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                     h_str_l, w_str_l, h_pad_l, w_pad_l,
                     epochs, batch_size, learning_rate, optimizer, loss_fn,
-                    data_type_l, sumnode_connections, MAX_LAYER_DIM)
+                    data_type_l, sumnode_connections, num_groups_l, MAX_LAYER_DIM)
     else:
         print(f"[DNN_Composer]: Not supported argument for USE_DMA: '{USE_DMA}' given")
 
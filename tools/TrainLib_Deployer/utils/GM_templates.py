@@ -126,4 +126,8 @@ NORMALIZATION TEMPLATE
 
 def InstNorm_template(layer, ch):
     template = f"\t\tself.l{layer}= nn.InstanceNorm2d(num_features={ch}, eps=1e-10, momentum=0, affine=True)\n"
+    return template
+
+def GroupNorm_template(layer, ch, groups):
+    template = f"\t\tself.l{layer}= nn.GroupNorm(num_groups={groups}, num_channels={ch}, eps=1e-10, affine=True)\n"
     return template
\ No newline at end of file
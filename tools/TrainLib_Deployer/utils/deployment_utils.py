@@ -26,6 +26,14 @@ from torch import mm
 import utils.GM_templates as Gtemp
 import utils.net_templates as ntemp
 
+# Hyperparameters of the Adam and AdamW optimizers (PyTorch defaults), shared by the Golden Model and the PULP code
+ADAM_BETA1 = 0.9
+ADAM_BETA2 = 0.999
+ADAM_EPS = 1e-8
+ADAM_WEIGHT_DECAY = {'Adam' : 0, 'AdamW' : 0.01}
+# Threshold of the clip-by-global-norm of the gradients, applied inside the optimizer (0 to disable)
+GRAD_CLIP_NORM = 0
+
 
 """
 DNN Size Checker backend functions
@@ -67,7 +75,7 @@ def compute_wgt_act_memocc_bytes(layer_number, layer_type, chin, chout, hk, wk,
     # Input act
     memocc_bytes += chin * hin * win * byte_size
     # Weights
-    if  layer_type == 'InstNorm':
+    if  layer_type in ['InstNorm', 'GroupNorm']:
         memocc_bytes += 2 * chin * byte_size
     else:    
         memocc_bytes += chin * chout * hk * wk * byte_size * wgt_present
@@ -210,6 +218,22 @@ def compute_bt_memocc_bytes(layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_
     return memocc_bytes, max_bt_index
 
 
+def compute_groupnorm_memocc_bytes(layers_l, num_groups_l, NUM_CORES):
+
+    memocc_bytes = 0
+
+    # GN_PARTIALS = 4 FP32 partial sums for each (group, spatial) tile, as in pulp_groupnorm_fp32.h
+    for layer in range(len(layers_l)):
+        if layers_l[layer] == 'GroupNorm':
+            groups = num_groups_l[layer]
+            n_tiles = 1 if groups >= NUM_CORES else (NUM_CORES + groups - 1) // groups
+            gn_size = 4 * groups * n_tiles * 4
+            if gn_size > memocc_bytes:
+                memocc_bytes = gn_size
+
+    return memocc_bytes
+
+
 """
 DNN Composer backend functions
 """
@@ -304,6 +328,7 @@ def GenerateMakefile(proj_folder_path, project_name, layers_l, NUM_CORES, data_t
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_pooling_fp32.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_residual_fp32.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_instnorm_fp32.c\n')
+        f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_groupnorm_fp32.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_train_utils_fp32.c\n\n')
     if check_FP16 == True:
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_act_fp16.c\n')
@@ -318,6 +343,7 @@ def GenerateMakefile(proj_folder_path, project_name, layers_l, NUM_CORES, data_t
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_pooling_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_residual_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_instnorm_fp16.c\n')
+        f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_groupnorm_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_train_utils_fp16.c\n\n')
     # if (check_FP16 and check_FP32) == False:
     #     print("[deployment_utils.GenerateMakefile] Data format not implemented!!\n")
@@ -340,7 +366,7 @@ def GenerateGM(proj_folder_path, project_name,
                 layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                 h_str_l, w_str_l, h_pad_l, w_pad_l,
                 epochs, batch_size, learning_rate, optimizer, loss_fn,
-                data_type_l, sumnode_connections, USE_DMA):
+                data_type_l, sumnode_connections, num_groups_l, USE_DMA):
     
     # Print DNN structure
     print("---------- DNN ARCHITECTURE ----------")
@@ -415,7 +441,7 @@ def GenerateGM(proj_folder_path, project_name,
     f.write("\n# Simple input data \n")
     if (layers_l[0] == 'linear'):
         f.write("inp = torch.div(torch.ones(l0_in_ch), 1e6)\n")
-    elif (layers_l[0] in ['conv2d', 'DW', 'PW', 'Skipnode', 'InstNorm']):
+    elif (layers_l[0] in ['conv2d', 'DW', 'PW', 'Skipnode', 'InstNorm', 'GroupNorm']):
         f.write("inp = torch.torch.div(torch.rand(batch_size, l0_in_ch, l0_hin, l0_win), 1e6)\n")
         #f.write("inp = torch.torch.div(torch.randint(1000, [batch_size, l0_in_ch, l0_hin, l0_win]), 1000)\n")
     # Throw error
@@ -532,6 +558,8 @@ def GenerateGM(proj_folder_path, project_name,
         #Normalization
         elif layers_l[layer] == "InstNorm":
             f.write(Gtemp.InstNorm_template(layer, in_ch_l[layer]))
+        elif layers_l[layer] == "GroupNorm":
+            f.write(Gtemp.GroupNorm_template(layer, in_ch_l[layer], num_groups_l[layer]))
         # Throw error
         else:
             print("[deployment_utils.GenerateGM]: Layer {} not recognized!!\n".format(layer))
@@ -597,7 +625,7 @@ def GenerateGM(proj_folder_path, project_name,
     for layer in range(len(layers_l)):
         if (layers_l[layer] not in ['ReLU', 'MaxPool',  'AvgPool', 'Skipnode', 'Sumnode']):
             dump = f"+dump.tensor_to_string(net.l{layer}.weight.data)+"
-            if layers_l[layer] != 'InstNorm':
+            if layers_l[layer] not in ['InstNorm', 'GroupNorm']:
                 f.write("f.write('#define WGT_SIZE_L"+str(layer)+" '+str(l"+str(layer)+"_in_ch*l"+str(layer)+"_out_ch*l"+str(layer)+"_hk*l"+str(layer)+"_wk)+'\\n')\n")
             else:
                 f.write("f.write(f'#define WGT_SIZE_L" + f"{layer}" + "  2*{" + f"l{layer}_in_ch" + "}\\n')\n")
@@ -623,10 +651,16 @@ def GenerateGM(proj_folder_path, project_name,
     # Define optimizer
     if optimizer == 'SGD':
         f.write("optimizer = optim."+str(optimizer)+"(net.parameters(), lr=learning_rate, momentum=0)\n")
+    elif optimizer in ['Adam', 'AdamW']:
+        f.write("optimizer = optim."+str(optimizer)+"(net.parameters(), lr=learning_rate, betas=("+str(ADAM_BETA1)+", "+str(ADAM_BETA2)+"), eps="+str(ADAM_EPS)+", weight_decay="+str(ADAM_WEIGHT_DECAY[optimizer])+")\n")
     else:
         print("[deployment_utils.GenerateGM]: Invalid optimizer!!\n!")
         exit()
-    f.write("loss_fn = nn."+str(loss_fn)+"()\n")
+    if loss_fn == 'KLDivLoss':
+        # Same normalization of pulp_KLDivLoss (batch size = 1)
+        f.write("loss_fn = nn."+str(loss_fn)+"(reduction='batchmean')\n")
+    else:
+        f.write("loss_fn = nn."+str(loss_fn)+"()\n")
     f.write("\n")
 
     # Perform training
@@ -636,6 +670,8 @@ def GenerateGM(proj_folder_path, project_name,
     f.write("\tout = net(inp)\n")
     f.write("\tloss = loss_fn(out, label)\n")
     f.write("\tloss.backward()\n")
+    if GRAD_CLIP_NORM > 0:
+        f.write("\ttorch.nn.utils.clip_grad_norm_(net.parameters(), "+str(GRAD_CLIP_NORM)+")\n")
     f.write("\toptimizer.step()\n")
     
     # Inference after training
@@ -683,7 +719,7 @@ def GenerateNet(proj_folder_path, project_name,
                 layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                 h_str_l, w_str_l, h_pad_l, w_pad_l,
                 epochs, batch_size, learning_rate, optimizer, loss_fn,
-                data_type_l, sumnode_connections):
+                data_type_l, sumnode_connections, num_groups_l):
 
     # Generate net.h
     f = open(proj_folder_path+'net.h', 'w')
@@ -772,6 +808,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 struct SkipConn_args l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write(f"PI_L1 struct InstNorm_args l{layer}_args;\n")
+            elif layers_l[layer] == 'GroupNorm':
+                f.write(f"PI_L1 struct GroupNorm_args l{layer}_args;\n")
             else:
                 print("[deployment_utils.GenerateNet] Layer "+str(layer)+" not recognized!!")
         # Define FP16 structure
@@ -796,6 +834,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 struct SkipConn_args_fp16 l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write(f"PI_L1 struct InstNorm_args_fp16 l{layer}_args;\n")
+            elif layers_l[layer] == 'GroupNorm':
+                f.write(f"PI_L1 struct GroupNorm_args_fp16 l{layer}_args;\n")
             else:
                 print("[deployment_utils.GenerateNet] Layer "+str(layer)+" not recognized!!")
         # Invalid data type
@@ -828,7 +868,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 float l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L1 float l"+str(layer)+f"_ker[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L1 float l"+str(layer)+"_ker[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -838,7 +878,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 fp16 l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L1 fp16 l"+str(layer)+f"_ker[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L1 fp16 l"+str(layer)+"_ker[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -855,7 +895,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 float l"+str(layer)+"_ker_diff[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L1 float l"+str(layer)+f"_ker_diff[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L1 float l"+str(layer)+"_ker_diff[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -865,7 +905,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 fp16 l"+str(layer)+"_ker_diff[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L1 fp16 l"+str(layer)+f"_ker_diff[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L1 fp16 l"+str(layer)+"_ker_diff[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -874,6 +914,17 @@ def GenerateNet(proj_folder_path, project_name,
             print("[deployment_utils.GenerateNet] Invalid data type for kernel grad definition @Layer{}!".format(layer))
             exit()
 
+    if optimizer in ['Adam', 'AdamW']:
+        f.write("\n// Define optimizer state tensors (always FP32)\n")
+        for layer in range(len(layers_l)):
+            if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm', 'GroupNorm']:
+                if layers_l[layer] in ['InstNorm', 'GroupNorm']:
+                    state_size = "2*Tin_C_l"+str(layer)
+                else:
+                    state_size = "Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)
+                f.write("PI_L1 float l"+str(layer)+"_ker_m["+state_size+"];\n")
+                f.write("PI_L1 float l"+str(layer)+"_ker_v["+state_size+"];\n")
+
     f.write("\n// Define I/O tensors\n")
 
     previous_was_skip = False 
@@ -999,6 +1050,16 @@ def GenerateNet(proj_folder_path, project_name,
             print("[deployment_utils.GenerateNet] Invalid data type for pw transp buffer definition!\n")
             exit()
 
+    # Define the partial sums buffer, shared by all the GroupNorm layers (FP32 also for FP16 layers)
+    gn_groups = sorted(set([num_groups_l[layer] for layer in range(len(layers_l)) if layers_l[layer] == 'GroupNorm']))
+    if len(gn_groups) == 1:
+        f.write("\n// Define the partial sums buffer for all GroupNorm layers\n")
+        f.write("PI_L1 float gn_partials_buffer[GN_PARTIALS_SIZE("+str(gn_groups[0])+")];\n")
+    elif len(gn_groups) > 1:
+        # G*ceil(NUM_CORES/G) < G+NUM_CORES bounds the tiles of every layer
+        f.write("\n// Define the partial sums buffer for all GroupNorm layers\n")
+        f.write("PI_L1 float gn_partials_buffer[GN_PARTIALS*("+str(gn_groups[-1])+"+NUM_CORES)];\n")
+
 
     # Define tensors to backpropagate the output error
     f.write("\n// Define error propagation tensors\n")
@@ -1096,9 +1157,9 @@ def GenerateNet(proj_folder_path, project_name,
         if layer == 0:
             f.write("  // Layer "+str(layer)+"\n")
             f.write("  for(int i=0; i<Tin_C_l0*Tin_H_l0*Tin_W_l0; i++)\t\t\tl0_in[i] = INPUT[i];\n")
-            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm']:
+            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0; i++)\t\tl0_ker[i] = init_WGT_l0[i];\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         elif layer > 0 and layer < len(layers_l)-1:
             f.write("  // Layer "+str(layer)+"\n")
@@ -1108,20 +1169,31 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  //   Pooling kernel (no parameters)\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 f.write("  //   Resconn layer (no parameters)\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
             else:
                 f.write("  for(int i=0; i<Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         elif layer == len(layers_l)-1:
-            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm']:
+            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm', 'GroupNorm']:
                 f.write("  // Layer "+str(layer)+"\n")
                 f.write("  for(int i=0; i<Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         else:
             print("[deployment_utils.GenerateNet]: Error in PULP layer initialization!")
             exit()
 
+    if optimizer in ['Adam', 'AdamW']:
+        f.write("\n  // Optimizer state (moments start from zero)\n")
+        for layer in range(len(layers_l)):
+            if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm', 'GroupNorm']:
+                if layers_l[layer] in ['InstNorm', 'GroupNorm']:
+                    state_size = "2*Tin_C_l"+str(layer)
+                else:
+                    state_size = "Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)
+                f.write("  for(int i=0; i<"+state_size+"; i++)\t\tl"+str(layer)+"_ker_m[i] = 0;\n")
+                f.write("  for(int i=0; i<"+state_size+"; i++)\t\tl"+str(layer)+"_ker_v[i] = 0;\n")
+
     # Mixed precision check
     C_data_type = 'float'
     f.write("\n  // Connect tensors to blobs\n")
@@ -1148,7 +1220,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_wgt.diff = l0_ker_diff;\n")
             if layers_l[layer] == 'DW':
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tker_H_l0*Tker_W_l0;\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  layer"+str(layer)+"_wgt.dim = 2*Tin_C_l0;\n")
             else:
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0;\n")
@@ -1174,7 +1246,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                elif layers_l[layer] == 'InstNorm':
+                elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                     f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1209,7 +1281,7 @@ def GenerateNet(proj_folder_path, project_name,
                     f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                     if layers_l[layer] == 'DW':
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                    elif layers_l[layer] == 'InstNorm':
+                    elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                         f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                     else:
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1247,7 +1319,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                elif layers_l[layer] == 'InstNorm':
+                elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                         f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1309,6 +1381,8 @@ def GenerateNet(proj_folder_path, project_name,
             pass
         elif layers_l[layer] == 'InstNorm':
             f.write(ntemp.InstNorm_config_template(layer, skip_inputgrad))
+        elif layers_l[layer] == 'GroupNorm':
+            f.write(ntemp.GroupNorm_config_template(layer, skip_inputgrad, num_groups_l[layer]))
         else:
             print("[deployment_utils.GenerateNet] Undefined layer "+str(layer)+" (unable to write configuration structure)!!")
         if sumnode_connections[layer] != -1 and layers_l[layer] != 'Sumnode':
@@ -1359,6 +1433,8 @@ def GenerateNet(proj_folder_path, project_name,
             f.write(ntemp.residualconn_template_FW(layer, data_type_l[layer]))
         elif layers_l[layer]  == 'InstNorm':
             f.write(ntemp.InstNorm_template_FW(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'GroupNorm':
+            f.write(ntemp.GroupNorm_template_FW(layer, data_type_l[layer]))
         else:
             print("[deployment_utils.GenerateNet FW]: PULP layer not implemented or wrapped in DNN Deployer!")
             exit()
@@ -1403,6 +1479,8 @@ def GenerateNet(proj_folder_path, project_name,
             prev_sumnode = lay
         elif layers_l[lay]  == 'InstNorm':
             f.write(ntemp.InstNorm_template_BW(lay, data_type_l[lay]))
+        elif layers_l[lay] == 'GroupNorm':
+            f.write(ntemp.GroupNorm_template_BW(lay, data_type_l[lay]))
         else:
             print("[deployment_utils.GenerateNet BW]: PULP layer not implemented or wrapped in DNN Deployer!")
             exit()
@@ -1422,14 +1500,22 @@ def GenerateNet(proj_folder_path, project_name,
     f.write("\n// Compute loss and output gradient\n")
     f.write("void compute_loss()\n{\n")
 
-    if loss_fn == "MSELoss":
+    # PyTorch losses and the relative PULP-TrainLib primitives
+    loss_fn_l = {'MSELoss': "pulp_MSELoss", 'L1Loss': "pulp_L1Loss", 'HuberLoss': "pulp_HuberLoss",
+                 'SmoothL1Loss': "pulp_SmoothL1Loss", 'BCEWithLogitsLoss': "pulp_BCEWithLogitsLoss",
+                 'KLDivLoss': "pulp_KLDivLoss", 'CrossEntropyLoss': "pulp_SoftmaxCrossEntropyLoss"}
+    if loss_fn in loss_fn_l:
+        # The fused primitive takes the logits, as nn.CrossEntropyLoss (no Softmax layer is needed)
+        if loss_fn == "CrossEntropyLoss" and layers_l[-1] != 'linear':
+            print("[deployment_utils.GenerateNet]: CrossEntropyLoss requires a linear layer as last layer!")
+            exit()
         f.write("  loss_args.output = &layer"+str(len(layers_l)-1)+"_out;\n")
         f.write("  loss_args.target = LABEL;\n")
         f.write("  loss_args.wr_loss = &loss;\n")
         if data_type_l[-1] == 'FP32':
-            f.write("  pulp_MSELoss(&loss_args);\n")
+            f.write("  "+loss_fn_l[loss_fn]+"(&loss_args);\n")
         elif data_type_l[-1] == 'FP16':
-            f.write("  pulp_MSELoss_fp16(&loss_args);\n")
+            f.write("  "+loss_fn_l[loss_fn]+"_fp16(&loss_args);\n")
         else:
             print("[deplyment_utils.GenerateNet]: Invalid loss type!")
             exit()
@@ -1443,26 +1529,60 @@ def GenerateNet(proj_folder_path, project_name,
     f.write("\n// Function to update the network\n")
     f.write("void update_weights()\n{\n")
 
-    for layer in range(len(layers_l)):
-        if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm']:
-            if data_type_l[layer] == 'FP32':
-                f.write("  struct optim_args opt_l"+str(layer)+";\n")
-            elif data_type_l[layer] == 'FP16':
-                f.write("  struct optim_args_fp16 opt_l"+str(layer)+";\n")
-            else:
-                print("[deployment_utils.GenerateNet]: Invalid data type for optimizer structure generation @layer{}!".format(layer))  
-            f.write("  opt_l"+str(layer)+".weights = &layer"+str(layer)+"_wgt;\n")
-            f.write("  opt_l"+str(layer)+".learning_rate = LEARNING_RATE;\n")
-            if optimizer == "SGD":
-                if data_type_l[layer] == 'FP32':
-                    f.write("  pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp32, &opt_l"+str(layer)+");\n")
-                elif data_type_l[layer] == 'FP16':
-                    f.write("  pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp16, &opt_l"+str(layer)+");\n")
-                else:
-                    print("[deployment_utils.GenerateNet]: Invalid data type for gradient descent @Layer{}!".format(layer))
-            else:
-                print("[deployment_utils.GenerateNet]: Invalid optimizer for PULP deployment!!")
-                exit()
+    # All the parameters of the same data type are updated within a single fork
+    if optimizer == "SGD":
+        optim_fn = "pulp_momentum_sgd"
+    elif optimizer == "Adam":
+        optim_fn = "pulp_adam"
+    elif optimizer == "AdamW":
+        optim_fn = "pulp_adamw"
+    else:
+        print("[deployment_utils.GenerateNet]: Invalid optimizer for PULP deployment!!")
+        exit()
+    if optimizer in ['Adam', 'AdamW']:
+        f.write("  static int opt_step = 0;\n")
+        f.write("  opt_step++;\n")
+    if GRAD_CLIP_NORM > 0:
+        # The global norm is reduced within each optimizer call
+        if len(set([data_type_l[layer] for layer in range(len(layers_l)) if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm', 'GroupNorm']])) > 1:
+            print("[deployment_utils.GenerateNet]: Gradient clipping is not supported for mixed FP32/FP16 parameters!!")
+            exit()
+        f.write("  static PI_L1 float opt_norm_partials[NUM_CORES];\n")
+    for data_type, suffix in [('FP32', 'fp32'), ('FP16', 'fp16')]:
+        param_layers = [layer for layer in range(len(layers_l)) if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm', 'GroupNorm'] and data_type_l[layer] == data_type]
+        if len(param_layers) == 0:
+            continue
+        blob_type = "struct blob" if data_type == 'FP32' else "struct blob_fp16"
+        args_type = "struct optim_multi_args" if data_type == 'FP32' else "struct optim_multi_args_fp16"
+        f.write("\n  static "+blob_type+" * opt_wgt_"+suffix+"[] = {"+", ".join(["&layer"+str(layer)+"_wgt" for layer in param_layers])+"};\n")
+        if optimizer in ['Adam', 'AdamW']:
+            f.write("  static float * opt_m_"+suffix+"[] = {"+", ".join(["l"+str(layer)+"_ker_m" for layer in param_layers])+"};\n")
+            f.write("  static float * opt_v_"+suffix+"[] = {"+", ".join(["l"+str(layer)+"_ker_v" for layer in param_layers])+"};\n")
+        f.write("  "+args_type+" opt_"+suffix+";\n")
+        f.write("  opt_"+suffix+".weights = opt_wgt_"+suffix+";\n")
+        f.write("  opt_"+suffix+".n_tensors = "+str(len(param_layers))+";\n")
+        f.write("  opt_"+suffix+".learning_rate = LEARNING_RATE;\n")
+        if optimizer == "SGD":
+            f.write("  opt_"+suffix+".first_moment = NULL;\n")
+            f.write("  opt_"+suffix+".second_moment = NULL;\n")
+            f.write("  opt_"+suffix+".momentum = 0;\n")
+            f.write("  opt_"+suffix+".weight_decay = 0;\n")
+        else:
+            f.write("  opt_"+suffix+".first_moment = opt_m_"+suffix+";\n")
+            f.write("  opt_"+suffix+".second_moment = opt_v_"+suffix+";\n")
+            f.write("  opt_"+suffix+".beta1 = "+str(ADAM_BETA1)+";\n")
+            f.write("  opt_"+suffix+".beta2 = "+str(ADAM_BETA2)+";\n")
+            f.write("  opt_"+suffix+".epsilon = "+str(ADAM_EPS)+";\n")
+            f.write("  opt_"+suffix+".weight_decay = "+str(ADAM_WEIGHT_DECAY[optimizer])+";\n")
+            f.write("  opt_"+suffix+".step = opt_step;\n")
+        f.write("  opt_"+suffix+".max_grad_norm = "+str(GRAD_CLIP_NORM)+";\n")
+        f.write("  opt_"+suffix+".grad_norm = NULL;\n")
+        f.write("  opt_"+suffix+".norm_partials = "+("opt_norm_partials" if GRAD_CLIP_NORM > 0 else "NULL")+";\n")
+        if data_type == 'FP16':
+            f.write("  opt_"+suffix+".master_weights = NULL;\n")
+            f.write("  opt_"+suffix+".scaler = NULL;\n")
+            f.write("  opt_"+suffix+".rng_state = NULL;\n")
+        f.write("  pi_cl_team_fork(NUM_CORES, "+optim_fn+"_"+suffix+", &opt_"+suffix+");\n")
     f.write("}\n")
 
 
@@ -47,7 +47,7 @@ def max_layer_dim (layers_l, cin_l, hin_l, win_l, cout_l, hk_l, wk_l, data, h_st
             temp2 = cin_l[layer]*cout_l[layer]
         if layers_l[layer] == 'Sumnode':
             temp2 = cin_l[layer]*hin_l[layer]*win_l[layer]
-        if layers_l[layer] == 'InstNorm':
+        if layers_l[layer] in ['InstNorm', 'GroupNorm']:
             temp2 = 2*cin_l[layer]
         if layers_l[layer] in ['ReLU', 'Skipnode']:
             temp2 = 0
@@ -78,7 +78,7 @@ def GenerateNet(proj_folder_path, project_name,
                 layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                 h_str_l, w_str_l, h_pad_l, w_pad_l,
                 epochs, batch_size, learning_rate, optimizer, loss_fn,
-                data_type_l, sumnode_connections, MAX_LAYER_DIM):
+                data_type_l, sumnode_connections, num_groups_l, MAX_LAYER_DIM):
 
 
     data_type = data_type_l[0]
@@ -166,6 +166,7 @@ def GenerateNet(proj_folder_path, project_name,
         f.write("PI_L1 struct DepthWise_Conv_args DW_args;\n")
         f.write("PI_L1 struct act_args act_args;\n")
         f.write("PI_L1 struct InstNorm_args InstNorm_args;\n")
+        f.write("PI_L1 struct GroupNorm_args GroupNorm_args;\n")
         f.write("PI_L1 struct SkipConn_args resconn_args;\n")
         #f.write("PI_L1 float * t;\n")
     elif data_type == 'FP16':
@@ -184,6 +185,7 @@ def GenerateNet(proj_folder_path, project_name,
         f.write("PI_L1 struct DepthWise_Conv_args_fp16 DW_args;\n")
         f.write("PI_L1 struct act_args_fp16 act_args;\n")
         f.write("PI_L1 struct InstNorm_args_fp16 InstNorm_args;\n")
+        f.write("PI_L1 struct GroupNorm_args_fp16 GroupNorm_args;\n")
         f.write("PI_L1 struct SkipConn_args_fp16 resconn_args;\n")
         #f.write("PI_L1 fp16 * t;\n")
     else:
@@ -246,6 +248,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 struct SkipConn_args l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write(f"PI_L2 struct InstNorm_args l{layer}_args;\n")
+            elif layers_l[layer] == 'GroupNorm':
+                f.write(f"PI_L2 struct GroupNorm_args l{layer}_args;\n")
             else:
                 print("[deployment_utils.GenerateNet] Layer "+str(layer)+" not recognized!!")
         # Define FP16 structure
@@ -270,6 +274,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 struct SkipConn_args_fp16 l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write(f"PI_L2 struct InstNorm_args_fp16 l{layer}_args;\n")
+            elif layers_l[layer] == 'GroupNorm':
+                f.write(f"PI_L2 struct GroupNorm_args_fp16 l{layer}_args;\n")
             else:
                 print("[deployment_utils.GenerateNet] Layer "+str(layer)+" not recognized!!")
         # Invalid data type
@@ -302,7 +308,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 float l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L2 float l"+str(layer)+f"_ker[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L2 float l"+str(layer)+"_ker[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -312,7 +318,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 fp16 l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L2 fp16 l"+str(layer)+f"_ker[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L2 fp16 l"+str(layer)+"_ker[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -329,7 +335,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 float l"+str(layer)+"_ker_diff[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L2 float l"+str(layer)+f"_ker_diff[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L2 float l"+str(layer)+"_ker_diff[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -339,7 +345,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L2 fp16 l"+str(layer)+"_ker_diff[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 pass
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("PI_L2 fp16 l"+str(layer)+f"_ker_diff[2*Tin_C_l{layer}];\n")
             else:    
                 f.write("PI_L2 fp16 l"+str(layer)+"_ker_diff[Tin_C_l"+str(layer)+" * Tout_C_l"+str(layer)+" * Tker_H_l"+str(layer)+" * Tker_W_l"+str(layer)+"];\n")
@@ -473,6 +479,16 @@ def GenerateNet(proj_folder_path, project_name,
             print("[deployment_utils.GenerateNet] Invalid data type for pw transp buffer definition!\n")
             exit()
 
+    # Define the partial sums buffer, shared by all the GroupNorm layers (FP32 also for FP16 layers)
+    gn_groups = sorted(set([num_groups_l[layer] for layer in range(len(layers_l)) if layers_l[layer] == 'GroupNorm']))
+    if len(gn_groups) == 1:
+        f.write("\n// Define the partial sums buffer for all GroupNorm layers\n")
+        f.write("PI_L1 float gn_partials_buffer[GN_PARTIALS_SIZE("+str(gn_groups[0])+")];\n")
+    elif len(gn_groups) > 1:
+        # G*ceil(NUM_CORES/G) < G+NUM_CORES bounds the tiles of every layer
+        f.write("\n// Define the partial sums buffer for all GroupNorm layers\n")
+        f.write("PI_L1 float gn_partials_buffer[GN_PARTIALS*("+str(gn_groups[-1])+"+NUM_CORES)];\n")
+
 
     # Define tensors to backpropagate the output error
     f.write("\n// Define error propagation tensors\n")
@@ -575,9 +591,9 @@ def GenerateNet(proj_folder_path, project_name,
         if layer == 0:
             f.write("  // Layer "+str(layer)+"\n")
             f.write("  for(int i=0; i<Tin_C_l0*Tin_H_l0*Tin_W_l0; i++)\t\t\tl0_in[i] = INPUT[i];\n")
-            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm']:
+            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0; i++)\t\tl0_ker[i] = init_WGT_l0[i];\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         elif layer > 0 and layer < len(layers_l)-1:
             f.write("  // Layer "+str(layer)+"\n")
@@ -587,15 +603,15 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  //   Pooling kernel (no parameters)\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 f.write("  //   Resconn layer (no parameters)\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
             else:
                 f.write("  for(int i=0; i<Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         elif layer == len(layers_l)-1:
-            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm']:
+            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm', 'GroupNorm']:
                 f.write("  // Layer "+str(layer)+"\n")
                 f.write("  for(int i=0; i<Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
         else:
             print("[deployment_utils.GenerateNet]: Error in PULP layer initialization!")
@@ -636,7 +652,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_wgt.diff = l0_ker_diff;\n")
             if layers_l[layer] == 'DW':
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tker_H_l0*Tker_W_l0;\n")
-            elif layers_l[layer] == 'InstNorm':
+            elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                 f.write("  layer"+str(layer)+"_wgt.dim = 2*Tin_C_l0;\n")
             else:
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0;\n")
@@ -662,7 +678,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                elif layers_l[layer] == 'InstNorm':
+                elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                     f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -715,7 +731,7 @@ def GenerateNet(proj_folder_path, project_name,
                     f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                     if layers_l[layer] == 'DW':
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                    elif layers_l[layer] == 'InstNorm':
+                    elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                         f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                     else:
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -760,7 +776,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
-                elif layers_l[layer] == 'InstNorm':
+                elif layers_l[layer] in ['InstNorm', 'GroupNorm']:
                     f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -826,6 +842,8 @@ def GenerateNet(proj_folder_path, project_name,
             pass
         elif layers_l[layer] == 'InstNorm':
             f.write(ntemp.InstNorm_config_template(layer, skip_inputgrad))
+        elif layers_l[layer] == 'GroupNorm':
+            f.write(ntemp.GroupNorm_config_template(layer, skip_inputgrad, num_groups_l[layer]))
         else:
             print("[deployment_utils.GenerateNet] Undefined layer "+str(layer)+" (unable to write configuration structure)!!")
         if sumnode_connections[layer] != -1 and layers_l[layer] != 'Sumnode':
@@ -953,6 +971,8 @@ def GenerateNet(proj_folder_path, project_name,
             f.write(ntemp.residualconn_template_FW(layer, data_type_l[layer]))
         elif layers_l[layer]  == 'InstNorm':
             f.write(ntemp.InstNorm_template_FW(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'GroupNorm':
+            f.write(ntemp.GroupNorm_template_FW(layer, data_type_l[layer]))
         else:
             print("[deployment_utils.GenerateNet]: PULP layer not implemented or wrapped in DNN Deployer!")
             exit()
@@ -1086,6 +1106,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write(ntemp.MaxPool_template_BW(lay, data_type_l[lay]))
             elif layers_l[lay]  == 'InstNorm':
                 f.write(ntemp.InstNorm_template_BW(lay, data_type_l[lay]))
+            elif layers_l[lay] == 'GroupNorm':
+                f.write(ntemp.GroupNorm_template_BW(lay, data_type_l[lay]))
 
             # Store dW 
             f.write(f"\tstore((uint32_t) w{output_buffer}_blob.diff, (uint32_t) layer{lay}_wgt.diff, {bytes_per_data}*layer{lay}_wgt.dim);\n")
@@ -1108,6 +1130,8 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write(ntemp.MaxPool_template_BW(lay, data_type_l[lay]))
             elif layers_l[lay]  == 'InstNorm':
                 f.write(ntemp.InstNorm_template_BW(lay, data_type_l[lay]))
+            elif layers_l[lay] == 'GroupNorm':
+                f.write(ntemp.GroupNorm_template_BW(lay, data_type_l[lay]))
 
             if is_skipderivation:
                 f.write(ntemp.sum(lay, layers_l[lay] == 'Skipnode', current_buffer, output_buffer, data_type_l[lay]))
@@ -1222,7 +1246,7 @@ def GenerateNet(proj_folder_path, project_name,
     layers_with_weights = []
     
     for layer in range(len(layers_l)):
-        if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm']:
+        if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm', 'GroupNorm']:
             layers_with_weights.append(layer)
     print(layers_with_weights)
 
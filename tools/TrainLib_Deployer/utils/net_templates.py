@@ -231,6 +231,20 @@ def InstNorm_template_BW(layer_number, data_type):
         template = "  pulp_instnorm_fp16_bw_cl(&l"+str(layer_number)+"_args);\n"
     return template
 
+def GroupNorm_template_FW(layer_number, data_type):
+    if data_type == 'FP32':
+        template = "  pulp_groupnorm_fp32_fw_cl(&l"+str(layer_number)+"_args);\n"
+    elif data_type == 'FP16':
+        template = "  pulp_groupnorm_fp16_fw_cl(&l"+str(layer_number)+"_args);\n"
+    return template
+
+def GroupNorm_template_BW(layer_number, data_type):
+    if data_type == 'FP32':
+        template = "  pulp_groupnorm_fp32_bw_cl(&l"+str(layer_number)+"_args);\n"
+    elif data_type == 'FP16':
+        template = "  pulp_groupnorm_fp16_bw_cl(&l"+str(layer_number)+"_args);\n"
+    return template
+
 """
 TYPE CHANGE TEMPLATES
 """
@@ -421,4 +435,13 @@ def InstNorm_config_template(layer_number, skip_in_grad):
     template += "  l"+str(layer_number)+"_args.coeff = &layer"+str(layer_number)+"_wgt;\n"
     template += "  l"+str(layer_number)+"_args.output = &layer"+str(layer_number)+"_out;\n"
     template += "  l"+str(layer_number)+"_args.skip_in_grad = "+str(skip_in_grad)+";\n"
+    return template
+
+def GroupNorm_config_template(layer_number, skip_in_grad, num_groups):
+    template  = "  l"+str(layer_number)+"_args.input = &layer"+str(layer_number)+"_in;\n"
+    template += "  l"+str(layer_number)+"_args.coeff = &layer"+str(layer_number)+"_wgt;\n"
+    template += "  l"+str(layer_number)+"_args.output = &layer"+str(layer_number)+"_out;\n"
+    template += "  l"+str(layer_number)+"_args.skip_in_grad = "+str(skip_in_grad)+";\n"
+    template += "  l"+str(layer_number)+"_args.num_groups = "+str(num_groups)+";\n"
+    template += "  l"+str(layer_number)+"_args.partials_buffer = gn_partials_buffer;\n"
     return template
\ No newline at end of file
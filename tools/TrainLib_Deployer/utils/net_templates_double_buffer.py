@@ -278,6 +278,26 @@ def InstNorm_template_BW(layer_number, data_type):
         exit()  
     return template
 
+def GroupNorm_template_FW(layer_number, data_type):
+    if data_type == 'FP32':
+        template = "\tpulp_groupnorm_fp32_fw_cl(&GroupNorm_args);\n"
+    elif data_type == 'FP16':
+        template = "\tpulp_groupnorm_fp16_fw_cl(&GroupNorm_args);\n"
+    else:
+        print("[net_templates.GroupNorm_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def GroupNorm_template_BW(layer_number, data_type):
+    if data_type == 'FP32':
+        template = "\tpulp_groupnorm_fp32_bw_cl(&GroupNorm_args);\n"
+    elif data_type == 'FP16':
+        template = "\tpulp_groupnorm_fp16_bw_cl(&GroupNorm_args);\n"
+    else:
+        print("[net_templates.GroupNorm_template_BW]: Invalid data type!")
+        exit()  
+    return template
+
 
 
 """
@@ -467,4 +487,13 @@ def InstNorm_config_template(layer_number, skip_in_grad):
     template += "  l"+str(layer_number)+"_args.coeff = &wgt;\n"
     template += "  l"+str(layer_number)+"_args.output = &out;\n"
     template += "  l"+str(layer_number)+"_args.skip_in_grad = "+str(skip_in_grad)+";\n"
+    return template
+
+def GroupNorm_config_template(layer_number, skip_in_grad, num_groups):
+    template  = "  l"+str(layer_number)+"_args.input = &in;\n"
+    template += "  l"+str(layer_number)+"_args.coeff = &wgt;\n"
+    template += "  l"+str(layer_number)+"_args.output = &out;\n"
+    template += "  l"+str(layer_number)+"_args.skip_in_grad = "+str(skip_in_grad)+";\n"
+    template += "  l"+str(layer_number)+"_args.num_groups = "+str(num_groups)+";\n"
+    template += "  l"+str(layer_number)+"_args.partials_buffer = gn_partials_buffer;\n"
     return template
\ No newline at end of file